@@ -18,6 +18,10 @@ describe('wasm', () => {
       Matrix.matmul_(a, b, c)
       assert.deepStrictEqual(c.data(), new Float32Array([3 + 10, 6 + 12 + 25, 12 + 21 + 40]))
 
+      // c = 2 a b - c
+      Matrix.gemm(2, a, b, -1, c)
+      assert.deepStrictEqual(c.data(), new Float32Array([3 + 10, 6 + 12 + 25, 12 + 21 + 40]))
+
       a.delete()
       b.delete()
       c.delete()
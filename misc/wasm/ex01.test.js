@@ -20,6 +20,12 @@ describe('wasm', () => {
       const c = MatrixCSR.matmul(a, b)
       assert.deepStrictEqual(c.data(), new Float32Array([3, 19, 8, 15]))
 
+      // Overwrite and accumulate
+      MatrixCSR.matmul_(a, b, c)
+      assert.deepStrictEqual(c.data(), new Float32Array([3, 19, 8, 15]))
+      MatrixCSR.matmulAdd_(a, b, c)
+      assert.deepStrictEqual(c.data(), new Float32Array([6, 38, 16, 30]))
+
       a.delete()
       b.delete()
       c.delete()
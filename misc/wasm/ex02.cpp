@@ -25,6 +25,30 @@ struct Buffer {
   float sum_sse() {
     return impl::sum_sse(data_);
   }
+
+  float sum_kahan() {
+    return impl::sum_kahan(data_);
+  }
+
+  float sum_pairwise() {
+    return impl::sum_pairwise(data_);
+  }
+
+  float dot(const Buffer& other) {
+    return impl::dot(data_, other.data_);
+  }
+
+  float min() {
+    return impl::min(data_);
+  }
+
+  float max() {
+    return impl::max(data_);
+  }
+
+  float norm2() {
+    return impl::norm2(data_);
+  }
 };
 
 EMSCRIPTEN_BINDINGS(ex02) {
@@ -32,5 +56,11 @@ EMSCRIPTEN_BINDINGS(ex02) {
     .constructor<size_t>()
     .function("data", &Buffer::data)
     .function("sum", &Buffer::sum)
-    .function("sum_sse", &Buffer::sum_sse);
+    .function("sum_sse", &Buffer::sum_sse)
+    .function("sum_kahan", &Buffer::sum_kahan)
+    .function("sum_pairwise", &Buffer::sum_pairwise)
+    .function("dot", &Buffer::dot)
+    .function("min", &Buffer::min)
+    .function("max", &Buffer::max)
+    .function("norm2", &Buffer::norm2);
 }
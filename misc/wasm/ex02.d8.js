@@ -11,6 +11,10 @@ const main = async () => {
       if (sum !== i) {
         console.log('Test failed:', sum, i)
       }
+      const dot = buf.dot(buf)
+      if (dot !== i || buf.sum_kahan() !== i || buf.sum_pairwise() !== i) {
+        console.log('Test failed:', dot, i)
+      }
       buf.delete()
     }
   }
@@ -24,6 +28,7 @@ const main = async () => {
     console.log('buf.sum_sse() =', buf.sum_sse())
     console.log('[timeit] buf.sum()     =>', timeit(() => buf.sum(), 200, 5))
     console.log('[timeit] buf.sum_sse() =>', timeit(() => buf.sum_sse(), 400, 5))
+    console.log('[timeit] buf.dot(buf)  =>', timeit(() => buf.dot(buf), 400, 5))
 
     buf.delete()
   }
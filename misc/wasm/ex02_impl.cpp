@@ -1,43 +1,45 @@
+#include <algorithm>
 #include <cstdint>
 #include <vector>
-#include <xmmintrin.h>
+#include "ex05/reduce.hpp" // reduce::sum etc...
 
 using std::vector;
 
 namespace impl {
   float sum(const vector<float>& v) {
     float result = 0;
-    for (auto i = 0; i < v.size(); i++) {
+    for (size_t i = 0; i < v.size(); i++) {
       result += v[i];
     }
     return result;
   }
 
+  // SSE/simd128 depending on compiler flags (cf. ex05/simd.hpp)
   float sum_sse(const vector<float>& v) {
-    auto ptr = v.data();
-    auto end = ptr + v.size();
-    auto end_sse = end - ((uintptr_t)end % 16) / 4;
+    return reduce::sum(v.data(), v.size());
+  }
 
-    float result = 0;
+  float sum_kahan(const vector<float>& v) {
+    return reduce::sumKahan(v.data(), v.size());
+  }
 
-    // Before 16 bytes block
-    while (((uintptr_t)ptr % 16 == 0) && ptr < end) {
-      result += *ptr++;
-    }
+  float sum_pairwise(const vector<float>& v) {
+    return reduce::sumPairwise(v.data(), v.size());
+  }
 
-    // 16 bytes block
-    __m128 resultv = {0, 0, 0, 0};
-    while (ptr < end) {
-      resultv += *reinterpret_cast<const __m128*>(ptr);
-      ptr += 4;
-    }
-    result += resultv[0] + resultv[1] + resultv[2] + resultv[3];
+  float dot(const vector<float>& v, const vector<float>& w) {
+    return reduce::dot(v.data(), w.data(), std::min(v.size(), w.size()));
+  }
 
-    // After 16 bytes block
-    while (ptr < end) {
-      result += *ptr++;
-    }
+  float min(const vector<float>& v) {
+    return reduce::min(v.data(), v.size());
+  }
 
-    return result;
+  float max(const vector<float>& v) {
+    return reduce::max(v.data(), v.size());
+  }
+
+  float norm2(const vector<float>& v) {
+    return reduce::norm2(v.data(), v.size());
   }
 }
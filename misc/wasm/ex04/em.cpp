@@ -1,7 +1,7 @@
 #include <emscripten.h>
 #include <emscripten/bind.h>
 #include <emscripten/val.h>
-#include "misc.hpp" // sum, sum_parallel
+#include "misc.hpp" // sum, sum_parallel, scheduler
 
 using namespace emscripten;
 
@@ -15,4 +15,6 @@ EMSCRIPTEN_BINDINGS(ex04) {
     .function("data", &Vector_data<float>)
     .function("sum", &sum)
     .function("sum_parallel", &sum_parallel);
+
+  function("setNumThreads", &scheduler::setNumThreads);
 }
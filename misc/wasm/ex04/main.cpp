@@ -6,5 +6,7 @@ int main() {
   std::vector<float> v{1 << 20, 1.0f};
   printf("sum = %f\n", sum(v));
   printf("sum_parallel = %f\n", sum_parallel(v));
+  scheduler::setNumThreads(2);
+  printf("sum_parallel (2 threads) = %f\n", sum_parallel(v));
   return 0;
 }
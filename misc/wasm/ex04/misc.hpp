@@ -1,5 +1,6 @@
 #include <vector>
-#include <thread>
+#include "../ex05/scheduler.hpp" // Scheduler
+#include "../ex05/reduce.hpp" // reduce::sum
 
 void sum_ptr(const float* ptr, const float* end, float* result) {
   while (ptr < end) {
@@ -14,15 +15,13 @@ float sum(const std::vector<float>& v) {
 }
 
 float sum_parallel(const std::vector<float>& v) {
-  auto begin = v.begin();
-  auto size = v.size();
-  auto middle = begin + size / 2;
-  auto end = begin + size;
-  float result1 = 0.0f;
-  float result2 = 0.0f;
-  std::thread t1(sum_ptr, &*begin, &*middle, &result1);
-  std::thread t2(sum_ptr, &*middle, &*end, &result2);
-  t1.join();
-  t2.join();
-  return result1 + result2;
+  // Work-stealing fork/join on persistent workers (cf. scheduler::setNumThreads).
+  // Small arrays stay in a single leaf so that they don't pay for tasks at all.
+  constexpr size_t kMinGrain = 1 << 14;
+  auto& scheduler = scheduler::getDefault();
+  const float* ptr = v.data();
+  size_t grain = std::max(kMinGrain, scheduler.defaultGrain(v.size()));
+  return scheduler.parallelReduce<float>(0, v.size(), grain, 0.0f,
+      [&](size_t i_begin, size_t i_end) { return reduce::sum(ptr + i_begin, i_end - i_begin); },
+      [](float a, float b) { return a + b; });
 }
@@ -23,11 +23,14 @@ const measure = (func, r = 32) => {
 describe('wasm', () => {
   describe('ex04', () => {
     it('works', async () => {
-      const { Vectorf } = await requireEm('./ex04/build/Release/em.js') // relative to ./utils.js
+      const { Vectorf, setNumThreads } = await requireEm('./ex04/build/Release/em.js') // relative to ./utils.js
       const a = new Vectorf()
       a.resize(2 ** 24, 1)
       const data = a.data()
-      console.log('sum_parallel:', measure(() => a.sum_parallel()))
+      for (const n of [1, 2, 4]) {
+        setNumThreads(n)
+        console.log(`sum_parallel (${n}):`, measure(() => a.sum_parallel()))
+      }
       console.log('sum:         ', measure(() => a.sum()))
       console.log('sum (js):    ', measure(() => sum(data)))
       a.delete()
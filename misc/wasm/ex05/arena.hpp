@@ -0,0 +1,164 @@
+#pragma once
+
+//
+// Allocators for solver temporaries so that steady state (e.g. each simulation step) doesn't touch the heap
+//   - Arena      : bump allocator for trivially destructible temporaries.
+//                  `Scope` rewinds to where it started (nested scopes follow stack order) and
+//                  after the arena has grown, rewinding to empty merges blocks into one block of the peak size,
+//                  thus from the second frame on nothing is allocated.
+//   - BufferPool : recycles std::vector<T> buffers (capacity is kept) for APIs returning Matrix<T> etc...
+//                  (cf. Matrix<T>::matmul(a, b, pool)).
+//   - threadArena() is per-thread arena used by kernels for small scratch (e.g. ThreadPool::parallelReduce).
+//
+
+#include <algorithm>
+#include <cassert>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <type_traits>
+#include <vector>
+
+namespace arena {
+
+struct Arena {
+  static constexpr size_t kDefaultBlockSize = 1 << 16;
+
+  struct Block {
+    std::unique_ptr<std::byte[]> data;
+    size_t size = 0;
+  };
+
+  std::vector<Block> blocks_;
+  size_t block_ = 0;   // current block
+  size_t offset_ = 0;  // offset in current block
+  size_t used_ = 0;    // bytes in use (including alignment padding)
+  size_t peak_ = 0;
+
+  struct Marker {
+    size_t block = 0;
+    size_t offset = 0;
+    size_t used = 0;
+  };
+
+  Arena(size_t block_size = kDefaultBlockSize) {
+    blocks_.reserve(32);
+    addBlock(block_size);
+  }
+
+  Arena(const Arena&) = delete;
+  Arena& operator=(const Arena&) = delete;
+
+  size_t used() const { return used_; }
+  size_t peak() const { return peak_; }
+
+  size_t capacity() const {
+    size_t result = 0;
+    for (auto& block : blocks_) { result += block.size; }
+    return result;
+  }
+
+  void addBlock(size_t size) {
+    blocks_.push_back({std::make_unique<std::byte[]>(size), size});
+  }
+
+  void* allocateBytes(size_t size, size_t align) {
+    assert(align > 0 && (align & (align - 1)) == 0);
+    while (true) {
+      auto& block = blocks_[block_];
+      auto base = reinterpret_cast<uintptr_t>(block.data.get());
+      size_t begin = ((base + offset_ + align - 1) & ~(align - 1)) - base;
+      if (begin + size <= block.size) {
+        used_ += begin + size - offset_;
+        peak_ = std::max(peak_, used_);
+        offset_ = begin + size;
+        return block.data.get() + begin;
+      }
+      // Next block (new one is at least twice the last one)
+      used_ += block.size - offset_;
+      if (block_ + 1 == blocks_.size()) {
+        addBlock(std::max(2 * blocks_.back().size, size + align));
+      }
+      block_++;
+      offset_ = 0;
+    }
+  }
+
+  // Uninitialized storage for n objects
+  template<typename T>
+  T* allocate(size_t n) {
+    static_assert(std::is_trivially_destructible_v<T>, "Arena doesn't run destructors");
+    return static_cast<T*>(allocateBytes(std::max<size_t>(1, n) * sizeof(T), alignof(T)));
+  }
+
+  Marker mark() const { return {block_, offset_, used_}; }
+
+  void rewind(const Marker& marker) {
+    block_ = marker.block;
+    offset_ = marker.offset;
+    used_ = marker.used;
+    if (used_ == 0 && blocks_.size() > 1) {
+      // Replace blocks with single block of the peak usage (happens only after growth)
+      size_t size = std::max(peak_, blocks_.front().size);
+      blocks_.clear();
+      addBlock(size);
+    }
+  }
+
+  void reset() { rewind({}); }
+};
+
+// Rewinds arena when going out of scope
+struct Scope {
+  Arena& arena_;
+  Arena::Marker marker_;
+
+  Scope(Arena& arena) : arena_{arena}, marker_{arena.mark()} {}
+  ~Scope() { arena_.rewind(marker_); }
+  Scope(const Scope&) = delete;
+  Scope& operator=(const Scope&) = delete;
+
+  template<typename T>
+  T* allocate(size_t n) { return arena_.allocate<T>(n); }
+};
+
+inline Arena& threadArena() {
+  static thread_local Arena result;
+  return result;
+}
+
+template<typename T>
+struct BufferPool {
+  std::vector<std::vector<T>> free_;
+
+  // Buffer of size n (content is unspecified) preferring the smallest one with enough capacity
+  std::vector<T> acquire(size_t n) {
+    size_t best = free_.size();
+    for (size_t i = 0; i < free_.size(); i++) {
+      auto capacity = free_[i].capacity();
+      if (capacity >= n && (best == free_.size() || capacity < free_[best].capacity())) { best = i; }
+    }
+    if (best == free_.size() && !free_.empty()) {
+      best = 0; // reuse (and grow) any buffer rather than keeping more buffers around
+    }
+    std::vector<T> result;
+    if (best < free_.size()) {
+      result = std::move(free_[best]);
+      free_[best] = std::move(free_.back());
+      free_.pop_back();
+    }
+    result.resize(n);
+    return result;
+  }
+
+  void release(std::vector<T>&& buffer) {
+    if (free_.size() == free_.capacity()) {
+      free_.reserve(std::max<size_t>(8, 2 * free_.size()));
+    }
+    free_.push_back(std::move(buffer));
+  }
+
+  size_t size() const { return free_.size(); }
+};
+
+} // namespace arena
@@ -0,0 +1,36 @@
+//
+// Compare two JSON outputs of "bench --json" (e.g. before/after a commit)
+//
+//   node misc/wasm/ex05/bench-compare.js base.json new.json [threshold = 0.1]
+//
+// Exits with 1 when some benchmark becomes slower by more than `threshold` (relative time)
+//
+
+const fs = require('fs')
+
+const main = () => {
+  const [basePath, newPath, thresholdArg] = process.argv.slice(2)
+  if (!basePath || !newPath) {
+    console.log('Usage: node bench-compare.js <base.json> <new.json> [threshold]')
+    process.exit(2)
+  }
+  const threshold = Number(thresholdArg || 0.1)
+  const load = (path) => JSON.parse(fs.readFileSync(path)).benchmarks
+  const baseMap = new Map(load(basePath).map(b => [b.name, b]))
+
+  let numRegressions = 0
+  for (const b of load(newPath)) {
+    const a = baseMap.get(b.name)
+    if (!a) { continue }
+    const change = b.real_time / a.real_time - 1
+    const regression = change > threshold
+    numRegressions += regression ? 1 : 0
+    const mark = regression ? ' <-- regression' : ''
+    console.log(
+      `${b.name.padEnd(40)} ${(a.real_time / 1e3).toFixed(3).padStart(14)} us ` +
+      `${(b.real_time / 1e3).toFixed(3).padStart(14)} us ${(100 * change).toFixed(1).padStart(7)} %${mark}`)
+  }
+  process.exit(numRegressions > 0 ? 1 : 0)
+}
+
+main()
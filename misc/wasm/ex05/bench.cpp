@@ -0,0 +1,716 @@
+//
+// Benchmark suite of misc/wasm kernels (cf. bench.hpp)
+//
+//   bench --filter "solve|svd" --threads 1,2,4 --json result.json
+//
+
+#include <cstdio>
+#include <filesystem>
+#include <tuple>
+#include <vector>
+#include "misc.hpp"
+#include "format.hpp"
+#include "rng.hpp"
+#include "thread_pool.hpp"
+#include "matrix.hpp"
+#include "bench.hpp"
+#include "reduce.hpp"
+#include "cholesky.hpp"
+#include "refinement.hpp"
+#include "gauss_seidel.hpp"
+#include "pcg.hpp"
+#include "ddg.hpp"
+#include "reader.hpp"
+#include "cache.hpp"
+#include "delaunay.hpp"
+#include "graph.hpp"
+#include "collision.hpp"
+#include "trace.hpp"
+#include "../ex04/misc.hpp" // sum_parallel
+#if defined(USE_DISPATCH)
+#include "dispatch.hpp"
+#endif
+
+using glm::vec3, glm::mat3;
+
+constexpr float kIdentity[4] = {0, 0, 0, 1}; // quaternion
+
+// Random 3x3 matrices packed as 9 floats each
+std::vector<float> randomMat3(size_t n, Rng& rng) {
+  std::vector<float> result(9 * n);
+  for (auto& v : result) { v = rng.uniform(); }
+  return result;
+}
+
+// 7-point Laplacian on n x n x n grid
+MatrixCSR<float> gridLaplacian(size_t n) {
+  size_t N = n * n * n;
+  std::vector<size_t> rows, cols;
+  std::vector<float> values;
+  for (size_t x = 0; x < n; x++) {
+    for (size_t y = 0; y < n; y++) {
+      for (size_t z = 0; z < n; z++) {
+        size_t i = (x * n + y) * n + z;
+        auto add = [&](size_t x2, size_t y2, size_t z2, float v) {
+          if (x2 >= n || y2 >= n || z2 >= n) { return; }
+          rows.push_back(i);
+          cols.push_back((x2 * n + y2) * n + z2);
+          values.push_back(v);
+        };
+        add(x, y, z, 6.01);
+        add(x - 1, y, z, -1); add(x + 1, y, z, -1);
+        add(x, y - 1, z, -1); add(x, y + 1, z, -1);
+        add(x, y, z - 1, -1); add(x, y, z + 1, -1);
+      }
+    }
+  }
+  return MatrixCSR<float>::fromCOO(N, N, rows, cols, values);
+}
+
+// Triangulated n x n grid on unit square (z = 0.1 sin(x) sin(y) so that cotans vary)
+void makeGridMesh(size_t n, std::vector<float>& verts, std::vector<uint32_t>& f2v) {
+  verts.clear();
+  f2v.clear();
+  for (size_t j = 0; j <= n; j++) {
+    for (size_t i = 0; i <= n; i++) {
+      float x = float(i) / n, y = float(j) / n;
+      verts.insert(verts.end(), {x, y, 0.1f * std::sin(7 * x) * std::sin(5 * y)});
+    }
+  }
+  for (size_t j = 0; j < n; j++) {
+    for (size_t i = 0; i < n; i++) {
+      auto v0 = uint32_t(j * (n + 1) + i), v1 = v0 + 1, v2 = v0 + uint32_t(n + 1), v3 = v2 + 1;
+      f2v.insert(f2v.end(), {v0, v1, v3, v0, v3, v2});
+    }
+  }
+}
+
+// Torus with n x n grid of quads split into two triangles (closed genus 1)
+void makeTorusMesh(size_t n, std::vector<float>& verts, std::vector<uint32_t>& f2v) {
+  verts.clear();
+  f2v.clear();
+  for (size_t j = 0; j < n; j++) {
+    for (size_t i = 0; i < n; i++) {
+      float p = 2 * ddg::kPi * i / n, t = 2 * ddg::kPi * j / n;
+      float r = 1 + 0.3f * std::cos(t);
+      verts.insert(verts.end(), {r * std::cos(p), r * std::sin(p), 0.3f * std::sin(t)});
+    }
+  }
+  auto vertex = [&](size_t i, size_t j) { return uint32_t((j % n) * n + i % n); };
+  for (size_t j = 0; j < n; j++) {
+    for (size_t i = 0; i < n; i++) {
+      auto v0 = vertex(i, j), v1 = vertex(i + 1, j), v2 = vertex(i, j + 1), v3 = vertex(i + 1, j + 1);
+      f2v.insert(f2v.end(), {v0, v1, v3, v0, v3, v2});
+    }
+  }
+}
+
+// n x n x n grid on unit cube with 6 tetrahedra per cell (Kuhn subdivision along the main diagonal)
+void makeTetGrid(size_t n, std::vector<float>& verts, std::vector<uint32_t>& c3xc0) {
+  verts.clear();
+  c3xc0.clear();
+  auto index = [n](size_t i, size_t j, size_t k) { return uint32_t((k * (n + 1) + j) * (n + 1) + i); };
+  for (size_t k = 0; k <= n; k++) {
+    for (size_t j = 0; j <= n; j++) {
+      for (size_t i = 0; i <= n; i++) {
+        verts.insert(verts.end(), {float(i) / n, float(j) / n, float(k) / n});
+      }
+    }
+  }
+  size_t axes[6][3] = {{0, 1, 2}, {0, 2, 1}, {1, 0, 2}, {1, 2, 0}, {2, 0, 1}, {2, 1, 0}};
+  for (size_t k = 0; k < n; k++) {
+    for (size_t j = 0; j < n; j++) {
+      for (size_t i = 0; i < n; i++) {
+        for (auto& axis : axes) {
+          size_t c[3] = {i, j, k};
+          c3xc0.push_back(index(c[0], c[1], c[2]));
+          for (auto a : axis) {
+            c[a]++;
+            c3xc0.push_back(index(c[0], c[1], c[2]));
+          }
+        }
+      }
+    }
+  }
+}
+
+void registerBenchmarks() {
+  // misc::jacobi3 (symmetric 3x3 eigen decomposition)
+  bench::add("jacobi3", {1 << 12, 1 << 16}, false, [](bench::State& state) {
+    Rng rng;
+    auto data = randomMat3(state.size, rng);
+    auto As = std::make_shared<std::vector<mat3>>(state.size);
+    for (size_t i = 0; i < state.size; i++) {
+      mat3 A = *reinterpret_cast<const mat3*>(&data[9 * i]);
+      (*As)[i] = glm::transpose(A) * A;
+    }
+    state.items = state.size;
+    return [As]() {
+      for (auto A : *As) {
+        mat3 Q;
+        misc::jacobi3(A, Q);
+        asm volatile("" : : "r"(&Q) : "memory");
+      }
+    };
+  });
+
+  // misc::svd
+  bench::add("svd", {1 << 12, 1 << 16}, false, [](bench::State& state) {
+    Rng rng;
+    auto data = std::make_shared<std::vector<float>>(randomMat3(state.size, rng));
+    state.items = state.size;
+    return [data, n = state.size]() {
+      for (size_t i = 0; i < n; i++) {
+        mat3 U, VT;
+        vec3 D;
+        misc::svd(*reinterpret_cast<const mat3*>(&(*data)[9 * i]), U, VT, D);
+        asm volatile("" : : "r"(&U), "r"(&VT), "r"(&D) : "memory");
+      }
+    };
+  });
+
+  // misc::solveScalar vs misc::solve (batched svdProjection)
+  for (auto batched : {false, true}) {
+    bench::add(batched ? "solve" : "solveScalar", {1 << 12, 1 << 16}, batched, [batched](bench::State& state) {
+      Rng rng;
+      auto u1 = std::make_shared<std::vector<float>>(randomMat3(state.size, rng));
+      auto u2 = std::make_shared<std::vector<float>>(randomMat3(state.size, rng));
+      auto p = std::make_shared<std::vector<float>>(9 * state.size);
+      state.items = state.size;
+      state.bytes = 3 * 9 * 4 * state.size;
+      return [=]() {
+        if (batched) {
+          misc::solve(*u1, *u2, *p);
+        } else {
+          misc::solveScalar(*u1, *u2, *p);
+        }
+      };
+    });
+  }
+
+  // misc::solvePolar (quaternion polar decomposition) warm-started with 1 iteration or from identity with 2 or 6
+  for (auto [name, iteration, rotate] : {std::tuple{"solvePolar (warm, 1 iteration)", 1, false},
+                                         std::tuple{"solvePolar (cold, 2 iterations)", 2, false},
+                                         std::tuple{"solvePolar (cold large rotation, 6 iterations)", 6, true}}) {
+    bench::add(name, {1 << 12, 1 << 16}, true, [iteration = iteration, rotate = rotate](bench::State& state) {
+      Rng rng;
+      size_t n = state.size;
+      auto u1 = std::make_shared<std::vector<float>>(9 * n);
+      auto u2 = std::make_shared<std::vector<float>>(9 * n);
+      auto q = std::make_shared<std::vector<float>>(4 * n);
+      auto p = std::make_shared<std::vector<float>>(9 * n);
+      for (size_t i = 0; i < 9 * n; i++) {
+        (*u2)[i] = ((i % 9) % 4 == 0) + 0.5 * (rng.uniform() - 0.5);
+        (*u1)[i] = (*u2)[i] + 0.2 * (rng.uniform() - 0.5);
+      }
+      for (size_t i = 0; rotate && i < n; i++) {
+        float r[4] = {rng.uniform() - 0.5f, rng.uniform() - 0.5f, rng.uniform() - 0.5f, 0.1f};
+        float l = std::sqrt(r[0] * r[0] + r[1] * r[1] + r[2] * r[2] + r[3] * r[3]);
+        for (auto& v : r) { v /= l; }
+        float R[3][3];
+        misc::quatToMat(r, R);
+        auto& A = *reinterpret_cast<mat3*>(&(*u1)[9 * i]);
+        A = mat3(R[0][0], R[0][1], R[0][2], R[1][0], R[1][1], R[1][2], R[2][0], R[2][1], R[2][2]) * A;
+      }
+      auto reset = [=]() {
+        for (size_t i = 0; i < n; i++) { std::copy_n(&kIdentity[0], 4, &(*q)[4 * i]); }
+      };
+      reset();
+      if (iteration == 1) { misc::solvePolar(*u1, *u2, *q, *p, 2, 0); } // converged rotations
+      state.items = n;
+      state.bytes = (3 * 9 + 2 * 4) * 4 * n;
+      return [=]() {
+        if (iteration > 1) { reset(); }
+        misc::solvePolar(*u1, *u2, *q, *p, iteration, 0);
+      };
+    });
+  }
+
+  // Matrix::matmul_ (dense GEMM) vs Matrix::matmulNaive_ (triple loop) on n x n
+  // (naive stops at 1024 since a single 2048 product takes tens of seconds)
+  auto addMatmul = [](const char* name, const std::vector<size_t>& sizes, bool threaded, auto func) {
+    bench::add(name, sizes, threaded, [func](bench::State& state) {
+      size_t n = state.size;
+      Rng rng;
+      auto a = std::make_shared<Matrix<float>>(n, n);
+      auto b = std::make_shared<Matrix<float>>(n, n);
+      auto c = std::make_shared<Matrix<float>>(n, n);
+      for (auto& v : a->data_) { v = rng.uniform(); }
+      for (auto& v : b->data_) { v = rng.uniform(); }
+      state.flops = 2.0 * n * n * n;
+      state.bytes = 3.0 * 4 * n * n;
+      return [=]() { func(*a, *b, *c); };
+    });
+  };
+  addMatmul("Matrix::matmulNaive_", {16, 32, 64, 128, 256, 512, 1024}, false, &Matrix<float>::matmulNaive_);
+  addMatmul("Matrix::matmul_", {16, 32, 64, 128, 256, 512, 1024, 2048}, true,
+            [](const Matrix<float>& a, const Matrix<float>& b, Matrix<float>& c) { Matrix<float>::matmul_(a, b, c); });
+
+  // MatrixCSR::matmul_ (SpMM with 3 columns) vs serial MatrixCSR::matmulNaive_
+  // on grid Laplacian of n^3 rows and on cotan Laplacian of n x n torus (ddg::computeLaplacian)
+  auto torusLaplacian = [](size_t n) {
+    std::vector<float> verts;
+    std::vector<uint32_t> f2v;
+    makeTorusMesh(n, verts, f2v);
+    ddg::Mesh mesh{verts.size() / 3, f2v.size() / 3};
+    mesh.verts_.data_ = verts;
+    mesh.topology_.f2v_ = f2v;
+    mesh.init();
+    return mesh.laplacian_;
+  };
+  auto addSpmm = [](const char* name, const std::vector<size_t>& sizes, bool threaded, auto makeA, auto func) {
+    bench::add(name, sizes, threaded, [makeA, func](bench::State& state) {
+      auto A = std::make_shared<MatrixCSR<float>>(makeA(state.size));
+      size_t N = A->shape_[0];
+      auto x = std::make_shared<Matrix<float>>(N, 3);
+      auto y = std::make_shared<Matrix<float>>(N, 3);
+      std::fill(x->data_.begin(), x->data_.end(), 1);
+      state.items = A->nnz();
+      state.flops = 2.0 * 3 * A->nnz();
+      state.bytes = A->nnz() * (sizeof(float) + sizeof(size_t)) + 2.0 * 3 * 4 * N;
+      return [=]() { func(*A, *x, *y); };
+    });
+  };
+  auto spmm = [](const MatrixCSR<float>& A, const Matrix<float>& x, Matrix<float>& y) {
+    MatrixCSR<float>::matmul_(A, x, y);
+  };
+  auto spmmNaive = [](const MatrixCSR<float>& A, const Matrix<float>& x, Matrix<float>& y) {
+    MatrixCSR<float>::matmulNaive_(A, x, y);
+  };
+  addSpmm("MatrixCSR::matmul_", {16, 48}, true, [](size_t n) { return gridLaplacian(n); }, spmm);
+  addSpmm("MatrixCSR::matmulNaive_", {16, 48}, false, [](size_t n) { return gridLaplacian(n); }, spmmNaive);
+  addSpmm("MatrixCSR::matmul_ (torus)", {256, 1024}, true, torusLaplacian, spmm);
+  addSpmm("MatrixCSR::matmulNaive_ (torus)", {256, 1024}, false, torusLaplacian, spmmNaive);
+
+  // MatrixCSR::gaussSeidel (single sweep with 3 columns)
+  bench::add("MatrixCSR::gaussSeidel", {16, 48}, false, [](bench::State& state) {
+    auto A = std::make_shared<MatrixCSR<float>>(gridLaplacian(state.size));
+    size_t N = A->shape_[0];
+    auto x = std::make_shared<Matrix<float>>(N, 3);
+    auto b = std::make_shared<Matrix<float>>(N, 3);
+    std::fill(b->data_.begin(), b->data_.end(), 1);
+    state.items = N;
+    state.bytes = A->nnz() * (sizeof(float) + sizeof(size_t)) + 2.0 * 3 * 4 * N;
+    return [=]() { MatrixCSR<float>::gaussSeidel(*A, *x, *b, 1); };
+  });
+
+  // Multicolor Gauss-Seidel (same sweep in parallel over rows of each color)
+  bench::add("MulticolorGaussSeidel::step", {16, 48}, true, [](bench::State& state) {
+    auto A = std::make_shared<MatrixCSR<float>>(gridLaplacian(state.size));
+    size_t N = A->shape_[0];
+    auto x = std::make_shared<Matrix<float>>(N, 3);
+    auto b = std::make_shared<Matrix<float>>(N, 3);
+    std::fill(b->data_.begin(), b->data_.end(), 1);
+    auto solver = std::make_shared<gauss_seidel::MulticolorGaussSeidel<float>>();
+    solver->setup(*A);
+    state.items = N;
+    state.bytes = A->nnz() * (sizeof(float) + sizeof(size_t)) + 2.0 * 3 * 4 * N;
+    return [=]() { solver->step(*A, *x, *b); };
+  });
+
+  // PCG from zero to relative residual 1e-4 (3 columns)
+  auto addConjugateGradient = [](const char* name, auto preconditioner) {
+    bench::add(name, {16, 32}, true, [](bench::State& state) {
+      using Solver = pcg::ConjugateGradient<float, decltype(preconditioner)>;
+      auto A = std::make_shared<MatrixCSR<float>>(gridLaplacian(state.size));
+      size_t N = A->shape_[0];
+      auto x = std::make_shared<Matrix<float>>(N, 3);
+      auto b = std::make_shared<Matrix<float>>(N, 3);
+      std::fill(b->data_.begin(), b->data_.end(), 1);
+      auto solver = std::make_shared<Solver>();
+      solver->setup(*A);
+      state.items = N;
+      return [=]() {
+        std::fill(x->data_.begin(), x->data_.end(), 0);
+        solver->solve(*A, *x, *b, 4096, 1e-4);
+      };
+    });
+  };
+  addConjugateGradient("ConjugateGradient::solve (Jacobi)", pcg::PreconditionerJacobi<float>{});
+  addConjugateGradient("ConjugateGradient::solve (IC0)", pcg::PreconditionerIC0<float>{});
+
+  // Cholesky solve in float, double and float with refinement in double (3 columns on grid Laplacian of n^3 rows)
+  for (auto name : {"Cholesky<float>::solve", "Cholesky<double>::solve", "CholeskyRefinement::solve"}) {
+    bench::add(name, {8, 16, 37}, false, [name = std::string{name}](bench::State& state) -> std::function<void()> {
+      auto A = gridLaplacian(state.size);
+      size_t N = A.shape_[0];
+      state.items = N;
+      if (name == "Cholesky<float>::solve") {
+        auto solver = std::make_shared<cholesky::Cholesky<float>>();
+        solver->compute(A);
+        auto x = std::make_shared<Matrix<float>>(N, 3);
+        auto b = std::make_shared<Matrix<float>>(N, 3);
+        std::fill(b->data_.begin(), b->data_.end(), 1);
+        return [=]() { solver->solve(*x, *b); };
+      }
+      auto A_double = MatrixCSR<double>::cast(A);
+      auto x = std::make_shared<Matrix<double>>(N, 3);
+      auto b = std::make_shared<Matrix<double>>(N, 3);
+      std::fill(b->data_.begin(), b->data_.end(), 1);
+      if (name == "Cholesky<double>::solve") {
+        auto solver = std::make_shared<cholesky::Cholesky<double>>();
+        solver->compute(A_double);
+        return [=]() { solver->solve(*x, *b); };
+      }
+      auto solver = std::make_shared<refinement::CholeskyRefinement<float, double>>();
+      solver->compute(A_double);
+      return [=]() {
+        std::fill(x->data_.begin(), x->data_.end(), 0);
+        solver->solve(*x, *b, 4, 1e-12);
+      };
+    });
+  }
+
+  // Cholesky analyze/factorize in float (grid Laplacian of n^3 rows, 37^3 is about 50k vertices)
+  for (auto ordering : {cholesky::Ordering::kRCM, cholesky::Ordering::kND}) {
+    bool nd = ordering == cholesky::Ordering::kND;
+    bench::add(nd ? "Cholesky<float>::factorize (ND)" : "Cholesky<float>::factorize (RCM)", nd ? std::vector<size_t>{16, 30, 37} : std::vector<size_t>{16, 30}, true,
+               [ordering](bench::State& state) {
+      auto A = std::make_shared<MatrixCSR<float>>(gridLaplacian(state.size));
+      auto solver = std::make_shared<cholesky::Cholesky<float>>();
+      solver->analyze(*A, ordering);
+      state.items = A->shape_[0];
+      state.flops = 0;
+      for (size_t j = 0; j < A->shape_[0]; j++) { state.flops += std::pow(solver->L_.indptr_[j + 1] - solver->L_.indptr_[j], 2); }
+      return [=]() { solver->factorize(*A); };
+    });
+  }
+  bench::add("Cholesky<float>::analyze (ND)", {16, 37}, false, [](bench::State& state) {
+    auto A = std::make_shared<MatrixCSR<float>>(gridLaplacian(state.size));
+    auto solver = std::make_shared<cholesky::Cholesky<float>>();
+    state.items = A->shape_[0];
+    return [=]() { solver->analyze(*A, cholesky::Ordering::kND); };
+  });
+
+  // ddg (topology and geometry of 2 n^2 triangles)
+  bench::add("ddg::Topology::compute", {256, 1024}, true, [](bench::State& state) {
+    std::vector<float> verts;
+    auto topology = std::make_shared<ddg::Topology>();
+    makeGridMesh(state.size, verts, topology->f2v_);
+    size_t nV = verts.size() / 3;
+    state.items = topology->f2v_.size() / 3;
+    return [=]() { topology->compute(nV); };
+  });
+
+  bench::add("ddg::Mesh::update", {256, 1024}, true, [](bench::State& state) {
+    std::vector<float> verts;
+    std::vector<uint32_t> f2v;
+    makeGridMesh(state.size, verts, f2v);
+    auto mesh = std::make_shared<ddg::Mesh>(verts.size() / 3, f2v.size() / 3);
+    mesh->verts_.data_ = verts;
+    mesh->topology_.f2v_ = f2v;
+    mesh->init();
+    state.items = f2v.size() / 3;
+    return [=]() { mesh->update(); };
+  });
+
+  // reader (sizes follow reader.bench.js inputs, i.e. nV of bunny.off, camelhead.off and bunny.mesh, and a large one)
+  for (auto format : {"OFF", "MESH"}) {
+    std::vector<size_t> sizes = format == std::string{"OFF"} ? std::vector<size_t>{3485, 11381, 1 << 20}
+                                                             : std::vector<size_t>{5433, 1 << 20};
+    bench::add(std::string{"reader::parse"} + format, sizes, true, [format](bench::State& state) {
+      // Random verts with 2 nV triangles (OFF) or 6 nV tetrahedra (MESH) as text
+      Rng rng;
+      size_t nV = state.size;
+      bool off = format == std::string{"OFF"};
+      auto text = std::make_shared<std::string>();
+      char buf[128];
+      auto append = [&](auto... args) { text->append(buf, std::snprintf(buf, sizeof(buf), args...)); };
+      if (off) {
+        append("OFF\n%zu %zu 0\n", nV, 2 * nV);
+      } else {
+        append("MeshVersionFormatted 1\nDimension 3\nVertices\n%zu\n", nV);
+      }
+      for (size_t i = 0; i < nV; i++) {
+        append(off ? "%.9g %.9g %.9g\n" : "%.9g %.9g %.9g 0\n", rng.uniform(), rng.uniform(), rng.uniform());
+      }
+      if (!off) { append("Triangles\n0\nTetrahedra\n%zu\n", 6 * nV); }
+      for (size_t i = 0; i < (off ? 2 : 6) * nV; i++) {
+        auto v = [&]() { return size_t(rng.uniform() * nV) % nV + (off ? 0 : 1); };
+        size_t v0 = v(), v1 = v(), v2 = v(), v3 = v();
+        if (off) {
+          append("3 %zu %zu %zu\n", v0, v1, v2);
+        } else {
+          append("%zu %zu %zu %zu 0\n", v0, v1, v2, v3);
+        }
+      }
+      auto mesh = std::make_shared<reader::Mesh>();
+      state.items = nV;
+      state.bytes = text->size();
+      return [=]() {
+        bool ok = off ? reader::parseOFF(text->data(), text->size(), *mesh)
+                      : reader::parseMESH(text->data(), text->size(), *mesh);
+        assert(ok);
+        (void)ok;
+      };
+    });
+  }
+
+  // reader on actual files when run from the repository root (cf. reader.bench.js)
+  for (auto path : {"thirdparty/libigl-tutorial-data/bunny.off", "thirdparty/libigl-tutorial-data/camelhead.off",
+                    "thirdparty/libigl-tutorial-data/bunny.mesh"}) {
+    reader::MappedFile file;
+    if (!file.open(path)) { continue; }
+    bool off = std::string{path}.find(".off") != std::string::npos;
+    bench::add(std::string{"reader::read ("} + path + ")", {1}, true, [path, off, size = file.size_](bench::State& state) {
+      auto mesh = std::make_shared<reader::Mesh>();
+      state.items = 1;
+      state.bytes = size;
+      return [=]() { off ? reader::readOFF(path, *mesh) : reader::readMESH(path, *mesh); };
+    });
+  }
+
+  // ProjectiveDynamics startup: init (assemble E and Cholesky) vs loading the same state from cache (n^3 cells)
+  for (auto cached : {false, true}) {
+    auto name = cached ? "cache::load (ProjectiveDynamics)" : "ProjectiveDynamics::init";
+    bench::add(name, {8, 16}, false, [cached](bench::State& state) -> std::function<void()> {
+      std::vector<float> verts;
+      std::vector<uint32_t> c3xc0;
+      makeTetGrid(state.size, verts, c3xc0);
+      auto solver = std::make_shared<physics::ProjectiveDynamics>(verts.size() / 3, c3xc0.size() / 4, 1);
+      solver->verts_.data_ = verts;
+      solver->c3xc0_ = c3xc0;
+      solver->handles_[0] = 0;
+      state.items = solver->nV_;
+      if (!cached) {
+        return [=]() { solver->init(1 << 5); };
+      }
+      solver->init(1 << 5);
+      uint64_t key = cache::hashConfig(*solver, cache::hash(verts.data(), verts.size() * sizeof(float)));
+      auto path = std::make_shared<std::string>(
+          (std::filesystem::temp_directory_path() / format::format("ex05-bench-cache-%d.bin", state.size)).string());
+      bool ok = cache::save(*path, key, *solver);
+      assert(ok);
+      (void)ok;
+      auto solver2 = std::make_shared<physics::ProjectiveDynamics>(0, 0, 0);
+      return [=]() {
+        bool ok = cache::load(*path, key, *solver2);
+        assert(ok);
+        (void)ok;
+      };
+    });
+  }
+
+  // ProjectiveDynamics frame (n^3 cells) with local step by svd from scratch or warm-started polar decomposition
+  for (auto warm_start : {false, true}) {
+    auto name = warm_start ? "ProjectiveDynamics::update (warm start)" : "ProjectiveDynamics::update";
+    bench::add(name, {8, 16}, true, [warm_start](bench::State& state) {
+      std::vector<float> verts;
+      std::vector<uint32_t> c3xc0;
+      makeTetGrid(state.size, verts, c3xc0);
+      auto solver = std::make_shared<physics::ProjectiveDynamics>(verts.size() / 3, c3xc0.size() / 4, 1);
+      solver->verts_.data_ = verts;
+      solver->c3xc0_ = c3xc0;
+      solver->handles_[0] = 0;
+      solver->warm_start_ = warm_start;
+      solver->init(1 << 5);
+      state.items = solver->nV_;
+      return [=]() { solver->update(); };
+    });
+  }
+
+  // Delaunay tetrahedralization of uniform random points (items/s = inserted points per second)
+  bench::add("delaunay::Delaunay::compute", {1 << 12, 1 << 16, 1 << 20}, false, [](bench::State& state) {
+    Rng rng;
+    auto verts = std::make_shared<std::vector<float>>(3 * state.size);
+    for (auto& x : *verts) { x = rng.uniform(); }
+    auto solver = std::make_shared<delaunay::Delaunay>();
+    state.items = state.size;
+    return [=, n = state.size]() { solver->compute(verts->data(), n); };
+  });
+
+  // graph (BFS on v2ve of 2 n^2 triangles from the center and tree-cotree of torus)
+  bench::add("graph::BFS::compute", {256, 1024, 2048}, true, [](bench::State& state) {
+    std::vector<float> verts;
+    ddg::Topology topology;
+    makeGridMesh(state.size, verts, topology.f2v_);
+    topology.compute(verts.size() / 3);
+    auto g = std::make_shared<graph::Graph>(graph::computeV2VE(topology));
+    auto bfs = std::make_shared<graph::BFS>();
+    state.items = g->n_;
+    return [=]() { bfs->compute(*g, uint32_t(g->n_ / 2)); };
+  });
+
+  bench::add("graph::TreeCotree::compute", {256, 1024}, true, [](bench::State& state) {
+    std::vector<float> verts;
+    auto topology = std::make_shared<ddg::Topology>();
+    makeTorusMesh(state.size, verts, topology->f2v_);
+    topology->compute(verts.size() / 3);
+    auto tree_cotree = std::make_shared<graph::TreeCotree>();
+    state.items = topology->nF_;
+    return [=]() { tree_cotree->compute(*topology); };
+  });
+
+  // collision (broad phase on n^3 cells with 6 n^3 tetrahedra vs svd local step of the same tetrahedra)
+  for (auto refit : {false, true}) {
+    bench::add(refit ? "collision::Bvh::refit" : "collision::Bvh::build", {16, 26}, true, [refit](bench::State& state) {
+      std::vector<float> verts;
+      std::vector<uint32_t> c3xc0;
+      makeTetGrid(state.size, verts, c3xc0);
+      auto boxes = std::make_shared<std::vector<float>>();
+      size_t nV = verts.size() / 3;
+      collision::computeBoxes<4>(Matrix<float>{nV, 3, std::move(verts)}, c3xc0, 0, *boxes);
+      auto bvh = std::make_shared<collision::Bvh>();
+      bvh->build(*boxes);
+      state.items = c3xc0.size() / 4;
+      if (refit) {
+        return std::function<void()>{[=]() { bvh->refit(*boxes); }};
+      }
+      return std::function<void()>{[=]() { bvh->build(*boxes); }};
+    });
+  }
+
+  bench::add("collision::Collision::detect", {16, 26}, true, [](bench::State& state) {
+    std::vector<float> verts;
+    std::vector<uint32_t> c3xc0;
+    makeTetGrid(state.size, verts, c3xc0);
+    size_t nV = verts.size() / 3;
+    auto x = std::make_shared<Matrix<float>>(nV, 3, std::move(verts));
+    auto collision = std::make_shared<collision::Collision>();
+    collision->init(*x, c3xc0);
+    state.items = c3xc0.size() / 4;
+    return [=]() { collision->detect(*x); };
+  });
+
+  bench::add("collision::(local step) misc::solve", {16, 26}, true, [](bench::State& state) {
+    Rng rng;
+    size_t n = 6 * state.size * state.size * state.size;
+    auto u1 = std::make_shared<std::vector<float>>(randomMat3(n, rng));
+    auto u2 = std::make_shared<std::vector<float>>(randomMat3(n, rng));
+    auto p = std::make_shared<std::vector<float>>(9 * n);
+    state.items = n;
+    return [=]() { misc::solve(*u1, *u2, *p); };
+  });
+
+  // trace (cost of n zones while recording or not)
+  for (auto enabled : {false, true}) {
+    bench::add(enabled ? "trace::Zone (enabled)" : "trace::Zone (disabled)", {1 << 16}, false, [enabled](bench::State& state) {
+      state.items = state.size;
+      return [enabled, n = state.size]() {
+        bool previous = trace::enabled();
+        trace::enable(enabled);
+        for (size_t i = 0; i < n; i++) {
+          trace::Zone zone{"bench"};
+          asm volatile("" : : "r"(&zone) : "memory");
+        }
+        trace::enable(previous);
+      };
+    });
+  }
+
+  // Reductions (ex02, ex04)
+  auto addSum = [](const char* name, auto func, bool threaded) {
+    bench::add(name, {1 << 16, 1 << 20, 1 << 24}, threaded, [func](bench::State& state) {
+      auto v = std::make_shared<std::vector<float>>(state.size, 1.0f);
+      state.items = state.size;
+      state.flops = state.size;
+      state.bytes = 4.0 * state.size;
+      return [v, func]() {
+        volatile float result = func(*v);
+        (void)result;
+      };
+    });
+  };
+  addSum("sum", &sum, false);
+  addSum("sum_parallel", &sum_parallel, true);
+  addSum("reduce::sum", [](const std::vector<float>& v) { return reduce::sum(v.data(), v.size()); }, false);
+  addSum("reduce::sumKahan", [](const std::vector<float>& v) { return reduce::sumKahan(v.data(), v.size()); }, false);
+  addSum("reduce::sumPairwise", [](const std::vector<float>& v) { return reduce::sumPairwise(v.data(), v.size()); }, false);
+  addSum("reduce::max", [](const std::vector<float>& v) { return reduce::max(v.data(), v.size()); }, false);
+
+  bench::add("reduce::dot", {1 << 16, 1 << 20, 1 << 24}, false, [](bench::State& state) {
+    auto x = std::make_shared<std::vector<float>>(state.size, 1.0f);
+    auto y = std::make_shared<std::vector<float>>(state.size, 1.0f);
+    state.items = state.size;
+    state.flops = 2.0 * state.size;
+    state.bytes = 8.0 * state.size;
+    return [x, y]() {
+      volatile float result = reduce::dot(x->data(), y->data(), x->size());
+      (void)result;
+    };
+  });
+
+  bench::add("reduce::axpy", {1 << 16, 1 << 20, 1 << 24}, false, [](bench::State& state) {
+    auto x = std::make_shared<std::vector<float>>(state.size, 1.0f);
+    auto y = std::make_shared<std::vector<float>>(state.size, 0.0f);
+    state.items = state.size;
+    state.flops = 2.0 * state.size;
+    state.bytes = 12.0 * state.size;
+    return [x, y]() { reduce::axpy(1e-3f, x->data(), y->data(), x->size()); };
+  });
+
+  // Irregular loop (cost grows with index) on fixed chunks of ThreadPool vs work-stealing Scheduler
+  auto irregular = [](size_t i_begin, size_t i_end) {
+    for (size_t i = i_begin; i < i_end; i++) {
+      float x = i;
+      for (size_t k = 0; k < i / 16; k++) { x = x * 0.999f + 1.0f; }
+      asm volatile("" : : "r"(x));
+    }
+  };
+  bench::add("thread_pool::parallelFor (irregular)", {1 << 12, 1 << 14}, true, [=](bench::State& state) {
+    state.items = state.size;
+    return [=, n = state.size]() { thread_pool::getDefault().parallelFor(0, n, 0, irregular); };
+  });
+  bench::add("scheduler::parallelFor (irregular)", {1 << 12, 1 << 14}, true, [=](bench::State& state) {
+    state.items = state.size;
+    return [=, n = state.size]() { scheduler::getDefault().parallelFor(0, n, 0, irregular); };
+  });
+
+#if defined(USE_DISPATCH)
+  // Same kernels through runtime dispatch (select target by e.g. SIMD_ISA=avx2)
+  bench::add("dispatch::solve", {1 << 12, 1 << 16}, true, [](bench::State& state) {
+    Rng rng;
+    auto u1 = std::make_shared<std::vector<float>>(randomMat3(state.size, rng));
+    auto u2 = std::make_shared<std::vector<float>>(randomMat3(state.size, rng));
+    auto p = std::make_shared<std::vector<float>>(9 * state.size);
+    state.items = state.size;
+    state.bytes = 3 * 9 * 4 * state.size;
+    return [=]() { dispatch::solve(*u1, *u2, *p); };
+  });
+
+  bench::add("dispatch::dot", {1 << 16, 1 << 20}, false, [](bench::State& state) {
+    auto x = std::make_shared<std::vector<float>>(state.size, 1.0f);
+    state.items = state.size;
+    state.flops = 2.0 * state.size;
+    state.bytes = 8.0 * state.size;
+    return [x]() {
+      volatile float result = dispatch::kernels().dot(x->data(), x->data(), x->size());
+      (void)result;
+    };
+  });
+
+  bench::add("dispatch::gemm", {64, 256}, true, [](bench::State& state) {
+    size_t n = state.size;
+    Rng rng;
+    auto a = std::make_shared<std::vector<float>>(n * n);
+    auto c = std::make_shared<std::vector<float>>(n * n);
+    for (auto& v : *a) { v = rng.uniform(); }
+    state.flops = 2.0 * n * n * n;
+    state.bytes = 3.0 * 4 * n * n;
+    return [=]() { dispatch::kernels().gemm(n, n, n, 1, a->data(), n, a->data(), n, 0, c->data(), n); };
+  });
+
+  bench::add("dispatch::MatrixCSR::matmul_", {16, 48}, true, [](bench::State& state) {
+    auto A = std::make_shared<MatrixCSR<float>>(gridLaplacian(state.size));
+    size_t N = A->shape_[0];
+    auto x = std::make_shared<Matrix<float>>(N, 16);
+    auto y = std::make_shared<Matrix<float>>(N, 16);
+    std::fill(x->data_.begin(), x->data_.end(), 1);
+    state.items = A->nnz();
+    state.flops = 2.0 * 16 * A->nnz();
+    state.bytes = A->nnz() * (sizeof(float) + sizeof(size_t)) + 2.0 * 16 * 4 * N;
+    return [=]() { dispatch::matmul_(*A, *x, *y); };
+  });
+#endif
+}
+
+int main(int argc, const char* argv[]) {
+  bench::Options options;
+  if (!bench::parseOptions(argc, argv, options)) { return 1; }
+  registerBenchmarks();
+#if defined(USE_DISPATCH)
+  format::prints("[dispatch] %s (simd width %d)", dispatch::kernels().name, dispatch::kernels().simd_width);
+#endif
+  bench::runAll(options);
+  return 0;
+}
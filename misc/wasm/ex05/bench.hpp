@@ -0,0 +1,263 @@
+#pragma once
+
+//
+// Minimal benchmark harness (similar to Google Benchmark but without dependency so that it also runs on node)
+//   - Each benchmark is registered with sizes and whether it depends on the number of threads.
+//   - Benchmark function does setup for given `State` and returns the closure to be timed.
+//     It also sets per-iteration counters (items, flops, bytes) used to report throughput.
+//   - Each closure is repeated until `min_time` elapses (iteration count doubles each round).
+//   - Results are printed as a table and optionally written as JSON in the same layout as
+//     Google Benchmark's "--benchmark_out" so that existing tools (e.g. compare.py) can diff them.
+//   - With `--trace <path>`, zones and counters inside benchmarks (cf. trace.hpp) are written as Chrome trace JSON.
+//   - With `--perf`, single thread runs are repeated under hardware counters (cf. perf.hpp) and
+//     IPC, miss rates, bytes per flop and roofline position are printed below each result.
+//     Roofline peaks are calibrated at startup unless given by `--peak-gflops` and `--peak-gbps`.
+//
+
+#include <chrono>
+#include <cstdio>
+#include <functional>
+#include <regex>
+#include <string>
+#include <thread>
+#include <vector>
+#include "format.hpp"
+#include "simd.hpp"
+#include "thread_pool.hpp"
+#include "scheduler.hpp"
+#include "trace.hpp"
+#include "perf.hpp"
+
+namespace bench {
+
+struct State {
+  size_t size = 0;
+  size_t threads = 1;
+
+  // Per-iteration counters
+  double items = 0;
+  double flops = 0;
+  double bytes = 0;
+};
+
+struct Benchmark {
+  std::string name;
+  std::vector<size_t> sizes;
+  bool threaded = false;
+  std::function<std::function<void()>(State&)> func;
+};
+
+struct Result {
+  std::string name; // e.g. "solve/65536/threads:2"
+  State state;
+  size_t iterations = 0;
+  double time = 0; // seconds per iteration
+  perf::Sample counters; // per iteration (with `--perf` and single thread)
+};
+
+inline std::vector<Benchmark>& registry() {
+  static std::vector<Benchmark> result;
+  return result;
+}
+
+inline void add(const std::string& name, const std::vector<size_t>& sizes, bool threaded,
+                const std::function<std::function<void()>(State&)>& func) {
+  registry().push_back({name, sizes, threaded, func});
+}
+
+struct Options {
+  std::string filter = ".*";
+  std::vector<size_t> threads = {1, 2, 4};
+  double min_time = 0.2;
+  std::string json; // output path (empty for no output)
+  std::string trace; // Chrome trace output path (empty for no tracing)
+  bool perf = false;
+  double peak_gflops = 0; // roofline peaks (0 for calibration)
+  double peak_gbps = 0;
+};
+
+inline Result runOne(const Benchmark& benchmark, size_t size, size_t threads, double min_time,
+                     perf::Counters* counters = nullptr) {
+  thread_pool::setNumThreads(threads); // also workers of scheduler::getDefault()
+  Result result;
+  result.state.size = size;
+  result.state.threads = threads;
+  result.name = benchmark.name + "/" + std::to_string(size);
+  if (benchmark.threaded) {
+    result.name += "/threads:" + std::to_string(threads);
+  }
+
+  trace::Zone zone{trace::intern(result.name)};
+  auto run = benchmark.func(result.state);
+  run(); // warm up
+
+  size_t iterations = 1;
+  while (true) {
+    auto t0 = std::chrono::steady_clock::now();
+    for (size_t i = 0; i < iterations; i++) { run(); }
+    auto t1 = std::chrono::steady_clock::now();
+    double elapsed = std::chrono::duration<double>(t1 - t0).count();
+    if (elapsed >= min_time || iterations >= (1u << 30)) {
+      result.iterations = iterations;
+      result.time = elapsed / iterations;
+      break;
+    }
+    iterations *= 2;
+  }
+
+  // Separate pass so that ioctl calls don't perturb timing (thread_pool workers are not counted, thus single thread only)
+  if (counters && threads == 1) {
+    counters->reset();
+    {
+      perf::Scope scope{*counters};
+      for (size_t i = 0; i < result.iterations; i++) { run(); }
+    }
+    result.counters = counters->read();
+    for (auto& v : result.counters.values_) { v /= result.iterations; }
+  }
+  return result;
+}
+
+inline std::string formatRate(double per_second, const char* unit) {
+  if (per_second <= 0) { return ""; }
+  const char* prefixes[] = {"", "k", "M", "G", "T"};
+  int k = 0;
+  while (per_second >= 1000 && k < 4) {
+    per_second /= 1000;
+    k++;
+  }
+  return format::format("%.3f %s%s/s", per_second, prefixes[k], unit);
+}
+
+inline void writeJson(const std::string& path, const std::vector<Result>& results) {
+  FILE* file = std::fopen(path.c_str(), "w");
+  if (!file) {
+    format::prints("[bench] cannot open %s", path);
+    return;
+  }
+  std::fprintf(file, "{\n  \"context\": {\n");
+  std::fprintf(file, "    \"simd_width\": %d,\n", simd::kWidth);
+  std::fprintf(file, "    \"num_cpus\": %d\n", (int)std::thread::hardware_concurrency());
+  std::fprintf(file, "  },\n  \"benchmarks\": [\n");
+  for (size_t i = 0; i < results.size(); i++) {
+    auto& r = results[i];
+    std::fprintf(file, "    {\n");
+    std::fprintf(file, "      \"name\": \"%s\",\n", r.name.c_str());
+    std::fprintf(file, "      \"run_name\": \"%s\",\n", r.name.c_str());
+    std::fprintf(file, "      \"run_type\": \"iteration\",\n");
+    std::fprintf(file, "      \"iterations\": %zu,\n", r.iterations);
+    std::fprintf(file, "      \"real_time\": %.6e,\n", r.time * 1e9);
+    std::fprintf(file, "      \"cpu_time\": %.6e,\n", r.time * 1e9);
+    std::fprintf(file, "      \"time_unit\": \"ns\",\n");
+    std::fprintf(file, "      \"size\": %zu,\n", r.state.size);
+    std::fprintf(file, "      \"threads\": %zu,\n", r.state.threads);
+    std::fprintf(file, "      \"items_per_second\": %.6e,\n", r.state.items / r.time);
+    std::fprintf(file, "      \"flops_per_second\": %.6e,\n", r.state.flops / r.time);
+    std::fprintf(file, "      \"bytes_per_second\": %.6e", r.state.bytes / r.time);
+    for (int k = 0; k < perf::kNumEvents; k++) {
+      if (r.counters.has(perf::Event(k))) {
+        std::fprintf(file, ",\n      \"%s\": %.6e", perf::kEventNames[k], r.counters[perf::Event(k)]);
+      }
+    }
+    std::fprintf(file, "\n");
+    std::fprintf(file, "    }%s\n", i + 1 < results.size() ? "," : "");
+  }
+  std::fprintf(file, "  ]\n}\n");
+  std::fclose(file);
+}
+
+inline std::vector<Result> runAll(const Options& options) {
+  std::regex filter{options.filter};
+  size_t num_threads_default = thread_pool::getNumThreads();
+  std::vector<Result> results;
+  trace::enable(!options.trace.empty());
+  perf::Counters counters;
+  perf::Machine machine;
+  if (options.perf) {
+    if (counters.init()) {
+      std::string missing;
+      for (int k = 0; k < perf::kNumEvents; k++) {
+        if (!counters.available(perf::Event(k))) { missing += std::string{missing.empty() ? "" : ", "} + perf::kEventNames[k]; }
+      }
+      if (!missing.empty()) { format::prints("[perf] unavailable events: %s", missing); }
+    } else {
+      format::prints("[perf] perf_event_open is unavailable (falling back to nominal flops and bytes)");
+    }
+    machine = perf::calibrate();
+    if (options.peak_gflops > 0) { machine.flops = options.peak_gflops * 1e9; }
+    if (options.peak_gbps > 0) { machine.bandwidth = options.peak_gbps * 1e9; }
+    format::prints("[perf] peak %.1f GFlop/s, %.1f GB/s (balance %.2f Flop/B)",
+        machine.flops * 1e-9, machine.bandwidth * 1e-9, machine.balance());
+  }
+  std::printf("%-40s %14s %12s %18s %18s %18s\n", "name", "time", "iterations", "items", "flops", "bytes");
+  for (auto& benchmark : registry()) {
+    if (!std::regex_search(benchmark.name, filter)) { continue; }
+    for (auto size : benchmark.sizes) {
+      auto threads_list = benchmark.threaded ? options.threads : std::vector<size_t>{1};
+      for (auto threads : threads_list) {
+        auto r = runOne(benchmark, size, threads, options.min_time, options.perf ? &counters : nullptr);
+        format::prints("%-40s %11.3f us %12d %18s %18s %18s",
+            r.name, r.time * 1e6, r.iterations,
+            formatRate(r.state.items / r.time, "item"),
+            formatRate(r.state.flops / r.time, "Flop"),
+            formatRate(r.state.bytes / r.time, "B"));
+        if (options.perf && threads == 1) {
+          auto report = perf::Report::compute(r.counters, r.time, r.state.flops, r.state.bytes, machine);
+          auto line = report.toString();
+          if (!line.empty()) { format::prints("%-40s %s", "", line); }
+        }
+        results.push_back(r);
+      }
+    }
+  }
+  thread_pool::setNumThreads(num_threads_default);
+  if (!options.json.empty()) {
+    writeJson(options.json, results);
+  }
+  if (!options.trace.empty()) {
+    trace::enable(false);
+    trace::write(options.trace);
+  }
+  return results;
+}
+
+// Usage: bench [--filter <regex>] [--threads 1,2,4] [--min-time <seconds>] [--json <path>] [--trace <path>]
+//              [--perf] [--peak-gflops <value>] [--peak-gbps <value>]
+inline bool parseOptions(int argc, const char* argv[], Options& options) {
+  for (int i = 1; i < argc; i++) {
+    std::string arg = argv[i];
+    bool has_value = i + 1 < argc;
+    if (arg == "--filter" && has_value) {
+      options.filter = argv[++i];
+    } else if (arg == "--threads" && has_value) {
+      options.threads.clear();
+      std::string list = argv[++i];
+      size_t begin = 0;
+      while (begin < list.size()) {
+        size_t end = list.find(',', begin);
+        if (end == std::string::npos) { end = list.size(); }
+        options.threads.push_back(std::stoul(list.substr(begin, end - begin)));
+        begin = end + 1;
+      }
+    } else if (arg == "--min-time" && has_value) {
+      options.min_time = std::stod(argv[++i]);
+    } else if (arg == "--json" && has_value) {
+      options.json = argv[++i];
+    } else if (arg == "--trace" && has_value) {
+      options.trace = argv[++i];
+    } else if (arg == "--perf") {
+      options.perf = true;
+    } else if (arg == "--peak-gflops" && has_value) {
+      options.peak_gflops = std::stod(argv[++i]);
+    } else if (arg == "--peak-gbps" && has_value) {
+      options.peak_gbps = std::stod(argv[++i]);
+    } else {
+      format::prints("Usage: %s [--filter <regex>] [--threads 1,2,4] [--min-time <seconds>] [--json <path>] [--trace <path>] "
+                     "[--perf] [--peak-gflops <value>] [--peak-gbps <value>]", argv[0]);
+      return false;
+    }
+  }
+  return true;
+}
+
+} // namespace bench
@@ -0,0 +1,467 @@
+#pragma once
+
+//
+// Versioned binary cache of mesh and solver state (ProjectiveDynamics after `init`) for instant startup
+//   - Layout: Header | Section table | payloads (each payload is kAlignment aligned, native byte order)
+//       Header  : magic "EX05CACH", version, byte order mark, number of sections, key, file size
+//       Section : name (e.g. "E.indptr"), dtype (kind | sizeof), offset, count
+//   - `key` is given by the caller, typically the content hash of the source mesh file combined with
+//     the solver configuration, e.g.
+//       reader::MappedFile src;
+//       src.open(mesh_path);
+//       (set handles_ and handle_targets_ of solver)
+//       uint64_t key = cache::hashConfig(solver, cache::hash(src.data_, src.size_));
+//       if (!cache::load(cache_path, key, solver)) {
+//         (parse mesh, fill solver, solver.init(...))
+//         cache::save(cache_path, key, solver);
+//       }
+//     and a file with other key, version, byte order or dtype is rejected (`load` returns false).
+//   - `File` maps the file (reader::MappedFile) and `File::get(name, View<T>&)` points into the mapping (zero-copy).
+//     ProjectiveDynamics owns its arrays as std::vector, so `load` copies each array once (memcpy),
+//     which replaces parsing text, assembling E and Cholesky analyze/factorize.
+//   - size_t arrays (CSR indptr/indices, Cholesky permutation) are stored as they are, thus a cache written by
+//     64 bit native build is rejected by 32 bit wasm (and vice versa) via dtype mismatch.
+//   - `save` writes "<path>.tmp" and renames it, so partially written file is never loaded.
+//   - `File::open` checks only the header and section bounds, thus `read` checks index arrays
+//     (CSR indptr/indices, Cholesky permutation/map/supernodes) so that a corrupt file with matching key
+//     is rejected (caller recomputes) rather than indexing out of bounds in later solves.
+//
+
+#include <algorithm>
+#include <cassert>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <functional>
+#include <string>
+#include <type_traits>
+#include <vector>
+#include "matrix.hpp"
+#include "cholesky.hpp"
+#include "refinement.hpp"
+#include "projective_dynamics.hpp"
+#include "reader.hpp"
+
+namespace cache {
+
+using std::vector;
+
+constexpr char kMagic[8] = {'E', 'X', '0', '5', 'C', 'A', 'C', 'H'};
+constexpr uint32_t kVersion = 2; // bump when cached structures change
+constexpr uint32_t kByteOrderMark = 0x01020304;
+constexpr size_t kAlignment = 64;
+constexpr size_t kNameSize = 40;
+constexpr uint64_t kHashSeed = 0xcbf29ce484222325ull;
+
+struct Header {
+  char magic[8];
+  uint32_t version;
+  uint32_t byte_order_mark;
+  uint32_t num_sections;
+  uint32_t reserved;
+  uint64_t key;
+  uint64_t size; // whole file
+};
+
+struct Section {
+  char name[kNameSize];
+  uint32_t dtype;
+  uint32_t reserved;
+  uint64_t offset; // from file start
+  uint64_t count;  // number of elements
+};
+
+static_assert(sizeof(Header) == 40);
+static_assert(sizeof(Section) == 64);
+
+// Element type tag (kind | sizeof) e.g. float = 0x104, uint32_t = 0x304
+template<typename T>
+constexpr uint32_t dtypeOf() {
+  static_assert(std::is_arithmetic_v<T>);
+  return (std::is_floating_point_v<T> ? 0x100u : std::is_signed_v<T> ? 0x200u : 0x300u) | uint32_t(sizeof(T));
+}
+
+//
+// Content hash (64 bit, 8 bytes per step with murmur3 finalizer, not cryptographic)
+//
+
+inline uint64_t mix(uint64_t h) {
+  h ^= h >> 33;
+  h *= 0xff51afd7ed558ccdull;
+  h ^= h >> 33;
+  h *= 0xc4ceb9fe1a85ec53ull;
+  h ^= h >> 33;
+  return h;
+}
+
+inline uint64_t hash(const void* data, size_t size, uint64_t seed = kHashSeed) {
+  auto p = static_cast<const unsigned char*>(data);
+  uint64_t h = seed ^ (uint64_t(size) * 0x9e3779b97f4a7c15ull);
+  size_t i = 0;
+  for (; i + 8 <= size; i += 8) {
+    uint64_t w;
+    std::memcpy(&w, p + i, 8);
+    w *= 0x87c37b91114253d5ull;
+    w = (w << 31) | (w >> 33);
+    h = (h ^ w) * 0x9e3779b97f4a7c15ull;
+    h = (h << 27) | (h >> 37);
+  }
+  if (i < size) {
+    uint64_t w = 0;
+    std::memcpy(&w, p + i, size - i);
+    h ^= w * 0x87c37b91114253d5ull;
+  }
+  return mix(h);
+}
+
+// Configuration which affects `init` including handles (vertices pinned in E and their targets),
+// thus `handles_` and `handle_targets_` have to be set before computing the key
+inline uint64_t hashConfig(const physics::ProjectiveDynamics& solver, uint64_t seed = kHashSeed) {
+  float values[] = {solver.mass_, solver.dt_, solver.handle_stiffness_, solver.strain_stiffness_,
+                    float(solver.refinement_iteration_ > 0)};
+  uint64_t result = hash(values, sizeof(values), seed);
+  result = hash(solver.handles_.data(), solver.handles_.size() * sizeof(uint32_t), result);
+  auto& targets = solver.handle_targets_.data_;
+  return hash(targets.data(), targets.size() * sizeof(float), result);
+}
+
+//
+// Writer (arrays are referenced until `write`)
+//
+
+struct Writer {
+  struct Entry {
+    std::string name;
+    uint32_t dtype;
+    const void* data;
+    size_t count;
+    size_t bytes;
+  };
+  vector<Entry> entries_;
+
+  template<typename T>
+  void add(const std::string& name, const T* data, size_t count) {
+    assert(name.size() < kNameSize);
+    entries_.push_back({name, dtypeOf<T>(), data, count, count * sizeof(T)});
+  }
+
+  template<typename T>
+  void add(const std::string& name, const vector<T>& data) {
+    add(name, data.data(), data.size());
+  }
+
+  static size_t align(size_t offset) { return (offset + kAlignment - 1) / kAlignment * kAlignment; }
+
+  bool write(const std::string& path, uint64_t key) const {
+    size_t num_sections = entries_.size();
+    vector<Section> sections(num_sections);
+    size_t offset = align(sizeof(Header) + num_sections * sizeof(Section));
+    for (size_t i = 0; i < num_sections; i++) {
+      auto& e = entries_[i];
+      auto& s = sections[i];
+      std::memset(&s, 0, sizeof(Section));
+      std::memcpy(s.name, e.name.c_str(), e.name.size());
+      s.dtype = e.dtype;
+      s.offset = offset;
+      s.count = e.count;
+      offset = align(offset + e.bytes);
+    }
+    Header header;
+    std::memset(&header, 0, sizeof(Header));
+    std::memcpy(header.magic, kMagic, sizeof(kMagic));
+    header.version = kVersion;
+    header.byte_order_mark = kByteOrderMark;
+    header.num_sections = uint32_t(num_sections);
+    header.key = key;
+    header.size = offset;
+
+    std::string tmp_path = path + ".tmp";
+    FILE* file = std::fopen(tmp_path.c_str(), "wb");
+    if (!file) { return false; }
+    char zeros[kAlignment] = {};
+    size_t position = 0;
+    bool ok = true;
+    auto put = [&](const void* data, size_t bytes) {
+      ok = ok && std::fwrite(data, 1, bytes, file) == bytes;
+      position += bytes;
+    };
+    auto pad = [&]() { put(zeros, align(position) - position); };
+    put(&header, sizeof(Header));
+    put(sections.data(), num_sections * sizeof(Section));
+    for (auto& e : entries_) {
+      pad();
+      put(e.data, e.bytes);
+    }
+    pad();
+    ok = (std::fclose(file) == 0) && ok;
+    assert(!ok || position == header.size);
+    if (!ok || std::rename(tmp_path.c_str(), path.c_str()) != 0) {
+      std::remove(tmp_path.c_str());
+      return false;
+    }
+    return true;
+  }
+};
+
+//
+// Reader
+//
+
+template<typename T>
+struct View {
+  const T* data_ = nullptr;
+  size_t size_ = 0;
+
+  const T* begin() const { return data_; }
+  const T* end() const { return data_ + size_; }
+  const T& operator[](size_t i) const { return data_[i]; }
+};
+
+struct File {
+  reader::MappedFile file_;
+  const Header* header_ = nullptr;
+  const Section* sections_ = nullptr;
+
+  // Returns false when the file is missing, malformed or written with other key/version/byte order
+  bool open(const std::string& path, uint64_t key) {
+    header_ = nullptr;
+    sections_ = nullptr;
+    if (!file_.open(path.c_str())) { return false; }
+    size_t size = file_.size_;
+    if (size < sizeof(Header)) { return false; }
+    auto header = reinterpret_cast<const Header*>(file_.data_);
+    if (std::memcmp(header->magic, kMagic, sizeof(kMagic)) != 0) { return false; }
+    if (header->version != kVersion || header->byte_order_mark != kByteOrderMark) { return false; }
+    if (header->key != key || header->size != size) { return false; }
+    if (header->num_sections > (size - sizeof(Header)) / sizeof(Section)) { return false; }
+    auto sections = reinterpret_cast<const Section*>(file_.data_ + sizeof(Header));
+    for (size_t i = 0; i < header->num_sections; i++) {
+      auto& s = sections[i];
+      size_t element_size = s.dtype & 0xff;
+      if (s.name[kNameSize - 1] != 0 || element_size == 0) { return false; }
+      if (s.offset % kAlignment != 0 || s.offset > size) { return false; }
+      if (s.count > (size - s.offset) / element_size) { return false; }
+    }
+    header_ = header;
+    sections_ = sections;
+    return true;
+  }
+
+  const Section* find(const std::string& name) const {
+    if (!header_) { return nullptr; }
+    for (size_t i = 0; i < header_->num_sections; i++) {
+      if (name == sections_[i].name) { return &sections_[i]; }
+    }
+    return nullptr;
+  }
+
+  // Zero-copy view into the mapping (valid while `File` is open)
+  template<typename T>
+  bool get(const std::string& name, View<T>& result) const {
+    auto s = find(name);
+    if (!s || s->dtype != dtypeOf<T>()) { return false; }
+    result.data_ = reinterpret_cast<const T*>(file_.data_ + s->offset);
+    result.size_ = s->count;
+    return true;
+  }
+
+  template<typename T>
+  bool get(const std::string& name, vector<T>& result) const {
+    View<T> view;
+    if (!get(name, view)) { return false; }
+    result.assign(view.begin(), view.end());
+    return true;
+  }
+};
+
+//
+// Index checks
+//
+
+// indptr[0] = 0 <= indptr[1] <= ... <= indptr[n] = nnz
+inline bool isIndptr(const vector<size_t>& indptr, size_t nnz) {
+  if (indptr.empty() || indptr.front() != 0 || indptr.back() != nnz) { return false; }
+  return std::is_sorted(indptr.begin(), indptr.end());
+}
+
+template<typename T>
+bool allBelow(const vector<T>& indices, size_t n) {
+  return std::all_of(indices.begin(), indices.end(), [n](T i) { return size_t(i) < n; });
+}
+
+// `perm` is a permutation of [0, n) and `perm_inv` its inverse
+inline bool isPermutation(const vector<size_t>& perm, const vector<size_t>& perm_inv) {
+  size_t n = perm.size();
+  if (perm_inv.size() != n) { return false; }
+  for (size_t i = 0; i < n; i++) {
+    if (perm[i] >= n || perm_inv[perm[i]] != i) { return false; }
+  }
+  return true;
+}
+
+//
+// Composite structures (stored as "<prefix>.<field>" sections)
+//
+
+template<typename T>
+void write(Writer& writer, const std::string& prefix, const Matrix<T>& a) {
+  writer.add(prefix + ".shape", a.shape_.data(), 2);
+  writer.add(prefix + ".data", a.data_);
+}
+
+template<typename T>
+bool read(const File& file, const std::string& prefix, Matrix<T>& a) {
+  View<size_t> shape;
+  if (!file.get(prefix + ".shape", shape) || shape.size_ != 2) { return false; }
+  if (!file.get(prefix + ".data", a.data_) || a.data_.size() != shape[0] * shape[1]) { return false; }
+  a.shape_[0] = shape[0];
+  a.shape_[1] = shape[1];
+  return true;
+}
+
+template<typename T>
+void write(Writer& writer, const std::string& prefix, const MatrixCSR<T>& a) {
+  writer.add(prefix + ".shape", a.shape_, 2);
+  writer.add(prefix + ".indptr", a.indptr_);
+  writer.add(prefix + ".indices", a.indices_);
+  writer.add(prefix + ".data", a.data_);
+}
+
+template<typename T>
+bool read(const File& file, const std::string& prefix, MatrixCSR<T>& a) {
+  View<size_t> shape;
+  if (!file.get(prefix + ".shape", shape) || shape.size_ != 2) { return false; }
+  if (!file.get(prefix + ".indptr", a.indptr_) || !file.get(prefix + ".indices", a.indices_) ||
+      !file.get(prefix + ".data", a.data_)) {
+    return false;
+  }
+  if (a.indptr_.size() != shape[0] + 1 || a.indices_.size() != a.data_.size() ||
+      !isIndptr(a.indptr_, a.indices_.size()) || !allBelow(a.indices_, shape[1])) {
+    return false;
+  }
+  a.shape_[0] = shape[0];
+  a.shape_[1] = shape[1];
+  return true;
+}
+
+// Symbolic and numeric factorization (`factorize` can still be called with new values after `read`)
+template<typename T>
+void write(Writer& writer, const std::string& prefix, const cholesky::Cholesky<T>& a) {
+  assert(a.factorized_);
+  writer.add(prefix + ".perm", a.perm_);
+  writer.add(prefix + ".perm_inv", a.perm_inv_);
+  write(writer, prefix + ".C", a.C_);
+  writer.add(prefix + ".C_map", a.C_map_);
+  write(writer, prefix + ".L", a.L_);
+  writer.add(prefix + ".super", a.super_);
+}
+
+template<typename T>
+bool read(const File& file, const std::string& prefix, cholesky::Cholesky<T>& a) {
+  if (!file.get(prefix + ".perm", a.perm_) || !file.get(prefix + ".perm_inv", a.perm_inv_) ||
+      !read(file, prefix + ".C", a.C_) || !file.get(prefix + ".C_map", a.C_map_) ||
+      !read(file, prefix + ".L", a.L_) || !file.get(prefix + ".super", a.super_)) {
+    return false;
+  }
+  size_t n = a.perm_.size();
+  if (!isPermutation(a.perm_, a.perm_inv_)) { return false; }
+  if (a.L_.shape_[0] != n || a.L_.shape_[1] != n || a.C_.shape_[0] != n || a.C_.shape_[1] != n) { return false; }
+  size_t C_nnz = a.C_.nnz();
+  if (!std::all_of(a.C_map_.begin(), a.C_map_.end(), [&](size_t q) { return q < C_nnz || q == cholesky::kNone; })) {
+    return false;
+  }
+  // Supernodes partition [0, n)
+  auto& super = a.super_;
+  if (super.empty() || super.front() != 0 || super.back() != n) { return false; }
+  if (std::adjacent_find(super.begin(), super.end(), std::greater_equal<size_t>()) != super.end()) { return false; }
+  // Each column of L starts with its diagonal followed by increasing rows, and columns of a supernode
+  // are the trapezoid of its first column (as `factorize` and `solve` index them)
+  auto& L = a.L_;
+  for (size_t s = 0; s + 1 < super.size(); s++) {
+    size_t first = super[s];
+    size_t length = L.indptr_[first + 1] - L.indptr_[first];
+    for (size_t j = first; j < super[s + 1]; j++) {
+      size_t p0 = L.indptr_[j], p1 = L.indptr_[j + 1];
+      if (p1 == p0 || p1 - p0 + (j - first) != length || L.indices_[p0] != j) { return false; }
+      if (std::adjacent_find(L.indices_.begin() + p0, L.indices_.begin() + p1, std::greater_equal<size_t>()) !=
+          L.indices_.begin() + p1) {
+        return false;
+      }
+    }
+  }
+  a.n_ = n;
+  a.initWorkspace();
+  a.analyzed_ = true;
+  a.factorized_ = true;
+  return true;
+}
+
+//
+// ProjectiveDynamics (mesh, handles, E and its factorization)
+//
+
+inline bool save(const std::string& path, uint64_t key, const physics::ProjectiveDynamics& solver) {
+  Writer writer;
+  size_t sizes[3] = {solver.nV_, solver.nC3_, solver.nH_};
+  writer.add("sizes", sizes, 3);
+  write(writer, "verts", solver.verts_);
+  writer.add("c3xc0", solver.c3xc0_);
+  writer.add("handles", solver.handles_);
+  write(writer, "handle_targets", solver.handle_targets_);
+  write(writer, "E", solver.E_);
+  if (solver.refinement_iteration_ > 0) {
+    write(writer, "E_high", solver.E_refinement_.A_);
+    write(writer, "E_cholesky", solver.E_refinement_.cholesky_);
+  } else {
+    write(writer, "E_cholesky", solver.E_cholesky_);
+  }
+  return writer.write(path, key);
+}
+
+// Configuration (e.g. `refinement_iteration_`, `strain_stiffness_`) must be set same as `save`
+// and `solver` is left untouched when this returns false
+inline bool load(const std::string& path, uint64_t key, physics::ProjectiveDynamics& solver) {
+  File file;
+  if (!file.open(path, key)) { return false; }
+  View<size_t> sizes;
+  if (!file.get("sizes", sizes) || sizes.size_ != 3) { return false; }
+  size_t nV = sizes[0], nC3 = sizes[1], nH = sizes[2];
+
+  Matrix<float> verts, handle_targets;
+  vector<uint32_t> c3xc0, handles;
+  MatrixCSR<float> E;
+  MatrixCSR<double> E_high;
+  cholesky::Cholesky<float> E_cholesky;
+  bool refinement = solver.refinement_iteration_ > 0;
+  if (!read(file, "verts", verts) || verts.shape_[0] != nV || verts.shape_[1] != 3) { return false; }
+  if (!file.get("c3xc0", c3xc0) || c3xc0.size() != 4 * nC3) { return false; }
+  if (!file.get("handles", handles) || handles.size() != nH) { return false; }
+  if (!read(file, "handle_targets", handle_targets) || handle_targets.shape_[0] != nH) { return false; }
+  if (!allBelow(c3xc0, nV) || !allBelow(handles, nV)) { return false; }
+  if (!read(file, "E", E) || E.shape_[0] != nV || E.shape_[1] != nV) { return false; }
+  if (refinement && (!read(file, "E_high", E_high) || E_high.indptr_ != E.indptr_ || E_high.indices_ != E.indices_)) {
+    return false;
+  }
+  if (!read(file, "E_cholesky", E_cholesky) || E_cholesky.n_ != nV || E_cholesky.C_map_.size() != E.nnz()) {
+    return false;
+  }
+
+  solver.nV_ = nV;
+  solver.nC3_ = nC3;
+  solver.nH_ = nH;
+  solver.verts_ = std::move(verts);
+  solver.c3xc0_ = std::move(c3xc0);
+  solver.handles_ = std::move(handles);
+  solver.handle_targets_ = std::move(handle_targets);
+  solver.initState();
+  solver.E_ = std::move(E);
+  if (refinement) {
+    solver.E_refinement_.A_ = std::move(E_high);
+    solver.E_refinement_.cholesky_ = std::move(E_cholesky);
+  } else {
+    solver.E_cholesky_ = std::move(E_cholesky);
+  }
+  return true;
+}
+
+} // namespace cache
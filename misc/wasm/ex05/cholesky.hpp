@@ -0,0 +1,598 @@
+#pragma once
+
+//
+// Sparse Cholesky decomposition P A PT = L LT (cf. MatrixCSR.choleskyComputeV3 in src/utils/array.js)
+//
+// - analyze   : fill-reducing ordering P (nested dissection by default) and symbolic factorization
+//               (pattern of L and its supernodes)
+// - factorize : numeric factorization (supernodal left-looking with dense 4-column blocks), which can be repeated
+//               for new values of A as long as the pattern of A is same as the one given to `analyze`
+// - solve     : forward/back substitution for multiple right hand sides
+//
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+#include <tuple>
+#include <utility>
+#include <vector>
+#include "matrix.hpp"
+#include "thread_pool.hpp"
+#include "trace.hpp"
+
+namespace cholesky {
+
+using std::vector;
+
+constexpr size_t kNone = std::numeric_limits<size_t>::max();
+constexpr size_t kParallelWork = 1 << 18; // flops of dense update split among threads
+
+enum class Ordering { kNatural, kRCM, kND };
+
+// Reverse Cuthill-McKee ordering (returns permutation "new index -> old index")
+// assuming A has symmetric pattern
+template<typename T>
+vector<size_t> orderingRCM(const MatrixCSR<T>& A) {
+  size_t n = A.shape_[0];
+  vector<size_t> degree(n);
+  for (size_t i = 0; i < n; i++) {
+    degree[i] = A.indptr_[i + 1] - A.indptr_[i];
+  }
+
+  vector<size_t> order; // Cuthill-McKee order (reversed at the end)
+  order.reserve(n);
+  vector<size_t> level(n, kNone);
+  vector<size_t> neighbors;
+
+  // BFS from `root` where neighbors are visited by increasing degree
+  // and returns the last node (i.e. one of the farthest from root)
+  auto bfs = [&](size_t root, size_t tag, bool record) {
+    size_t head = order.size();
+    order.push_back(root);
+    level[root] = tag;
+    size_t last = root;
+    for (size_t q = head; q < order.size(); q++) {
+      size_t i = order[q];
+      last = i;
+      neighbors.clear();
+      for (auto p = A.indptr_[i]; p < A.indptr_[i + 1]; p++) {
+        size_t j = A.indices_[p];
+        if (level[j] == tag) { continue; }
+        level[j] = tag;
+        neighbors.push_back(j);
+      }
+      std::sort(neighbors.begin(), neighbors.end(), [&](size_t a, size_t b) {
+        return degree[a] < degree[b];
+      });
+      order.insert(order.end(), neighbors.begin(), neighbors.end());
+    }
+    if (!record) {
+      // Rollback so that the component can be traversed again
+      for (size_t q = head; q < order.size(); q++) { level[order[q]] = kNone; }
+      order.resize(head);
+    }
+    return last;
+  };
+
+  for (size_t start = 0; start < n; start++) {
+    if (level[start] != kNone) { continue; }
+
+    // Pseudo-peripheral node by two BFS sweeps (the farthest from the farthest)
+    size_t root = start;
+    for (size_t k = 0; k < 2; k++) {
+      root = bfs(root, n + k, false);
+    }
+
+    bfs(root, n + 2, true);
+  }
+
+  std::reverse(order.begin(), order.end());
+  return order;
+}
+
+// Nested dissection ordering (returns permutation "new index -> old index") assuming A has symmetric pattern
+//   - Each part is split by a level set of BFS from pseudo-peripheral node (the smallest level
+//     with 30%-70% of nodes before it) and the separator is ordered after both halves.
+//   - Separator nodes without neighbor on the far side are moved to the near half.
+//   - Disconnected parts are split without separator and parts up to `leaf_size` are kept in BFS order.
+template<typename T>
+vector<size_t> orderingND(const MatrixCSR<T>& A, size_t leaf_size = 16) {
+  size_t n = A.shape_[0];
+  vector<size_t> order(n);
+  if (n == 0) { return order; }
+  vector<size_t> part(n, 0); // id of the part containing each node
+  vector<size_t> level(n);
+  vector<size_t> queue;
+  size_t num_parts = 1;
+
+  // (nodes, first position in order)
+  vector<std::pair<vector<size_t>, size_t>> stack;
+  {
+    vector<size_t> all(n);
+    for (size_t i = 0; i < n; i++) { all[i] = i; }
+    stack.push_back({std::move(all), 0});
+  }
+
+  // BFS within part `id` from `root` (returns the last node and fills `queue` and `level`)
+  auto bfs = [&](size_t root, size_t id) {
+    queue.clear();
+    queue.push_back(root);
+    level[root] = 0;
+    size_t visited = num_parts++; // temporary id for visited nodes (restored below)
+    part[root] = visited;
+    for (size_t q = 0; q < queue.size(); q++) {
+      size_t i = queue[q];
+      for (auto p = A.indptr_[i]; p < A.indptr_[i + 1]; p++) {
+        size_t j = A.indices_[p];
+        if (part[j] != id) { continue; }
+        part[j] = visited;
+        level[j] = level[i] + 1;
+        queue.push_back(j);
+      }
+    }
+    for (auto i : queue) { part[i] = id; }
+    return queue.back();
+  };
+
+  while (!stack.empty()) {
+    auto [nodes, begin] = std::move(stack.back());
+    stack.pop_back();
+    size_t id = part[nodes[0]];
+
+    size_t root = bfs(bfs(nodes[0], id), id);
+    bfs(root, id);
+    if (queue.size() < nodes.size()) {
+      // Disconnected (component of `root` and the rest)
+      size_t id_rest = num_parts++;
+      for (auto i : nodes) { part[i] = id_rest; }
+      for (auto i : queue) { part[i] = id; }
+      vector<size_t> rest;
+      for (auto i : nodes) {
+        if (part[i] == id_rest) { rest.push_back(i); }
+      }
+      size_t size = queue.size();
+      stack.push_back({queue, begin});
+      stack.push_back({std::move(rest), begin + size});
+      continue;
+    }
+    if (nodes.size() <= leaf_size) {
+      std::copy(queue.begin(), queue.end(), order.begin() + begin);
+      continue;
+    }
+
+    // Level sizes and separator level
+    size_t num_levels = level[queue.back()] + 1;
+    vector<size_t> level_begin(num_levels + 1, 0);
+    for (auto i : queue) { level_begin[level[i] + 1]++; }
+    for (size_t l = 0; l < num_levels; l++) { level_begin[l + 1] += level_begin[l]; }
+    size_t m = nodes.size();
+    size_t best = num_levels / 2;
+    for (size_t l = 1; l + 1 < num_levels; l++) {
+      if (10 * level_begin[l] < 3 * m || 10 * level_begin[l] > 7 * m) { continue; }
+      if (level_begin[l + 1] - level_begin[l] < level_begin[best + 1] - level_begin[best]) { best = l; }
+    }
+    if (best == 0 || best + 1 >= num_levels) {
+      std::copy(queue.begin(), queue.end(), order.begin() + begin); // path-like part without useful separator
+      continue;
+    }
+
+    // Near half (level < best), far half (level > best) and separator
+    vector<size_t> near, far, separator;
+    for (auto i : queue) {
+      if (level[i] < best) {
+        near.push_back(i);
+      } else if (level[i] > best) {
+        far.push_back(i);
+      } else {
+        bool touches_far = false;
+        for (auto p = A.indptr_[i]; p < A.indptr_[i + 1] && !touches_far; p++) {
+          size_t j = A.indices_[p];
+          touches_far = part[j] == id && level[j] == best + 1;
+        }
+        (touches_far ? separator : near).push_back(i);
+      }
+    }
+    size_t id_near = num_parts++;
+    size_t id_far = num_parts++;
+    size_t id_separator = num_parts++;
+    for (auto i : near) { part[i] = id_near; }
+    for (auto i : far) { part[i] = id_far; }
+    for (auto i : separator) { part[i] = id_separator; }
+    std::copy(separator.begin(), separator.end(), order.begin() + begin + near.size() + far.size());
+    size_t size = near.size();
+    stack.push_back({std::move(near), begin});
+    stack.push_back({std::move(far), begin + size});
+  }
+  return order;
+}
+
+template<typename T>
+struct Cholesky {
+  size_t n_ = 0;
+
+  // P A PT where A[perm_[i], perm_[j]] = (P A PT)[i, j]
+  vector<size_t> perm_;
+  vector<size_t> perm_inv_;
+
+  // Lower triangle of P A PT as CSC (i.e. MatrixCSR of upper triangle)
+  // and A.data_ index -> C_.data_ index (kNone for the entries in upper triangle)
+  MatrixCSR<T> C_;
+  vector<size_t> C_map_;
+
+  // L as CSC where diagonal comes first in each column (same as choleskyComputeV3)
+  MatrixCSR<T> L_;
+
+  // Supernodes i.e. consecutive columns [super_[s], super_[s + 1]) with the same pattern below the diagonal block.
+  // Column j of supernode s is a dense trapezoid in L_ (rows are L_.indices_ of column super_[s] from j on).
+  vector<size_t> super_;
+  vector<size_t> super_of_; // column -> supernode
+
+  // Workspaces (reused across calls)
+  vector<size_t> rel_;  // row -> position in rows of current supernode
+  vector<size_t> head_; // supernode -> first descendant to be applied
+  vector<size_t> next_; // descendant -> next one in the same list
+  vector<size_t> ptr_;  // descendant -> first row not applied yet
+  vector<T> update_;    // dense update from descendant
+  Matrix<T> y_;
+
+  bool analyzed_ = false;
+  bool factorized_ = false;
+
+  void analyze(const MatrixCSR<T>& A, Ordering ordering = Ordering::kND) {
+    assert(A.shape_[0] == A.shape_[1]);
+    size_t n = n_ = A.shape_[0];
+
+    // 1. Ordering
+    if (ordering == Ordering::kRCM) {
+      perm_ = orderingRCM(A);
+    } else if (ordering == Ordering::kND) {
+      perm_ = orderingND(A);
+    } else {
+      perm_.resize(n);
+      for (size_t i = 0; i < n; i++) { perm_[i] = i; }
+    }
+    perm_inv_.resize(n);
+    for (size_t i = 0; i < n; i++) { perm_inv_[perm_[i]] = i; }
+
+    // 2. Permuted lower triangle C (CSC with sorted unique indices)
+    {
+      vector<size_t> counts(n + 1, 0);
+      for (size_t r = 0; r < n; r++) {
+        for (auto p = A.indptr_[r]; p < A.indptr_[r + 1]; p++) {
+          size_t i = perm_inv_[r];
+          size_t j = perm_inv_[A.indices_[p]];
+          if (i >= j) { counts[j + 1]++; }
+        }
+      }
+      for (size_t j = 0; j < n; j++) { counts[j + 1] += counts[j]; }
+
+      // Unsorted CSC with possible duplicates
+      vector<size_t> indptr = counts;
+      vector<size_t> indices(indptr[n]);
+      vector<size_t> sources(indptr[n]);
+      for (size_t r = 0; r < n; r++) {
+        for (auto p = A.indptr_[r]; p < A.indptr_[r + 1]; p++) {
+          size_t i = perm_inv_[r];
+          size_t j = perm_inv_[A.indices_[p]];
+          if (i < j) { continue; }
+          size_t q = counts[j]++;
+          indices[q] = i;
+          sources[q] = p;
+        }
+      }
+
+      // Sort each column and merge duplicates
+      C_ = MatrixCSR<T>(n, n, 0);
+      C_map_.assign(A.nnz(), kNone);
+      vector<size_t> order;
+      for (size_t j = 0; j < n; j++) {
+        order.resize(indptr[j + 1] - indptr[j]);
+        for (size_t k = 0; k < order.size(); k++) { order[k] = indptr[j] + k; }
+        std::sort(order.begin(), order.end(), [&](size_t a, size_t b) { return indices[a] < indices[b]; });
+        for (auto q : order) {
+          if (C_.indices_.size() == C_.indptr_[j] || C_.indices_.back() != indices[q]) {
+            C_.indices_.push_back(indices[q]);
+          }
+          C_map_[sources[q]] = C_.indices_.size() - 1;
+        }
+        C_.indptr_[j + 1] = C_.indices_.size();
+      }
+      C_.data_.resize(C_.indices_.size());
+    }
+
+    // 3. Elimination tree and column counts (same as choleskyComputeV3 but on transposed C)
+    //    where "row k of lower triangle" = "column k of C^T" = the entries C[k, i] (i < k)
+    //    so we first make row-wise view of C's pattern
+    vector<size_t> Crow_indptr(n + 1, 0);
+    vector<size_t> Crow_indices(C_.nnz());
+    {
+      for (auto i : C_.indices_) { Crow_indptr[i + 1]++; }
+      for (size_t i = 0; i < n; i++) { Crow_indptr[i + 1] += Crow_indptr[i]; }
+      vector<size_t> heads(Crow_indptr.begin(), Crow_indptr.end() - 1);
+      for (size_t j = 0; j < n; j++) {
+        for (auto p = C_.indptr_[j]; p < C_.indptr_[j + 1]; p++) {
+          Crow_indices[heads[C_.indices_[p]]++] = j; // sorted since j increases
+        }
+      }
+    }
+
+    vector<size_t> etree(n, kNone);
+    vector<size_t> visited(n, kNone);
+    vector<size_t> counts(n, 1); // column counts of L
+    for (size_t k = 0; k < n; k++) {
+      visited[k] = k;
+      for (auto p = Crow_indptr[k]; p < Crow_indptr[k + 1]; p++) {
+        size_t i0 = Crow_indices[p];
+        if (i0 == k) { break; }
+        // Follow elimination tree
+        for (size_t i = i0; visited[i] != k; i = etree[i]) {
+          if (etree[i] == kNone) { etree[i] = k; }
+          visited[i] = k;
+          counts[i]++;
+        }
+      }
+    }
+
+    // 4. Pattern of L (row indices within each column are sorted since k increases)
+    L_ = MatrixCSR<T>(n, n, 0);
+    for (size_t j = 0; j < n; j++) { L_.indptr_[j + 1] = L_.indptr_[j] + counts[j]; }
+    L_.indices_.resize(L_.indptr_[n]);
+    L_.data_.resize(L_.indptr_[n]);
+
+    std::fill(visited.begin(), visited.end(), kNone);
+    vector<size_t> heads(n);
+    for (size_t k = 0; k < n; k++) {
+      visited[k] = k;
+      L_.indices_[L_.indptr_[k]] = k;
+      heads[k] = L_.indptr_[k] + 1;
+      for (auto p = Crow_indptr[k]; p < Crow_indptr[k + 1]; p++) {
+        size_t i0 = Crow_indices[p];
+        if (i0 == k) { break; }
+        for (size_t i = i0; visited[i] != k; i = etree[i]) {
+          visited[i] = k;
+          L_.indices_[heads[i]++] = k;
+        }
+      }
+    }
+
+    // 5. Supernodes (column j + 1 has the pattern of column j without j when j + 1 is the parent with one less count)
+    super_.assign(1, 0);
+    for (size_t j = 0; j < n; j++) {
+      if (j + 1 < n && etree[j] == j + 1 && counts[j] == counts[j + 1] + 1) { continue; }
+      super_.push_back(j + 1);
+    }
+
+    initWorkspace();
+    analyzed_ = true;
+    factorized_ = false;
+  }
+
+  void initWorkspace() {
+    size_t num_supers = super_.size() - 1;
+    super_of_.resize(n_);
+    for (size_t s = 0; s < num_supers; s++) {
+      std::fill(super_of_.begin() + super_[s], super_of_.begin() + super_[s + 1], s);
+    }
+    rel_.assign(n_, 0);
+    head_.assign(num_supers, kNone);
+    next_.assign(num_supers, kNone);
+    ptr_.assign(num_supers, 0);
+  }
+
+  // Returns false when A is not positive definite
+  bool factorize(const MatrixCSR<T>& A) {
+    TRACE_ZONE("cholesky::Cholesky::factorize");
+    TRACE_COUNTER("cholesky nnz(L)", double(L_.nnz()));
+    assert(analyzed_);
+    assert(A.nnz() == C_map_.size());
+
+    // Gather values of A into C
+    std::fill(C_.data_.begin(), C_.data_.end(), 0);
+    for (size_t p = 0; p < C_map_.size(); p++) {
+      if (C_map_[p] != kNone) {
+        C_.data_[C_map_[p]] += A.data_[p];
+      }
+    }
+
+    // Supernodal left-looking: supernode s is updated by the descendants d having rows in its columns.
+    // Each descendant is kept in the list `head_` of the next supernode it updates (i.e. the one of row ptr_[d]).
+    size_t num_supers = super_.size() - 1;
+    auto column = [&](size_t j, size_t first) { return &L_.data_[L_.indptr_[j]] - (j - first); }; // indexed by row position
+    auto link = [&](size_t d, size_t p) {
+      size_t f = super_[d];
+      if (p == L_.indptr_[f + 1] - L_.indptr_[f]) { return; }
+      size_t t = super_of_[L_.indices_[L_.indptr_[f] + p]];
+      ptr_[d] = p;
+      next_[d] = head_[t];
+      head_[t] = d;
+    };
+    std::fill(head_.begin(), head_.end(), kNone);
+    auto& pool = thread_pool::getDefault();
+    factorized_ = false;
+    for (size_t s = 0; s < num_supers; s++) {
+      size_t f = super_[s];
+      size_t l = super_[s + 1];
+      const size_t* rows = &L_.indices_[L_.indptr_[f]];
+      size_t m = L_.indptr_[f + 1] - L_.indptr_[f];
+      for (size_t r = 0; r < m; r++) { rel_[rows[r]] = r; }
+
+      // Scatter C[:, f:l]
+      for (size_t j = f; j < l; j++) {
+        T* x = column(j, f);
+        std::fill(x + (j - f), x + m, T(0));
+        for (auto p = C_.indptr_[j]; p < C_.indptr_[j + 1]; p++) {
+          x[rel_[C_.indices_[p]]] = C_.data_[p];
+        }
+      }
+
+      // Dense update L[rows_d[p1:], d] L[rows_d[p1:p2], d]^T from each descendant d (where rows_d[p1:p2] are in [f, l))
+      for (size_t d = head_[s], d_next; d != kNone; d = d_next) {
+        d_next = next_[d];
+        size_t fd = super_[d];
+        size_t wd = super_[d + 1] - fd;
+        const size_t* rows_d = &L_.indices_[L_.indptr_[fd]];
+        size_t md = L_.indptr_[fd + 1] - L_.indptr_[fd];
+        size_t p1 = ptr_[d];
+        size_t p2 = p1;
+        while (p2 < md && rows_d[p2] < l) { p2++; }
+        size_t mu = md - p1;
+        if (update_.size() < mu * (p2 - p1)) { update_.resize(mu * (p2 - p1)); }
+        // 4 columns at once so that each column of d is read once per block (rows above the diagonal are unused).
+        // Blocks update distinct columns of s, thus large updates are split among threads.
+        size_t nc = p2 - p1;
+        auto updateBlock = [&](size_t block) {
+          size_t c0 = 4 * block;
+          size_t cb = std::min<size_t>(4, nc - c0);
+          T* u = &update_[c0 * mu];
+          std::fill(u + c0, u + cb * mu, T(0));
+          for (size_t k = 0; k < wd; k++) {
+            const T* x = column(fd + k, fd) + p1;
+            if (cb == 4) {
+              T a0 = x[c0], a1 = x[c0 + 1], a2 = x[c0 + 2], a3 = x[c0 + 3];
+              for (size_t r = c0; r < mu; r++) {
+                T xr = x[r];
+                u[r] += xr * a0;
+                u[mu + r] += xr * a1;
+                u[2 * mu + r] += xr * a2;
+                u[3 * mu + r] += xr * a3;
+              }
+            } else {
+              for (size_t i = 0; i < cb; i++) {
+                T a = x[c0 + i];
+                for (size_t r = c0; r < mu; r++) { u[i * mu + r] += x[r] * a; }
+              }
+            }
+          }
+          for (size_t i = 0, c = c0; i < cb; i++, c++) {
+            T* y = column(rows_d[p1 + c], f);
+            for (size_t r = c; r < mu; r++) { y[rel_[rows_d[p1 + r]]] -= u[i * mu + r]; }
+          }
+        };
+        size_t num_blocks = (nc + 3) / 4;
+        if (mu * nc * wd >= kParallelWork) {
+          pool.parallelFor(0, num_blocks, 0, [&](size_t b0, size_t b1) {
+            for (size_t block = b0; block < b1; block++) { updateBlock(block); }
+          });
+        } else {
+          for (size_t block = 0; block < num_blocks; block++) { updateBlock(block); }
+        }
+        link(d, p2);
+      }
+
+      // Dense factorization of supernode (left-looking within its columns by blocks of 4 columns)
+      size_t w = l - f;
+      for (size_t c0 = 0; c0 < w; c0 += 4) {
+        size_t cb = std::min<size_t>(4, w - c0);
+        T* x[4] = {};
+        for (size_t i = 0; i < cb; i++) { x[i] = column(f + c0 + i, f); }
+        // Triangle of the block then 4 columns at once (split by rows among threads when large)
+        for (size_t k = 0; k < c0; k++) {
+          const T* y = column(f + k, f);
+          for (size_t i = 0; i < cb; i++) {
+            T a = y[c0 + i];
+            for (size_t r = c0 + i; r < c0 + cb; r++) { x[i][r] -= y[r] * a; }
+          }
+        }
+        auto updateRows = [&](size_t r0, size_t r1) {
+          for (size_t k = 0; k < c0; k++) {
+            const T* y = column(f + k, f);
+            if (cb == 4) {
+              T a0 = y[c0], a1 = y[c0 + 1], a2 = y[c0 + 2], a3 = y[c0 + 3];
+              for (size_t r = r0; r < r1; r++) {
+                T yr = y[r];
+                x[0][r] -= yr * a0;
+                x[1][r] -= yr * a1;
+                x[2][r] -= yr * a2;
+                x[3][r] -= yr * a3;
+              }
+            } else {
+              for (size_t i = 0; i < cb; i++) {
+                T a = y[c0 + i];
+                for (size_t r = r0; r < r1; r++) { x[i][r] -= y[r] * a; }
+              }
+            }
+          }
+        };
+        size_t r_begin = std::min(c0 + cb, m);
+        if ((m - r_begin) * c0 * cb >= kParallelWork) {
+          pool.parallelFor(r_begin, m, 0, updateRows);
+        } else {
+          updateRows(r_begin, m);
+        }
+        for (size_t i = 0; i < cb; i++) {
+          size_t c = c0 + i;
+          for (size_t k = 0; k < i; k++) {
+            T a = x[k][c];
+            for (size_t r = c; r < m; r++) { x[i][r] -= x[k][r] * a; }
+          }
+          T Ljj2 = x[i][c];
+          if (!(Ljj2 > 0)) { return false; }
+          T Ljj = std::sqrt(Ljj2);
+          x[i][c] = Ljj;
+          for (size_t r = c + 1; r < m; r++) { x[i][r] /= Ljj; }
+        }
+      }
+      link(s, w);
+    }
+    factorized_ = true;
+    return true;
+  }
+
+  bool compute(const MatrixCSR<T>& A, Ordering ordering = Ordering::kND) {
+    analyze(A, ordering);
+    return factorize(A);
+  }
+
+  // A x = b
+  void solve(Matrix<T>& x, const Matrix<T>& b) {
+    TRACE_ZONE("cholesky::Cholesky::solve");
+    assert(factorized_);
+    assert(b.shape_[0] == n_);
+    assert(x.shape_[0] == n_);
+    assert(x.shape_[1] == b.shape_[1]);
+    size_t n = n_;
+    size_t K = b.shape_[1];
+
+    // y = P b
+    auto& y = y_;
+    if (y.shape_[0] != n || y.shape_[1] != K) { y.resize(n, K); }
+    for (size_t i = 0; i < n; i++) {
+      for (size_t k = 0; k < K; k++) {
+        y(i, k) = b(perm_[i], k);
+      }
+    }
+
+    // L y' = y
+    for (size_t j = 0; j < n; j++) { // Loop L col
+      size_t p = L_.indptr_[j];
+      T Ljj = L_.data_[p];
+      for (size_t k = 0; k < K; k++) { y(j, k) /= Ljj; }
+      for (p++; p < L_.indptr_[j + 1]; p++) { // Loop L row
+        size_t i = L_.indices_[p];
+        T Lij = L_.data_[p];
+        for (size_t k = 0; k < K; k++) { y(i, k) -= Lij * y(j, k); }
+      }
+    }
+
+    // LT y'' = y'
+    for (size_t j = n; j-- > 0;) { // Loop LT row from bottom
+      size_t p = L_.indptr_[j];
+      T Ljj = L_.data_[p];
+      for (p++; p < L_.indptr_[j + 1]; p++) { // Loop LT col
+        size_t i = L_.indices_[p];
+        T Lij = L_.data_[p];
+        for (size_t k = 0; k < K; k++) { y(j, k) -= Lij * y(i, k); }
+      }
+      for (size_t k = 0; k < K; k++) { y(j, k) /= Ljj; }
+    }
+
+    // x = PT y''
+    for (size_t i = 0; i < n; i++) {
+      for (size_t k = 0; k < K; k++) {
+        x(perm_[i], k) = y(i, k);
+      }
+    }
+  }
+};
+
+} // namespace cholesky
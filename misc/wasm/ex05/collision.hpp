@@ -0,0 +1,701 @@
+#pragma once
+
+//
+// Collision detection of tetrahedral mesh for ProjectiveDynamics (Example02 in src/utils/physics.js has no collision)
+//   - Bvh is linear BVH (Karras, "Maximizing Parallelism in the Construction of BVHs, Octrees, and k-d Trees"):
+//     primitives are sorted by 30 bit morton code of box centers (parallel radix sort), each internal node is
+//     found independently from the sorted codes, and `refit` updates boxes of disjoint subtrees in parallel
+//     (post-order per subtree) and then the few nodes above them.
+//   - SpatialHash is uniform grid hashed into a counting sorted table (broad phase alternative for primitives of similar size).
+//   - Collision keeps at most one contact per surface vertex
+//     - vertex inside a tetrahedron (tetrahedron Bvh) -> nearest surface triangle (branch and bound on triangle Bvh)
+//     - otherwise nearest surface triangle within `thickness_` in front of it (triangle Bvh or SpatialHash)
+//     and each contact is a projection block (A x = x_v) whose target is x_v projected onto the half space
+//     n . (y - c) >= thickness where c is the point on the triangle with barycentric coordinates fixed by `detect`.
+//     `project` computes all targets in parallel as a local step (cf. misc::solve for volume strain).
+//
+
+#include <algorithm>
+#include <array>
+#include <cassert>
+#include <cmath>
+#include <cstdint>
+#include <vector>
+#include <glm/glm.hpp>
+#include "matrix.hpp"
+#include "thread_pool.hpp"
+#include "trace.hpp"
+
+namespace collision {
+
+using std::vector;
+using glm::vec3;
+
+constexpr uint32_t kNone = ~uint32_t(0);
+constexpr size_t kStackSize = 96; // depth of Bvh is at most 30 (code) + 32 (index) bits
+
+//
+// Box is 6 floats (lo x, y, z, hi x, y, z)
+//
+
+inline bool overlap(const float* a, const float* b) {
+  return a[0] <= b[3] && b[0] <= a[3] && a[1] <= b[4] && b[1] <= a[4] && a[2] <= b[5] && b[2] <= a[5];
+}
+
+inline void merge(const float* a, const float* b, float* result) {
+  for (size_t k = 0; k < 3; k++) {
+    result[k] = std::min(a[k], b[k]);
+    result[k + 3] = std::max(a[k + 3], b[k + 3]);
+  }
+}
+
+// Strictly inside box
+inline bool insideBox(const float* box, const vec3& p) {
+  return box[0] < p[0] && p[0] < box[3] && box[1] < p[1] && p[1] < box[4] && box[2] < p[2] && p[2] < box[5];
+}
+
+// Squared distance from point to box
+inline float distance2(const float* box, const vec3& p) {
+  float result = 0;
+  for (int k = 0; k < 3; k++) {
+    float d = std::max({box[k] - p[k], 0.0f, p[k] - box[k + 3]});
+    result += d * d;
+  }
+  return result;
+}
+
+// Boxes of simplices with `K` vertices each (enlarged by `margin`)
+template<size_t K>
+void computeBoxes(const Matrix<float>& verts, const vector<uint32_t>& simplices, float margin, vector<float>& boxes) {
+  size_t n = simplices.size() / K;
+  boxes.resize(6 * n);
+  const float* x = verts.data_.data();
+  thread_pool::getDefault().parallelFor(0, n, 0, [&](size_t i0, size_t i1) {
+    for (size_t i = i0; i < i1; i++) {
+      const uint32_t* vs = &simplices[K * i];
+      float* box = &boxes[6 * i];
+      for (size_t c = 0; c < 3; c++) {
+        float lo = x[3 * vs[0] + c], hi = lo;
+        for (size_t j = 1; j < K; j++) {
+          lo = std::min(lo, x[3 * vs[j] + c]);
+          hi = std::max(hi, x[3 * vs[j] + c]);
+        }
+        box[c] = lo - margin;
+        box[c + 3] = hi + margin;
+      }
+    }
+  });
+}
+
+// Spread 10 bits to every third bit
+inline uint32_t expandBits(uint32_t v) {
+  v = (v * 0x00010001u) & 0xFF0000FFu;
+  v = (v * 0x00000101u) & 0x0F00F00Fu;
+  v = (v * 0x00000011u) & 0xC30C30C3u;
+  v = (v * 0x00000005u) & 0x49249249u;
+  return v;
+}
+
+// Morton code of point in [0, 1]^3
+inline uint32_t morton(float x, float y, float z) {
+  auto quantize = [](float t) { return uint32_t(std::clamp(t * 1024.0f, 0.0f, 1023.0f)); };
+  return (expandBits(quantize(x)) << 2) | (expandBits(quantize(y)) << 1) | expandBits(quantize(z));
+}
+
+// LSD radix sort of (key, value) by 30 bit keys (3 passes of 10 bits with histogram and scatter per chunk, stable)
+inline void radixSort(
+    vector<uint32_t>& keys, vector<uint32_t>& values, vector<uint32_t>& keys_tmp, vector<uint32_t>& values_tmp) {
+  constexpr size_t kBits = 10;
+  constexpr size_t kRadix = 1 << kBits;
+  size_t n = keys.size();
+  auto& pool = thread_pool::getDefault();
+  size_t num_chunks = std::clamp<size_t>(n / 4096, 1, 4 * pool.size());
+  vector<size_t> offsets(num_chunks * kRadix);
+  keys_tmp.resize(n);
+  values_tmp.resize(n);
+  for (size_t shift = 0; shift < 3 * kBits; shift += kBits) {
+    std::fill(offsets.begin(), offsets.end(), 0);
+    pool.run(num_chunks, [&](size_t c) {
+      auto count = &offsets[c * kRadix];
+      for (size_t i = n * c / num_chunks; i < n * (c + 1) / num_chunks; i++) {
+        count[(keys[i] >> shift) & (kRadix - 1)]++;
+      }
+    });
+    // Offsets in (digit, chunk) order
+    size_t offset = 0;
+    for (size_t d = 0; d < kRadix; d++) {
+      for (size_t c = 0; c < num_chunks; c++) {
+        size_t count = offsets[c * kRadix + d];
+        offsets[c * kRadix + d] = offset;
+        offset += count;
+      }
+    }
+    pool.run(num_chunks, [&](size_t c) {
+      auto offset = &offsets[c * kRadix];
+      for (size_t i = n * c / num_chunks; i < n * (c + 1) / num_chunks; i++) {
+        size_t p = offset[(keys[i] >> shift) & (kRadix - 1)]++;
+        keys_tmp[p] = keys[i];
+        values_tmp[p] = values[i];
+      }
+    });
+    std::swap(keys, keys_tmp);
+    std::swap(values, values_tmp);
+  }
+}
+
+//
+// Linear BVH
+//
+
+struct Bvh {
+  size_t n_ = 0;
+  vector<float> boxes_;        // 6 (2 n - 1) (internal nodes [0, n - 1) then leaves, root is 0)
+  vector<uint32_t> children_;  // 2 (n - 1)
+  vector<uint32_t> order_;     // n (primitive of each leaf)
+  vector<uint32_t> codes_;     // n (sorted morton codes)
+
+  vector<uint32_t> tops_;      // internal nodes above subtrees (breadth first order)
+  vector<uint32_t> subtrees_;  // roots of disjoint subtrees covering all leaves (refitted in parallel)
+
+  // Workspace
+  vector<uint32_t> codes_tmp_, order_tmp_;
+  vector<float> bounds_;
+
+  bool isLeaf(uint32_t node) const { return node + 1 >= n_; }
+
+  // `boxes` has 6 floats per primitive
+  void build(const vector<float>& boxes) {
+    n_ = boxes.size() / 6;
+    size_t n = n_;
+    boxes_.resize(6 * (2 * n - 1) * (n > 0));
+    children_.resize(2 * (n - 1) * (n > 0));
+    order_.resize(n);
+    codes_.resize(n);
+    if (n == 0) { return; }
+    auto& pool = thread_pool::getDefault();
+
+    // Bounds of box centers (per chunk then merged)
+    size_t num_chunks = std::clamp<size_t>(n / 4096, 1, 4 * pool.size());
+    bounds_.resize(6 * num_chunks);
+    pool.run(num_chunks, [&](size_t c) {
+      float* bounds = &bounds_[6 * c];
+      std::fill(bounds, bounds + 3, INFINITY);
+      std::fill(bounds + 3, bounds + 6, -INFINITY);
+      for (size_t i = n * c / num_chunks; i < n * (c + 1) / num_chunks; i++) {
+        for (size_t k = 0; k < 3; k++) {
+          float x = 0.5f * (boxes[6 * i + k] + boxes[6 * i + k + 3]);
+          bounds[k] = std::min(bounds[k], x);
+          bounds[k + 3] = std::max(bounds[k + 3], x);
+        }
+      }
+    });
+    for (size_t c = 1; c < num_chunks; c++) { merge(&bounds_[0], &bounds_[6 * c], &bounds_[0]); }
+    vec3 lo{bounds_[0], bounds_[1], bounds_[2]};
+    vec3 scale;
+    for (int k = 0; k < 3; k++) { scale[k] = 1.0f / std::max(bounds_[k + 3] - bounds_[k], 1e-30f); }
+
+    // Sort by morton codes
+    pool.parallelFor(0, n, 0, [&](size_t i0, size_t i1) {
+      for (size_t i = i0; i < i1; i++) {
+        auto b = &boxes[6 * i];
+        vec3 x = (0.5f * (vec3{b[0], b[1], b[2]} + vec3{b[3], b[4], b[5]}) - lo) * scale;
+        codes_[i] = morton(x[0], x[1], x[2]);
+        order_[i] = uint32_t(i);
+      }
+    });
+    radixSort(codes_, order_, codes_tmp_, order_tmp_);
+
+    // Internal nodes (duplicate codes are distinguished by index)
+    auto delta = [&](int64_t i, int64_t j) -> int {
+      if (j < 0 || j >= int64_t(n)) { return -1; }
+      uint32_t a = codes_[i], b = codes_[j];
+      return a != b ? __builtin_clz(a ^ b) : 32 + __builtin_clz(uint32_t(i ^ j));
+    };
+    pool.parallelFor(0, n - 1, 0, [&](size_t i0, size_t i1) {
+      for (int64_t i = int64_t(i0); i < int64_t(i1); i++) {
+        // Direction and other end of the range
+        int64_t d = delta(i, i + 1) > delta(i, i - 1) ? 1 : -1;
+        int delta_min = delta(i, i - d);
+        int64_t l_max = 2;
+        while (delta(i, i + l_max * d) > delta_min) { l_max *= 2; }
+        int64_t l = 0;
+        for (int64_t t = l_max / 2; t >= 1; t /= 2) {
+          if (delta(i, i + (l + t) * d) > delta_min) { l += t; }
+        }
+        int64_t j = i + l * d;
+
+        // Split
+        int delta_node = delta(i, j);
+        int64_t s = 0;
+        for (int64_t t = l; t > 1;) {
+          t = (t + 1) / 2;
+          if (delta(i, i + (s + t) * d) > delta_node) { s += t; }
+        }
+        int64_t gamma = i + s * d + std::min<int64_t>(d, 0);
+        uint32_t left = uint32_t(std::min(i, j) == gamma ? n - 1 + gamma : gamma);
+        uint32_t right = uint32_t(std::max(i, j) == gamma + 1 ? n - 1 + gamma + 1 : gamma + 1);
+        children_[2 * i + 0] = left;
+        children_[2 * i + 1] = right;
+      }
+    });
+
+    // Split top levels until there are a few subtrees per thread
+    tops_.clear();
+    subtrees_.assign(1, 0);
+    vector<uint32_t> next;
+    while (subtrees_.size() < 4 * pool.size()) {
+      next.clear();
+      for (auto node : subtrees_) {
+        if (isLeaf(node)) {
+          next.push_back(node);
+          continue;
+        }
+        tops_.push_back(node);
+        next.insert(next.end(), {children_[2 * node], children_[2 * node + 1]});
+      }
+      if (next.size() == subtrees_.size()) { break; }
+      std::swap(subtrees_, next);
+    }
+    refit(boxes);
+  }
+
+  // Update boxes keeping the hierarchy (e.g. every frame between rebuilds)
+  void refit(const vector<float>& boxes) {
+    size_t n = n_;
+    assert(boxes.size() == 6 * n);
+    if (n == 0) { return; }
+    thread_pool::getDefault().run(subtrees_.size(), [&](size_t i) { refitSubtree(subtrees_[i], boxes); });
+    for (size_t i = tops_.size(); i-- > 0;) {
+      uint32_t node = tops_[i];
+      merge(&boxes_[6 * children_[2 * node]], &boxes_[6 * children_[2 * node + 1]], &boxes_[6 * node]);
+    }
+  }
+
+  void refitSubtree(uint32_t node, const vector<float>& boxes) {
+    if (isLeaf(node)) {
+      std::copy_n(&boxes[6 * order_[node - (n_ - 1)]], 6, &boxes_[6 * node]);
+      return;
+    }
+    refitSubtree(children_[2 * node + 0], boxes);
+    refitSubtree(children_[2 * node + 1], boxes);
+    merge(&boxes_[6 * children_[2 * node]], &boxes_[6 * children_[2 * node + 1]], &boxes_[6 * node]);
+  }
+
+  // Call `func(primitive)` for each primitive whose box overlaps `box`
+  template<typename F>
+  void query(const float* box, const F& func) const {
+    if (n_ == 0) { return; }
+    // Children are tested before pushed (stack has only overlapping nodes)
+    uint32_t stack[kStackSize];
+    size_t size = 0;
+    if (overlap(&boxes_[0], box)) { stack[size++] = 0; }
+    while (size > 0) {
+      uint32_t node = stack[--size];
+      if (isLeaf(node)) {
+        func(order_[node - (n_ - 1)]);
+        continue;
+      }
+      assert(size + 2 <= kStackSize);
+      for (size_t j = 0; j < 2; j++) {
+        uint32_t child = children_[2 * node + j];
+        if (overlap(&boxes_[6 * child], box)) { stack[size++] = child; }
+      }
+    }
+  }
+
+  // Primitive minimizing `func(primitive)` (squared distance from `p`, at least the one to its box) below `best2`
+  // (kNone if there is none, `best2` receives the minimum)
+  template<typename F>
+  uint32_t nearest(const vec3& p, float& best2, const F& func) const {
+    if (n_ == 0) { return kNone; }
+    uint32_t result = kNone;
+    uint32_t stack[kStackSize];
+    size_t size = 0;
+    stack[size++] = 0;
+    while (size > 0) {
+      uint32_t node = stack[--size];
+      if (distance2(&boxes_[6 * node], p) >= best2) { continue; }
+      if (isLeaf(node)) {
+        uint32_t primitive = order_[node - (n_ - 1)];
+        float d2 = func(primitive);
+        if (d2 < best2) {
+          best2 = d2;
+          result = primitive;
+        }
+        continue;
+      }
+      // Nearer child is visited first
+      uint32_t a = children_[2 * node + 0], b = children_[2 * node + 1];
+      if (distance2(&boxes_[6 * a], p) < distance2(&boxes_[6 * b], p)) { std::swap(a, b); }
+      assert(size + 2 <= kStackSize);
+      stack[size++] = a;
+      stack[size++] = b;
+    }
+    return result;
+  }
+};
+
+//
+// Spatial hash
+//
+
+struct SpatialHash {
+  float cell_size_ = 1;
+  size_t table_size_ = 0;      // power of two (bucket `table_size_` collects duplicates within primitive)
+  vector<float> boxes_;        // 6 n
+  vector<uint32_t> indptr_;    // table_size + 2
+  vector<uint32_t> entries_;   // primitives sorted by bucket
+
+  // Workspace
+  vector<size_t> offsets_;
+  vector<uint32_t> keys_;
+
+  int32_t cell(float x) const { return int32_t(std::floor(x / cell_size_)); }
+
+  size_t bucket(int32_t i, int32_t j, int32_t k) const {
+    uint32_t h = (uint32_t(i) * 73856093u) ^ (uint32_t(j) * 19349663u) ^ (uint32_t(k) * 83492791u);
+    return h & (table_size_ - 1);
+  }
+
+  // Each primitive goes to every cell overlapping its box (cell size should be about the size of boxes)
+  void build(const vector<float>& boxes, float cell_size) {
+    size_t n = boxes.size() / 6;
+    cell_size_ = cell_size;
+    boxes_ = boxes;
+    table_size_ = 1;
+    while (table_size_ < 2 * n) { table_size_ *= 2; }
+    auto& pool = thread_pool::getDefault();
+
+    // Number of cells per primitive
+    offsets_.resize(n + 1);
+    offsets_[0] = 0;
+    pool.parallelFor(0, n, 0, [&](size_t i0, size_t i1) {
+      for (size_t i = i0; i < i1; i++) {
+        auto b = &boxes[6 * i];
+        size_t count = 1;
+        for (size_t k = 0; k < 3; k++) { count *= cell(b[k + 3]) - cell(b[k]) + 1; }
+        offsets_[i + 1] = count;
+      }
+    });
+    for (size_t i = 0; i < n; i++) { offsets_[i + 1] += offsets_[i]; }
+
+    // Buckets of each primitive (sorted and deduplicated so that a primitive appears at most once per bucket)
+    keys_.resize(offsets_[n]);
+    pool.parallelFor(0, n, 0, [&](size_t i0, size_t i1) {
+      for (size_t p = i0; p < i1; p++) {
+        auto b = &boxes[6 * p];
+        size_t q = offsets_[p];
+        for (int32_t k = cell(b[2]); k <= cell(b[5]); k++) {
+          for (int32_t j = cell(b[1]); j <= cell(b[4]); j++) {
+            for (int32_t i = cell(b[0]); i <= cell(b[3]); i++) { keys_[q++] = uint32_t(bucket(i, j, k)); }
+          }
+        }
+        auto begin = keys_.begin() + offsets_[p], end = keys_.begin() + offsets_[p + 1];
+        std::sort(begin, end);
+        for (auto it = begin + 1; it < end; it++) {
+          if (*it == *(it - 1)) { *(it - 1) = uint32_t(table_size_); }
+        }
+      }
+    });
+
+    // Counting sort by bucket
+    indptr_.assign(table_size_ + 2, 0);
+    for (auto key : keys_) { indptr_[key + 1]++; }
+    for (size_t h = 0; h <= table_size_; h++) { indptr_[h + 1] += indptr_[h]; }
+    entries_.resize(keys_.size());
+    for (size_t p = 0; p < n; p++) {
+      for (size_t q = offsets_[p]; q < offsets_[p + 1]; q++) { entries_[indptr_[keys_[q]]++] = uint32_t(p); }
+    }
+    for (size_t h = table_size_ + 1; h > 0; h--) { indptr_[h] = indptr_[h - 1]; }
+    indptr_[0] = 0;
+  }
+
+  // Same as Bvh::query (each primitive is reported once at the first cell shared by both boxes)
+  template<typename F>
+  void query(const float* box, const F& func) const {
+    if (table_size_ == 0) { return; }
+    int32_t lo[3] = {cell(box[0]), cell(box[1]), cell(box[2])};
+    int32_t hi[3] = {cell(box[3]), cell(box[4]), cell(box[5])};
+    for (int32_t k = lo[2]; k <= hi[2]; k++) {
+      for (int32_t j = lo[1]; j <= hi[1]; j++) {
+        for (int32_t i = lo[0]; i <= hi[0]; i++) {
+          size_t h = bucket(i, j, k);
+          for (auto q = indptr_[h]; q < indptr_[h + 1]; q++) {
+            uint32_t p = entries_[q];
+            auto b = &boxes_[6 * p];
+            if (!overlap(b, box)) { continue; }
+            if (std::max(cell(b[0]), lo[0]) != i || std::max(cell(b[1]), lo[1]) != j ||
+                std::max(cell(b[2]), lo[2]) != k) {
+              continue;
+            }
+            func(p);
+          }
+        }
+      }
+    }
+  }
+};
+
+//
+// Geometry
+//
+
+// Closest point on triangle (a, b, c) to p with its barycentric coordinates (cf. Ericson, "Real-Time Collision Detection")
+inline vec3 closestPoint(const vec3& p, const vec3& a, const vec3& b, const vec3& c, float* bary) {
+  auto result = [&](float u, float v, float w) {
+    bary[0] = u;
+    bary[1] = v;
+    bary[2] = w;
+    return u * a + v * b + w * c;
+  };
+  vec3 ab = b - a, ac = c - a, ap = p - a;
+  float d1 = glm::dot(ab, ap), d2 = glm::dot(ac, ap);
+  if (d1 <= 0 && d2 <= 0) { return result(1, 0, 0); }
+  vec3 bp = p - b;
+  float d3 = glm::dot(ab, bp), d4 = glm::dot(ac, bp);
+  if (d3 >= 0 && d4 <= d3) { return result(0, 1, 0); }
+  float vc = d1 * d4 - d3 * d2;
+  if (vc <= 0 && d1 >= 0 && d3 <= 0) {
+    float v = d1 / (d1 - d3);
+    return result(1 - v, v, 0);
+  }
+  vec3 cp = p - c;
+  float d5 = glm::dot(ab, cp), d6 = glm::dot(ac, cp);
+  if (d6 >= 0 && d5 <= d6) { return result(0, 0, 1); }
+  float vb = d5 * d2 - d1 * d6;
+  if (vb <= 0 && d2 >= 0 && d6 <= 0) {
+    float w = d2 / (d2 - d6);
+    return result(1 - w, 0, w);
+  }
+  float va = d3 * d6 - d5 * d4;
+  if (va <= 0 && (d4 - d3) >= 0 && (d5 - d6) >= 0) {
+    float w = (d4 - d3) / ((d4 - d3) + (d5 - d6));
+    return result(0, 1 - w, w);
+  }
+  float denom = 1 / (va + vb + vc);
+  float v = vb * denom, w = vc * denom;
+  return result(1 - v - w, v, w);
+}
+
+// Strictly inside tetrahedron (either orientation) by signed volumes of sub-tetrahedra sharing edge cross products
+inline bool insideTetrahedron(const vec3& p, const vec3& a, const vec3& b, const vec3& c, const vec3& d) {
+  vec3 e1 = b - a, e2 = c - a, e3 = d - a, q = p - a;
+  vec3 c23 = glm::cross(e2, e3), c31 = glm::cross(e3, e1), c12 = glm::cross(e1, e2);
+  float v = glm::dot(e1, c23);
+  float w1 = glm::dot(q, c23), w2 = glm::dot(q, c31), w3 = glm::dot(q, c12);
+  float w0 = v - w1 - w2 - w3;
+  if (v < 0) {
+    return w0 < 0 && w1 < 0 && w2 < 0 && w3 < 0;
+  }
+  return v > 0 && w0 > 0 && w1 > 0 && w2 > 0 && w3 > 0;
+}
+
+//
+// Contacts of tetrahedral mesh
+//
+
+struct Collision {
+  // Configuration
+  float thickness_ = 1e-2;  // separation between surface vertex and triangle (should be smaller than edge length)
+  bool use_hash_ = false;   // proximity broad phase by SpatialHash instead of triangle Bvh
+  bool rebuild_ = false;    // rebuild Bvh on every `detect` instead of refit
+
+  // Mesh (`init`)
+  vector<uint32_t> c3xc0_;          // 4 nC3
+  vector<uint32_t> surface_;        // 3 nS (outward triangles)
+  vector<uint32_t> surface_verts_;  // vertices of surface
+  float cell_size_ = 1;             // SpatialHash cell (mean box size of surface triangles)
+
+  // Broad phase
+  vector<float> tet_boxes_, tri_boxes_;
+  Bvh tet_bvh_, tri_bvh_;
+  SpatialHash hash_;
+
+  // Contacts (`detect` and `project`)
+  vector<uint32_t> contact_verts_;  // nK
+  vector<uint32_t> contact_tris_;   // nK (index of surface triangle)
+  vector<float> contact_bary_;      // 3 nK
+  Matrix<float> contact_targets_;   // nK x 3
+  size_t num_penetrations_ = 0;     // contacts from vertices inside tetrahedra
+
+  // Workspace (per chunk)
+  struct Local {
+    vector<uint32_t> verts, tris;
+    vector<float> bary;
+    size_t num_penetrations = 0;
+  };
+  vector<Local> locals_;
+
+  // Surface triangles (faces of a single tetrahedron) oriented outward at `verts`
+  void init(const Matrix<float>& verts, const vector<uint32_t>& c3xc0) {
+    c3xc0_ = c3xc0;
+    size_t nC3 = c3xc0.size() / 4;
+    constexpr uint32_t kFaces[4][3] = {{1, 2, 3}, {0, 3, 2}, {0, 1, 3}, {0, 2, 1}}; // outward for positive volume
+    auto position = [&](uint32_t v) { return vec3{verts(v, 0), verts(v, 1), verts(v, 2)}; };
+
+    // Sort faces by sorted vertices and keep unpaired ones
+    vector<std::array<uint32_t, 4>> faces(4 * nC3);
+    for (size_t i = 0; i < nC3; i++) {
+      for (size_t f = 0; f < 4; f++) {
+        std::array<uint32_t, 4> face;
+        for (size_t j = 0; j < 3; j++) { face[j] = c3xc0[4 * i + kFaces[f][j]]; }
+        std::sort(face.begin(), face.begin() + 3);
+        face[3] = uint32_t(4 * i + f);
+        faces[4 * i + f] = face;
+      }
+    }
+    std::sort(faces.begin(), faces.end());
+    auto same = [&](size_t p, size_t q) { return std::equal(&faces[p][0], &faces[p][3], &faces[q][0]); };
+    surface_.clear();
+    for (size_t p = 0; p < faces.size(); p++) {
+      if ((p > 0 && same(p - 1, p)) || (p + 1 < faces.size() && same(p, p + 1))) { continue; }
+      auto vs = &c3xc0[4 * (faces[p][3] / 4)];
+      auto& f = kFaces[faces[p][3] % 4];
+      vec3 a = position(vs[0]), b = position(vs[1]), c = position(vs[2]), d = position(vs[3]);
+      bool flip = glm::dot(glm::cross(b - a, c - a), d - a) < 0;
+      surface_.insert(surface_.end(), {vs[f[0]], vs[flip ? f[2] : f[1]], vs[flip ? f[1] : f[2]]});
+    }
+    surface_verts_ = surface_;
+    std::sort(surface_verts_.begin(), surface_verts_.end());
+    surface_verts_.erase(std::unique(surface_verts_.begin(), surface_verts_.end()), surface_verts_.end());
+
+    computeBoxes<3>(verts, surface_, thickness_, tri_boxes_);
+    double sum = 0;
+    for (size_t s = 0; s < tri_boxes_.size() / 6; s++) {
+      auto b = &tri_boxes_[6 * s];
+      sum += std::max({b[3] - b[0], b[4] - b[1], b[5] - b[2]});
+    }
+    cell_size_ = surface_.empty() ? 1 : float(sum / (surface_.size() / 3));
+    computeBoxes<4>(verts, c3xc0_, 0, tet_boxes_);
+    tet_bvh_.build(tet_boxes_);
+    tri_bvh_.build(tri_boxes_);
+    contact_verts_.clear();
+  }
+
+  // Broad phase at current `verts` and a contact for each surface vertex in (or too close to) the mesh
+  void detect(const Matrix<float>& verts) {
+    TRACE_ZONE("collision::Collision::detect");
+    auto& pool = thread_pool::getDefault();
+    computeBoxes<4>(verts, c3xc0_, 0, tet_boxes_);
+    computeBoxes<3>(verts, surface_, thickness_, tri_boxes_);
+    if (rebuild_) {
+      tet_bvh_.build(tet_boxes_);
+      tri_bvh_.build(tri_boxes_);
+    } else {
+      tet_bvh_.refit(tet_boxes_);
+      tri_bvh_.refit(tri_boxes_);
+    }
+    if (use_hash_) { hash_.build(tri_boxes_, cell_size_); }
+
+    auto position = [&](uint32_t v) { return vec3{verts(v, 0), verts(v, 1), verts(v, 2)}; };
+    auto incident = [](const uint32_t* vs, size_t k, uint32_t v) { return std::find(vs, vs + k, v) != vs + k; };
+
+    // Nearest surface triangle (not incident to v) with closest point
+    auto distance = [&](uint32_t v, const vec3& x, uint32_t s, float* result) {
+      auto vs = &surface_[3 * s];
+      if (incident(vs, 3, v)) { return float(INFINITY); }
+      vec3 c = closestPoint(x, position(vs[0]), position(vs[1]), position(vs[2]), result);
+      return glm::dot(x - c, x - c);
+    };
+
+    size_t n = surface_verts_.size();
+    size_t num_chunks = std::clamp<size_t>(n / 256, 1, 4 * pool.size());
+    locals_.resize(num_chunks);
+    pool.run(num_chunks, [&](size_t chunk) {
+      auto& local = locals_[chunk];
+      local.verts.clear();
+      local.tris.clear();
+      local.bary.clear();
+      local.num_penetrations = 0;
+      for (size_t i = n * chunk / num_chunks; i < n * (chunk + 1) / num_chunks; i++) {
+        uint32_t v = surface_verts_[i];
+        vec3 x = position(v);
+        float box[6] = {x[0], x[1], x[2], x[0], x[1], x[2]};
+
+        // 1. Inside of other tetrahedron
+        bool inside = false;
+        tet_bvh_.query(box, [&](uint32_t t) {
+          auto vs = &c3xc0_[4 * t];
+          if (inside || incident(vs, 4, v) || !insideBox(&tet_boxes_[6 * t], x)) { return; }
+          inside = insideTetrahedron(x, position(vs[0]), position(vs[1]), position(vs[2]), position(vs[3]));
+        });
+        uint32_t best = kNone;
+        float bary[3], best_bary[3]; // per vertex since `distance` is called from all workers
+        if (inside) {
+          float best2 = INFINITY;
+          best = tri_bvh_.nearest(x, best2, [&](uint32_t s) {
+            float d2 = distance(v, x, s, bary);
+            if (d2 < best2) { std::copy_n(bary, 3, best_bary); }
+            return d2;
+          });
+          local.num_penetrations += best != kNone;
+        } else {
+          // 2. Within thickness in front of triangle
+          float best2 = thickness_ * thickness_;
+          auto visit = [&](uint32_t s) {
+            float d2 = distance(v, x, s, bary);
+            if (d2 > best2) { return; }
+            auto vs = &surface_[3 * s];
+            vec3 a = position(vs[0]), b = position(vs[1]), c = position(vs[2]);
+            vec3 y = bary[0] * a + bary[1] * b + bary[2] * c;
+            if (glm::dot(glm::cross(b - a, c - a), x - y) < 0) { return; }
+            // Tie is broken by triangle index so that result doesn't depend on broad phase
+            if (d2 == best2 && s > best) { return; }
+            best2 = d2;
+            best = s;
+            std::copy_n(bary, 3, best_bary);
+          };
+          if (use_hash_) {
+            hash_.query(box, visit);
+          } else {
+            tri_bvh_.query(box, visit);
+          }
+        }
+        if (best != kNone) {
+          local.verts.push_back(v);
+          local.tris.push_back(best);
+          local.bary.insert(local.bary.end(), best_bary, best_bary + 3);
+        }
+      }
+    });
+
+    contact_verts_.clear();
+    contact_tris_.clear();
+    contact_bary_.clear();
+    num_penetrations_ = 0;
+    for (auto& local : locals_) {
+      contact_verts_.insert(contact_verts_.end(), local.verts.begin(), local.verts.end());
+      contact_tris_.insert(contact_tris_.end(), local.tris.begin(), local.tris.end());
+      contact_bary_.insert(contact_bary_.end(), local.bary.begin(), local.bary.end());
+      num_penetrations_ += local.num_penetrations;
+    }
+    contact_targets_.resize(contact_verts_.size(), 3);
+    TRACE_COUNTER("contacts", double(contact_verts_.size()));
+  }
+
+  // Local step: project contact vertices onto the half space in front of their triangles
+  void project(const Matrix<float>& verts) {
+    TRACE_ZONE("collision::Collision::project");
+    size_t nK = contact_verts_.size();
+    auto position = [&](uint32_t v) { return vec3{verts(v, 0), verts(v, 1), verts(v, 2)}; };
+    thread_pool::getDefault().parallelFor(0, nK, 0, [&](size_t i0, size_t i1) {
+      for (size_t i = i0; i < i1; i++) {
+        auto vs = &surface_[3 * contact_tris_[i]];
+        auto w = &contact_bary_[3 * i];
+        vec3 a = position(vs[0]), b = position(vs[1]), c = position(vs[2]);
+        vec3 x = position(contact_verts_[i]);
+        vec3 normal = glm::cross(b - a, c - a);
+        float length = glm::length(normal);
+        vec3 y = x;
+        if (length > 0) {
+          normal /= length;
+          float d = glm::dot(normal, x - (w[0] * a + w[1] * b + w[2] * c));
+          y += std::max(0.0f, thickness_ - d) * normal;
+        }
+        for (size_t k = 0; k < 3; k++) { contact_targets_(i, k) = y[k]; }
+      }
+    });
+  }
+};
+
+} // namespace collision
@@ -0,0 +1,315 @@
+#pragma once
+
+//
+// Triangle mesh topology and discrete differential geometry (native version of src/utils/ddg.js)
+//   - Edges are found without hashing: half-edges are bucketed by their smaller vertex (counting sort)
+//     and sorted by the larger vertex within each bucket (cf. computeTopologyV2 in ddg.js).
+//     Thus edges are numbered in (v0, v1) order with v0 < v1 (orientation of d0 as in ddg.js).
+//   - Half-edge h = 3 f + j goes from f2v[h] to f2v[3 f + (j + 1) % 3].
+//   - Geometry is computed per vertex by gathering over incident edges/corners (instead of scattering from faces)
+//     so that loops run in parallel without atomics and the result doesn't depend on the number of threads.
+//   - Laplacian = - d0T hodge1 d0 is built directly as MatrixCSR<float> since the pattern is the vertex adjacency.
+//
+
+#include <algorithm>
+#include <cassert>
+#include <cmath>
+#include <cstdint>
+#include <vector>
+#include <glm/glm.hpp>
+#include "matrix.hpp"
+#include "thread_pool.hpp"
+
+namespace ddg {
+
+using std::vector;
+using glm::vec3;
+
+constexpr uint32_t kNone = ~uint32_t(0);
+constexpr float kPi = 3.14159265358979f;
+
+struct Topology {
+  size_t nV_ = 0;
+  size_t nF_ = 0;
+  size_t nE_ = 0;
+
+  vector<uint32_t> f2v_;  // 3 nF (filled by user before `compute`)
+  vector<uint32_t> e2v_;  // 2 nE (v0 < v1)
+  vector<uint32_t> e2h_;  // nE (one of half-edges of each edge)
+  vector<uint32_t> h2e_;  // 3 nF
+  vector<uint32_t> twin_; // 3 nF (opposite half-edge or kNone on boundary)
+
+  // Vertex to incident edges (sorted by the other vertex) and outgoing half-edges (i.e. corners) in CSR
+  vector<size_t> v2e_indptr_;
+  vector<uint32_t> v2e_;
+  vector<size_t> v2h_indptr_;
+  vector<uint32_t> v2h_;
+
+  bool boundary_ = false;
+  bool orientable_ = true; // false when two faces traverse their shared edge in the same direction
+
+  static uint32_t next(uint32_t h) { return (h % 3 == 2) ? h - 2 : h + 1; }
+  static uint32_t prev(uint32_t h) { return (h % 3 == 0) ? h + 2 : h - 1; }
+  uint32_t source(uint32_t h) const { return f2v_[h]; }
+  uint32_t target(uint32_t h) const { return f2v_[next(h)]; }
+  uint32_t other(uint32_t e, uint32_t v) const { return e2v_[2 * e] == v ? e2v_[2 * e + 1] : e2v_[2 * e]; }
+
+  // Returns false when an edge is shared by more than two faces
+  bool compute(size_t nV) {
+    assert(f2v_.size() % 3 == 0);
+    nV_ = nV;
+    nF_ = f2v_.size() / 3;
+    size_t nH = 3 * nF_;
+    auto& pool = thread_pool::getDefault();
+    auto lo = [&](uint32_t h) { return std::min(source(h), target(h)); };
+    auto hi = [&](uint32_t h) { return std::max(source(h), target(h)); };
+
+    // 1. Bucket half-edges by smaller vertex
+    vector<size_t> indptr(nV + 1, 0);
+    for (uint32_t h = 0; h < nH; h++) {
+      assert(f2v_[h] < nV && source(h) != target(h));
+      indptr[lo(h) + 1]++;
+    }
+    for (size_t v = 0; v < nV; v++) { indptr[v + 1] += indptr[v]; }
+    vector<uint32_t> buckets(nH);
+    {
+      vector<size_t> offsets(indptr.begin(), indptr.end() - 1);
+      for (uint32_t h = 0; h < nH; h++) { buckets[offsets[lo(h)]++] = h; }
+    }
+
+    // 2. Sort each bucket by larger vertex (buckets are small, i.e. vertex valence)
+    pool.parallelFor(0, nV, 0, [&](size_t v_begin, size_t v_end) {
+      for (size_t v = v_begin; v < v_end; v++) {
+        std::sort(buckets.begin() + indptr[v], buckets.begin() + indptr[v + 1], [&](uint32_t a, uint32_t b) {
+          return hi(a) < hi(b) || (hi(a) == hi(b) && a < b);
+        });
+      }
+    });
+
+    // 3. Runs of the same (v0, v1) make an edge
+    e2v_.clear();
+    e2h_.clear();
+    e2v_.reserve(nH + 2 * nV);
+    e2h_.reserve(nH / 2 + nV);
+    h2e_.assign(nH, kNone);
+    twin_.assign(nH, kNone);
+    boundary_ = false;
+    orientable_ = true;
+    for (size_t v = 0; v < nV; v++) {
+      size_t p = indptr[v];
+      while (p < indptr[v + 1]) {
+        size_t q = p + 1;
+        while (q < indptr[v + 1] && hi(buckets[q]) == hi(buckets[p])) { q++; }
+        if (q - p > 2) { return false; }
+        auto e = uint32_t(e2h_.size());
+        e2v_.push_back(uint32_t(v));
+        e2v_.push_back(hi(buckets[p]));
+        e2h_.push_back(buckets[p]);
+        for (auto k = p; k < q; k++) { h2e_[buckets[k]] = e; }
+        if (q - p == 2) {
+          uint32_t h0 = buckets[p], h1 = buckets[p + 1];
+          twin_[h0] = h1;
+          twin_[h1] = h0;
+          orientable_ = orientable_ && source(h0) != source(h1);
+        } else {
+          boundary_ = true;
+        }
+        p = q;
+      }
+    }
+    nE_ = e2h_.size();
+
+    // 4. Vertex to edge (edges are ordered by (v0, v1), so each row is sorted by the other vertex)
+    v2e_indptr_.assign(nV + 1, 0);
+    for (size_t e = 0; e < nE_; e++) {
+      v2e_indptr_[e2v_[2 * e] + 1]++;
+      v2e_indptr_[e2v_[2 * e + 1] + 1]++;
+    }
+    for (size_t v = 0; v < nV; v++) { v2e_indptr_[v + 1] += v2e_indptr_[v]; }
+    v2e_.resize(2 * nE_);
+    {
+      vector<size_t> offsets(v2e_indptr_.begin(), v2e_indptr_.end() - 1);
+      for (size_t e = 0; e < nE_; e++) {
+        v2e_[offsets[e2v_[2 * e]]++] = uint32_t(e);
+        v2e_[offsets[e2v_[2 * e + 1]]++] = uint32_t(e);
+      }
+    }
+
+    // 5. Vertex to outgoing half-edge
+    v2h_indptr_.assign(nV + 1, 0);
+    for (uint32_t h = 0; h < nH; h++) { v2h_indptr_[source(h) + 1]++; }
+    for (size_t v = 0; v < nV; v++) { v2h_indptr_[v + 1] += v2h_indptr_[v]; }
+    v2h_.resize(nH);
+    {
+      vector<size_t> offsets(v2h_indptr_.begin(), v2h_indptr_.end() - 1);
+      for (uint32_t h = 0; h < nH; h++) { v2h_[offsets[source(h)]++] = h; }
+    }
+    return true;
+  }
+};
+
+inline vec3 position(const Matrix<float>& verts, size_t v) {
+  return vec3{verts(v, 0), verts(v, 1), verts(v, 2)};
+}
+
+// Primal 1-form to dual 1-form (i.e. (cot(a) + cot(b)) / 2 of the angles opposite to each edge)
+inline void computeHodge1(const Topology& topology, const Matrix<float>& verts, vector<float>& hodge1) {
+  auto& pool = thread_pool::getDefault();
+
+  // Half cotan of the angle opposite to each half-edge
+  vector<float> cotans(3 * topology.nF_);
+  pool.parallelFor(0, topology.nF_, 0, [&](size_t f_begin, size_t f_end) {
+    for (size_t f = f_begin; f < f_end; f++) {
+      auto vs = &topology.f2v_[3 * f];
+      vec3 ps[3] = {position(verts, vs[0]), position(verts, vs[1]), position(verts, vs[2])};
+      for (auto j = 0; j < 3; j++) {
+        vec3 u = ps[j] - ps[(j + 2) % 3];
+        vec3 w = ps[(j + 1) % 3] - ps[(j + 2) % 3];
+        cotans[3 * f + j] = 0.5f * glm::dot(u, w) / glm::length(glm::cross(u, w));
+      }
+    }
+  });
+
+  hodge1.resize(topology.nE_);
+  pool.parallelFor(0, topology.nE_, 0, [&](size_t e_begin, size_t e_end) {
+    for (size_t e = e_begin; e < e_end; e++) {
+      uint32_t h = topology.e2h_[e];
+      uint32_t t = topology.twin_[h];
+      hodge1[e] = cotans[h] + (t != kNone ? cotans[t] : 0);
+    }
+  });
+}
+
+// Primal 0-form to dual 2-form (i.e. area of dual cell = sum of |e|^2 hodge1(e) / 4 over incident edges)
+inline void computeHodge0(
+    const Topology& topology, const Matrix<float>& verts, const vector<float>& hodge1, vector<float>& hodge0) {
+  hodge0.resize(topology.nV_);
+  thread_pool::getDefault().parallelFor(0, topology.nV_, 0, [&](size_t v_begin, size_t v_end) {
+    for (size_t v = v_begin; v < v_end; v++) {
+      float area = 0;
+      for (auto p = topology.v2e_indptr_[v]; p < topology.v2e_indptr_[v + 1]; p++) {
+        uint32_t e = topology.v2e_[p];
+        vec3 d = position(verts, topology.other(e, uint32_t(v))) - position(verts, v);
+        area += 0.25f * glm::dot(d, d) * hodge1[e];
+      }
+      hodge0[v] = area;
+    }
+  });
+}
+
+// Angle defect 2 pi - (sum of corner angles) (i.e. discrete gaussian curvature integrated over dual cell)
+inline void computeAngleDefect(const Topology& topology, const Matrix<float>& verts, vector<float>& kg) {
+  kg.resize(topology.nV_);
+  thread_pool::getDefault().parallelFor(0, topology.nV_, 0, [&](size_t v_begin, size_t v_end) {
+    for (size_t v = v_begin; v < v_end; v++) {
+      vec3 p = position(verts, v);
+      float angle_sum = 0;
+      for (auto k = topology.v2h_indptr_[v]; k < topology.v2h_indptr_[v + 1]; k++) {
+        uint32_t h = topology.v2h_[k];
+        vec3 u = position(verts, topology.target(h)) - p;
+        vec3 w = position(verts, topology.source(Topology::prev(h))) - p;
+        angle_sum += std::atan2(glm::length(glm::cross(u, w)), glm::dot(u, w));
+      }
+      kg[v] = 2 * kPi - angle_sum;
+    }
+  });
+}
+
+// Laplacian = - d0T hodge1 d0 (nV x nV, sorted indices with diagonal, cf. computeLaplacian in ddg.js)
+inline MatrixCSR<float> computeLaplacian(const Topology& topology, const vector<float>& hodge1) {
+  size_t nV = topology.nV_;
+  MatrixCSR<float> L{nV, nV, 2 * topology.nE_ + nV};
+  for (size_t v = 0; v <= nV; v++) {
+    L.indptr_[v] = topology.v2e_indptr_[v] + v;
+  }
+  thread_pool::getDefault().parallelFor(0, nV, 0, [&](size_t v_begin, size_t v_end) {
+    for (size_t v = v_begin; v < v_end; v++) {
+      size_t q = L.indptr_[v];
+      size_t q_diag = MatrixCSR<float>::kIndexEnd;
+      float diag = 0;
+      for (auto p = topology.v2e_indptr_[v]; p < topology.v2e_indptr_[v + 1]; p++) {
+        uint32_t e = topology.v2e_[p];
+        uint32_t u = topology.other(e, uint32_t(v));
+        if (q_diag == MatrixCSR<float>::kIndexEnd && u > v) { q_diag = q++; }
+        L.indices_[q] = u;
+        L.data_[q] = hodge1[e];
+        diag -= hodge1[e];
+        q++;
+      }
+      if (q_diag == MatrixCSR<float>::kIndexEnd) { q_diag = q; }
+      L.indices_[q_diag] = v;
+      L.data_[q_diag] = diag;
+    }
+  });
+  return L;
+}
+
+// 2 H N as dual 2-form (divide by hodge0 for pointwise value, cf. computeMeanCurvature in ddg.js)
+inline Matrix<float> computeMeanCurvature(const MatrixCSR<float>& L, const Matrix<float>& verts) {
+  return MatrixCSR<float>::matmul(L, verts);
+}
+
+// Unit face normals (nF x 3)
+inline void computeFaceNormals(const Topology& topology, const Matrix<float>& verts, Matrix<float>& normals) {
+  normals.resize(topology.nF_, 3);
+  thread_pool::getDefault().parallelFor(0, topology.nF_, 0, [&](size_t f_begin, size_t f_end) {
+    for (size_t f = f_begin; f < f_end; f++) {
+      auto vs = &topology.f2v_[3 * f];
+      vec3 p0 = position(verts, vs[0]);
+      vec3 n = glm::normalize(glm::cross(position(verts, vs[1]) - p0, position(verts, vs[2]) - p0));
+      for (auto k = 0; k < 3; k++) { normals(f, k) = n[k]; }
+    }
+  });
+}
+
+// Normalized average of incident face normals (nV x 3, cf. computeVertexNormals in ddg.js)
+inline void computeVertexNormals(const Topology& topology, const Matrix<float>& verts, Matrix<float>& normals) {
+  Matrix<float> face_normals;
+  computeFaceNormals(topology, verts, face_normals);
+  normals.resize(topology.nV_, 3);
+  thread_pool::getDefault().parallelFor(0, topology.nV_, 0, [&](size_t v_begin, size_t v_end) {
+    for (size_t v = v_begin; v < v_end; v++) {
+      vec3 n{0, 0, 0};
+      for (auto k = topology.v2h_indptr_[v]; k < topology.v2h_indptr_[v + 1]; k++) {
+        n += position(face_normals, topology.v2h_[k] / 3);
+      }
+      n = glm::normalize(n);
+      for (auto k = 0; k < 3; k++) { normals(v, k) = n[k]; }
+    }
+  });
+}
+
+// Topology and geometry together (e.g. for embind where user fills `verts` and `f2v` views before `init`)
+struct Mesh {
+  Matrix<float> verts_;           // nV x 3
+  Topology topology_;             // f2v_ : 3 nF
+  vector<float> hodge0_;          // nV
+  vector<float> hodge1_;          // nE
+  vector<float> kg_;              // nV (angle defect)
+  MatrixCSR<float> laplacian_;    // nV x nV
+  Matrix<float> mean_curvature_;  // nV x 3 (2 H N as dual 2-form)
+  Matrix<float> normals_;         // nV x 3
+
+  Mesh(size_t nV, size_t nF) : verts_{nV, 3} {
+    topology_.f2v_.resize(3 * nF);
+  }
+
+  // Returns false when mesh is not manifold
+  bool init() {
+    if (!topology_.compute(verts_.shape_[0])) { return false; }
+    update();
+    return true;
+  }
+
+  // Recompute geometry after `verts_` changes (topology is kept)
+  void update() {
+    computeHodge1(topology_, verts_, hodge1_);
+    computeHodge0(topology_, verts_, hodge1_, hodge0_);
+    computeAngleDefect(topology_, verts_, kg_);
+    laplacian_ = computeLaplacian(topology_, hodge1_);
+    mean_curvature_ = computeMeanCurvature(laplacian_, verts_);
+    computeVertexNormals(topology_, verts_, normals_);
+  }
+};
+
+} // namespace ddg
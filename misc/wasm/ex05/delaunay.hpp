@@ -0,0 +1,568 @@
+#pragma once
+
+//
+// 3D Delaunay tetrahedralization by incremental Bowyer-Watson insertion (replaces misc2.delaunayBruteforce)
+//   - Points are inserted in BRIO order (random rounds of doubling size, each round sorted along a Hilbert curve)
+//     so that consecutive points are close and the walk from the last created tetrahedron is short.
+//   - Point location is a stochastic visibility walk (orient3d against each face, random face order).
+//   - Conflict region (tetrahedra whose circumsphere contains the point) is collected by BFS from the located one,
+//     then it is replaced by the cone of its boundary faces to the point.
+//   - Convex hull is closed by "ghost" tetrahedra sharing the infinite vertex (kGhost), thus points outside hull
+//     are inserted the same way. Ghost (a, b, c, oo) conflicts with p when p is strictly outside of face (a, b, c),
+//     or on its plane and inside the circumcircle (i.e. in conflict with the finite neighbor).
+//   - Predicates (orient3d, insphere) are evaluated in double with the error bounds of Shewchuk's robust predicates
+//     and fall back to exact expansion arithmetic only when the sign is uncertain, so degenerate inputs
+//     (e.g. lattice points) are triangulated consistently. Duplicate points are skipped (cf. `num_skipped_`).
+//   - Orientation is same as delaunayBruteforce i.e. det[p1 - p0, p2 - p0, p3 - p0] > 0 for each row of c3xc0.
+//
+
+#include <algorithm>
+#include <cassert>
+#include <cmath>
+#include <cstdint>
+#include <tuple>
+#include <vector>
+#include "thread_pool.hpp"
+
+namespace delaunay {
+
+using std::vector;
+
+//
+// Exact arithmetic on expansions (nonoverlapping sequence of doubles sorted by increasing magnitude,
+// cf. Shewchuk, "Adaptive Precision Floating-Point Arithmetic and Fast Robust Geometric Predicates")
+//
+
+using Expansion = vector<double>;
+
+inline void twoSum(double a, double b, double& x, double& y) {
+  x = a + b;
+  double bv = x - a;
+  double av = x - bv;
+  y = (a - av) + (b - bv);
+}
+
+inline void twoDiff(double a, double b, double& x, double& y) {
+  x = a - b;
+  double bv = a - x;
+  double av = x + bv;
+  y = (a - av) + (bv - b);
+}
+
+// (fma keeps the error term exact even when compiler contracts multiply-add elsewhere)
+inline void twoProduct(double a, double b, double& x, double& y) {
+  x = a * b;
+  y = std::fma(a, b, -x);
+}
+
+inline Expansion diff(double a, double b) {
+  double x, y;
+  twoDiff(a, b, x, y);
+  return y == 0 ? Expansion{x} : Expansion{y, x};
+}
+
+// h = e + f (fast_expansion_sum_zeroelim)
+inline Expansion sum(const Expansion& e, const Expansion& f) {
+  Expansion h;
+  h.reserve(e.size() + f.size());
+  size_t ie = 0, jf = 0;
+  auto smaller = [&]() { return jf == f.size() || (ie < e.size() && std::abs(e[ie]) < std::abs(f[jf])); };
+  double q = smaller() ? e[ie++] : f[jf++];
+  while (ie < e.size() || jf < f.size()) {
+    double x, y;
+    twoSum(q, smaller() ? e[ie++] : f[jf++], x, y);
+    if (y != 0) { h.push_back(y); }
+    q = x;
+  }
+  if (q != 0 || h.empty()) { h.push_back(q); }
+  return h;
+}
+
+inline Expansion negate(Expansion e) {
+  for (auto& x : e) { x = -x; }
+  return e;
+}
+
+// h = b e (scale_expansion_zeroelim)
+inline Expansion scale(const Expansion& e, double b) {
+  Expansion h;
+  h.reserve(2 * e.size());
+  double q, y;
+  twoProduct(e[0], b, q, y);
+  if (y != 0) { h.push_back(y); }
+  for (size_t i = 1; i < e.size(); i++) {
+    double p1, p0, s;
+    twoProduct(e[i], b, p1, p0);
+    twoSum(q, p0, s, y);
+    if (y != 0) { h.push_back(y); }
+    twoSum(p1, s, q, y);
+    if (y != 0) { h.push_back(y); }
+  }
+  if (q != 0 || h.empty()) { h.push_back(q); }
+  return h;
+}
+
+inline Expansion product(const Expansion& e, const Expansion& f) {
+  Expansion h = scale(e, f[0]);
+  for (size_t i = 1; i < f.size(); i++) { h = sum(h, scale(e, f[i])); }
+  return h;
+}
+
+// The largest component determines the sign
+inline double estimateSign(const Expansion& e) { return e.back(); }
+
+//
+// Predicates (result has the sign of the exact determinant)
+//
+
+constexpr double kEpsilon = 1.1102230246251565e-16; // 2^-53
+constexpr double kOrientBound = (7.0 + 56.0 * kEpsilon) * kEpsilon;
+constexpr double kInsphereBound = (16.0 + 224.0 * kEpsilon) * kEpsilon;
+
+// det[b - a, c - a, d - a] (positive when d is on the side of (b - a) x (c - a))
+inline double orient3dExact(const double* a, const double* b, const double* c, const double* d) {
+  // Same as -det[a - d, b - d, c - d]
+  Expansion ax = diff(a[0], d[0]), ay = diff(a[1], d[1]), az = diff(a[2], d[2]);
+  Expansion bx = diff(b[0], d[0]), by = diff(b[1], d[1]), bz = diff(b[2], d[2]);
+  Expansion cx = diff(c[0], d[0]), cy = diff(c[1], d[1]), cz = diff(c[2], d[2]);
+  auto cross = [](const Expansion& x1, const Expansion& y1, const Expansion& x2, const Expansion& y2) {
+    return sum(product(x1, y2), negate(product(x2, y1)));
+  };
+  Expansion det = sum(sum(product(az, cross(bx, by, cx, cy)), product(bz, cross(cx, cy, ax, ay))),
+                      product(cz, cross(ax, ay, bx, by)));
+  return -estimateSign(det);
+}
+
+inline double orient3d(const double* a, const double* b, const double* c, const double* d) {
+  double adx = a[0] - d[0], ady = a[1] - d[1], adz = a[2] - d[2];
+  double bdx = b[0] - d[0], bdy = b[1] - d[1], bdz = b[2] - d[2];
+  double cdx = c[0] - d[0], cdy = c[1] - d[1], cdz = c[2] - d[2];
+  double bdxcdy = bdx * cdy, cdxbdy = cdx * bdy;
+  double cdxady = cdx * ady, adxcdy = adx * cdy;
+  double adxbdy = adx * bdy, bdxady = bdx * ady;
+  double det = adz * (bdxcdy - cdxbdy) + bdz * (cdxady - adxcdy) + cdz * (adxbdy - bdxady);
+  double permanent = (std::abs(bdxcdy) + std::abs(cdxbdy)) * std::abs(adz) +
+                     (std::abs(cdxady) + std::abs(adxcdy)) * std::abs(bdz) +
+                     (std::abs(adxbdy) + std::abs(bdxady)) * std::abs(cdz);
+  double bound = kOrientBound * permanent;
+  if (det > bound || -det > bound) { return -det; }
+  return orient3dExact(a, b, c, d);
+}
+
+// Positive when e is inside the circumsphere of (a, b, c, d) with orient3d(a, b, c, d) > 0
+inline double insphereExact(const double* a, const double* b, const double* c, const double* d, const double* e) {
+  Expansion x[4], y[4], z[4], lift[4];
+  const double* ps[4] = {a, b, c, d};
+  for (size_t i = 0; i < 4; i++) {
+    x[i] = diff(ps[i][0], e[0]);
+    y[i] = diff(ps[i][1], e[1]);
+    z[i] = diff(ps[i][2], e[2]);
+    lift[i] = sum(sum(product(x[i], x[i]), product(y[i], y[i])), product(z[i], z[i]));
+  }
+  auto cross = [&](size_t i, size_t j) { return sum(product(x[i], y[j]), negate(product(x[j], y[i]))); };
+  Expansion ab = cross(0, 1), bc = cross(1, 2), cd = cross(2, 3), da = cross(3, 0), ac = cross(0, 2), bd = cross(1, 3);
+  Expansion abc = sum(sum(product(z[0], bc), negate(product(z[1], ac))), product(z[2], ab));
+  Expansion bcd = sum(sum(product(z[1], cd), negate(product(z[2], bd))), product(z[3], bc));
+  Expansion cda = sum(sum(product(z[2], da), product(z[3], ac)), product(z[0], cd));
+  Expansion dab = sum(sum(product(z[3], ab), product(z[0], bd)), product(z[1], da));
+  Expansion det = sum(sum(product(lift[3], abc), negate(product(lift[2], dab))),
+                      sum(product(lift[1], cda), negate(product(lift[0], bcd))));
+  return -estimateSign(det);
+}
+
+inline double insphere(const double* a, const double* b, const double* c, const double* d, const double* e) {
+  double aex = a[0] - e[0], aey = a[1] - e[1], aez = a[2] - e[2];
+  double bex = b[0] - e[0], bey = b[1] - e[1], bez = b[2] - e[2];
+  double cex = c[0] - e[0], cey = c[1] - e[1], cez = c[2] - e[2];
+  double dex = d[0] - e[0], dey = d[1] - e[1], dez = d[2] - e[2];
+  double aexbey = aex * bey, bexaey = bex * aey;
+  double bexcey = bex * cey, cexbey = cex * bey;
+  double cexdey = cex * dey, dexcey = dex * cey;
+  double dexaey = dex * aey, aexdey = aex * dey;
+  double aexcey = aex * cey, cexaey = cex * aey;
+  double bexdey = bex * dey, dexbey = dex * bey;
+  double ab = aexbey - bexaey, bc = bexcey - cexbey, cd = cexdey - dexcey;
+  double da = dexaey - aexdey, ac = aexcey - cexaey, bd = bexdey - dexbey;
+  double abc = aez * bc - bez * ac + cez * ab;
+  double bcd = bez * cd - cez * bd + dez * bc;
+  double cda = cez * da + dez * ac + aez * cd;
+  double dab = dez * ab + aez * bd + bez * da;
+  double alift = aex * aex + aey * aey + aez * aez;
+  double blift = bex * bex + bey * bey + bez * bez;
+  double clift = cex * cex + cey * cey + cez * cez;
+  double dlift = dex * dex + dey * dey + dez * dez;
+  double det = (dlift * abc - clift * dab) + (blift * cda - alift * bcd);
+
+  double az = std::abs(aez), bz = std::abs(bez), cz = std::abs(cez), dz = std::abs(dez);
+  double permanent =
+      ((std::abs(cexdey) + std::abs(dexcey)) * bz + (std::abs(dexbey) + std::abs(bexdey)) * cz +
+       (std::abs(bexcey) + std::abs(cexbey)) * dz) * alift +
+      ((std::abs(dexaey) + std::abs(aexdey)) * cz + (std::abs(aexcey) + std::abs(cexaey)) * dz +
+       (std::abs(cexdey) + std::abs(dexcey)) * az) * blift +
+      ((std::abs(aexbey) + std::abs(bexaey)) * dz + (std::abs(bexdey) + std::abs(dexbey)) * az +
+       (std::abs(dexaey) + std::abs(aexdey)) * bz) * clift +
+      ((std::abs(bexcey) + std::abs(cexbey)) * az + (std::abs(cexaey) + std::abs(aexcey)) * bz +
+       (std::abs(aexbey) + std::abs(bexaey)) * cz) * dlift;
+  double bound = kInsphereBound * permanent;
+  if (det > bound || -det > bound) { return -det; }
+  return insphereExact(a, b, c, d, e);
+}
+
+//
+// Spatial sorting
+//
+
+// Hilbert curve index of (x, y, z) in [0, 2^bits)^3 (Skilling, "Programming the Hilbert curve")
+inline uint64_t hilbertIndex(uint32_t x, uint32_t y, uint32_t z, int bits) {
+  uint32_t X[3] = {x, y, z};
+  uint32_t M = 1u << (bits - 1);
+  for (uint32_t Q = M; Q > 1; Q >>= 1) {
+    uint32_t P = Q - 1;
+    for (size_t i = 0; i < 3; i++) {
+      if (X[i] & Q) {
+        X[0] ^= P;
+      } else {
+        uint32_t t = (X[0] ^ X[i]) & P;
+        X[0] ^= t;
+        X[i] ^= t;
+      }
+    }
+  }
+  X[1] ^= X[0];
+  X[2] ^= X[1];
+  uint32_t t = 0;
+  for (uint32_t Q = M; Q > 1; Q >>= 1) {
+    if (X[2] & Q) { t ^= Q - 1; }
+  }
+  uint64_t result = 0;
+  for (int b = bits - 1; b >= 0; b--) {
+    for (size_t i = 0; i < 3; i++) {
+      result = (result << 1) | (((X[i] ^ t) >> b) & 1);
+    }
+  }
+  return result;
+}
+
+// Biased randomized insertion order: shuffle, then rounds [n / 2^(k+1), n / 2^k) each sorted along Hilbert curve
+inline vector<uint32_t> orderBRIO(const vector<double>& points, uint64_t seed = 0x9e3779b97f4a7c15ull) {
+  constexpr int kBits = 16;
+  constexpr size_t kMinRound = 64;
+  size_t n = points.size() / 3;
+  vector<uint32_t> order(n);
+  if (n == 0) { return order; }
+
+  double lo[3], hi[3];
+  for (size_t k = 0; k < 3; k++) { lo[k] = hi[k] = points[k]; }
+  for (size_t i = 0; i < n; i++) {
+    for (size_t k = 0; k < 3; k++) {
+      lo[k] = std::min(lo[k], points[3 * i + k]);
+      hi[k] = std::max(hi[k], points[3 * i + k]);
+    }
+  }
+  double extent = std::max({hi[0] - lo[0], hi[1] - lo[1], hi[2] - lo[2], 1e-300});
+  double s = ((1 << kBits) - 1) / extent;
+  vector<uint64_t> keys(n);
+  thread_pool::getDefault().parallelFor(0, n, 0, [&](size_t i0, size_t i1) {
+    for (size_t i = i0; i < i1; i++) {
+      auto p = &points[3 * i];
+      keys[i] = hilbertIndex(uint32_t((p[0] - lo[0]) * s), uint32_t((p[1] - lo[1]) * s), uint32_t((p[2] - lo[2]) * s),
+                             kBits);
+    }
+  });
+
+  // Fisher-Yates shuffle (splitmix64)
+  for (size_t i = 0; i < n; i++) { order[i] = uint32_t(i); }
+  uint64_t state = seed;
+  for (size_t i = n - 1; i > 0; i--) {
+    uint64_t z = (state += 0x9e3779b97f4a7c15ull);
+    z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9ull;
+    z = (z ^ (z >> 27)) * 0x94d049bb133111ebull;
+    z ^= z >> 31;
+    std::swap(order[i], order[z % (i + 1)]);
+  }
+
+  auto byKey = [&](uint32_t a, uint32_t b) { return keys[a] < keys[b]; };
+  size_t end = n;
+  while (end > 0) {
+    size_t begin = end > kMinRound ? end / 2 : 0;
+    std::sort(order.begin() + begin, order.begin() + end, byKey);
+    end = begin;
+  }
+  return order;
+}
+
+//
+// Triangulation
+//
+
+constexpr uint32_t kGhost = ~uint32_t(0); // infinite vertex
+constexpr uint32_t kDead = ~uint32_t(0);  // mark of removed tetrahedron
+
+struct Delaunay {
+  size_t n_ = 0;
+  vector<double> points_;   // 3 n (input order)
+  vector<uint32_t> order_;  // n (insertion order, i.e. internal vertex index -> input index)
+  vector<double> sorted_;   // 3 n (points in insertion order, which makes walk and cavity cache friendly)
+  vector<uint32_t> tets_;   // 4 per tetrahedron (face i is opposite to vertex i), kGhost for infinite vertex
+  vector<uint32_t> adj_;    // 4 per tetrahedron (4 neighbor + face index within neighbor)
+  vector<uint32_t> mark_;   // per tetrahedron (2 epoch: in conflict, 2 epoch + 1: not in conflict, kDead: removed)
+  vector<uint32_t> free_;   // removed tetrahedra to reuse
+  vector<uint32_t> c3xc0_;  // result (4 per finite tetrahedron)
+  size_t num_skipped_ = 0;  // duplicate points (not referenced by c3xc0)
+
+  // Insertion workspace
+  uint32_t epoch_ = 0;
+  uint32_t last_ = 0;
+  uint64_t walk_state_ = 0x853c49e6748fea9bull;
+  vector<uint32_t> cavity_;
+  vector<uint32_t> boundary_;   // 4 tetrahedron + face (faces of cavity whose neighbor is not in conflict)
+  vector<uint32_t> new_tets_;
+  vector<uint64_t> edge_keys_;  // open addressing (edge of boundary -> face of new tetrahedron)
+  vector<uint32_t> edge_values_;
+
+  const double* point(uint32_t v) const { return &sorted_[3 * size_t(v)]; }
+
+  bool isGhost(uint32_t t) const {
+    auto v = &tets_[4 * size_t(t)];
+    return v[0] == kGhost || v[1] == kGhost || v[2] == kGhost || v[3] == kGhost;
+  }
+
+  // orient3d of tetrahedron t with its i-th vertex replaced by p (negative when p is beyond face i)
+  double orientFace(uint32_t t, size_t i, const double* p) const {
+    auto v = &tets_[4 * size_t(t)];
+    const double* ps[4];
+    for (size_t k = 0; k < 4; k++) { ps[k] = k == i ? p : point(v[k]); }
+    return orient3d(ps[0], ps[1], ps[2], ps[3]);
+  }
+
+  double insphereTet(uint32_t t, const double* p) const {
+    auto v = &tets_[4 * size_t(t)];
+    return insphere(point(v[0]), point(v[1]), point(v[2]), point(v[3]), p);
+  }
+
+  bool inConflict(uint32_t t, const double* p) const {
+    auto v = &tets_[4 * size_t(t)];
+    for (size_t i = 0; i < 4; i++) {
+      if (v[i] != kGhost) { continue; }
+      double o = orientFace(t, i, p);
+      if (o != 0) { return o > 0; }
+      return insphereTet(adj_[4 * size_t(t) + i] >> 2, p) > 0;
+    }
+    return insphereTet(t, p) > 0;
+  }
+
+  uint32_t newTet() {
+    if (!free_.empty()) {
+      uint32_t t = free_.back();
+      free_.pop_back();
+      mark_[t] = 0;
+      return t;
+    }
+    uint32_t t = uint32_t(mark_.size());
+    tets_.resize(tets_.size() + 4);
+    adj_.resize(adj_.size() + 4);
+    mark_.push_back(0);
+    return t;
+  }
+
+  // Visibility walk from `t` to the tetrahedron containing p (or a ghost one in conflict with p)
+  uint32_t locate(const double* p, uint32_t t) {
+    uint32_t previous = kDead;
+    auto v = &tets_[4 * size_t(t)];
+    for (size_t i = 0; i < 4; i++) {
+      if (v[i] == kGhost) { t = adj_[4 * size_t(t) + i] >> 2; } // start from finite one
+    }
+    while (true) {
+      if (isGhost(t)) { return t; }
+      walk_state_ = walk_state_ * 6364136223846793005ull + 1442695040888963407ull;
+      size_t start = walk_state_ >> 62;
+      bool moved = false;
+      for (size_t k = 0; k < 4; k++) {
+        size_t i = (start + k) & 3;
+        uint32_t next = adj_[4 * size_t(t) + i] >> 2;
+        if (next == previous) { continue; }
+        if (orientFace(t, i, p) < 0) {
+          previous = t;
+          t = next;
+          moved = true;
+          break;
+        }
+      }
+      if (!moved) { return t; }
+    }
+  }
+
+  // Returns false when p is duplicate (or otherwise not in conflict with any tetrahedron)
+  bool insert(uint32_t pi) {
+    const double* p = point(pi);
+    uint32_t t = locate(p, last_);
+    if (!inConflict(t, p)) { return false; }
+
+    // 1. Conflict region by BFS
+    epoch_++;
+    uint32_t in = 2 * epoch_, out = 2 * epoch_ + 1;
+    cavity_.clear();
+    boundary_.clear();
+    cavity_.push_back(t);
+    mark_[t] = in;
+    for (size_t k = 0; k < cavity_.size(); k++) {
+      uint32_t c = cavity_[k];
+      for (size_t i = 0; i < 4; i++) {
+        uint32_t n = adj_[4 * size_t(c) + i] >> 2;
+        if (mark_[n] == in) { continue; }
+        if (mark_[n] != out && inConflict(n, p)) {
+          mark_[n] = in;
+          cavity_.push_back(n);
+          continue;
+        }
+        mark_[n] = out;
+        boundary_.push_back(4 * c + uint32_t(i));
+      }
+    }
+
+    // 2. Cone from boundary faces (tetrahedron c with its i-th vertex replaced by p keeps orientation)
+    size_t table_size = 16;
+    while (table_size < 4 * boundary_.size()) { table_size *= 2; }
+    if (edge_keys_.size() < table_size) {
+      edge_keys_.assign(table_size, ~uint64_t(0));
+      edge_values_.resize(table_size);
+    }
+    uint64_t mask = table_size - 1;
+    int shift = 64 - __builtin_ctzll(table_size);
+    new_tets_.clear();
+    for (auto f : boundary_) {
+      uint32_t c = f >> 2, i = f & 3;
+      uint32_t nt = newTet();
+      new_tets_.push_back(nt);
+      for (size_t k = 0; k < 4; k++) { tets_[4 * size_t(nt) + k] = k == i ? pi : tets_[4 * size_t(c) + k]; }
+      uint32_t outside = adj_[4 * size_t(c) + i];
+      adj_[4 * size_t(nt) + i] = outside;
+      adj_[4 * size_t(outside >> 2) + (outside & 3)] = 4 * nt + i;
+
+      // Other faces contain p and an edge of the boundary face, which is shared by exactly two new tetrahedra
+      for (uint32_t j = 0; j < 4; j++) {
+        if (j == i) { continue; }
+        uint32_t e[2], m = 0;
+        for (uint32_t k = 0; k < 4; k++) {
+          if (k != i && k != j) { e[m++] = tets_[4 * size_t(nt) + k]; }
+        }
+        uint64_t key = (uint64_t(std::min(e[0], e[1])) << 32) | std::max(e[0], e[1]);
+        uint64_t slot = (key * 0x9e3779b97f4a7c15ull) >> shift;
+        while (edge_keys_[slot] != ~uint64_t(0) && edge_keys_[slot] != key) { slot = (slot + 1) & mask; }
+        if (edge_keys_[slot] == key) {
+          uint32_t other = edge_values_[slot];
+          adj_[4 * size_t(nt) + j] = other;
+          adj_[4 * size_t(other >> 2) + (other & 3)] = 4 * nt + j;
+          edge_keys_[slot] = ~uint64_t(1); // tombstone (keeps probe chains of other keys intact)
+        } else {
+          edge_keys_[slot] = key;
+          edge_values_[slot] = 4 * nt + j;
+        }
+      }
+    }
+    std::fill(edge_keys_.begin(), edge_keys_.begin() + table_size, ~uint64_t(0));
+
+    // 3. Remove conflict region
+    for (auto c : cavity_) {
+      mark_[c] = kDead;
+      free_.push_back(c);
+    }
+    last_ = new_tets_[0];
+    for (auto nt : new_tets_) {
+      if (!isGhost(nt)) {
+        last_ = nt;
+        break;
+      }
+    }
+    return true;
+  }
+
+  // Returns false when there are no 4 affinely independent points
+  bool compute(const float* verts, size_t n) {
+    n_ = n;
+    points_.assign(verts, verts + 3 * n);
+    tets_.clear();
+    adj_.clear();
+    mark_.clear();
+    free_.clear();
+    c3xc0_.clear();
+    num_skipped_ = 0;
+    epoch_ = 0;
+    if (n < 4) { return false; }
+
+    order_ = orderBRIO(points_);
+    sorted_.resize(3 * n);
+    for (size_t k = 0; k < n; k++) { std::copy_n(&points_[3 * size_t(order_[k])], 3, &sorted_[3 * k]); }
+
+    // Initial tetrahedron from the first affinely independent points in insertion order
+    // (p2 is not collinear with p0, p1 when some q = p0 + unit axis is off their plane)
+    size_t i0 = 0, i1 = 1, i2 = 0, i3 = 0;
+    auto p0 = point(uint32_t(i0));
+    while (i1 < n && std::equal(p0, p0 + 3, point(uint32_t(i1)))) { i1++; }
+    if (i1 == n) { return false; }
+    auto p1 = point(uint32_t(i1));
+    for (i2 = i1 + 1; i2 < n; i2++) {
+      auto p2 = point(uint32_t(i2));
+      bool collinear = true;
+      for (size_t k = 0; k < 3 && collinear; k++) {
+        double q[3] = {p0[0], p0[1], p0[2]};
+        q[k] += 1;
+        collinear = orient3d(p0, p1, p2, q) == 0;
+      }
+      if (!collinear) { break; }
+    }
+    if (i2 == n) { return false; }
+    for (i3 = i2 + 1; i3 < n; i3++) {
+      if (orient3d(p0, p1, point(uint32_t(i2)), point(uint32_t(i3))) != 0) { break; }
+    }
+    if (i3 == n) { return false; }
+    uint32_t v[4] = {uint32_t(i0), uint32_t(i1), uint32_t(i2), uint32_t(i3)};
+    if (orient3d(point(v[0]), point(v[1]), point(v[2]), point(v[3])) < 0) { std::swap(v[2], v[3]); }
+
+    // Initial tetrahedron and 4 ghosts (ghost k has face k of the initial one reversed and oo instead of vertex k)
+    for (size_t k = 0; k < 5; k++) { newTet(); }
+    std::copy(v, v + 4, &tets_[0]);
+    for (uint32_t k = 0; k < 4; k++) {
+      uint32_t g = k + 1;
+      auto w = &tets_[4 * size_t(g)];
+      std::copy(v, v + 4, w);
+      w[k] = kGhost;
+      std::swap(w[(k + 1) & 3], w[(k + 2) & 3]);
+    }
+    // Adjacency by matching faces (vertex sets) among the 5 tetrahedra
+    auto faceKey = [&](uint32_t t, size_t i) {
+      uint32_t f[3], m = 0;
+      for (size_t k = 0; k < 4; k++) {
+        if (k != i) { f[m++] = tets_[4 * size_t(t) + k]; }
+      }
+      std::sort(f, f + 3);
+      return std::make_tuple(f[0], f[1], f[2]);
+    };
+    for (uint32_t t = 0; t < 5; t++) {
+      for (uint32_t i = 0; i < 4; i++) {
+        for (uint32_t s = 0; s < 5; s++) {
+          for (uint32_t j = 0; j < 4; j++) {
+            if (s != t && faceKey(t, i) == faceKey(s, j)) { adj_[4 * t + i] = 4 * s + j; }
+          }
+        }
+      }
+    }
+    last_ = 0;
+
+    // Insert the rest
+    for (size_t k = 0; k < n; k++) {
+      if (k == i0 || k == i1 || k == i2 || k == i3) { continue; }
+      if (!insert(uint32_t(k))) { num_skipped_++; }
+    }
+
+    // Finite tetrahedra
+    size_t nT = mark_.size();
+    for (size_t t = 0; t < nT; t++) {
+      if (mark_[t] == kDead || isGhost(uint32_t(t))) { continue; }
+      for (size_t k = 0; k < 4; k++) { c3xc0_.push_back(order_[tets_[4 * t + k]]); }
+    }
+    return true;
+  }
+};
+
+} // namespace delaunay
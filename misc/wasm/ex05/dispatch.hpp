@@ -0,0 +1,158 @@
+#pragma once
+
+//
+// Runtime CPU dispatch of SIMD kernels (native x86-64 builds with USE_DISPATCH, cf. CMakeLists.txt)
+//   - dispatch_kernels.hpp compiles misc::solve, reductions, GEMM and SpMM once per target
+//     (dispatch_generic.cpp, dispatch_avx2.cpp, dispatch_avx512.cpp) into separate namespaces,
+//     and each exposes its entry points as a `Kernels` table on plain arrays.
+//   - The first call of `kernels()` picks the widest target supported by the CPU (cpuid via __builtin_cpu_supports).
+//   - Environment variable SIMD_ISA (generic, avx2 or avx512) overrides the choice for testing
+//     (ignored with a warning when the CPU doesn't support it).
+//   - "generic" is compiled with the flags of the build (e.g. SSE2 by default, AVX2 with USE_NATIVE_ARCH).
+//   - Production entry points of float (misc::solve, reduce::sum/dot/max/axpy, gemm::gemm and MatrixCSR::spmm
+//     behind MatrixCSR::matmul_/matmulAdd_, thus pcg and ProjectiveDynamics) forward to `kernels()`
+//     when this header is included with USE_DISPATCH (DISPATCH_ROUTE below). dispatch_kernels.hpp compiles
+//     the bodies themselves, so DISPATCH_NAME (defined there) disables the forwarding.
+//
+
+#include <cassert>
+#include <cstdlib>
+#include <cstring>
+#include <vector>
+#include "format.hpp"
+
+#if !defined(DISPATCH_NAME)
+#define DISPATCH_ROUTE
+#endif
+
+namespace dispatch {
+
+enum Isa { kGeneric, kAvx2, kAvx512, kNumIsas };
+
+struct Kernels {
+  const char* name;
+  int simd_width; // simd::kWidth of the target
+
+  // misc::solve
+  void (*solve)(const std::vector<float>& u1, const std::vector<float>& u2, std::vector<float>& result);
+
+  // reduce::sum/dot/max/axpy
+  float (*sum)(const float* x, size_t n);
+  float (*dot)(const float* x, const float* y, size_t n);
+  float (*max)(const float* x, size_t n);
+  void (*axpy)(float a, const float* x, float* y, size_t n);
+
+  // gemm::gemm
+  void (*gemm)(size_t M, size_t N, size_t K, float alpha, const float* A, size_t lda,
+               const float* B, size_t ldb, float beta, float* C, size_t ldc);
+
+  // MatrixCSR<float>::spmm (y = A x or y += A x for n rows and nc columns)
+  void (*spmm)(size_t n, const size_t* indptr, const size_t* indices, const float* data,
+               const float* x, float* y, size_t nc, bool accumulate);
+};
+
+// Defined in dispatch_{generic,avx2,avx512}.cpp
+extern const Kernels kKernelsGeneric;
+extern const Kernels kKernelsAvx2;
+extern const Kernels kKernelsAvx512;
+
+inline const Kernels& getKernels(Isa isa) {
+  switch (isa) {
+    case kAvx2: return kKernelsAvx2;
+    case kAvx512: return kKernelsAvx512;
+    default: return kKernelsGeneric;
+  }
+}
+
+inline bool isSupported(Isa isa) {
+  __builtin_cpu_init();
+  switch (isa) {
+    case kGeneric: return true;
+    case kAvx2: return __builtin_cpu_supports("avx2") && __builtin_cpu_supports("fma");
+    case kAvx512: return __builtin_cpu_supports("avx512f") && __builtin_cpu_supports("fma");
+    default: return false;
+  }
+}
+
+// Widest supported target
+inline Isa detect() {
+  for (int isa = kNumIsas - 1; isa > kGeneric; isa--) {
+    if (isSupported(Isa(isa))) { return Isa(isa); }
+  }
+  return kGeneric;
+}
+
+// Returns false for unknown name
+inline bool parseIsa(const char* name, Isa& isa) {
+  for (int k = 0; k < kNumIsas; k++) {
+    if (std::strcmp(name, getKernels(Isa(k)).name) == 0) {
+      isa = Isa(k);
+      return true;
+    }
+  }
+  return false;
+}
+
+// Detected target unless SIMD_ISA is set
+inline Isa selectFromEnv() {
+  Isa result = detect();
+  const char* env = std::getenv("SIMD_ISA");
+  if (!env || !*env) { return result; }
+  Isa isa;
+  if (!parseIsa(env, isa)) {
+    format::prints("[dispatch] unknown SIMD_ISA=%s (using %s)", env, getKernels(result).name);
+  } else if (!isSupported(isa)) {
+    format::prints("[dispatch] SIMD_ISA=%s is not supported by CPU (using %s)", env, getKernels(result).name);
+  } else {
+    result = isa;
+  }
+  return result;
+}
+
+inline Isa& currentIsa() {
+  static Isa result = selectFromEnv();
+  return result;
+}
+
+inline Isa getIsa() { return currentIsa(); }
+
+// Returns false when the CPU doesn't support `isa` (e.g. for testing every target in turn)
+inline bool setIsa(Isa isa) {
+  if (!isSupported(isa)) { return false; }
+  currentIsa() = isa;
+  return true;
+}
+
+// Replaces the table returned by `kernels()` until reset by nullptr
+// (e.g. tests checking that production entry points go through the selected kernels)
+inline const Kernels*& kernelsOverride() {
+  static const Kernels* result = nullptr;
+  return result;
+}
+
+inline const Kernels& kernels() {
+  auto table = kernelsOverride();
+  return table ? *table : getKernels(getIsa());
+}
+
+// Shorthands with the same signatures as misc::solve and MatrixCSR<float>::matmul_/matmulAdd_
+// (MatrixCSR/Matrix are template parameters so that this header doesn't include matrix.hpp)
+inline void solve(const std::vector<float>& u1, const std::vector<float>& u2, std::vector<float>& result) {
+  kernels().solve(u1, u2, result);
+}
+
+template<typename CSR, typename Dense>
+inline void matmul_(const CSR& A, const Dense& x, Dense& y, bool accumulate = false) {
+  assert(y.shape_[0] == A.shape_[0]);
+  assert(A.shape_[1] == x.shape_[0]);
+  assert(x.shape_[1] == y.shape_[1]);
+  kernels().spmm(A.shape_[0], A.indptr_.data(), A.indices_.data(), A.data_.data(),
+                 x.data_.data(), y.data_.data(), x.shape_[1], accumulate);
+}
+
+template<typename CSR, typename Dense>
+inline void matmulAdd_(const CSR& A, const Dense& x, Dense& y) {
+  matmul_(A, x, y, true);
+}
+
+} // namespace dispatch
@@ -0,0 +1,6 @@
+// Kernels for AVX2 + FMA (cf. dispatch.hpp)
+#define DISPATCH_NAME avx2
+#define DISPATCH_TABLE kKernelsAvx2
+#define DISPATCH_TARGET "avx2,fma"
+#define SIMD_AVX
+#include "dispatch_kernels.hpp"
@@ -0,0 +1,6 @@
+// Kernels for AVX-512F (cf. dispatch.hpp)
+#define DISPATCH_NAME avx512
+#define DISPATCH_TABLE kKernelsAvx512
+#define DISPATCH_TARGET "avx512f,avx2,fma"
+#define SIMD_AVX512
+#include "dispatch_kernels.hpp"
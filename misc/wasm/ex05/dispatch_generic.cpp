@@ -0,0 +1,4 @@
+// Kernels compiled with the default flags of the build (cf. dispatch.hpp)
+#define DISPATCH_NAME generic
+#define DISPATCH_TABLE kKernelsGeneric
+#include "dispatch_kernels.hpp"
@@ -0,0 +1,79 @@
+//
+// Body of dispatch_{generic,avx2,avx512}.cpp (no include guard since each of them includes this once)
+//
+// The kernel headers are included inside namespace dispatch::<target> and, for avx2/avx512,
+// under `#pragma GCC target` (or clang's equivalent) instead of compiling the file with -mavx2 etc.
+// This way every function of the kernels has its own symbol per target, while anything outside
+// (standard library, glm, thread_pool) is compiled with the default flags. Otherwise the linker
+// could pick an AVX instantiation of e.g. std::vector<float> for the whole program.
+//
+// The includer defines DISPATCH_NAME (namespace and name in `Kernels`), DISPATCH_TABLE (variable name)
+// and, for non-generic targets, DISPATCH_TARGET together with the matching SIMD_AVX/SIMD_AVX512 (cf. simd.hpp).
+//
+
+// Headers used by the kernels (included first so that they stay out of the namespace)
+#include <algorithm>
+#include <array>
+#include <cassert>
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+#include <limits>
+#include <type_traits>
+#include <utility>
+#include <vector>
+#include <glm/glm.hpp>
+#include <immintrin.h>
+#include "thread_pool.hpp"
+#include "dispatch.hpp"
+
+#define DISPATCH_STR(...) #__VA_ARGS__
+#define DISPATCH_XSTR(...) DISPATCH_STR(__VA_ARGS__)
+#if defined(DISPATCH_TARGET) && defined(__clang__)
+_Pragma(DISPATCH_XSTR(clang attribute push(__attribute__((target(DISPATCH_TARGET))), apply_to = function)))
+#elif defined(DISPATCH_TARGET)
+#pragma GCC push_options
+_Pragma(DISPATCH_XSTR(GCC target(DISPATCH_TARGET)))
+#endif
+
+namespace dispatch {
+namespace DISPATCH_NAME {
+
+#include "simd.hpp"
+#include "reduce.hpp"
+#include "gemm.hpp"
+#include "matrix.hpp"
+#include "misc.hpp"
+
+void spmm(size_t n, const size_t* indptr, const size_t* indices, const float* data,
+          const float* x, float* y, size_t nc, bool accumulate) {
+  if (accumulate) {
+    MatrixCSR<float>::spmm<true>(n, indptr, indices, data, x, y, nc);
+  } else {
+    MatrixCSR<float>::spmm<false>(n, indptr, indices, data, x, y, nc);
+  }
+}
+
+} // namespace DISPATCH_NAME
+
+extern const Kernels DISPATCH_TABLE;
+
+const Kernels DISPATCH_TABLE = {
+  DISPATCH_XSTR(DISPATCH_NAME),
+  DISPATCH_NAME::simd::kWidth,
+  &DISPATCH_NAME::misc::solve,
+  &DISPATCH_NAME::reduce::sum<float>,
+  &DISPATCH_NAME::reduce::dot<float>,
+  &DISPATCH_NAME::reduce::max<float>,
+  &DISPATCH_NAME::reduce::axpy<float>,
+  &DISPATCH_NAME::gemm::gemm<float>,
+  &DISPATCH_NAME::spmm,
+};
+
+} // namespace dispatch
+
+#if defined(DISPATCH_TARGET) && defined(__clang__)
+_Pragma("clang attribute pop")
+#elif defined(DISPATCH_TARGET)
+#pragma GCC pop_options
+#endif
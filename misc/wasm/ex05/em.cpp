@@ -2,6 +2,11 @@
 #include <emscripten/bind.h>
 #include <emscripten/val.h>
 #include "misc.hpp"
+#include "projective_dynamics.hpp"
+#include "ddg.hpp"
+#include "delaunay.hpp"
+#include "graph.hpp"
+#include "trace.hpp"
 
 using namespace emscripten;
 
@@ -17,10 +22,148 @@ std::vector<T> Vector_zeros(size_t n) {
   return a;
 }
 
+// In-place version of `zeros` (reuses the capacity, e.g. for per-frame buffers)
+template<typename T>
+void Vector_assignZeros(std::vector<T>& self, size_t n) {
+  self.assign(n, 0);
+}
+
+//
+// ProjectiveDynamics views (valid as long as wasm memory doesn't grow after `init`)
+//
+
+val ProjectiveDynamics_verts(physics::ProjectiveDynamics& self) {
+  return Vector_data(self.verts_.data_);
+}
+
+val ProjectiveDynamics_velocities(physics::ProjectiveDynamics& self) {
+  return Vector_data(self.v_.data_);
+}
+
+val ProjectiveDynamics_c3xc0(physics::ProjectiveDynamics& self) {
+  return Vector_data(self.c3xc0_);
+}
+
+val ProjectiveDynamics_handles(physics::ProjectiveDynamics& self) {
+  return Vector_data(self.handles_);
+}
+
+val ProjectiveDynamics_handleTargets(physics::ProjectiveDynamics& self) {
+  return Vector_data(self.handle_targets_.data_);
+}
+
+void ProjectiveDynamics_setIterPD(physics::ProjectiveDynamics& self, int iterPD) {
+  self.iterPD_ = iterPD;
+}
+
+// Collision is enabled by stiffness > 0 before `init`
+void ProjectiveDynamics_setContact(physics::ProjectiveDynamics& self, float stiffness, float thickness) {
+  self.contact_stiffness_ = stiffness;
+  self.collision_.thickness_ = thickness;
+}
+
+size_t ProjectiveDynamics_numContacts(physics::ProjectiveDynamics& self) {
+  return self.collision_.contact_verts_.size();
+}
+
+//
+// ddg::Mesh views (`verts` and `f2v` are filled before `init`, others are valid after `init` or `update`)
+//
+
+val Mesh_verts(ddg::Mesh& self) { return Vector_data(self.verts_.data_); }
+val Mesh_f2v(ddg::Mesh& self) { return Vector_data(self.topology_.f2v_); }
+val Mesh_e2v(ddg::Mesh& self) { return Vector_data(self.topology_.e2v_); }
+val Mesh_twin(ddg::Mesh& self) { return Vector_data(self.topology_.twin_); }
+val Mesh_hodge0(ddg::Mesh& self) { return Vector_data(self.hodge0_); }
+val Mesh_hodge1(ddg::Mesh& self) { return Vector_data(self.hodge1_); }
+val Mesh_kg(ddg::Mesh& self) { return Vector_data(self.kg_); }
+val Mesh_meanCurvature(ddg::Mesh& self) { return Vector_data(self.mean_curvature_.data_); }
+val Mesh_normals(ddg::Mesh& self) { return Vector_data(self.normals_.data_); }
+val Mesh_laplacianIndptr(ddg::Mesh& self) { return Vector_data(self.laplacian_.indptr_); }
+val Mesh_laplacianIndices(ddg::Mesh& self) { return Vector_data(self.laplacian_.indices_); }
+val Mesh_laplacianData(ddg::Mesh& self) { return Vector_data(self.laplacian_.data_); }
+size_t Mesh_numEdges(ddg::Mesh& self) { return self.topology_.nE_; }
+bool Mesh_hasBoundary(ddg::Mesh& self) { return self.topology_.boundary_; }
+
+//
+// delaunay::Delaunay (`verts` is Vector of 3 n floats, `c3xc0` is valid after `compute`)
+//
+
+bool Delaunay_compute(delaunay::Delaunay& self, const std::vector<float>& verts) {
+  return self.compute(verts.data(), verts.size() / 3);
+}
+val Delaunay_c3xc0(delaunay::Delaunay& self) { return Vector_data(self.c3xc0_); }
+size_t Delaunay_numSkipped(delaunay::Delaunay& self) { return self.num_skipped_; }
+
+//
+// graph::TreeCotree (homology generators of closed `mesh` after `Mesh.init`, loop i is loops[loopsIndptr[i]:loopsIndptr[i + 1]])
+//
+
+bool TreeCotree_compute(graph::TreeCotree& self, ddg::Mesh& mesh) { return self.compute(mesh.topology_); }
+val TreeCotree_edgeKind(graph::TreeCotree& self) { return Vector_data(self.edge_kind_); }
+val TreeCotree_generators(graph::TreeCotree& self) { return Vector_data(self.generators_); }
+val TreeCotree_loopsIndptr(graph::TreeCotree& self) { return Vector_data(self.loops_indptr_); }
+val TreeCotree_loops(graph::TreeCotree& self) { return Vector_data(self.loops_); }
+
 EMSCRIPTEN_BINDINGS(ex05) {
   register_vector<float>("Vector")
     .function("data", &Vector_data<float>)
+    .function("assignZeros", &Vector_assignZeros<float>)
     .class_function("zeros", &Vector_zeros<float>);
 
   function("solve", &misc::solve);
+  function("solvePolar", &misc::solvePolar);
+  function("setNumThreads", &thread_pool::setNumThreads);
+  function("getNumThreads", &thread_pool::getNumThreads);
+
+  // Chrome trace JSON of zones recorded while enabled (e.g. `JSON.parse(traceToJSON())`)
+  function("traceEnable", &trace::enable);
+  function("traceClear", &trace::clear);
+  function("traceToJSON", &trace::toJSON);
+
+  class_<physics::ProjectiveDynamics>("ProjectiveDynamics")
+    .constructor<size_t, size_t, size_t>()
+    .function("verts", &ProjectiveDynamics_verts)
+    .function("velocities", &ProjectiveDynamics_velocities)
+    .function("c3xc0", &ProjectiveDynamics_c3xc0)
+    .function("handles", &ProjectiveDynamics_handles)
+    .function("handleTargets", &ProjectiveDynamics_handleTargets)
+    .function("setIterPD", &ProjectiveDynamics_setIterPD)
+    .function("setContact", &ProjectiveDynamics_setContact)
+    .function("numContacts", &ProjectiveDynamics_numContacts)
+    .function("init", &physics::ProjectiveDynamics::init)
+    .function("update", &physics::ProjectiveDynamics::update);
+
+  class_<ddg::Mesh>("Mesh")
+    .constructor<size_t, size_t>()
+    .function("verts", &Mesh_verts)
+    .function("f2v", &Mesh_f2v)
+    .function("e2v", &Mesh_e2v)
+    .function("twin", &Mesh_twin)
+    .function("hodge0", &Mesh_hodge0)
+    .function("hodge1", &Mesh_hodge1)
+    .function("kg", &Mesh_kg)
+    .function("meanCurvature", &Mesh_meanCurvature)
+    .function("normals", &Mesh_normals)
+    .function("laplacianIndptr", &Mesh_laplacianIndptr)
+    .function("laplacianIndices", &Mesh_laplacianIndices)
+    .function("laplacianData", &Mesh_laplacianData)
+    .function("numEdges", &Mesh_numEdges)
+    .function("hasBoundary", &Mesh_hasBoundary)
+    .function("init", &ddg::Mesh::init)
+    .function("update", &ddg::Mesh::update);
+
+  class_<delaunay::Delaunay>("Delaunay")
+    .constructor<>()
+    .function("compute", &Delaunay_compute)
+    .function("c3xc0", &Delaunay_c3xc0)
+    .function("numSkipped", &Delaunay_numSkipped);
+
+  class_<graph::TreeCotree>("TreeCotree")
+    .constructor<>()
+    .function("compute", &TreeCotree_compute)
+    .function("edgeKind", &TreeCotree_edgeKind)
+    .function("generators", &TreeCotree_generators)
+    .function("loopsIndptr", &TreeCotree_loopsIndptr)
+    .function("loops", &TreeCotree_loops);
 }
@@ -2,6 +2,8 @@
 
 //
 // Simple wraper of printf with ostringstream
+//   - formatTo(out, ...) appends to `out` and doesn't allocate when `out` has enough capacity
+//     and arguments are scalars or strings (e.g. reuse the same string for per-frame log)
 //
 
 #include <cstdio>
@@ -35,6 +37,21 @@ inline std::string formatScalarOrString(const char* format_str, const Ts&... vs)
   return result;
 }
 
+// Append to `out` trying the spare capacity first
+template<typename... Ts>
+inline void appendScalarOrString(std::string& out, const char* format_str, const Ts&... vs) {
+  size_t offset = out.size();
+  out.resize(out.capacity());
+  // Writing up to `capacity + 1` bytes is fine since the last one is null terminator
+  int size = std::snprintf(out.data() + offset, out.size() - offset + 1, format_str, toScalarOrChars(vs)...);
+  assert(size >= 0);
+  if (offset + size > out.size()) {
+    out.resize(offset + size);
+    std::snprintf(out.data() + offset, size + 1, format_str, toScalarOrChars(vs)...);
+  }
+  out.resize(offset + size);
+}
+
 //
 // toScalarOrString
 //
@@ -44,6 +61,14 @@ inline T toScalarOrString(T v) {
   return v;
 }
 
+inline const std::string& toScalarOrString(const std::string& v) {
+  return v;
+}
+
+inline const char* toScalarOrString(const char* v) {
+  return v;
+}
+
 template<typename T, std::enable_if_t<!std::is_scalar_v<T>, int> = 0>
 inline std::string toScalarOrString(const T& v) {
   std::ostringstream result;
@@ -65,6 +90,15 @@ inline std::string format(const char* fmtstr) {
   return std::string{fmtstr};
 }
 
+template<typename T, typename... Ts>
+inline void formatTo(std::string& out, const char* fmtstr, const T& v, const Ts&... vs) {
+  appendScalarOrString(out, fmtstr, toScalarOrString(v), toScalarOrString(vs)...);
+}
+
+inline void formatTo(std::string& out, const char* fmtstr) {
+  out += fmtstr;
+}
+
 template<typename... Ts>
 inline void print(const char* fmtstr, const Ts&... vs) {
   std::string result = format(fmtstr, vs...);
@@ -0,0 +1,148 @@
+#pragma once
+
+//
+// Multicolor Gauss-Seidel / SOR smoother (parallel version of MatrixCSR::gaussSeidel)
+//
+// - setup : greedy coloring of rows so that rows of the same color don't refer to each other,
+//           which allows each color class to be swept in parallel.
+//           It also precomputes inverse diagonal (duplicate diagonal entries are summed).
+// - step  : one sweep over colors with relaxation parameter omega (omega = 1 is Gauss-Seidel)
+// - stepSymmetric : forward sweep followed by backward sweep (colors in reverse order, skipping the last color
+//                   for omega = 1)
+//
+// Assume A has symmetric pattern (e.g. Laplacian), otherwise coloring doesn't guarantee independence.
+//
+
+#include <algorithm>
+#include <cassert>
+#include <vector>
+#include "matrix.hpp"
+#include "thread_pool.hpp"
+
+namespace gauss_seidel {
+
+using std::vector;
+
+template<typename T>
+struct MulticolorGaussSeidel {
+  size_t n_ = 0;
+  vector<size_t> color_indptr_ = {0}; // rows of color c are rows_[color_indptr_[c] : color_indptr_[c + 1]]
+  vector<size_t> rows_;
+  vector<T> inv_diag_;
+
+  size_t numColors() const { return color_indptr_.size() - 1; }
+
+  // Returns false when some diagonal is zero
+  bool setup(const MatrixCSR<T>& A) {
+    assert(A.shape_[0] == A.shape_[1]);
+    size_t n = n_ = A.shape_[0];
+
+    // Greedy coloring (smallest color not used by already colored neighbors)
+    vector<size_t> color(n);
+    vector<size_t> last_seen; // last_seen[c] == i + 1 iff color c is used by neighbor of row i
+    size_t num_colors = 0;
+    for (size_t i = 0; i < n; i++) {
+      for (auto p = A.indptr_[i]; p < A.indptr_[i + 1]; p++) {
+        size_t j = A.indices_[p];
+        if (j < i) { last_seen[color[j]] = i + 1; }
+      }
+      size_t c = 0;
+      while (c < num_colors && last_seen[c] == i + 1) { c++; }
+      if (c == num_colors) {
+        num_colors++;
+        last_seen.push_back(0);
+      }
+      color[i] = c;
+    }
+
+    // Bucket rows by color (rows are kept in increasing order within color)
+    color_indptr_.assign(num_colors + 1, 0);
+    for (size_t i = 0; i < n; i++) { color_indptr_[color[i] + 1]++; }
+    for (size_t c = 0; c < num_colors; c++) { color_indptr_[c + 1] += color_indptr_[c]; }
+    rows_.resize(n);
+    vector<size_t> offsets(color_indptr_.begin(), color_indptr_.end() - 1);
+    for (size_t i = 0; i < n; i++) { rows_[offsets[color[i]]++] = i; }
+
+    // Inverse diagonal
+    inv_diag_.assign(n, 0);
+    bool ok = true;
+    for (size_t i = 0; i < n; i++) {
+      T diag = 0;
+      for (auto p = A.indptr_[i]; p < A.indptr_[i + 1]; p++) {
+        if (A.indices_[p] == i) { diag += A.data_[p]; }
+      }
+      ok = ok && diag != 0;
+      inv_diag_[i] = diag != 0 ? T(1) / diag : T(0);
+    }
+    return ok;
+  }
+
+  // x_i <- (1 - omega) x_i + omega (b_i - sum_{j != i} A_ij x_j) / A_ii for rows of color c
+  void sweepColor(const MatrixCSR<T>& A, Matrix<T>& x, const Matrix<T>& b, T omega, size_t c) const {
+    size_t nc = x.shape_[1];
+    size_t begin = color_indptr_[c];
+    size_t end = color_indptr_[c + 1];
+    auto& pool = thread_pool::getDefault();
+    size_t grain = std::max<size_t>(256, pool.defaultGrain(end - begin));
+    pool.parallelFor(begin, end, grain, [&](size_t q0, size_t q1) {
+      constexpr size_t kMaxCols = 8;
+      for (size_t q = q0; q < q1; q++) {
+        size_t i = rows_[q];
+        for (size_t k0 = 0; k0 < nc; k0 += kMaxCols) {
+          size_t k1 = std::min(nc, k0 + kMaxCols);
+          T rhs[kMaxCols];
+          for (size_t k = k0; k < k1; k++) {
+            rhs[k - k0] = b(i, k);
+          }
+          // Subtract whole row including diagonal (avoids branch in the inner loop)
+          for (auto p = A.indptr_[i]; p < A.indptr_[i + 1]; p++) {
+            size_t j = A.indices_[p];
+            T Aij = A.data_[p];
+            for (size_t k = k0; k < k1; k++) {
+              rhs[k - k0] -= Aij * x(j, k);
+            }
+          }
+          T inv_d = inv_diag_[i];
+          for (size_t k = k0; k < k1; k++) {
+            // x_i + rhs / A_ii = (b_i - sum_{j != i} A_ij x_j) / A_ii
+            T xi = x(i, k);
+            T gs = xi + inv_d * rhs[k - k0];
+            x(i, k) = (1 - omega) * xi + omega * gs;
+          }
+        }
+      }
+    });
+  }
+
+  void step(const MatrixCSR<T>& A, Matrix<T>& x, const Matrix<T>& b, T omega = 1) const {
+    assert(A.shape_[0] == n_);
+    for (size_t c = 0; c < numColors(); c++) {
+      sweepColor(A, x, b, omega, c);
+    }
+  }
+
+  // Backward sweep starts at numColors() - 2 for omega = 1 since rows of the last color were just solved
+  // against unchanged neighbors (SOR relaxes the last color twice as point-wise SSOR does for the last row)
+  void stepSymmetric(const MatrixCSR<T>& A, Matrix<T>& x, const Matrix<T>& b, T omega = 1) const {
+    assert(A.shape_[0] == n_);
+    for (size_t c = 0; c < numColors(); c++) {
+      sweepColor(A, x, b, omega, c);
+    }
+    size_t c_last = (omega == 1 && numColors() > 0) ? numColors() - 1 : numColors();
+    for (size_t c = c_last; c-- > 0;) {
+      sweepColor(A, x, b, omega, c);
+    }
+  }
+
+  void solve(const MatrixCSR<T>& A, Matrix<T>& x, const Matrix<T>& b, int iteration, T omega = 1, bool symmetric = false) const {
+    for (auto i = 0; i < iteration; i++) {
+      if (symmetric) {
+        stepSymmetric(A, x, b, omega);
+      } else {
+        step(A, x, b, omega);
+      }
+    }
+  }
+};
+
+} // namespace gauss_seidel
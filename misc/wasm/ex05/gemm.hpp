@@ -0,0 +1,205 @@
+#pragma once
+
+//
+// Dense GEMM  C = alpha A B + beta C  (row major)
+//   - Blocking follows Goto and van de Geijn "Anatomy of High-Performance Matrix Multiplication":
+//     KC x NC block of B is packed into NR-wide panels (shared by threads),
+//     MC x KC block of A is packed into MR-tall panels (per thread),
+//     and MR x NR micro kernel keeps the tile of C in registers.
+//   - NR is two SIMD vectors (cf. simd.hpp) so that float/double use the same kernel.
+//   - MC blocks are distributed over `thread_pool::getDefault()`.
+//   - Packed blocks live in `arena::threadArena()` (B in calling thread's, A in each worker's),
+//     thus steady state doesn't allocate.
+//   - Small problems (e.g. 9 x 12 constraint blocks) go through plain i-k-j loop
+//     since packing doesn't pay off.
+//
+
+#include <algorithm>
+#include <cassert>
+#include <type_traits>
+#include "arena.hpp"
+#include "simd.hpp"
+#include "thread_pool.hpp"
+#if defined(USE_DISPATCH)
+#include "dispatch.hpp"
+#endif
+
+namespace gemm {
+
+template<typename T>
+struct Config {
+  static constexpr size_t kLanes = simd::Vec<T>::kSize;
+  static constexpr size_t kMR = 6;
+  static constexpr size_t kNR = 2 * kLanes;
+  static constexpr size_t kKC = 256;
+  static constexpr size_t kMC = 16 * kMR;
+  static constexpr size_t kNC = 128 * kNR;
+  static constexpr size_t kSmall = 32 * 32 * 32; // M N K below this uses `gemmSmall`
+};
+
+// C = beta C (beta = 0 overwrites so that NaN in C doesn't propagate)
+template<typename T>
+void scale(size_t M, size_t N, T beta, T* C, size_t ldc) {
+  if (beta == T(1)) { return; }
+  for (size_t i = 0; i < M; i++) {
+    auto c = C + i * ldc;
+    for (size_t j = 0; j < N; j++) {
+      c[j] = (beta == T(0)) ? T(0) : beta * c[j];
+    }
+  }
+}
+
+template<typename T>
+void gemmSmall(
+    size_t M, size_t N, size_t K,
+    T alpha, const T* A, size_t lda, const T* B, size_t ldb,
+    T beta, T* C, size_t ldc) {
+  scale(M, N, beta, C, ldc);
+  for (size_t i = 0; i < M; i++) {
+    auto c = C + i * ldc;
+    for (size_t k = 0; k < K; k++) {
+      T aik = alpha * A[i * lda + k];
+      auto b = B + k * ldb;
+      for (size_t j = 0; j < N; j++) {
+        c[j] += aik * b[j];
+      }
+    }
+  }
+}
+
+// Pack kc x nc block of B into NR-wide panels (zero padded)
+template<typename T>
+void packB(size_t kc, size_t nc, const T* B, size_t ldb, T* dst) {
+  constexpr size_t NR = Config<T>::kNR;
+  for (size_t j0 = 0; j0 < nc; j0 += NR) {
+    size_t nr = std::min(NR, nc - j0);
+    for (size_t p = 0; p < kc; p++) {
+      auto b = B + p * ldb + j0;
+      size_t j = 0;
+      for (; j < nr; j++) { dst[j] = b[j]; }
+      for (; j < NR; j++) { dst[j] = T(0); }
+      dst += NR;
+    }
+  }
+}
+
+// Pack mc x kc block of A into MR-tall panels (zero padded, column major within panel)
+template<typename T>
+void packA(size_t mc, size_t kc, const T* A, size_t lda, T* dst) {
+  constexpr size_t MR = Config<T>::kMR;
+  for (size_t i0 = 0; i0 < mc; i0 += MR) {
+    size_t mr = std::min(MR, mc - i0);
+    for (size_t p = 0; p < kc; p++) {
+      size_t r = 0;
+      for (; r < mr; r++) { dst[r] = A[(i0 + r) * lda + p]; }
+      for (; r < MR; r++) { dst[r] = T(0); }
+      dst += MR;
+    }
+  }
+}
+
+// C[0:mr, 0:nr] += alpha a b where a is MR x kc panel and b is kc x NR panel
+template<typename T>
+inline void microKernel(
+    size_t kc, const T* a, const T* b, T alpha,
+    T* C, size_t ldc, size_t mr, size_t nr) {
+  using V = typename simd::Vec<T>::type;
+  constexpr size_t kLanes = Config<T>::kLanes;
+  constexpr size_t MR = Config<T>::kMR;
+  constexpr size_t NR = Config<T>::kNR;
+
+  V c0[MR], c1[MR];
+  for (size_t r = 0; r < MR; r++) {
+    c0[r] = simd::broadcast<V>(T(0));
+    c1[r] = simd::broadcast<V>(T(0));
+  }
+  for (size_t p = 0; p < kc; p++) {
+    V b0 = simd::load<V>(b);
+    V b1 = simd::load<V>(b + kLanes);
+    for (size_t r = 0; r < MR; r++) {
+      V ar = simd::broadcast<V>(a[r]);
+      c0[r] += ar * b0;
+      c1[r] += ar * b1;
+    }
+    a += MR;
+    b += NR;
+  }
+
+  V alphav = simd::broadcast<V>(alpha);
+  if (mr == MR && nr == NR) {
+    for (size_t r = 0; r < MR; r++) {
+      auto c = C + r * ldc;
+      simd::store(c, simd::load<V>(c) + alphav * c0[r]);
+      simd::store(c + kLanes, simd::load<V>(c + kLanes) + alphav * c1[r]);
+    }
+    return;
+  }
+
+  // Edge tile
+  T tmp[MR * NR];
+  for (size_t r = 0; r < MR; r++) {
+    simd::store(&tmp[r * NR], alphav * c0[r]);
+    simd::store(&tmp[r * NR + kLanes], alphav * c1[r]);
+  }
+  for (size_t r = 0; r < mr; r++) {
+    for (size_t j = 0; j < nr; j++) {
+      C[r * ldc + j] += tmp[r * NR + j];
+    }
+  }
+}
+
+// C = alpha A B + beta C where A is M x K, B is K x N, C is M x N (row major with leading dimensions)
+template<typename T>
+void gemm(
+    size_t M, size_t N, size_t K,
+    T alpha, const T* A, size_t lda, const T* B, size_t ldb,
+    T beta, T* C, size_t ldc) {
+#if defined(DISPATCH_ROUTE)
+  if constexpr (std::is_same_v<T, float>) {
+    dispatch::kernels().gemm(M, N, K, alpha, A, lda, B, ldb, beta, C, ldc);
+    return;
+  }
+#endif
+  using Cfg = Config<T>;
+  if (M == 0 || N == 0) { return; }
+  if (M * N * K <= Cfg::kSmall) {
+    gemmSmall(M, N, K, alpha, A, lda, B, ldb, beta, C, ldc);
+    return;
+  }
+  scale(M, N, beta, C, ldc);
+  if (K == 0 || alpha == T(0)) { return; }
+
+  auto& pool = thread_pool::getDefault();
+  arena::Scope scope{arena::threadArena()};
+  T* B_packed = scope.allocate<T>(Cfg::kKC * (Cfg::kNC + Cfg::kNR));
+
+  for (size_t jc = 0; jc < N; jc += Cfg::kNC) {
+    size_t nc = std::min(Cfg::kNC, N - jc);
+    for (size_t pc = 0; pc < K; pc += Cfg::kKC) {
+      size_t kc = std::min(Cfg::kKC, K - pc);
+      packB(kc, nc, B + pc * ldb + jc, ldb, B_packed);
+
+      size_t num_blocks = (M + Cfg::kMC - 1) / Cfg::kMC;
+      pool.parallelFor(0, num_blocks, 1, [&](size_t block_begin, size_t block_end) {
+        arena::Scope scope{arena::threadArena()};
+        T* A_packed = scope.allocate<T>(Cfg::kKC * (Cfg::kMC + Cfg::kMR));
+        for (size_t block = block_begin; block < block_end; block++) {
+          size_t ic = block * Cfg::kMC;
+          size_t mc = std::min(Cfg::kMC, M - ic);
+          packA(mc, kc, A + ic * lda + pc, lda, A_packed);
+          for (size_t jr = 0; jr < nc; jr += Cfg::kNR) {
+            size_t nr = std::min(Cfg::kNR, nc - jr);
+            for (size_t ir = 0; ir < mc; ir += Cfg::kMR) {
+              size_t mr = std::min(Cfg::kMR, mc - ir);
+              microKernel(
+                  kc, &A_packed[ir * kc], &B_packed[jr * kc], alpha,
+                  C + (ic + ir) * ldc + jc + jr, ldc, mr, nr);
+            }
+          }
+        }
+      });
+    }
+  }
+}
+
+} // namespace gemm
@@ -0,0 +1,293 @@
+#pragma once
+
+//
+// Graph kernels over CSR adjacency with edge ids (native version of spanning tree / tree-cotree in src/utils/ddg.js)
+//   - Graph is v2ve (vertex -> (vertex, edge)) or f2fe (face -> (face, edge)) of ddg.js as flat CSR.
+//   - BFS is direction-optimizing (Beamer et al.): top-down expands the frontier while it is small and
+//     bottom-up lets each unvisited node look for a neighbor in the frontier once the frontier touches
+//     a large part of the edges. Both steps run on thread_pool.
+//   - Parent of each node is the first neighbor (in CSR order) on the previous level, and `order_` is
+//     sorted by (level, node), thus the tree doesn't depend on the number of threads or on which direction was used.
+//   - Tree-cotree: BFS on faces (dual tree), then BFS on vertices avoiding dual tree edges (primal tree).
+//     Remaining edges generate homology (2g of them for closed genus-g surface), and each loop is
+//     the dual tree path between the two faces of the generator (cf. computeLoop in ddg.js)
+//     written to a flat buffer (loops_indptr_, loops_) without the common part near the root.
+//
+
+#include <algorithm>
+#include <atomic>
+#include <cassert>
+#include <cstdint>
+#include <vector>
+#include "thread_pool.hpp"
+#include "ddg.hpp"
+
+namespace graph {
+
+using std::vector;
+
+constexpr uint32_t kNone = ~uint32_t(0);
+
+struct Graph {
+  size_t n_ = 0;
+  vector<size_t> indptr_;    // n + 1
+  vector<uint32_t> nodes_;   // neighbor
+  vector<uint32_t> edges_;   // edge id of each adjacency
+
+  size_t degree(size_t v) const { return indptr_[v + 1] - indptr_[v]; }
+};
+
+// v2ve (neighbors are sorted since ddg::Topology::v2e_ is)
+inline Graph computeV2VE(const ddg::Topology& topology) {
+  Graph result;
+  result.n_ = topology.nV_;
+  result.indptr_ = topology.v2e_indptr_;
+  result.edges_ = topology.v2e_;
+  result.nodes_.resize(topology.v2e_.size());
+  for (size_t v = 0; v < topology.nV_; v++) {
+    for (auto p = topology.v2e_indptr_[v]; p < topology.v2e_indptr_[v + 1]; p++) {
+      result.nodes_[p] = topology.other(topology.v2e_[p], uint32_t(v));
+    }
+  }
+  return result;
+}
+
+// f2fe (neighbors across half-edges 3 f, 3 f + 1, 3 f + 2 except boundary)
+inline Graph computeF2FE(const ddg::Topology& topology) {
+  Graph result;
+  size_t nF = topology.nF_;
+  result.n_ = nF;
+  result.indptr_.assign(nF + 1, 0);
+  for (size_t f = 0; f < nF; f++) {
+    size_t count = 0;
+    for (size_t j = 0; j < 3; j++) { count += topology.twin_[3 * f + j] != ddg::kNone; }
+    result.indptr_[f + 1] = result.indptr_[f] + count;
+  }
+  result.nodes_.resize(result.indptr_[nF]);
+  result.edges_.resize(result.indptr_[nF]);
+  for (size_t f = 0; f < nF; f++) {
+    size_t p = result.indptr_[f];
+    for (size_t j = 0; j < 3; j++) {
+      uint32_t h = uint32_t(3 * f + j);
+      uint32_t twin = topology.twin_[h];
+      if (twin == ddg::kNone) { continue; }
+      result.nodes_[p] = twin / 3;
+      result.edges_[p] = topology.h2e_[h];
+      p++;
+    }
+  }
+  return result;
+}
+
+//
+// BFS tree
+//
+
+struct BFS {
+  // Heuristic of direction switch (cf. Beamer et al., "Direction-Optimizing Breadth-First Search")
+  size_t alpha_ = 14; // bottom-up when frontier edges > unexplored edges / alpha
+  size_t beta_ = 24;  // top-down when frontier nodes < n / beta
+
+  vector<uint32_t> level_;        // n (kNone when not reached)
+  vector<uint32_t> parent_;       // n (kNone for root and unreached)
+  vector<uint32_t> parent_edge_;  // n
+  vector<uint32_t> order_;        // reached nodes sorted by (level, node) (i.e. topological order of the tree)
+  size_t num_levels_ = 0;
+  size_t num_bottom_up_ = 0;      // number of levels expanded bottom-up (for testing)
+
+  // Workspace
+  vector<std::atomic<uint32_t>> levels_;
+  vector<uint32_t> frontier_, next_;
+  vector<vector<uint32_t>> locals_;
+
+  // `blocked` (optional, per edge) excludes edges from traversal
+  void compute(const Graph& graph, uint32_t root, const vector<uint8_t>* blocked = nullptr) {
+    size_t n = graph.n_;
+    assert(root < n);
+    auto& pool = thread_pool::getDefault();
+    auto usable = [&](size_t p) { return !blocked || !(*blocked)[graph.edges_[p]]; };
+
+    if (levels_.size() != n) { levels_ = vector<std::atomic<uint32_t>>(n); }
+    pool.parallelFor(0, n, 0, [&](size_t i0, size_t i1) {
+      for (size_t i = i0; i < i1; i++) { levels_[i].store(kNone, std::memory_order_relaxed); }
+    });
+    levels_[root].store(0, std::memory_order_relaxed);
+    frontier_.assign(1, root);
+    num_bottom_up_ = 0;
+
+    size_t unexplored_edges = graph.indptr_[n];
+    size_t num_chunks = 4 * pool.size();
+    locals_.resize(num_chunks);
+    uint32_t depth = 0;
+    bool bottom_up = false;
+    while (!frontier_.empty()) {
+      size_t frontier_edges = 0;
+      for (auto v : frontier_) { frontier_edges += graph.degree(v); }
+      unexplored_edges -= std::min(unexplored_edges, frontier_edges);
+      if (!bottom_up && frontier_edges > unexplored_edges / alpha_) { bottom_up = true; }
+      if (bottom_up && frontier_.size() < n / beta_) { bottom_up = false; }
+      num_bottom_up_ += bottom_up;
+
+      // Each chunk appends newly reached nodes to its own list (concatenated in chunk order)
+      for (auto& local : locals_) { local.clear(); }
+      if (bottom_up) {
+        pool.run(num_chunks, [&](size_t c) {
+          size_t i0 = n * c / num_chunks, i1 = n * (c + 1) / num_chunks;
+          for (size_t w = i0; w < i1; w++) {
+            if (levels_[w].load(std::memory_order_relaxed) != kNone) { continue; }
+            for (auto p = graph.indptr_[w]; p < graph.indptr_[w + 1]; p++) {
+              if (usable(p) && levels_[graph.nodes_[p]].load(std::memory_order_relaxed) == depth) {
+                levels_[w].store(depth + 1, std::memory_order_relaxed);
+                locals_[c].push_back(uint32_t(w));
+                break;
+              }
+            }
+          }
+        });
+      } else {
+        size_t nf = frontier_.size();
+        size_t chunks = std::min(num_chunks, nf);
+        pool.run(chunks, [&](size_t c) {
+          size_t i0 = nf * c / chunks, i1 = nf * (c + 1) / chunks;
+          for (size_t i = i0; i < i1; i++) {
+            uint32_t v = frontier_[i];
+            for (auto p = graph.indptr_[v]; p < graph.indptr_[v + 1]; p++) {
+              if (!usable(p)) { continue; }
+              uint32_t w = graph.nodes_[p];
+              uint32_t expected = kNone;
+              if (levels_[w].load(std::memory_order_relaxed) == kNone &&
+                  levels_[w].compare_exchange_strong(expected, depth + 1, std::memory_order_relaxed)) {
+                locals_[c].push_back(w);
+              }
+            }
+          }
+        });
+      }
+      next_.clear();
+      for (auto& local : locals_) { next_.insert(next_.end(), local.begin(), local.end()); }
+      std::swap(frontier_, next_);
+      depth++;
+    }
+    num_levels_ = depth;
+
+    // Levels, parents (first neighbor on the previous level) and order by counting sort on levels
+    level_.resize(n);
+    parent_.resize(n);
+    parent_edge_.resize(n);
+    vector<size_t> counts(num_levels_ + 1, 0);
+    for (size_t v = 0; v < n; v++) {
+      level_[v] = levels_[v].load(std::memory_order_relaxed);
+      if (level_[v] != kNone) { counts[level_[v] + 1]++; }
+    }
+    pool.parallelFor(0, n, 0, [&](size_t i0, size_t i1) {
+      for (size_t w = i0; w < i1; w++) {
+        parent_[w] = parent_edge_[w] = kNone;
+        if (level_[w] == kNone || level_[w] == 0) { continue; }
+        for (auto p = graph.indptr_[w]; p < graph.indptr_[w + 1]; p++) {
+          if (usable(p) && level_[graph.nodes_[p]] == level_[w] - 1) {
+            parent_[w] = graph.nodes_[p];
+            parent_edge_[w] = graph.edges_[p];
+            break;
+          }
+        }
+      }
+    });
+    for (size_t d = 0; d < num_levels_; d++) { counts[d + 1] += counts[d]; }
+    order_.resize(counts[num_levels_]);
+    for (size_t v = 0; v < n; v++) {
+      if (level_[v] != kNone) { order_[counts[level_[v]]++] = uint32_t(v); }
+    }
+  }
+};
+
+//
+// Tree-cotree decomposition and homology generators (cf. computeTreeCotree in ddg.js)
+//
+
+enum EdgeKind : uint8_t { kFree = 0, kPrimal = 1, kDual = 2 };
+
+struct TreeCotree {
+  Graph v2ve_;
+  Graph f2fe_;
+  BFS tree_v_;                 // primal spanning tree (vertices)
+  BFS tree_f_;                 // dual spanning tree (faces)
+  vector<uint8_t> edge_kind_;  // nE (EdgeKind)
+  vector<uint32_t> generators_;    // edges in neither tree
+  vector<size_t> loops_indptr_;    // generators + 1
+  vector<uint32_t> loops_;         // edges of each dual loop
+
+  // Returns false when mesh has boundary (each generator needs two faces) or is disconnected
+  bool compute(const ddg::Topology& topology, uint32_t root_v = 0, uint32_t root_f = 0) {
+    if (topology.boundary_) { return false; }
+    size_t nE = topology.nE_;
+    v2ve_ = computeV2VE(topology);
+    f2fe_ = computeF2FE(topology);
+
+    // Dual tree first, then primal tree avoiding its edges ("cotree-tree" as computeTreeCotree)
+    edge_kind_.assign(nE, kFree);
+    tree_f_.compute(f2fe_, root_f);
+    for (auto f : tree_f_.order_) {
+      if (tree_f_.parent_edge_[f] != kNone) { edge_kind_[tree_f_.parent_edge_[f]] = kDual; }
+    }
+    if (tree_f_.order_.size() != topology.nF_) { return false; }
+    tree_v_.compute(v2ve_, root_v, &edge_kind_);
+    if (tree_v_.order_.size() != topology.nV_) { return false; }
+    for (auto v : tree_v_.order_) {
+      if (tree_v_.parent_edge_[v] != kNone) { edge_kind_[tree_v_.parent_edge_[v]] = kPrimal; }
+    }
+    generators_.clear();
+    for (size_t e = 0; e < nE; e++) {
+      if (edge_kind_[e] == kFree) { generators_.push_back(uint32_t(e)); }
+    }
+
+    // Loop of generator e = path f1 -> lca (dual tree), e, lca -> f2 (lengths first, then filled in parallel)
+    auto& pool = thread_pool::getDefault();
+    auto& level = tree_f_.level_;
+    auto& parent = tree_f_.parent_;
+    auto faces = [&](uint32_t e) {
+      uint32_t h = topology.e2h_[e];
+      return std::make_pair(h / 3, topology.twin_[h] / 3);
+    };
+    size_t nG = generators_.size();
+    loops_indptr_.assign(nG + 1, 0);
+    pool.parallelFor(0, nG, 0, [&](size_t i0, size_t i1) {
+      for (size_t i = i0; i < i1; i++) {
+        auto [f1, f2] = faces(generators_[i]);
+        size_t length = 1;
+        while (f1 != f2) {
+          if (level[f1] >= level[f2]) {
+            f1 = parent[f1];
+          } else {
+            f2 = parent[f2];
+          }
+          length++;
+        }
+        loops_indptr_[i + 1] = length;
+      }
+    });
+    for (size_t i = 0; i < nG; i++) { loops_indptr_[i + 1] += loops_indptr_[i]; }
+    loops_.resize(loops_indptr_[nG]);
+    pool.parallelFor(0, nG, 0, [&](size_t i0, size_t i1) {
+      for (size_t i = i0; i < i1; i++) {
+        uint32_t e = generators_[i];
+        auto [f1, f2] = faces(e);
+        // Path from f1 is written forward from the beginning, path from f2 backward from the end
+        size_t head = loops_indptr_[i], tail = loops_indptr_[i + 1];
+        while (f1 != f2) {
+          if (level[f1] >= level[f2]) {
+            loops_[head++] = tree_f_.parent_edge_[f1];
+            f1 = parent[f1];
+          } else {
+            loops_[--tail] = tree_f_.parent_edge_[f2];
+            f2 = parent[f2];
+          }
+        }
+        assert(head + 1 == tail);
+        loops_[head] = e;
+      }
+    });
+    return true;
+  }
+};
+
+} // namespace graph
@@ -1,14 +1,63 @@
 #include <cstdio>
 #include <cassert>
+#include <atomic>
+#include <algorithm>
+#include <tuple>
+#include <numeric>
+#include <cstdlib>
+#include <new>
+#include <memory>
+#include <cstddef>
+#include <filesystem>
+#include <array>
+#include <map>
+#include <set>
+#include <mutex>
+#include <thread>
 #include <catch2/catch.hpp>
 #include "misc.hpp"
 #include "format.hpp"
 #include "rng.hpp"
 #include "utils.hpp"
+#include "thread_pool.hpp"
+#include "scheduler.hpp"
+#include "gemm.hpp"
+#include "matrix.hpp"
+#include "cholesky.hpp"
+#include "gauss_seidel.hpp"
+#include "pcg.hpp"
+#include "refinement.hpp"
+#include "reduce.hpp"
+#include "projective_dynamics.hpp"
+#include "arena.hpp"
+#include "ddg.hpp"
+#include "reader.hpp"
+#include "cache.hpp"
+#include "delaunay.hpp"
+#include "graph.hpp"
+#include "collision.hpp"
+#include "trace.hpp"
+#include "perf.hpp"
+#if defined(USE_DISPATCH)
+#include "dispatch.hpp"
+#endif
 
 using glm::vec2, glm::mat2;
 using glm::vec3, glm::mat3, glm::transpose;
 
+// Count heap allocations of the whole program (cf. "Arena" test)
+// (noinline so that compiler doesn't see malloc/free pairs with new/delete)
+std::atomic<size_t> g_num_allocations{0};
+
+__attribute__((noinline)) void* operator new(size_t size) {
+  g_num_allocations.fetch_add(1, std::memory_order_relaxed);
+  if (void* result = std::malloc(size > 0 ? size : 1)) { return result; }
+  throw std::bad_alloc{};
+}
+
+__attribute__((noinline)) void operator delete(void* ptr) noexcept { std::free(ptr); }
+__attribute__((noinline)) void operator delete(void* ptr, size_t) noexcept { std::free(ptr); }
+
 TEST_CASE("jacobi2") {
   mat2 A = mat2(1, 2, 2, 3);
   vec2 u, d;
@@ -47,11 +96,7 @@ TEST_CASE("jacobi3") {
 
   CHECK(closeTo(Q * QT, mat3(1)));
 
-  // TODO:
-  // Can't we get more precision??
-  // The number of iteration doesn't affect since
-  // nothing progresses after off-diagonals are zeroed-out.
-  CHECK(closeTo(Q * D * QT, A, 1e-3));
+  CHECK(closeTo(Q * D * QT, A, 1e-5));
 
   // [ Debug ]
   if (false) {
@@ -85,7 +130,7 @@ TEST_CASE("svd") {
 
     CHECK(closeTo(U * UT, mat3(1)));
     CHECK(closeTo(V * VT, mat3(1)));
-    CHECK(closeTo(U * D * VT, A, 1e-3)); // this much of error comes from "jacobi3"
+    CHECK(closeTo(U * D * VT, A, 1e-3)); // rank deficient (AT A squares the condition number)
 
     // [ Debug ]
     if (false) {
@@ -120,7 +165,7 @@ TEST_CASE("svd") {
       bool check =
         closeTo(U * UT, mat3(1)) &&
         closeTo(V * VT, mat3(1)) &&
-        closeTo(U * D * VT, A, 1e-3);
+        closeTo(U * D * VT, A, 5e-5);
       if (check) { continue; }
       result = false;
 
@@ -134,3 +179,2605 @@ TEST_CASE("svd") {
     CHECK(result);
   }
 }
+
+TEST_CASE("svd-double") {
+  using glm::dmat3, glm::dvec3;
+  auto maxError = [](const dmat3& a, const dmat3& b) {
+    double result = 0;
+    for (auto c = 0; c < 3; c++) {
+      for (auto r = 0; r < 3; r++) { result = std::max(result, std::abs(a[c][r] - b[c][r])); }
+    }
+    return result;
+  };
+
+  SECTION("jacobi3") {
+    dmat3 A = dmat3(
+      2, 3, 5,
+      3, 5, 7,
+      5, 7, 11);
+    dmat3 _D = A;
+    dmat3 Q;
+    misc::jacobi3(_D, Q);
+    dmat3 D = dmat3(
+      _D[0][0], 0, 0,
+      0, _D[1][1], 0,
+      0, 0, _D[2][2]);
+    CHECK(maxError(Q * transpose(Q), dmat3(1)) < 1e-14);
+    CHECK(maxError(Q * D * transpose(Q), A) < 1e-13);
+  }
+
+  SECTION("random") {
+    Rng rng;
+    double error = 0;
+    for (auto i = 0; i < 1024; i++) {
+      dmat3 A;
+      for (auto c = 0; c < 3; c++) {
+        for (auto r = 0; r < 3; r++) { A[c][r] = rng.uniform(); }
+      }
+      dmat3 U, VT;
+      dvec3 D;
+      misc::svd(A, U, VT, D);
+      error = std::max(error, maxError(U * dmat3(D[0], 0, 0, 0, D[1], 0, 0, 0, D[2]) * VT, A));
+      error = std::max(error, maxError(U * transpose(U), dmat3(1)));
+      error = std::max(error, maxError(VT * transpose(VT), dmat3(1)));
+    }
+    CHECK(error < 1e-12);
+  }
+
+  SECTION("solveScalar") {
+    Rng rng;
+    size_t n = 64;
+    std::vector<double> u1(9 * n), u2(9 * n), p(9 * n);
+    for (size_t i = 0; i < 9 * n; i++) {
+      u2[i] = ((i % 9) % 4 == 0) + 0.5 * (rng.uniform() - 0.5);
+      u1[i] = u2[i] + 0.2 * (rng.uniform() - 0.5);
+    }
+    misc::solveScalar(u1, u2, p);
+    double error = 0;
+    for (size_t i = 0; i < n; i++) {
+      dmat3 P = *reinterpret_cast<const dmat3*>(&p[9 * i]);
+      error = std::max(error, maxError(P * transpose(P), dmat3(1)));
+      error = std::max(error, std::abs(glm::determinant(P) - 1));
+    }
+    CHECK(error < 1e-12);
+  }
+}
+
+TEST_CASE("solve") {
+  Rng rng;
+  size_t n = 1023; // not multiple of simd::kWidth
+  std::vector<float> u1(9 * n), u2(9 * n), p1(9 * n), p2(9 * n);
+  // Rest frame around identity and deformed frame around rest frame (cf. Example02.svdProjectionWasm)
+  // since projection is ill-conditioned (thus scalar and batched paths can differ) when u1 is close to singular
+  for (size_t i = 0; i < 9 * n; i++) {
+    u2[i] = ((i % 9) % 4 == 0) + 0.5 * (rng.uniform() - 0.5);
+    u1[i] = u2[i] + 0.2 * (rng.uniform() - 0.5);
+  }
+  misc::solveScalar(u1, u2, p1);
+  misc::solve(u1, u2, p2);
+  CHECK(closeTo(p1, p2, 1e-3));
+
+  bool result = true;
+  for (size_t i = 0; i < n; i++) {
+    mat3 P = *reinterpret_cast<const mat3*>(&p2[9 * i]);
+    result = result && closeTo(P * transpose(P), mat3(1)) && closeTo(glm::determinant(P), 1);
+  }
+  CHECK(result);
+
+  // B AT = R diag(s) VT with arbitrary rotations R, V whose projection is R VT
+  // (also for reflection s2 < 0 and rank deficient s2 = 0 since s0 > s1 > |s2|)
+  auto randomRotation = [&]() {
+    glm::vec4 v = glm::normalize(glm::vec4{rng.uniform(), rng.uniform(), rng.uniform(), rng.uniform()} - 0.5f);
+    float q[4] = {v[0], v[1], v[2], v[3]}, R[3][3];
+    misc::quatToMat(q, R);
+    return mat3(R[0][0], R[0][1], R[0][2], R[1][0], R[1][1], R[1][2], R[2][0], R[2][1], R[2][2]);
+  };
+  auto isRotation = [](const mat3& P) { return closeTo(P * transpose(P), mat3(1)) && closeTo(glm::determinant(P), 1); };
+  for (float s2 : {0.7f, -0.7f, 0.0f}) {
+    DYNAMIC_SECTION("large rotation (s2 = " << s2 << ")") {
+      std::vector<float> expected(9 * n);
+      for (size_t i = 0; i < n; i++) {
+        mat3 R = randomRotation(), V = randomRotation();
+        mat3 A = mat3(1) + 0.2f * mat3(rng.uniform() - 0.5f, rng.uniform() - 0.5f, rng.uniform() - 0.5f,
+                                       rng.uniform() - 0.5f, rng.uniform() - 0.5f, rng.uniform() - 0.5f,
+                                       rng.uniform() - 0.5f, rng.uniform() - 0.5f, rng.uniform() - 0.5f);
+        mat3 S{1.3f + 0.1f * rng.uniform(), 0, 0, 0, 1.0f, 0, 0, 0, s2};
+        mat3 B = R * S * transpose(V) * glm::inverse(transpose(A));
+        *reinterpret_cast<mat3*>(&u1[9 * i]) = A;
+        *reinterpret_cast<mat3*>(&u2[9 * i]) = B;
+        *reinterpret_cast<mat3*>(&expected[9 * i]) = R * transpose(V);
+      }
+      misc::solveScalar(u1, u2, p1);
+      misc::solve(u1, u2, p2);
+      CHECK(closeTo(p1, expected, 1e-3));
+      CHECK(closeTo(p2, expected, 1e-3));
+    }
+  }
+
+  SECTION("rank one") {
+    // Projection isn't unique but it's still rotation
+    for (size_t i = 0; i < n; i++) {
+      mat3 R = randomRotation(), V = randomRotation();
+      *reinterpret_cast<mat3*>(&u1[9 * i]) = mat3(1);
+      *reinterpret_cast<mat3*>(&u2[9 * i]) = R * mat3{1, 0, 0, 0, 0, 0, 0, 0, 0} * transpose(V);
+    }
+    misc::solve(u1, u2, p2);
+    bool ok = true;
+    for (size_t i = 0; i < n; i++) { ok = ok && isRotation(*reinterpret_cast<const mat3*>(&p2[9 * i])); }
+    CHECK(ok);
+  }
+}
+
+TEST_CASE("solvePolar") {
+  Rng rng;
+  size_t n = 1023;
+  std::vector<float> u1(9 * n), u2(9 * n), p1(9 * n), p2(9 * n), q(4 * n);
+  for (size_t i = 0; i < 9 * n; i++) {
+    u2[i] = ((i % 9) % 4 == 0) + 0.5 * (rng.uniform() - 0.5);
+    u1[i] = u2[i] + 0.2 * (rng.uniform() - 0.5);
+  }
+  auto resetQ = [&]() {
+    for (size_t i = 0; i < n; i++) { q[4 * i + 0] = q[4 * i + 1] = q[4 * i + 2] = 0; q[4 * i + 3] = 1; }
+  };
+  auto isRotation = [&](const std::vector<float>& p) {
+    bool result = true;
+    for (size_t i = 0; i < n; i++) {
+      mat3 P = *reinterpret_cast<const mat3*>(&p[9 * i]);
+      result = result && closeTo(P * transpose(P), mat3(1)) && closeTo(glm::determinant(P), 1);
+    }
+    return result;
+  };
+
+  // Same result as svd path
+  misc::solveScalar(u1, u2, p1);
+  resetQ();
+  misc::solvePolar(u1, u2, q, p2, 2, 0);
+  CHECK(closeTo(p1, p2, 1e-4));
+  CHECK(isRotation(p2));
+
+  // Scalar version
+  bool result = true;
+  for (size_t i = 0; i < n; i++) {
+    glm::vec4 qi{0, 0, 0, 1};
+    mat3 P = misc::polarProjection(
+        *reinterpret_cast<const mat3*>(&u1[9 * i]), *reinterpret_cast<const mat3*>(&u2[9 * i]), qi, 2);
+    result = result && closeTo(P, *reinterpret_cast<const mat3*>(&p2[9 * i]), 1e-5);
+  }
+  CHECK(result);
+
+  SECTION("warm start") {
+    // Single iteration from previous rotations after small change
+    for (auto& v : u1) { v += 0.02 * (rng.uniform() - 0.5); }
+    misc::solveScalar(u1, u2, p1);
+    misc::solvePolar(u1, u2, q, p2, 1, 0);
+    CHECK(closeTo(p1, p2, 1e-4));
+  }
+
+  SECTION("early exit") {
+    // Converged rotations take a single step while cold start takes more
+    int max_warm = 0, max_cold = 0;
+    for (size_t i = 0; i < n; i++) {
+      mat3 M = *reinterpret_cast<const mat3*>(&u2[9 * i]) * transpose(*reinterpret_cast<const mat3*>(&u1[9 * i]));
+      float Ms[3][3], qs[4] = {0, 0, 0, 1};
+      for (auto c = 0; c < 3; c++) {
+        for (auto r = 0; r < 3; r++) { Ms[c][r] = M[c][r]; }
+      }
+      max_cold = std::max(max_cold, misc::polarIterate(Ms, qs, 16, 1e-4));
+      max_warm = std::max(max_warm, misc::polarIterate(Ms, qs, 16, 1e-4));
+    }
+    CHECK(max_warm == 1);
+    CHECK(max_cold > 1);
+
+    // Batched version with tolerance
+    resetQ();
+    misc::solvePolar(u1, u2, q, p2, 16, 1e-4);
+    CHECK(closeTo(p1, p2, 1e-4));
+  }
+
+  SECTION("large rotation") {
+    // Rotate u1 by arbitrary rotations
+    for (size_t i = 0; i < n; i++) {
+      float r[4] = {rng.uniform() - 0.5f, rng.uniform() - 0.5f, rng.uniform() - 0.5f, rng.uniform() - 0.5f};
+      float l = std::sqrt(r[0] * r[0] + r[1] * r[1] + r[2] * r[2] + r[3] * r[3]);
+      for (auto& v : r) { v /= l; }
+      float R[3][3];
+      misc::quatToMat(r, R);
+      auto& A = *reinterpret_cast<mat3*>(&u1[9 * i]);
+      A = mat3(R[0][0], R[0][1], R[0][2], R[1][0], R[1][1], R[1][2], R[2][0], R[2][1], R[2][2]) * A;
+    }
+    misc::solveScalar(u1, u2, p1);
+    resetQ();
+    misc::solvePolar(u1, u2, q, p2, 8, 0);
+    CHECK(closeTo(p1, p2, 1e-3));
+    CHECK(isRotation(p2));
+  }
+}
+
+TEST_CASE("ThreadPool") {
+  thread_pool::ThreadPool pool{4};
+  CHECK(pool.size() == (thread_pool::kHasThreads ? 4 : 1));
+
+  SECTION("parallelFor") {
+    std::vector<int> counts(1000, 0);
+    pool.parallelFor(0, counts.size(), 7, [&](size_t i_begin, size_t i_end) {
+      for (auto i = i_begin; i < i_end; i++) { counts[i]++; }
+    });
+    CHECK(std::all_of(counts.begin(), counts.end(), [](int c) { return c == 1; }));
+  }
+
+  SECTION("parallelReduce") {
+    for (auto k = 0; k < 100; k++) { // Reuse workers many times
+      size_t result = pool.parallelReduce<size_t>(0, 1000, 0, 0, [&](size_t i_begin, size_t i_end) {
+        size_t partial = 0;
+        for (auto i = i_begin; i < i_end; i++) { partial += i; }
+        return partial;
+      });
+      CHECK(result == 999 * 1000 / 2);
+    }
+  }
+
+  SECTION("nested") {
+    std::atomic<size_t> count{0};
+    pool.parallelFor(0, 8, 1, [&](size_t, size_t) {
+      pool.parallelFor(0, 8, 1, [&](size_t, size_t) { count++; });
+    });
+    CHECK(count == 64);
+  }
+
+  SECTION("external threads") {
+    // Concurrent outermost calls (queued on the pool) while the pool is resized
+    std::atomic<size_t> num_wrong{0};
+    std::vector<std::thread> threads;
+    for (auto t = 0; t < 3; t++) {
+      threads.emplace_back([&]() {
+        for (auto k = 0; k < 100; k++) {
+          size_t result = pool.parallelReduce<size_t>(0, 1000, 0, 0, [&](size_t i_begin, size_t i_end) {
+            size_t partial = 0;
+            for (auto i = i_begin; i < i_end; i++) { partial += i; }
+            return partial;
+          });
+          num_wrong += result != 999 * 1000 / 2;
+        }
+      });
+    }
+    threads.emplace_back([&]() {
+      for (size_t k = 0; k < 20; k++) { pool.resize(1 + k % 4); }
+    });
+    for (auto& thread : threads) { thread.join(); }
+    CHECK(num_wrong == 0);
+    CHECK(pool.size() == (thread_pool::kHasThreads ? 4 : 1));
+  }
+
+  SECTION("solve") {
+    Rng rng;
+    size_t n = 4099;
+    std::vector<float> u1(9 * n), u2(9 * n), p1(9 * n), p2(9 * n);
+    for (auto& v : u1) { v = rng.uniform(); }
+    for (auto& v : u2) { v = rng.uniform(); }
+    size_t num_threads_default = thread_pool::getNumThreads();
+    thread_pool::setNumThreads(1);
+    misc::solve(u1, u2, p1);
+    thread_pool::setNumThreads(3);
+    misc::solve(u1, u2, p2);
+    thread_pool::setNumThreads(num_threads_default);
+    CHECK(p1 == p2);
+  }
+}
+
+TEST_CASE("Scheduler") {
+  scheduler::Scheduler sched{4};
+  CHECK(sched.size() == (thread_pool::kHasThreads ? 4 : 1));
+
+  SECTION("parallelInvoke") {
+    // Recursive fork/join (fib(20) leaves)
+    std::atomic<size_t> count{0};
+    std::function<void(int)> fib = [&](int n) {
+      if (n < 2) {
+        count++;
+        return;
+      }
+      sched.parallelInvoke([&]() { fib(n - 1); }, [&]() { fib(n - 2); });
+    };
+    fib(20);
+    CHECK(count == 10946);
+
+    int a = 0, b = 0, c = 0;
+    sched.parallelInvoke([&]() { a = 1; }, [&]() { b = 2; }, [&]() { c = 3; });
+    CHECK((a == 1 && b == 2 && c == 3));
+  }
+
+  SECTION("parallelFor") {
+    // Irregular cost per index
+    std::vector<int> counts(1000, 0);
+    std::atomic<size_t> work{0};
+    std::atomic<bool> grain_ok{true};
+    sched.parallelFor(0, counts.size(), 3, [&](size_t i_begin, size_t i_end) {
+      if (i_end - i_begin > 3) { grain_ok = false; }
+      for (auto i = i_begin; i < i_end; i++) {
+        counts[i]++;
+        for (size_t k = 0; k < (i % 37) * 100; k++) { work++; }
+      }
+    });
+    CHECK(std::all_of(counts.begin(), counts.end(), [](int c) { return c == 1; }));
+    CHECK(grain_ok);
+  }
+
+  SECTION("parallelReduce") {
+    for (auto k = 0; k < 100; k++) { // Reuse workers many times
+      size_t result = sched.parallelReduce<size_t>(0, 1000, 0, 0,
+          [&](size_t i_begin, size_t i_end) {
+            size_t partial = 0;
+            for (auto i = i_begin; i < i_end; i++) { partial += i; }
+            return partial;
+          },
+          [](size_t x, size_t y) { return x + y; });
+      CHECK(result == 999 * 1000 / 2);
+    }
+    CHECK(sched.parallelReduce<int>(5, 5, 0, -1, [](size_t, size_t) { return 0; }, [](int x, int y) { return x + y; }) == -1);
+
+    // Floating point result doesn't depend on the number of threads (fixed split tree)
+    Rng rng;
+    std::vector<float> v(100000);
+    for (auto& x : v) { x = rng.uniform(); }
+    auto sum = [&](scheduler::Scheduler& s) {
+      return s.parallelReduce<float>(0, v.size(), 100, 0.0f,
+          [&](size_t i_begin, size_t i_end) { return reduce::sum(v.data() + i_begin, i_end - i_begin); },
+          [](float x, float y) { return x + y; });
+    };
+    scheduler::Scheduler sched1{1};
+    CHECK(sum(sched) == sum(sched1));
+  }
+
+  SECTION("nested") {
+    std::atomic<size_t> count{0};
+    sched.parallelFor(0, 8, 1, [&](size_t, size_t) {
+      sched.parallelFor(0, 8, 1, [&](size_t, size_t) { count++; });
+    });
+    CHECK(count == 64);
+  }
+
+  SECTION("non default constructible result") {
+    struct Sum {
+      size_t value;
+      explicit Sum(size_t value) : value{value} {}
+    };
+    auto result = sched.parallelReduce<Sum>(0, 1000, 10, Sum{0},
+        [](size_t i_begin, size_t i_end) { return Sum{i_end - i_begin}; },
+        [](Sum x, Sum y) { return Sum{x.value + y.value}; });
+    CHECK(result.value == 1000);
+  }
+
+  SECTION("default scheduler shares thread_pool workers") {
+    size_t num_threads_default = thread_pool::getNumThreads();
+    thread_pool::setNumThreads(3);
+    CHECK(scheduler::getNumThreads() == thread_pool::getNumThreads());
+    std::mutex mutex;
+    std::set<std::thread::id> ids;
+    std::atomic<size_t> count{0};
+    scheduler::getDefault().parallelFor(0, 1000, 1, [&](size_t i_begin, size_t i_end) {
+      count += i_end - i_begin;
+      std::lock_guard<std::mutex> lock{mutex};
+      ids.insert(std::this_thread::get_id());
+    });
+    CHECK(count == 1000);
+    CHECK(ids.size() <= 3);
+    scheduler::setNumThreads(2);
+    CHECK(thread_pool::getNumThreads() == (thread_pool::kHasThreads ? 2 : 1));
+    thread_pool::setNumThreads(num_threads_default);
+  }
+
+  SECTION("external threads") {
+    // Outermost calls from other threads take turns on the workers
+    std::atomic<size_t> count{0};
+    std::vector<std::thread> threads;
+    for (auto t = 0; t < 3; t++) {
+      threads.emplace_back([&]() {
+        sched.parallelFor(0, 1000, 10, [&](size_t i_begin, size_t i_end) { count += i_end - i_begin; });
+      });
+    }
+    for (auto& thread : threads) { thread.join(); }
+    CHECK(count == 3000);
+  }
+}
+
+TEST_CASE("gemm") {
+  Rng rng;
+  // Sizes around small-path threshold and micro kernel edges
+  for (auto [M, N, K] : {std::tuple<size_t, size_t, size_t>{9, 12, 9}, {37, 45, 29}, {100, 70, 300}, {13, 257, 64}}) {
+    Matrix<float> a{M, K}, b{K, N}, c{M, N}, c_naive{M, N};
+    for (auto& v : a.data_) { v = rng.uniform() - 0.5; }
+    for (auto& v : b.data_) { v = rng.uniform() - 0.5; }
+    for (auto& v : c.data_) { v = rng.uniform() - 0.5; }
+
+    // c = 2 a b - c
+    Matrix<float>::matmulNaive_(a, b, c_naive);
+    for (size_t i = 0; i < M * N; i++) { c_naive.data_[i] = 2 * c_naive.data_[i] - c.data_[i]; }
+    Matrix<float>::gemm(2, a, b, -1, c);
+    CHECK(closeTo(c.data_, c_naive.data_, 1e-4));
+
+    // c = a b (beta = 0 ignores NaN in c)
+    std::fill(c.data_.begin(), c.data_.end(), NAN);
+    Matrix<float>::matmul_(a, b, c);
+    Matrix<float>::matmulNaive_(a, b, c_naive);
+    CHECK(closeTo(c.data_, c_naive.data_, 1e-4));
+  }
+
+  SECTION("double") {
+    size_t M = 50, N = 61, K = 70;
+    Matrix<double> a{M, K}, b{K, N}, c{M, N}, c_naive{M, N};
+    for (auto& v : a.data_) { v = rng.uniform() - 0.5; }
+    for (auto& v : b.data_) { v = rng.uniform() - 0.5; }
+    Matrix<double>::matmul_(a, b, c);
+    Matrix<double>::matmulNaive_(a, b, c_naive);
+    double error = 0;
+    for (size_t i = 0; i < M * N; i++) { error = std::max(error, std::abs(c.data_[i] - c_naive.data_[i])); }
+    CHECK(error < 1e-12);
+  }
+}
+
+// 7-point Laplacian on n x n x n grid + shift * I (rows/cols are shuffled when rng is given)
+MatrixCSR<float> gridLaplacian(size_t n, float shift, Rng* rng = nullptr) {
+  size_t N = n * n * n;
+  std::vector<size_t> perm(N);
+  for (size_t i = 0; i < N; i++) { perm[i] = i; }
+  if (rng) {
+    for (size_t i = N - 1; i > 0; i--) { std::swap(perm[i], perm[rng->next() % (i + 1)]); }
+  }
+  std::vector<std::vector<std::pair<size_t, float>>> rows(N);
+  for (size_t x = 0; x < n; x++) {
+    for (size_t y = 0; y < n; y++) {
+      for (size_t z = 0; z < n; z++) {
+        size_t i = perm[(x * n + y) * n + z];
+        rows[i].push_back({i, 6 + shift});
+        auto add = [&](size_t x2, size_t y2, size_t z2) {
+          if (x2 >= n || y2 >= n || z2 >= n) { return; }
+          rows[i].push_back({perm[(x2 * n + y2) * n + z2], -1});
+        };
+        add(x - 1, y, z); add(x + 1, y, z);
+        add(x, y - 1, z); add(x, y + 1, z);
+        add(x, y, z - 1); add(x, y, z + 1);
+      }
+    }
+  }
+  MatrixCSR<float> A{N, N, 0};
+  for (size_t i = 0; i < N; i++) {
+    std::sort(rows[i].begin(), rows[i].end());
+    for (auto [j, v] : rows[i]) {
+      A.indices_.push_back(j);
+      A.data_.push_back(v);
+    }
+    A.indptr_[i + 1] = A.indices_.size();
+  }
+  return A;
+}
+
+TEST_CASE("Cholesky") {
+  Rng rng;
+  auto A = gridLaplacian(8, 0.1, &rng);
+  size_t N = A.shape_[0];
+  Matrix<float> b{N, 3};
+  for (auto& v : b.data_) { v = rng.uniform(); }
+
+  auto residual = [&](const Matrix<float>& x) {
+    auto Ax = MatrixCSR<float>::matmul(A, x);
+    return closeTo(Ax.data_, b.data_, 1e-4);
+  };
+
+  cholesky::Cholesky<float> natural, rcm, nd;
+  CHECK(natural.compute(A, cholesky::Ordering::kNatural));
+  CHECK(rcm.compute(A, cholesky::Ordering::kRCM));
+  CHECK(nd.compute(A, cholesky::Ordering::kND));
+  CHECK(rcm.L_.nnz() < natural.L_.nnz());
+  CHECK(nd.L_.nnz() < rcm.L_.nnz());
+
+  Matrix<float> x1{N, 3}, x2{N, 3}, x3{N, 3};
+  natural.solve(x1, b);
+  rcm.solve(x2, b);
+  nd.solve(x3, b);
+  CHECK(residual(x1));
+  CHECK(residual(x2));
+  CHECK(residual(x3));
+
+  // Supernodes partition columns and each column has the pattern of the previous one without its diagonal
+  bool ok = nd.super_.front() == 0 && nd.super_.back() == N && nd.super_.size() < 3 * N / 4;
+  for (size_t s = 0; s + 1 < nd.super_.size(); s++) {
+    for (size_t j = nd.super_[s] + 1; j < nd.super_[s + 1]; j++) {
+      auto& L = nd.L_;
+      ok = ok && std::equal(L.indices_.begin() + L.indptr_[j], L.indices_.begin() + L.indptr_[j + 1],
+                            L.indices_.begin() + L.indptr_[j - 1] + 1);
+    }
+  }
+  CHECK(ok);
+
+  SECTION("nested dissection") {
+    // Permutation and multi-threaded supernodal factorization of larger grid (matches single thread)
+    auto A2 = gridLaplacian(20, 0.1, &rng);
+    size_t N2 = A2.shape_[0];
+    auto perm = cholesky::orderingND(A2);
+    auto sorted = perm;
+    std::sort(sorted.begin(), sorted.end());
+    bool is_permutation = true;
+    for (size_t i = 0; i < N2; i++) { is_permutation = is_permutation && sorted[i] == i; }
+    CHECK(is_permutation);
+
+    auto num_threads_default = thread_pool::getNumThreads();
+    cholesky::Cholesky<float> solver1, solver4;
+    thread_pool::setNumThreads(1);
+    REQUIRE(solver1.compute(A2));
+    thread_pool::setNumThreads(4);
+    REQUIRE(solver4.compute(A2));
+    thread_pool::setNumThreads(num_threads_default);
+    CHECK(solver1.L_.nnz() < 120 * N2); // about 92 N (RCM gives about 225 N)
+    CHECK(solver4.L_.data_ == solver1.L_.data_);
+
+    Matrix<float> b2{N2, 3}, x{N2, 3};
+    for (auto& v : b2.data_) { v = rng.uniform(); }
+    solver4.solve(x, b2);
+    CHECK(closeTo(MatrixCSR<float>::matmul(A2, x).data_, b2.data_, 1e-4));
+  }
+
+  SECTION("refactorize") {
+    auto A2 = A;
+    for (auto& v : A2.data_) { v *= 2; }
+    CHECK(rcm.factorize(A2));
+    Matrix<float> x3{N, 3};
+    rcm.solve(x3, b);
+    for (auto& v : x3.data_) { v *= 2; }
+    CHECK(closeTo(x3.data_, x2.data_, 1e-4));
+  }
+
+  SECTION("not positive definite") {
+    auto A2 = A;
+    for (auto& v : A2.data_) { v = -v; }
+    CHECK(!rcm.factorize(A2));
+  }
+
+  SECTION("empty") {
+    MatrixCSR<float> A0;
+    CHECK(cholesky::orderingND(A0).empty());
+    cholesky::Cholesky<float> solver;
+    CHECK(solver.compute(A0));
+    Matrix<float> x0{0, 3}, b0{0, 3};
+    solver.solve(x0, b0);
+  }
+}
+
+TEST_CASE("CholeskyRefinement") {
+  // Stiff system (Laplacian with a few heavily weighted rows as pinned vertices)
+  Rng rng;
+  auto A_float = gridLaplacian(8, 1e-3, &rng);
+  size_t N = A_float.shape_[0];
+  auto A = MatrixCSR<double>::cast(A_float);
+  for (size_t i = 0; i < N; i += 37) {
+    for (auto p = A.indptr_[i]; p < A.indptr_[i + 1]; p++) {
+      if (A.indices_[p] == i) { A.data_[p] += 1e5; }
+    }
+  }
+  Matrix<double> b{N, 3};
+  for (auto& v : b.data_) { v = rng.uniform(); }
+
+  auto residual = [&](const Matrix<double>& x) {
+    auto Ax = MatrixCSR<double>::matmul(A, x);
+    double r = 0, b2 = 0;
+    for (size_t i = 0; i < N * 3; i++) {
+      r += std::pow(Ax.data_[i] - b.data_[i], 2);
+      b2 += std::pow(b.data_[i], 2);
+    }
+    return std::sqrt(r / b2);
+  };
+
+  // Plain float Cholesky
+  cholesky::Cholesky<float> cholesky_float;
+  REQUIRE(cholesky_float.compute(MatrixCSR<float>::cast(A)));
+  Matrix<float> x_float{N, 3}, b_float;
+  Matrix<float>::cast_(b, b_float);
+  cholesky_float.solve(x_float, b_float);
+  Matrix<double> x1;
+  Matrix<double>::cast_(x_float, x1);
+
+  // Float Cholesky with refinement in double
+  refinement::CholeskyRefinement<float, double> solver;
+  REQUIRE(solver.compute(A));
+  Matrix<double> x2{N, 3};
+  CHECK(solver.solve(x2, b, 8, 1e-12));
+  CHECK(solver.iteration_ <= 4);
+  CHECK(solver.residue_ < 1e-12);
+  CHECK(residual(x2) < 1e-12);
+  CHECK(residual(x1) > 1e-8);
+
+  // Same as double Cholesky
+  cholesky::Cholesky<double> cholesky_double;
+  REQUIRE(cholesky_double.compute(A));
+  Matrix<double> x3{N, 3};
+  cholesky_double.solve(x3, b);
+  double error = 0;
+  for (size_t i = 0; i < N * 3; i++) { error = std::max(error, std::abs(x2.data_[i] - x3.data_[i])); }
+  CHECK(error < 1e-10);
+
+  SECTION("warm start") {
+    solver.solve(x2, b, 8, 1e-12);
+    CHECK(solver.iteration_ == 0);
+  }
+
+  SECTION("fixed number of steps") {
+    // Same steps as with unreachable residue_lim but without the residual after the last step
+    Matrix<double> x4{N, 3}, x5{N, 3};
+    CHECK(!solver.solve(x5, b, 2, 1e-30));
+    double residue_last = solver.residue_;
+    CHECK(!solver.solve(x4, b, 2, 0));
+    CHECK(solver.iteration_ == 2);
+    CHECK(x4.data_ == x5.data_);
+    CHECK(solver.residue_ > residue_last);
+  }
+
+  SECTION("refactorize") {
+    // Same pattern with new values doesn't allocate
+    auto A2 = A;
+    for (auto& v : A2.data_) { v *= 2; }
+    REQUIRE(solver.factorize(A2));
+    size_t num_allocations = g_num_allocations;
+    for (auto k = 0; k < 4; k++) { REQUIRE(solver.factorize(A2)); }
+    CHECK(g_num_allocations == num_allocations);
+    Matrix<double> x4{N, 3};
+    CHECK(solver.solve(x4, b, 8, 1e-12));
+    double error2 = 0;
+    for (size_t i = 0; i < N * 3; i++) { error2 = std::max(error2, std::abs(2 * x4.data_[i] - x2.data_[i])); }
+    CHECK(error2 < 1e-10);
+  }
+}
+
+// cf. misc2.makeTetrahedralizedCubeSymmetric in src/utils/misc2.js
+void makeTetrahedralizedCubeSymmetric(size_t m, std::vector<float>& verts, std::vector<uint32_t>& c3xc0) {
+  size_t n = 2 * m;
+  verts.clear();
+  c3xc0.clear();
+  for (size_t k = 0; k <= n; k++) {
+    for (size_t j = 0; j <= n; j++) {
+      for (size_t i = 0; i <= n; i++) {
+        verts.insert(verts.end(), {float(i) / n, float(j) / n, float(k) / n});
+      }
+    }
+  }
+  for (size_t k = 0; k < n; k++) {
+    for (size_t j = 0; j < n; j++) {
+      for (size_t i = 0; i < n; i++) {
+        uint32_t a0 = (n + 1) * (n + 1) * k + (n + 1) * j + i;
+        uint32_t a1 = a0 + 1;
+        uint32_t a2 = a0 + (n + 1);
+        uint32_t a3 = a2 + 1;
+        uint32_t a4 = a0 + (n + 1) * (n + 1);
+        uint32_t a5 = a4 + 1;
+        uint32_t a6 = a4 + (n + 1);
+        uint32_t a7 = a6 + 1;
+        if ((i + j + k) % 2 == 0) {
+          // roll([a0, a1, a3, a2], 1)
+          std::tie(a0, a1, a3, a2) = std::make_tuple(a2, a0, a1, a3);
+          std::tie(a4, a5, a7, a6) = std::make_tuple(a6, a4, a5, a7);
+        }
+        // tetrahedralizeBox5
+        c3xc0.insert(c3xc0.end(), {
+          a4, a1, a2, a7,
+          a0, a1, a2, a4,
+          a3, a1, a7, a2,
+          a5, a1, a4, a7,
+          a6, a2, a7, a4});
+      }
+    }
+  }
+}
+
+TEST_CASE("ProjectiveDynamics") {
+  std::vector<float> verts;
+  std::vector<uint32_t> c3xc0;
+  makeTetrahedralizedCubeSymmetric(3, verts, c3xc0);
+  size_t nV = verts.size() / 3;
+  size_t nC3 = c3xc0.size() / 4;
+
+  physics::ProjectiveDynamics solver{nV, nC3, 1};
+  solver.verts_.data_ = verts;
+  solver.c3xc0_ = c3xc0;
+  solver.handles_[0] = 0;
+  for (size_t k = 0; k < 3; k++) { solver.handle_targets_(0, k) = verts[k]; }
+  REQUIRE(solver.init(1 << 5));
+
+  SECTION("rest state without gravity") {
+    solver.g_ = 0;
+    for (auto i = 0; i < 8; i++) { solver.update(); }
+    CHECK(closeTo(solver.verts_.data_, verts, 1e-4));
+  }
+
+  SECTION("mixed precision global step") {
+    physics::ProjectiveDynamics solver2{nV, nC3, 1};
+    solver2.verts_.data_ = verts;
+    solver2.c3xc0_ = c3xc0;
+    solver2.handles_[0] = 0;
+    for (size_t k = 0; k < 3; k++) { solver2.handle_targets_(0, k) = verts[k]; }
+    solver2.refinement_iteration_ = 2;
+    REQUIRE(solver2.init(1 << 5));
+    for (auto i = 0; i < 8; i++) {
+      solver.update();
+      solver2.update();
+    }
+    CHECK(closeTo(solver.verts_.data_, solver2.verts_.data_, 1e-3)); // difference is mostly the error of float solve
+  }
+
+  SECTION("warm-started local step") {
+    // Same motion as svd from scratch
+    physics::ProjectiveDynamics solver2{nV, nC3, 1};
+    solver2.verts_.data_ = verts;
+    solver2.c3xc0_ = c3xc0;
+    solver2.handles_[0] = 0;
+    for (size_t k = 0; k < 3; k++) { solver2.handle_targets_(0, k) = verts[k]; }
+    solver2.warm_start_ = false;
+    REQUIRE(solver2.init(1 << 5));
+    for (auto i = 0; i < 30; i++) {
+      solver.update();
+      solver2.update();
+    }
+    CHECK(closeTo(solver.verts_.data_, solver2.verts_.data_, 1e-3));
+    CHECK(closeTo(solver.p_, solver2.p_, 1e-3));
+  }
+
+  SECTION("gravity") {
+    for (auto i = 0; i < 60; i++) { solver.update(); }
+    auto& x = solver.verts_.data_;
+    CHECK(std::all_of(x.begin(), x.end(), [](float v) { return std::isfinite(v); }));
+    CHECK(closeTo(solver.verts_(0, 1), verts[1], 5e-2)); // handle stays
+    CHECK(solver.verts_(nV - 1, 1) < verts[3 * (nV - 1) + 1]); // others fall
+  }
+}
+
+// Graph Laplacian of tetrahedral mesh (+ shift * I)
+MatrixCSR<float> meshLaplacian(size_t nV, const std::vector<uint32_t>& c3xc0, float shift) {
+  std::vector<std::vector<std::pair<size_t, float>>> rows(nV);
+  for (size_t i = 0; i < nV; i++) { rows[i].push_back({i, shift}); }
+  for (size_t c = 0; c < c3xc0.size() / 4; c++) {
+    auto vs = &c3xc0[4 * c];
+    for (size_t a = 0; a < 4; a++) {
+      for (size_t b = a + 1; b < 4; b++) {
+        rows[vs[a]].push_back({vs[b], -1});
+        rows[vs[b]].push_back({vs[a], -1});
+      }
+    }
+  }
+  MatrixCSR<float> A{nV, nV, 0};
+  for (size_t i = 0; i < nV; i++) {
+    std::sort(rows[i].begin(), rows[i].end());
+    float degree = 0;
+    for (auto [j, v] : rows[i]) {
+      if (j != i && A.indices_.size() > A.indptr_[i] && A.indices_.back() == j) { continue; } // Shared edge
+      if (j != i) { degree += 1; }
+      A.indices_.push_back(j);
+      A.data_.push_back(v);
+    }
+    A.indptr_[i + 1] = A.indices_.size();
+    for (auto p = A.indptr_[i]; p < A.indptr_[i + 1]; p++) {
+      if (A.indices_[p] == i) { A.data_[p] += degree; }
+    }
+  }
+  return A;
+}
+
+TEST_CASE("MatrixCSR-matmul") {
+  std::vector<float> verts;
+  std::vector<uint32_t> c3xc0;
+  makeTetrahedralizedCubeSymmetric(4, verts, c3xc0);
+  size_t nV = verts.size() / 3;
+  auto A = meshLaplacian(nV, c3xc0, 0.1);
+
+  Rng rng;
+  size_t num_threads_default = thread_pool::getNumThreads();
+  for (size_t num_threads : {1, 3}) {
+    thread_pool::setNumThreads(num_threads);
+    for (size_t nc : {1, 3, 4, 5, 8, 11}) {
+      Matrix<float> x{nV, nc}, y{nV, nc}, y_naive{nV, nc};
+      for (auto& v : x.data_) { v = rng.uniform(); }
+      for (auto& v : y.data_) { v = NAN; }
+      MatrixCSR<float>::matmul_(A, x, y); // overwrite
+      MatrixCSR<float>::matmulNaive_(A, x, y_naive);
+      CHECK(closeTo(y.data_, y_naive.data_, 1e-4));
+      MatrixCSR<float>::matmulAdd_(A, x, y); // accumulate
+      MatrixCSR<float>::matmulNaive_(A, x, y_naive);
+      CHECK(closeTo(y.data_, y_naive.data_, 1e-4));
+    }
+  }
+  thread_pool::setNumThreads(num_threads_default);
+
+  SECTION("partitionRows") {
+    size_t num_parts = 7;
+    auto parts = MatrixCSR<float>::partitionRows(A, num_parts);
+    REQUIRE(parts.size() == num_parts + 1);
+    CHECK(parts.front() == 0);
+    CHECK(parts.back() == nV);
+    size_t share = (A.nnz() + nV) / num_parts;
+    for (size_t k = 0; k < num_parts; k++) {
+      CHECK(parts[k] <= parts[k + 1]);
+      size_t work = A.indptr_[parts[k + 1]] - A.indptr_[parts[k]] + parts[k + 1] - parts[k];
+      CHECK(work <= share + 64); // within a few rows
+    }
+  }
+}
+
+TEST_CASE("MulticolorGaussSeidel") {
+  std::vector<float> verts;
+  std::vector<uint32_t> c3xc0;
+  makeTetrahedralizedCubeSymmetric(4, verts, c3xc0);
+  size_t nV = verts.size() / 3;
+  auto A = meshLaplacian(nV, c3xc0, 1);
+
+  gauss_seidel::MulticolorGaussSeidel<float> solver;
+  REQUIRE(solver.setup(A));
+
+  // Rows of the same color are independent
+  std::vector<size_t> color(nV);
+  for (size_t c = 0; c < solver.numColors(); c++) {
+    for (auto q = solver.color_indptr_[c]; q < solver.color_indptr_[c + 1]; q++) { color[solver.rows_[q]] = c; }
+  }
+  bool independent = true;
+  for (size_t i = 0; i < nV; i++) {
+    for (auto p = A.indptr_[i]; p < A.indptr_[i + 1]; p++) {
+      size_t j = A.indices_[p];
+      independent = independent && (j == i || color[i] != color[j]);
+    }
+  }
+  CHECK(independent);
+
+  Rng rng;
+  Matrix<float> b{nV, 3};
+  for (auto& v : b.data_) { v = rng.uniform(); }
+  auto residual = [&](const Matrix<float>& x) {
+    auto Ax = MatrixCSR<float>::matmul(A, x);
+    float result = 0;
+    for (size_t i = 0; i < Ax.data_.size(); i++) { result = std::max(result, std::abs(Ax.data_[i] - b.data_[i])); }
+    return result;
+  };
+  float r0 = residual(Matrix<float>{nV, 3});
+
+  // Converges similarly to sequential Gauss-Seidel
+  Matrix<float> x1{nV, 3}, x2{nV, 3}, x3{nV, 3}, x4{nV, 3};
+  MatrixCSR<float>::gaussSeidel(A, x1, b, 16);
+  size_t num_threads_default = thread_pool::getNumThreads();
+  thread_pool::setNumThreads(3);
+  solver.solve(A, x2, b, 16);
+  solver.solve(A, x3, b, 8, 1, true);
+  solver.solve(A, x4, b, 16, 1.5);
+  thread_pool::setNumThreads(num_threads_default);
+  float r1 = residual(x1), r2 = residual(x2), r3 = residual(x3), r4 = residual(x4);
+  CHECK(r1 < 0.1 * r0);
+  CHECK(r2 < 2 * r1);
+  CHECK(r3 < 0.5 * r0);
+  CHECK(r4 < 0.1 * r0);
+
+  // Skipped backward sweep of the last color (omega = 1) only changes x by roundoff
+  Matrix<float> x5{nV, 3}, x6{nV, 3};
+  solver.stepSymmetric(A, x5, b);
+  solver.step(A, x6, b);
+  for (size_t c = solver.numColors(); c-- > 0;) { solver.sweepColor(A, x6, b, 1, c); }
+  CHECK(closeTo(x5.data_, x6.data_, 1e-6));
+}
+
+TEST_CASE("ConjugateGradient") {
+  // Poisson problem (Laplacian + small shift for Dirichlet-like boundary)
+  Rng rng;
+  auto A = gridLaplacian(12, 1e-2, &rng);
+  size_t N = A.shape_[0];
+  Matrix<float> b{N, 3};
+  for (auto& v : b.data_) { v = rng.uniform(); }
+  auto residual = [&](const Matrix<float>& x) {
+    auto Ax = MatrixCSR<float>::matmul(A, x);
+    double r = 0, b2 = 0;
+    for (size_t i = 0; i < N; i++) {
+      r += std::pow(Ax(i, 0) - b(i, 0), 2);
+      b2 += std::pow(b(i, 0), 2);
+    }
+    return std::sqrt(r / b2);
+  };
+
+  pcg::ConjugateGradient<float, pcg::PreconditionerIdentity<float>> cg;
+  pcg::ConjugateGradient<float, pcg::PreconditionerJacobi<float>> cg_jacobi;
+  pcg::ConjugateGradient<float, pcg::PreconditionerIC0<float>> cg_ic0;
+  REQUIRE(cg.setup(A));
+  REQUIRE(cg_jacobi.setup(A));
+  REQUIRE(cg_ic0.setup(A));
+  CHECK(cg_ic0.preconditioner_.shift_ == 0);
+
+  Matrix<float> x1{N, 3}, x2{N, 3}, x3{N, 3};
+  CHECK(cg.solve(A, x1, b, 1024, 1e-4));
+  CHECK(cg_jacobi.solve(A, x2, b, 1024, 1e-4));
+  CHECK(cg_ic0.solve(A, x3, b, 1024, 1e-4));
+  CHECK(residual(x1) < 2e-4);
+  CHECK(residual(x2) < 2e-4);
+  CHECK(residual(x3) < 2e-4);
+  CHECK(cg_ic0.residue_ < 1e-4);
+  CHECK(cg_ic0.iteration_ < cg.iteration_);
+
+  // Gauss-Seidel doesn't get close with the same number of iterations
+  Matrix<float> x4{N, 3};
+  MatrixCSR<float>::gaussSeidel(A, x4, b, cg.iteration_);
+  CHECK(residual(x4) > 10 * residual(x1));
+
+  SECTION("multiple right hand sides give the same result as single") {
+    Matrix<float> b1{N, 1}, x5{N, 1};
+    for (size_t i = 0; i < N; i++) { b1(i, 0) = b(i, 2); }
+    pcg::ConjugateGradient<float, pcg::PreconditionerIC0<float>> solver;
+    solver.setup(A);
+    solver.solve(A, x5, b1, 1024, 1e-4);
+    float error = 0;
+    for (size_t i = 0; i < N; i++) { error = std::max(error, std::abs(x5(i, 0) - x3(i, 2))); }
+    CHECK(error < 1e-3);
+  }
+}
+
+// Dense copy (for testing)
+template<typename T>
+Matrix<T> toDense(const MatrixCSR<T>& a) {
+  Matrix<T> result{a.shape_[0], a.shape_[1]};
+  for (size_t i = 0; i < a.shape_[0]; i++) {
+    for (auto p = a.indptr_[i]; p < a.indptr_[i + 1]; p++) {
+      result(i, a.indices_[p]) += a.data_[p];
+    }
+  }
+  return result;
+}
+
+// Sorted and no duplicates
+template<typename T>
+bool isCanonical(const MatrixCSR<T>& a) {
+  for (size_t i = 0; i < a.shape_[0]; i++) {
+    for (auto p = a.indptr_[i] + 1; p < a.indptr_[i + 1]; p++) {
+      if (a.indices_[p - 1] >= a.indices_[p]) { return false; }
+    }
+  }
+  return true;
+}
+
+// cf. Example02.init in src/utils/physics.js (AT A of volume strain constraints assembled through generic CSR operations)
+MatrixCSR<float> assembleStrainATA(size_t nV, const std::vector<uint32_t>& c3xc0, float weight) {
+  size_t nC3 = c3xc0.size() / 4;
+  Matrix<float> A{9, 12};
+  for (size_t r = 0; r < 3; r++) {
+    for (size_t k = 0; k < 3; k++) {
+      A(3 * r + k, k) = -std::sqrt(weight);
+      A(3 * r + k, 3 * (r + 1) + k) = std::sqrt(weight);
+    }
+  }
+  auto A_sparse = MatrixCSR<float>::fromDense(A);
+  std::vector<MatrixCSR<float>> As(nC3);
+  thread_pool::getDefault().parallelFor(0, nC3, 0, [&](size_t i0, size_t i1) {
+    for (size_t i = i0; i < i1; i++) {
+      std::vector<uint32_t> selector(&c3xc0[4 * i], &c3xc0[4 * i + 4]);
+      As[i] = MatrixCSR<float>::matmulCsr(A_sparse, MatrixCSR<float>::fromSelector(selector, nV, 3));
+    }
+  });
+  auto A_all = MatrixCSR<float>::stackCsr(As);
+  auto AT = MatrixCSR<float>::transpose(A_all);
+  return MatrixCSR<float>::matmulCsr(AT, A_all);
+}
+
+TEST_CASE("MatrixCSR-construction") {
+  Rng rng;
+  size_t n = 37, m = 23;
+  auto randomCsr = [&](size_t shape0, size_t shape1, size_t nnz) {
+    std::vector<size_t> rows(nnz), cols(nnz);
+    std::vector<float> values(nnz);
+    for (size_t p = 0; p < nnz; p++) {
+      rows[p] = rng.next() % shape0;
+      cols[p] = rng.next() % shape1;
+      values[p] = rng.uniform() - 0.5;
+    }
+    Matrix<float> dense{shape0, shape1};
+    for (size_t p = 0; p < nnz; p++) { dense(rows[p], cols[p]) += values[p]; }
+    return std::make_pair(MatrixCSR<float>::fromCOO(shape0, shape1, rows, cols, values), dense);
+  };
+
+  SECTION("fromCOO") {
+    // Large enough to use multiple chunks
+    size_t num_threads_default = thread_pool::getNumThreads();
+    thread_pool::setNumThreads(3);
+    auto [a, a_dense] = randomCsr(300, 200, 1 << 17);
+    thread_pool::setNumThreads(num_threads_default);
+    CHECK(isCanonical(a));
+    CHECK(closeTo(toDense(a).data_, a_dense.data_, 1e-3));
+  }
+
+  SECTION("transpose / add / matmulCsr") {
+    auto [a, a_dense] = randomCsr(n, m, 100);
+    auto [b, b_dense] = randomCsr(m, n, 100);
+    auto [c, c_dense] = randomCsr(n, m, 100);
+
+    auto aT = MatrixCSR<float>::transpose(a);
+    CHECK(isCanonical(aT));
+    for (size_t i = 0; i < n; i++) {
+      for (size_t j = 0; j < m; j++) { CHECK(toDense(aT)(j, i) == a_dense(i, j)); }
+    }
+
+    auto ac = MatrixCSR<float>::add(a, c, 2, -1);
+    CHECK(isCanonical(ac));
+    for (size_t i = 0; i < n * m; i++) { c_dense.data_[i] = 2 * a_dense.data_[i] - c_dense.data_[i]; }
+    CHECK(closeTo(toDense(ac).data_, c_dense.data_, 1e-5));
+
+    auto ab = MatrixCSR<float>::matmulCsr(a, b);
+    CHECK(isCanonical(ab));
+    CHECK(closeTo(toDense(ab).data_, Matrix<float>::matmul(a_dense, b_dense).data_, 1e-5));
+  }
+
+  SECTION("stackCsr / stackDiagonal / fromSelector / fromDiagonal") {
+    auto [a, a_dense] = randomCsr(3, 4, 6);
+    auto [b, b_dense] = randomCsr(2, 4, 5);
+    auto v = MatrixCSR<float>::stackCsr({a, b});
+    auto d = MatrixCSR<float>::stackDiagonal({a, b});
+    auto v_dense = toDense(v), d_dense = toDense(d);
+    REQUIRE(d.shape_[0] == 5);
+    REQUIRE(d.shape_[1] == 8);
+    for (size_t j = 0; j < 4; j++) {
+      for (size_t i = 0; i < 3; i++) { CHECK(v_dense(i, j) == a_dense(i, j)); CHECK(d_dense(i, j) == a_dense(i, j)); }
+      for (size_t i = 0; i < 2; i++) { CHECK(v_dense(3 + i, j) == b_dense(i, j)); CHECK(d_dense(3 + i, 4 + j) == b_dense(i, j)); }
+    }
+
+    auto S = MatrixCSR<float>::fromSelector(std::vector<uint32_t>{2, 0}, 3, 2);
+    auto S_dense = toDense(S);
+    CHECK(S_dense.data_ == std::vector<float>{
+        0, 0, 0, 0, 1, 0,
+        0, 0, 0, 0, 0, 1,
+        1, 0, 0, 0, 0, 0,
+        0, 1, 0, 0, 0, 0});
+    CHECK(toDense(MatrixCSR<float>::fromDiagonal({1, 2})).data_ == std::vector<float>{1, 0, 0, 2});
+  }
+
+  SECTION("AT A of volume strain matches ProjectiveDynamics") {
+    std::vector<float> verts;
+    std::vector<uint32_t> c3xc0;
+    makeTetrahedralizedCubeSymmetric(2, verts, c3xc0);
+    size_t nV = verts.size() / 3;
+    auto ATA = assembleStrainATA(nV, c3xc0, 32);
+
+    physics::ProjectiveDynamics solver{nV, c3xc0.size() / 4, 0};
+    solver.verts_.data_ = verts;
+    solver.c3xc0_ = c3xc0;
+    REQUIRE(solver.init(32));
+    auto ATA_dense = toDense(ATA);
+    auto E_dense = toDense(solver.E_);
+    bool same = true;
+    for (size_t i = 0; i < nV; i++) {
+      for (size_t j = 0; j < nV; j++) {
+        float expected = E_dense(i, j) - (i == j ? solver.Md_[i] : 0);
+        for (size_t k = 0; k < 3; k++) {
+          same = same && closeTo(ATA_dense(3 * i + k, 3 * j + k), expected, 1e-3);
+        }
+      }
+    }
+    CHECK(same);
+  }
+}
+
+TEST_CASE("reduce") {
+  Rng rng;
+  std::vector<float> x(1000), y(1000);
+  for (auto& v : x) { v = rng.uniform() - 0.5; }
+  for (auto& v : y) { v = rng.uniform() - 0.5; }
+
+  // Every offset/length to cover unaligned head and tail
+  bool ok = true;
+  for (size_t offset = 0; offset < 9; offset++) {
+    for (size_t n = 0; n < 80; n++) {
+      auto px = x.data() + offset;
+      auto py = y.data() + 2 * offset + 1; // different alignment from x
+      double s = 0, d = 0;
+      float mn = INFINITY, mx = -INFINITY;
+      for (size_t i = 0; i < n; i++) {
+        s += px[i];
+        d += double(px[i]) * py[i];
+        mn = std::min(mn, px[i]);
+        mx = std::max(mx, px[i]);
+      }
+      ok = ok && closeTo(reduce::sum(px, n), s, 1e-4);
+      ok = ok && closeTo(reduce::sumKahan(px, n), s, 1e-5);
+      ok = ok && closeTo(reduce::sumPairwise(px, n), s, 1e-4);
+      ok = ok && closeTo(reduce::dot(px, py, n), d, 1e-4);
+      ok = ok && closeTo(reduce::norm2(px, n), std::sqrt(reduce::dot(px, px, n)), 1e-5);
+      ok = ok && reduce::min(px, n) == mn;
+      ok = ok && reduce::max(px, n) == mx;
+
+      std::vector<float> z(py, py + n), z_expected(py, py + n);
+      reduce::axpy(2.0f, px, z.data(), n);
+      for (size_t i = 0; i < n; i++) { z_expected[i] += 2.0f * px[i]; }
+      ok = ok && closeTo(z, z_expected, 1e-6);
+    }
+  }
+  CHECK(ok);
+
+  SECTION("double") {
+    std::vector<double> a(37);
+    for (size_t i = 0; i < a.size(); i++) { a[i] = i; }
+    CHECK(reduce::sum(a.data() + 1, 36) == 666);
+    CHECK(reduce::max(a.data(), 37) == 36);
+    CHECK(reduce::sumKahan(a.data(), 37) == 666);
+  }
+
+  SECTION("compensated summation") {
+    // 1 + 2^24 * 2^-24 (each small term is lost in plain float accumulation order)
+    size_t n = (1 << 24) + 1;
+    std::vector<float> a(n, 1.0f / (1 << 24));
+    a[0] = 1;
+    float plain = 0;
+    for (auto v : a) { plain += v; }
+    CHECK(plain == 1);
+    CHECK(closeTo(reduce::sumKahan(a.data(), n), 2, 1e-6));
+    // Pairwise sum still rounds within SIMD lanes of each leaf (1024 / lanes terms per lane)
+    CHECK(closeTo(reduce::sumPairwise(a.data(), n), 2, 1e-5));
+  }
+}
+
+#if defined(USE_DISPATCH)
+TEST_CASE("dispatch") {
+  Rng rng;
+  auto isa_default = dispatch::getIsa();
+  CHECK(dispatch::isSupported(dispatch::kGeneric));
+  CHECK(dispatch::isSupported(isa_default));
+
+  // Inputs and references by scalar code (the entry points of float themselves go through `kernels()`)
+  size_t n = 1023;
+  std::vector<float> u1(9 * n), u2(9 * n), p(9 * n), p_expected(9 * n);
+  for (size_t i = 0; i < 9 * n; i++) {
+    u2[i] = ((i % 9) % 4 == 0) + 0.5 * (rng.uniform() - 0.5);
+    u1[i] = u2[i] + 0.2 * (rng.uniform() - 0.5);
+  }
+  misc::solveScalar(u1, u2, p_expected);
+
+  std::vector<float> x(1001), y(1001);
+  for (auto& v : x) { v = rng.uniform() - 0.5; }
+  for (auto& v : y) { v = rng.uniform() - 0.5; }
+  float sum_expected = 0, dot_expected = 0, max_expected = -INFINITY;
+  for (size_t i = 0; i < 1000; i++) { sum_expected += x[1 + i]; }
+  for (size_t i = 0; i < 998; i++) { dot_expected += x[i] * y[3 + i]; }
+  for (size_t i = 0; i < 999; i++) { max_expected = std::max(max_expected, x[2 + i]); }
+  std::vector<float> z_expected = y;
+  for (size_t i = 0; i < 1001; i++) { z_expected[i] += 0.5f * x[i]; }
+
+  size_t M = 37, N = 45, K = 29;
+  Matrix<float> a{M, K}, b{K, N}, c{M, N}, c_expected{M, N};
+  for (auto& v : a.data_) { v = rng.uniform() - 0.5; }
+  for (auto& v : b.data_) { v = rng.uniform() - 0.5; }
+  Matrix<float>::matmulNaive_(a, b, c_expected);
+
+  auto A = gridLaplacian(10, 0.1, &rng);
+  size_t nA = A.shape_[0];
+
+  for (int k = 0; k < dispatch::kNumIsas; k++) {
+    auto isa = dispatch::Isa(k);
+    if (!dispatch::setIsa(isa)) { continue; }
+    auto& kernels = dispatch::kernels();
+    INFO(kernels.name);
+    CHECK(dispatch::getIsa() == isa);
+
+    std::fill(p.begin(), p.end(), 0);
+    dispatch::solve(u1, u2, p);
+    CHECK(closeTo(p, p_expected, 1e-3));
+
+    CHECK(closeTo(kernels.sum(x.data() + 1, 1000), sum_expected, 1e-4));
+    CHECK(closeTo(kernels.dot(x.data(), y.data() + 3, 998), dot_expected, 1e-4));
+    CHECK(kernels.max(x.data() + 2, 999) == max_expected);
+    std::vector<float> z = y;
+    kernels.axpy(0.5, x.data(), z.data(), 1001);
+    CHECK(closeTo(z, z_expected, 1e-6));
+
+    std::fill(c.data_.begin(), c.data_.end(), 0);
+    kernels.gemm(M, N, K, 1, a.data_.data(), K, b.data_.data(), N, 0, c.data_.data(), N);
+    CHECK(closeTo(c.data_, c_expected.data_, 1e-4));
+
+    // Runtime column count (nc = 19) goes through SIMD path
+    for (size_t nc : {3, 19}) {
+      Matrix<float> xs{nA, nc}, ys{nA, nc}, ys_expected{nA, nc};
+      for (auto& v : xs.data_) { v = rng.uniform() - 0.5; }
+      MatrixCSR<float>::matmulNaive_(A, xs, ys_expected);
+      dispatch::matmul_(A, xs, ys);
+      CHECK(closeTo(ys.data_, ys_expected.data_, 1e-4));
+      dispatch::matmulAdd_(A, xs, ys);
+      for (auto& v : ys_expected.data_) { v *= 2; }
+      CHECK(closeTo(ys.data_, ys_expected.data_, 1e-4));
+    }
+  }
+  dispatch::setIsa(isa_default);
+
+  SECTION("production entry points") {
+    // Table forwarding to the selected kernels while counting calls
+    static size_t num_calls[6];
+    std::fill_n(num_calls, 6, 0);
+    dispatch::Kernels counting = dispatch::getKernels(isa_default);
+    counting.solve = [](const std::vector<float>& u1, const std::vector<float>& u2, std::vector<float>& result) {
+      num_calls[0]++;
+      dispatch::getKernels(dispatch::getIsa()).solve(u1, u2, result);
+    };
+    counting.sum = [](const float* x, size_t n) { num_calls[1]++; return dispatch::getKernels(dispatch::getIsa()).sum(x, n); };
+    counting.dot = [](const float* x, const float* y, size_t n) {
+      num_calls[2]++;
+      return dispatch::getKernels(dispatch::getIsa()).dot(x, y, n);
+    };
+    counting.axpy = [](float a, const float* x, float* y, size_t n) {
+      num_calls[3]++;
+      dispatch::getKernels(dispatch::getIsa()).axpy(a, x, y, n);
+    };
+    counting.gemm = [](size_t M, size_t N, size_t K, float alpha, const float* A, size_t lda,
+                       const float* B, size_t ldb, float beta, float* C, size_t ldc) {
+      num_calls[4]++;
+      dispatch::getKernels(dispatch::getIsa()).gemm(M, N, K, alpha, A, lda, B, ldb, beta, C, ldc);
+    };
+    counting.spmm = [](size_t n, const size_t* indptr, const size_t* indices, const float* data,
+                       const float* x, float* y, size_t nc, bool accumulate) {
+      num_calls[5]++;
+      dispatch::getKernels(dispatch::getIsa()).spmm(n, indptr, indices, data, x, y, nc, accumulate);
+    };
+    dispatch::kernelsOverride() = &counting;
+
+    misc::solve(u1, u2, p);
+    CHECK(closeTo(p, p_expected, 1e-3));
+    CHECK(closeTo(reduce::sum(x.data() + 1, 1000), sum_expected, 1e-4));
+    CHECK(closeTo(reduce::dot(x.data(), y.data() + 3, 998), dot_expected, 1e-4));
+    std::vector<float> z = y;
+    reduce::axpy(0.5f, x.data(), z.data(), 1001);
+    CHECK(closeTo(z, z_expected, 1e-6));
+    Matrix<float>::matmul_(a, b, c);
+    CHECK(closeTo(c.data_, c_expected.data_, 1e-4));
+    CHECK(num_calls[0] == 1);
+    CHECK(num_calls[1] == 1);
+    CHECK(num_calls[2] == 1);
+    CHECK(num_calls[3] == 1);
+    CHECK(num_calls[4] == 1);
+
+    // SpMV of pcg (as ProjectiveDynamics global step with contacts)
+    pcg::ConjugateGradient<float, pcg::PreconditionerJacobi<float>> solver;
+    Matrix<float> xs{nA, 1}, bs{nA, 1};
+    for (auto& v : bs.data_) { v = rng.uniform() - 0.5; }
+    REQUIRE(solver.setup(A));
+    CHECK(solver.solve(A, xs, bs));
+    CHECK(num_calls[5] == size_t(solver.iteration_) + 1);
+    dispatch::kernelsOverride() = nullptr;
+  }
+}
+#endif
+
+TEST_CASE("Arena") {
+  SECTION("Arena") {
+    arena::Arena a{256};
+    auto p1 = a.allocate<char>(3);
+    auto p2 = a.allocate<double>(4);
+    CHECK(reinterpret_cast<uintptr_t>(p2) % alignof(double) == 0);
+    CHECK(reinterpret_cast<char*>(p2) >= p1 + 3);
+    auto marker = a.mark();
+    {
+      arena::Scope scope{a};
+      auto p3 = scope.allocate<float>(1000); // doesn't fit in the first block
+      std::fill(p3, p3 + 1000, 1.0f);
+      CHECK(a.blocks_.size() == 2);
+      CHECK(a.used() >= 4000);
+    }
+    CHECK(a.used() == marker.used);
+    CHECK(a.allocate<char>(1) == reinterpret_cast<char*>(p2 + 4));
+
+    // Merged into single block after reset and no allocation from then on
+    a.reset();
+    CHECK(a.blocks_.size() == 1);
+    CHECK(a.capacity() >= a.peak());
+    size_t num_allocations = g_num_allocations;
+    for (auto k = 0; k < 4; k++) {
+      arena::Scope scope{a};
+      scope.allocate<char>(3);
+      scope.allocate<double>(4);
+      scope.allocate<float>(1000);
+    }
+    CHECK(g_num_allocations == num_allocations);
+  }
+
+  SECTION("BufferPool") {
+    Rng rng;
+    Matrix<float> a{16, 8}, b{8, 4};
+    for (auto& v : a.data_) { v = rng.uniform(); }
+    for (auto& v : b.data_) { v = rng.uniform(); }
+    auto A = gridLaplacian(20, 0.1);
+    Matrix<float> x{A.shape_[0], 3};
+    for (auto& v : x.data_) { v = rng.uniform(); }
+    auto c_expected = Matrix<float>::matmul(a, b);
+    auto y_expected = MatrixCSR<float>::matmul(A, x);
+
+    arena::BufferPool<float> pool;
+    for (auto num_threads : {1, 3}) {
+      thread_pool::setNumThreads(num_threads);
+      size_t num_allocations = 0;
+      for (auto k = 0; k < 4; k++) {
+        if (k == 1) { num_allocations = g_num_allocations; } // after warm-up
+        auto c = Matrix<float>::matmul(a, b, pool);
+        auto y = MatrixCSR<float>::matmul(A, x, pool);
+        bool ok = c.data_ == c_expected.data_ && y.data_ == y_expected.data_;
+        pool.release(std::move(c.data_));
+        pool.release(std::move(y.data_));
+        if (!ok) { FAIL("matmul with BufferPool"); }
+      }
+      CHECK(g_num_allocations == num_allocations);
+      CHECK(pool.size() == 2);
+    }
+    thread_pool::setNumThreads(THREAD_POOL_DEFAULT_SIZE);
+  }
+
+  SECTION("steady state") {
+    std::vector<float> verts;
+    std::vector<uint32_t> c3xc0;
+    makeTetrahedralizedCubeSymmetric(3, verts, c3xc0);
+    auto A = gridLaplacian(12, 1e-2);
+    Matrix<float> b{A.shape_[0], 3}, x{A.shape_[0], 3};
+    std::fill(b.data_.begin(), b.data_.end(), 1);
+
+    for (auto num_threads : {1, 3}) {
+      thread_pool::setNumThreads(num_threads);
+
+      // ProjectiveDynamics::update
+      physics::ProjectiveDynamics solver{verts.size() / 3, c3xc0.size() / 4, 1};
+      solver.verts_.data_ = verts;
+      solver.c3xc0_ = c3xc0;
+      solver.handles_[0] = 0;
+      REQUIRE(solver.init(1 << 5));
+      solver.update();
+      size_t num_allocations = g_num_allocations;
+      for (auto k = 0; k < 4; k++) { solver.update(); }
+      CHECK(g_num_allocations == num_allocations);
+
+      // Matrix::matmul_ (packed gemm, warm-up grows the arena of every thread since any of them may pack A)
+      Matrix<float> d{200, 300}, e{300, 100}, f{200, 100};
+      Matrix<float>::matmul_(d, e, f);
+      auto& pool = thread_pool::getDefault();
+      std::atomic<size_t> num_arrived{0};
+      pool.run(pool.size(), [&](size_t) {
+        num_arrived++;
+        while (num_arrived < pool.size()) { std::this_thread::yield(); } // one chunk per thread
+        arena::Scope scope{arena::threadArena()};
+        scope.allocate<char>(1 << 20);
+      });
+      num_allocations = g_num_allocations;
+      for (auto k = 0; k < 4; k++) { Matrix<float>::matmul_(d, e, f); }
+      CHECK(g_num_allocations == num_allocations);
+
+      // ConjugateGradient::solve
+      pcg::ConjugateGradient<float, pcg::PreconditionerIC0<float>> cg;
+      REQUIRE(cg.setup(A));
+      std::fill(x.data_.begin(), x.data_.end(), 0);
+      cg.solve(A, x, b, 1024, 1e-4);
+      num_allocations = g_num_allocations;
+      for (auto k = 0; k < 4; k++) {
+        std::fill(x.data_.begin(), x.data_.end(), 0);
+        cg.solve(A, x, b, 1024, 1e-4);
+      }
+      CHECK(g_num_allocations == num_allocations);
+    }
+    thread_pool::setNumThreads(THREAD_POOL_DEFAULT_SIZE);
+
+    // format::formatTo with enough capacity
+    std::string out;
+    out.reserve(256);
+    size_t num_allocations = g_num_allocations;
+    for (auto k = 0; k < 4; k++) {
+      out.clear();
+      format::formatTo(out, "frame %d : %.3f ms (%s)", k, 1.5, "ok");
+    }
+    CHECK(g_num_allocations == num_allocations);
+    CHECK(out == "frame 3 : 1.500 ms (ok)");
+    out.clear();
+    format::formatTo(out, "%s %s", std::string(100, 'a'), std::string(200, 'b')); // grows
+    CHECK(out.size() == 301);
+  }
+}
+
+// Unit sphere with poles (vertex 0 and nV - 1) and `n_lat - 1` rings of `n_lon` vertices (outward ccw faces)
+void makeUVSphere(size_t n_lat, size_t n_lon, std::vector<float>& verts, std::vector<uint32_t>& f2v) {
+  verts.clear();
+  f2v.clear();
+  float pi = ddg::kPi;
+  verts.insert(verts.end(), {0, 0, 1});
+  for (size_t k = 1; k < n_lat; k++) {
+    float t = pi * k / n_lat;
+    for (size_t i = 0; i < n_lon; i++) {
+      float p = 2 * pi * i / n_lon;
+      verts.insert(verts.end(), {std::sin(t) * std::cos(p), std::sin(t) * std::sin(p), std::cos(t)});
+    }
+  }
+  verts.insert(verts.end(), {0, 0, -1});
+  auto ring = [&](size_t k, size_t i) { return uint32_t(1 + (k - 1) * n_lon + i % n_lon); };
+  uint32_t south = uint32_t(verts.size() / 3 - 1);
+  for (size_t i = 0; i < n_lon; i++) {
+    f2v.insert(f2v.end(), {0, ring(1, i), ring(1, i + 1)});
+    f2v.insert(f2v.end(), {south, ring(n_lat - 1, i + 1), ring(n_lat - 1, i)});
+    for (size_t k = 1; k + 1 < n_lat; k++) {
+      f2v.insert(f2v.end(), {ring(k, i), ring(k + 1, i), ring(k + 1, i + 1)});
+      f2v.insert(f2v.end(), {ring(k, i), ring(k + 1, i + 1), ring(k, i + 1)});
+    }
+  }
+}
+
+TEST_CASE("ddg") {
+  std::vector<float> verts;
+  std::vector<uint32_t> f2v;
+  makeUVSphere(32, 64, verts, f2v);
+  size_t nV = verts.size() / 3;
+  size_t nF = f2v.size() / 3;
+
+  ddg::Mesh mesh{nV, nF};
+  mesh.verts_.data_ = verts;
+  mesh.topology_.f2v_ = f2v;
+  REQUIRE(mesh.init());
+  auto& topology = mesh.topology_;
+
+  SECTION("topology") {
+    CHECK(!topology.boundary_);
+    CHECK(topology.orientable_);
+    CHECK(2 * topology.nE_ == 3 * nF);
+    CHECK(nV + nF - topology.nE_ == 2); // euler characteristic
+    bool ok = true;
+    for (uint32_t h = 0; h < 3 * nF; h++) {
+      uint32_t t = topology.twin_[h];
+      uint32_t e = topology.h2e_[h];
+      ok = ok && topology.twin_[t] == h && topology.h2e_[t] == e;
+      ok = ok && topology.source(h) == topology.target(t);
+      ok = ok && topology.e2v_[2 * e] == std::min(topology.source(h), topology.target(h));
+    }
+    CHECK(ok);
+  }
+
+  SECTION("laplacian") {
+    // Same as COO assembly of cotan weights per face (cf. computeLaplacianV2 in ddg.js)
+    std::vector<size_t> rows, cols;
+    std::vector<float> values;
+    for (size_t f = 0; f < nF; f++) {
+      for (auto j = 0; j < 3; j++) {
+        uint32_t v0 = f2v[3 * f + j], v1 = f2v[3 * f + (j + 1) % 3], v2 = f2v[3 * f + (j + 2) % 3];
+        vec3 u = ddg::position(mesh.verts_, v0) - ddg::position(mesh.verts_, v2);
+        vec3 w = ddg::position(mesh.verts_, v1) - ddg::position(mesh.verts_, v2);
+        float h = 0.5f * glm::dot(u, w) / glm::length(glm::cross(u, w));
+        for (auto [i, k, s] : {std::tuple{v0, v0, -1}, {v1, v1, -1}, {v0, v1, 1}, {v1, v0, 1}}) {
+          rows.push_back(i);
+          cols.push_back(k);
+          values.push_back(s * h);
+        }
+      }
+    }
+    auto L_coo = MatrixCSR<float>::fromCOO(nV, nV, rows, cols, values);
+    auto& L = mesh.laplacian_;
+    CHECK(L.indptr_ == L_coo.indptr_);
+    CHECK(L.indices_ == L_coo.indices_);
+    CHECK(closeTo(L.data_, L_coo.data_, 1e-5));
+
+    // Sum of dual areas is surface area
+    float area = 0;
+    for (size_t f = 0; f < nF; f++) {
+      vec3 p0 = ddg::position(mesh.verts_, f2v[3 * f]);
+      vec3 p1 = ddg::position(mesh.verts_, f2v[3 * f + 1]);
+      vec3 p2 = ddg::position(mesh.verts_, f2v[3 * f + 2]);
+      area += 0.5f * glm::length(glm::cross(p1 - p0, p2 - p0));
+    }
+    float area0 = std::accumulate(mesh.hodge0_.begin(), mesh.hodge0_.end(), 0.0f);
+    CHECK(closeTo(area0, area, 1e-3));
+  }
+
+  SECTION("curvature and normals") {
+    // Gauss-Bonnet
+    float kg = std::accumulate(mesh.kg_.begin(), mesh.kg_.end(), 0.0f);
+    CHECK(closeTo(kg, 4 * ddg::kPi, 1e-3));
+
+    // 2 H N = - 2 N on equator of unit sphere and normals are radial
+    bool ok = true;
+    for (size_t v = 0; v < nV; v++) {
+      vec3 p = ddg::position(mesh.verts_, v);
+      vec3 n = ddg::position(mesh.normals_, v);
+      ok = ok && glm::dot(n, p) > 0.999f;
+      if (std::abs(p.z) < 0.1) {
+        vec3 hn = ddg::position(mesh.mean_curvature_, v) / mesh.hodge0_[v];
+        ok = ok && closeTo(glm::dot(hn, n), -2, 2e-2);
+      }
+    }
+    CHECK(ok);
+  }
+
+  SECTION("boundary") {
+    // Open hemisphere (drop faces below equator) keeps orientation and has boundary
+    ddg::Topology open;
+    for (size_t f = 0; f < nF; f++) {
+      bool upper = true;
+      for (auto j = 0; j < 3; j++) { upper = upper && verts[3 * f2v[3 * f + j] + 2] > -1e-3; }
+      if (upper) { open.f2v_.insert(open.f2v_.end(), &f2v[3 * f], &f2v[3 * f + 3]); }
+    }
+    REQUIRE(open.compute(nV));
+    CHECK(open.boundary_);
+    CHECK(open.orientable_);
+    size_t num_boundary = std::count(open.twin_.begin(), open.twin_.end(), ddg::kNone);
+    CHECK(num_boundary == 64);
+  }
+
+  SECTION("non-manifold") {
+    // Three triangles sharing edge (0, 1)
+    ddg::Topology fan;
+    fan.f2v_ = {0, 1, 2, 1, 0, 3, 0, 1, 4};
+    CHECK(!fan.compute(5));
+  }
+}
+
+TEST_CASE("reader") {
+  // Mesh as text
+  std::vector<float> verts;
+  std::vector<uint32_t> f2v;
+  makeUVSphere(64, 128, verts, f2v);
+  size_t nV = verts.size() / 3;
+  size_t nF = f2v.size() / 3;
+  std::string off = format::format("OFF\n%d %d 0\n", nV, nF);
+  for (size_t i = 0; i < nV; i++) {
+    format::formatTo(off, "%.9g %.9g %.9g\n", verts[3 * i], verts[3 * i + 1], verts[3 * i + 2]);
+  }
+  for (size_t i = 0; i < nF; i++) {
+    format::formatTo(off, "3 %d %d %d\n", f2v[3 * i], f2v[3 * i + 1], f2v[3 * i + 2]);
+  }
+
+  auto tmpPath = [](const char* name) {
+    return (std::filesystem::temp_directory_path() / name).string();
+  };
+  auto writeFile = [](const std::string& path, const std::string& data) {
+    FILE* file = std::fopen(path.c_str(), "wb");
+    REQUIRE(file);
+    std::fwrite(data.data(), 1, data.size(), file);
+    std::fclose(file);
+  };
+
+  SECTION("parseFloat") {
+    Rng rng;
+    bool ok = true;
+    for (auto i = 0; i < 10000; i++) {
+      float expected = (rng.uniform() - 0.5f) * std::pow(10.0f, float(int(rng.uniform() * 20) - 10));
+      for (auto fmt : {"%.9g", "%.3f", "%e", "%.12e"}) {
+        std::string s = format::format(fmt, expected);
+        const char* p = s.data();
+        float result = 0;
+        ok = ok && reader::parseFloat(p, s.data() + s.size(), result) && p == s.data() + s.size();
+        ok = ok && result == std::strtof(s.c_str(), nullptr);
+      }
+    }
+    CHECK(ok);
+    // 1 + 2^-24 is halfway between 1 and 1 + 2^-23, and the longer inputs are just above it
+    // but round to it in double (thus rounding via double would give 1)
+    for (std::string s : {"1e-40", "-123456789012345678901234", "0.000000000000000000000000000123", "+7", "-.5", "2.",
+                          "1.000000059604644775390625", "1.000000059604644776", "1.0000000596046448"}) {
+      const char* p = s.data();
+      float result = 0;
+      CHECK(reader::parseFloat(p, s.data() + s.size(), result));
+      CHECK(result == std::strtof(s.c_str(), nullptr));
+    }
+    std::string s = "x";
+    const char* p = s.data();
+    float result;
+    CHECK(!reader::parseFloat(p, s.data() + s.size(), result));
+  }
+
+  SECTION("OFF") {
+    reader::Mesh mesh;
+    REQUIRE(reader::parseOFF(off.data(), off.size(), mesh));
+    CHECK(closeTo(mesh.verts_, verts, 1e-6));
+    CHECK(mesh.f2v_ == f2v);
+
+    // Memory-mapped and streamed through small window (blocks arrive in order)
+    auto path = tmpPath("ex05-reader-test.off");
+    writeFile(path, off);
+    reader::Mesh mesh2;
+    REQUIRE(reader::readOFF(path.c_str(), mesh2));
+    CHECK(mesh2.verts_ == mesh.verts_);
+    CHECK(mesh2.f2v_ == mesh.f2v_);
+
+    reader::Mesh mesh3;
+    size_t num_blocks = 0;
+    bool in_order = true;
+    bool ok = reader::streamOFF(path.c_str(), 1 << 12, [&](const reader::Block& block) {
+      num_blocks++;
+      if (block.kind == reader::Kind::kVerts) {
+        in_order = in_order && mesh3.verts_.size() == 3 * block.first;
+        mesh3.verts_.insert(mesh3.verts_.end(), block.verts, block.verts + 3 * block.count);
+      } else {
+        in_order = in_order && mesh3.f2v_.size() == 3 * block.first;
+        mesh3.f2v_.insert(mesh3.f2v_.end(), block.cells, block.cells + 3 * block.count);
+      }
+    });
+    CHECK(ok);
+    CHECK(in_order);
+    CHECK(num_blocks > 2);
+    CHECK(mesh3.verts_ == mesh.verts_);
+    CHECK(mesh3.f2v_ == mesh.f2v_);
+    std::remove(path.c_str());
+
+    // Comments, blank lines and CRLF
+    std::string off2 = "OFF\r\n# comment\r\n3 1 0\r\n\r\n0 0 0\r\n1 0 0\r\n  0 1 0\r\n3 0 1 2\r\n";
+    REQUIRE(reader::parseOFF(off2.data(), off2.size(), mesh));
+    CHECK(mesh.verts_ == std::vector<float>{0, 0, 0, 1, 0, 0, 0, 1, 0});
+    CHECK(mesh.f2v_ == std::vector<uint32_t>{0, 1, 2});
+
+    // Errors
+    for (std::string bad : {"OFX\n3 1 0\n", "OFF\n3 1 1\n", "OFF\n3 1 0\n0 0 0\n1 0 0\n", "OFF\n1 1 0\n0 0 a\n3 0 0 0\n"}) {
+      CHECK(!reader::parseOFF(bad.data(), bad.size(), mesh));
+    }
+  }
+
+  SECTION("OBJ") {
+    std::string obj =
+        "# quad and triangle\n"
+        "v 0 0 0\nv 1 0 0\nv 1 1 0\nvn 0 0 1\nv 0 1 0\n"
+        "f 1//1 2//1 3//1 4//1\n"
+        "f 1/1 3/2 4/3\n";
+    reader::Mesh mesh;
+    REQUIRE(reader::parseOBJ(obj.data(), obj.size(), mesh));
+    CHECK(mesh.verts_ == std::vector<float>{0, 0, 0, 1, 0, 0, 1, 1, 0, 0, 1, 0});
+    CHECK(mesh.f2v_ == std::vector<uint32_t>{0, 1, 2, 0, 2, 3, 0, 2, 3});
+    std::string bad = "v 0 0 0\nf 0 1 2\n";
+    CHECK(!reader::parseOBJ(bad.data(), bad.size(), mesh));
+  }
+
+  SECTION("MESH and ELE/NODE") {
+    std::vector<float> tverts;
+    std::vector<uint32_t> c3xc0;
+    makeTetrahedralizedCubeSymmetric(6, tverts, c3xc0);
+    size_t nC0 = tverts.size() / 3;
+    size_t nC3 = c3xc0.size() / 4;
+    std::string mesh_text = format::format("MeshVersionFormatted 1\nDimension 3\nVertices\n%d\n", nC0);
+    std::string node = format::format("%d 3 0 0\n", nC0);
+    for (size_t i = 0; i < nC0; i++) {
+      format::formatTo(mesh_text, "%.9g %.9g %.9g 0\n", tverts[3 * i], tverts[3 * i + 1], tverts[3 * i + 2]);
+      format::formatTo(node, "%d %.9g %.9g %.9g\n", i + 1, tverts[3 * i], tverts[3 * i + 1], tverts[3 * i + 2]);
+    }
+    mesh_text += "Triangles\n1\n1 2 3 0\nTetrahedra\n";
+    format::formatTo(mesh_text, "%d\n", nC3);
+    std::string ele = format::format("%d 4 0\n", nC3);
+    for (size_t i = 0; i < nC3; i++) {
+      auto vs = &c3xc0[4 * i];
+      format::formatTo(mesh_text, "%d %d %d %d 0\n", vs[0] + 1, vs[1] + 1, vs[2] + 1, vs[3] + 1);
+      format::formatTo(ele, "%d %d %d %d %d\n", i + 1, vs[0] + 1, vs[1] + 1, vs[2] + 1, vs[3] + 1);
+    }
+    mesh_text += "End\n";
+
+    reader::Mesh mesh;
+    REQUIRE(reader::parseMESH(mesh_text.data(), mesh_text.size(), mesh));
+    CHECK(closeTo(mesh.verts_, tverts, 1e-6));
+    CHECK(mesh.f2v_ == std::vector<uint32_t>{0, 1, 2});
+    CHECK(mesh.c3xc0_ == c3xc0);
+
+    auto path = tmpPath("ex05-reader-test.mesh");
+    writeFile(path, mesh_text);
+    reader::Mesh mesh2;
+    bool ok = reader::streamMESH(path.c_str(), 1 << 10, [&](const reader::Block& block) {
+      if (block.kind == reader::Kind::kTetrahedra) {
+        mesh2.c3xc0_.insert(mesh2.c3xc0_.end(), block.cells, block.cells + 4 * block.count);
+      }
+    });
+    CHECK(ok);
+    CHECK(mesh2.c3xc0_ == c3xc0);
+    std::remove(path.c_str());
+
+    // 1-based tetgen files
+    auto ele_path = tmpPath("ex05-reader-test.ele");
+    auto node_path = tmpPath("ex05-reader-test.node");
+    writeFile(ele_path, ele);
+    writeFile(node_path, node);
+    reader::Mesh mesh3;
+    REQUIRE(reader::readELENODE(ele_path.c_str(), node_path.c_str(), mesh3));
+    CHECK(mesh3.verts_ == mesh.verts_);
+    CHECK(mesh3.c3xc0_ == c3xc0);
+    std::remove(ele_path.c_str());
+    std::remove(node_path.c_str());
+
+    // 0 is invalid in 1-based indices
+    std::string bad = "MeshVersionFormatted 1\nDimension 3\nVertices\n1\n0 0 0 0\nTriangles\n1\n0 1 1 0\n";
+    CHECK(!reader::parseMESH(bad.data(), bad.size(), mesh));
+  }
+}
+
+TEST_CASE("cache") {
+  std::vector<float> verts;
+  std::vector<uint32_t> c3xc0;
+  makeTetrahedralizedCubeSymmetric(2, verts, c3xc0);
+  size_t nV = verts.size() / 3;
+  size_t nC3 = c3xc0.size() / 4;
+
+  auto makeSolver = [&](int refinement_iteration) {
+    auto solver = std::make_unique<physics::ProjectiveDynamics>(nV, nC3, 1);
+    solver->verts_.data_ = verts;
+    solver->c3xc0_ = c3xc0;
+    solver->handles_[0] = 0;
+    for (size_t k = 0; k < 3; k++) { solver->handle_targets_(0, k) = verts[k]; }
+    solver->refinement_iteration_ = refinement_iteration;
+    REQUIRE(solver->init(1 << 5));
+    return solver;
+  };
+  auto path = (std::filesystem::temp_directory_path() / "ex05-cache-test.bin").string();
+  uint64_t source_hash = cache::hash(verts.data(), verts.size() * sizeof(float));
+
+  SECTION("hash") {
+    std::string s = "0123456789abcdefg";
+    uint64_t h = cache::hash(s.data(), s.size());
+    CHECK(h == cache::hash(s.data(), s.size()));
+    for (size_t i = 0; i < s.size(); i++) {
+      std::string t = s;
+      t[i] ^= 1;
+      CHECK(h != cache::hash(t.data(), t.size()));
+    }
+    CHECK(h != cache::hash(s.data(), s.size() - 1));
+    physics::ProjectiveDynamics solver{0, 0, 0};
+    uint64_t k1 = cache::hashConfig(solver, source_hash);
+    solver.strain_stiffness_ *= 2;
+    CHECK(k1 != cache::hashConfig(solver, source_hash));
+  }
+
+  for (auto refinement_iteration : {0, 2}) {
+    DYNAMIC_SECTION("save and load (refinement_iteration = " << refinement_iteration << ")") {
+      auto solver = makeSolver(refinement_iteration);
+      uint64_t key = cache::hashConfig(*solver, source_hash);
+      REQUIRE(cache::save(path, key, *solver));
+
+      physics::ProjectiveDynamics solver2{0, 0, 0};
+      solver2.refinement_iteration_ = refinement_iteration;
+      REQUIRE(cache::load(path, key, solver2));
+      CHECK(solver2.nV_ == nV);
+      CHECK(solver2.nC3_ == nC3);
+      CHECK(solver2.verts_.data_ == verts);
+      CHECK(solver2.c3xc0_ == c3xc0);
+      CHECK(solver2.E_.indices_ == solver->E_.indices_);
+      CHECK(solver2.E_.data_ == solver->E_.data_);
+      auto& L = refinement_iteration > 0 ? solver->E_refinement_.cholesky_.L_ : solver->E_cholesky_.L_;
+      auto& L2 = refinement_iteration > 0 ? solver2.E_refinement_.cholesky_.L_ : solver2.E_cholesky_.L_;
+      CHECK(L2.indptr_ == L.indptr_);
+      CHECK(L2.data_ == L.data_);
+
+      // Same simulation as the solver given to `save`
+      for (auto i = 0; i < 8; i++) {
+        solver->update();
+        solver2.update();
+      }
+      CHECK(solver2.verts_.data_ == solver->verts_.data_);
+
+      // Zero-copy view
+      cache::File file;
+      REQUIRE(file.open(path, key));
+      cache::View<float> view;
+      REQUIRE(file.get("verts.data", view));
+      CHECK(reinterpret_cast<uintptr_t>(view.data_) % cache::kAlignment == 0);
+      CHECK(std::equal(view.begin(), view.end(), verts.begin(), verts.end()));
+      cache::View<double> wrong_dtype;
+      CHECK(!file.get("verts.data", wrong_dtype));
+      std::remove(path.c_str());
+    }
+  }
+
+  SECTION("rejects other key and broken file") {
+    auto solver = makeSolver(0);
+    uint64_t key = cache::hashConfig(*solver, source_hash);
+    REQUIRE(cache::save(path, key, *solver));
+    physics::ProjectiveDynamics solver2{0, 0, 0};
+    CHECK(!cache::load(path, key + 1, solver2));
+    CHECK(!cache::load(path + ".missing", key, solver2));
+
+    // Cached with refinement but loaded without (and vice versa) is rejected by `hashConfig`
+    solver2.refinement_iteration_ = 2;
+    CHECK(cache::hashConfig(solver2, source_hash) != key);
+
+    // Other handle set (or target) misses the cache
+    physics::ProjectiveDynamics solver3{nV, nC3, 1};
+    solver3.handles_[0] = 0;
+    for (size_t k = 0; k < 3; k++) { solver3.handle_targets_(0, k) = verts[k]; }
+    CHECK(cache::hashConfig(solver3, source_hash) == key);
+    solver3.handles_[0] = 1;
+    uint64_t key3 = cache::hashConfig(solver3, source_hash);
+    CHECK(key3 != key);
+    CHECK(!cache::load(path, key3, solver3));
+    solver3.handles_[0] = 0;
+    solver3.handle_targets_(0, 1) += 1;
+    CHECK(cache::hashConfig(solver3, source_hash) != key);
+    physics::ProjectiveDynamics solver4{nV, nC3, 2};
+    solver4.handles_ = {0, 1};
+    CHECK(cache::hashConfig(solver4, source_hash) != key);
+
+    // Truncated and corrupted
+    std::string data;
+    {
+      FILE* file = std::fopen(path.c_str(), "rb");
+      REQUIRE(file);
+      char buffer[4096];
+      size_t n;
+      while ((n = std::fread(buffer, 1, sizeof(buffer), file)) > 0) { data.append(buffer, n); }
+      std::fclose(file);
+    }
+    auto writeAndLoad = [&](const std::string& content) {
+      FILE* file = std::fopen(path.c_str(), "wb");
+      REQUIRE(file);
+      std::fwrite(content.data(), 1, content.size(), file);
+      std::fclose(file);
+      physics::ProjectiveDynamics solver3{0, 0, 0};
+      bool ok = cache::load(path, key, solver3);
+      CHECK(solver3.nV_ == (ok ? nV : 0)); // untouched on failure
+      return ok;
+    };
+    CHECK(writeAndLoad(data));
+    CHECK(!writeAndLoad(data.substr(0, data.size() / 2)));
+    CHECK(!writeAndLoad(data.substr(0, 20)));
+    std::string bad_magic = data;
+    bad_magic[0] = 'X';
+    CHECK(!writeAndLoad(bad_magic));
+    std::string bad_version = data;
+    bad_version[8] ^= 1;
+    CHECK(!writeAndLoad(bad_version));
+    std::string bad_offset = data;
+    bad_offset[sizeof(cache::Header) + offsetof(cache::Section, offset)] ^= 1; // misaligned first section
+    CHECK(!writeAndLoad(bad_offset));
+
+    // Index payloads out of range (header and sections intact)
+    auto payloadOffset = [&](const std::string& name) {
+      cache::File file;
+      REQUIRE(file.open(path, key));
+      cache::View<size_t> view;
+      REQUIRE(file.get(name, view));
+      return size_t(reinterpret_cast<const char*>(view.data_) - file.file_.data_);
+    };
+    REQUIRE(writeAndLoad(data));
+    for (auto name : {"E.indices", "E.indptr", "E_cholesky.perm", "E_cholesky.L.indices", "E_cholesky.super"}) {
+      std::string bad_index = data;
+      size_t offset = payloadOffset(name) + sizeof(size_t); // second element
+      size_t value = size_t(1) << 40;
+      std::memcpy(&bad_index[offset], &value, sizeof(size_t));
+      CHECK(!writeAndLoad(bad_index));
+    }
+    std::remove(path.c_str());
+  }
+}
+
+TEST_CASE("delaunay") {
+  using delaunay::orient3d, delaunay::insphere;
+
+  auto volume = [](const std::vector<double>& points, const std::vector<uint32_t>& c3xc0) {
+    double result = 0;
+    for (size_t t = 0; t < c3xc0.size() / 4; t++) {
+      double u[3][3];
+      for (size_t k = 0; k < 3; k++) {
+        for (size_t l = 0; l < 3; l++) { u[k][l] = points[3 * c3xc0[4 * t + k + 1] + l] - points[3 * c3xc0[4 * t] + l]; }
+      }
+      result += (u[0][0] * (u[1][1] * u[2][2] - u[1][2] * u[2][1]) - u[0][1] * (u[1][0] * u[2][2] - u[1][2] * u[2][0]) +
+                 u[0][2] * (u[1][0] * u[2][1] - u[1][1] * u[2][0])) / 6;
+    }
+    return result;
+  };
+
+  // Positive orientation, empty circumspheres and each face shared by at most two tetrahedra
+  auto isDelaunay = [](const std::vector<double>& points, const std::vector<uint32_t>& c3xc0) {
+    size_t n = points.size() / 3;
+    bool ok = true;
+    std::map<std::tuple<uint32_t, uint32_t, uint32_t>, int> faces;
+    for (size_t t = 0; t < c3xc0.size() / 4; t++) {
+      auto vs = &c3xc0[4 * t];
+      auto p = [&](size_t k) { return &points[3 * vs[k]]; };
+      ok = ok && orient3d(p(0), p(1), p(2), p(3)) > 0;
+      for (size_t i = 0; i < n; i++) {
+        ok = ok && !(insphere(p(0), p(1), p(2), p(3), &points[3 * i]) > 0);
+      }
+      for (size_t k = 0; k < 4; k++) {
+        uint32_t f[3] = {vs[(k + 1) % 4], vs[(k + 2) % 4], vs[(k + 3) % 4]};
+        std::sort(f, f + 3);
+        ok = ok && ++faces[{f[0], f[1], f[2]}] <= 2;
+      }
+    }
+    return ok;
+  };
+
+  SECTION("predicates") {
+    double a[3] = {0, 0, 0}, b[3] = {1, 0, 0}, c[3] = {0, 1, 0}, d[3] = {0, 0, 1};
+    double inside[3] = {0.2, 0.2, 0.2}, outside[3] = {2, 2, 2}, on[3] = {1, 1, 1};
+    CHECK(orient3d(a, b, c, d) > 0);
+    CHECK(orient3d(a, c, b, d) < 0);
+    CHECK(orient3d(a, b, c, inside) > 0);
+    CHECK(insphere(a, b, c, d, inside) > 0);
+    CHECK(insphere(a, b, c, d, outside) < 0);
+    CHECK(insphere(a, b, c, d, on) == 0); // cube corners are cospherical
+    CHECK(orient3d(a, b, on, outside) == 0);
+
+    // Nearly degenerate inputs agree with exact arithmetic
+    Rng rng;
+    bool ok = true;
+    for (auto i = 0; i < 1000; i++) {
+      double p[5][3];
+      for (auto& q : p) {
+        for (auto& x : q) { x = rng.uniform(); }
+      }
+      for (size_t k = 0; k < 3; k++) {
+        p[3][k] = p[0][k] + (p[1][k] - p[0][k]) * 0.25 + (p[2][k] - p[0][k]) * 0.5; // on plane (up to rounding)
+        p[4][k] = 2 * p[1][k] - p[0][k];
+      }
+      auto sign = [](double x) { return (x > 0) - (x < 0); };
+      ok = ok && sign(orient3d(p[0], p[1], p[2], p[3])) == sign(delaunay::orient3dExact(p[0], p[1], p[2], p[3]));
+      ok = ok && sign(insphere(p[0], p[1], p[2], p[3], p[4])) ==
+                 sign(delaunay::insphereExact(p[0], p[1], p[2], p[3], p[4]));
+    }
+    CHECK(ok);
+  }
+
+  SECTION("same as brute force") {
+    Rng rng;
+    for (auto trial = 0; trial < 4; trial++) {
+      size_t n = 16;
+      std::vector<float> verts(3 * n);
+      for (auto& x : verts) { x = rng.uniform(); }
+      delaunay::Delaunay solver;
+      REQUIRE(solver.compute(verts.data(), n));
+
+      // misc2.delaunayBruteforce
+      std::vector<double> points(verts.begin(), verts.end());
+      std::set<std::array<uint32_t, 4>> expected, result;
+      auto p = [&](size_t i) { return &points[3 * i]; };
+      for (uint32_t i0 = 0; i0 < n; i0++) {
+        for (uint32_t i1 = i0 + 1; i1 < n; i1++) {
+          for (uint32_t i2 = i1 + 1; i2 < n; i2++) {
+            for (uint32_t i3 = i2 + 1; i3 < n; i3++) {
+              std::array<uint32_t, 4> vs = {i0, i1, i2, i3};
+              double o = orient3d(p(i0), p(i1), p(i2), p(i3));
+              if (o == 0) { continue; }
+              if (o < 0) { std::swap(vs[2], vs[3]); }
+              bool empty = true;
+              for (size_t j = 0; j < n && empty; j++) {
+                empty = !(insphere(p(vs[0]), p(vs[1]), p(vs[2]), p(vs[3]), p(j)) > 0);
+              }
+              if (empty) { expected.insert({i0, i1, i2, i3}); }
+            }
+          }
+        }
+      }
+      for (size_t t = 0; t < solver.c3xc0_.size() / 4; t++) {
+        std::array<uint32_t, 4> vs;
+        std::copy_n(&solver.c3xc0_[4 * t], 4, vs.begin());
+        std::sort(vs.begin(), vs.end());
+        result.insert(vs);
+      }
+      CHECK(result == expected);
+      CHECK(isDelaunay(points, solver.c3xc0_));
+    }
+  }
+
+  SECTION("random points in cube") {
+    Rng rng;
+    size_t n = 2000;
+    std::vector<float> verts;
+    for (auto i = 0; i < 8; i++) { verts.insert(verts.end(), {float(i & 1), float((i >> 1) & 1), float(i >> 2)}); }
+    while (verts.size() < 3 * n) { verts.push_back(rng.uniform()); }
+    delaunay::Delaunay solver;
+    REQUIRE(solver.compute(verts.data(), n));
+    CHECK(solver.num_skipped_ == 0);
+    CHECK(solver.c3xc0_.size() / 4 > 5 * n); // roughly 6.5 n for uniform points
+    CHECK(closeTo(float(volume(solver.points_, solver.c3xc0_)), 1));
+    CHECK(isDelaunay(solver.points_, solver.c3xc0_));
+
+    // Every point is used
+    std::vector<bool> used(n);
+    for (auto v : solver.c3xc0_) { used[v] = true; }
+    CHECK(std::all_of(used.begin(), used.end(), [](bool b) { return b; }));
+  }
+
+  SECTION("degenerate inputs") {
+    // Lattice (many cospherical and coplanar points) with duplicates
+    size_t m = 5;
+    std::vector<float> verts;
+    for (size_t k = 0; k < m; k++) {
+      for (size_t j = 0; j < m; j++) {
+        for (size_t i = 0; i < m; i++) { verts.insert(verts.end(), {float(i), float(j), float(k)}); }
+      }
+    }
+    size_t n = verts.size() / 3;
+    verts.insert(verts.end(), verts.begin(), verts.begin() + 30); // 10 duplicates
+    delaunay::Delaunay solver;
+    REQUIRE(solver.compute(verts.data(), verts.size() / 3));
+    CHECK(solver.num_skipped_ == 10);
+    CHECK(closeTo(float(volume(solver.points_, solver.c3xc0_)), float((m - 1) * (m - 1) * (m - 1))));
+    CHECK(isDelaunay(solver.points_, solver.c3xc0_));
+    CHECK(std::set<uint32_t>(solver.c3xc0_.begin(), solver.c3xc0_.end()).size() == n); // one of each duplicate
+
+    // Coplanar and too few points
+    std::vector<float> plane = {0, 0, 0, 1, 0, 0, 0, 1, 0, 1, 1, 0, 0.5, 0.3, 0};
+    CHECK(!solver.compute(plane.data(), 5));
+    CHECK(!solver.compute(plane.data(), 3));
+  }
+}
+
+// Torus with n x m grid of quads split into two triangles (closed genus 1)
+void makeTorus(size_t n, size_t m, std::vector<float>& verts, std::vector<uint32_t>& f2v) {
+  verts.clear();
+  f2v.clear();
+  float pi = ddg::kPi;
+  for (size_t j = 0; j < m; j++) {
+    for (size_t i = 0; i < n; i++) {
+      float p = 2 * pi * i / n, t = 2 * pi * j / m;
+      float r = 1 + 0.3f * std::cos(t);
+      verts.insert(verts.end(), {r * std::cos(p), r * std::sin(p), 0.3f * std::sin(t)});
+    }
+  }
+  auto vertex = [&](size_t i, size_t j) { return uint32_t((j % m) * n + i % n); };
+  for (size_t j = 0; j < m; j++) {
+    for (size_t i = 0; i < n; i++) {
+      auto v0 = vertex(i, j), v1 = vertex(i + 1, j), v2 = vertex(i, j + 1), v3 = vertex(i + 1, j + 1);
+      f2v.insert(f2v.end(), {v0, v1, v3, v0, v3, v2});
+    }
+  }
+}
+
+TEST_CASE("graph") {
+  auto num_threads_default = thread_pool::getNumThreads();
+
+  // Levels by sequential queue
+  auto sequentialLevels = [](const graph::Graph& g, uint32_t root) {
+    std::vector<uint32_t> level(g.n_, graph::kNone);
+    std::vector<uint32_t> queue = {root};
+    level[root] = 0;
+    for (size_t i = 0; i < queue.size(); i++) {
+      uint32_t v = queue[i];
+      for (auto p = g.indptr_[v]; p < g.indptr_[v + 1]; p++) {
+        uint32_t w = g.nodes_[p];
+        if (level[w] == graph::kNone) {
+          level[w] = level[v] + 1;
+          queue.push_back(w);
+        }
+      }
+    }
+    return level;
+  };
+
+  SECTION("BFS") {
+    std::vector<float> verts;
+    std::vector<uint32_t> f2v;
+    makeUVSphere(32, 64, verts, f2v);
+    ddg::Topology topology;
+    topology.f2v_ = f2v;
+    topology.compute(verts.size() / 3);
+    for (auto& g : {graph::computeV2VE(topology), graph::computeF2FE(topology)}) {
+      uint32_t root = uint32_t(g.n_ / 3);
+      auto expected = sequentialLevels(g, root);
+
+      // Same tree for top-down only, bottom-up as much as possible, and any number of threads
+      graph::BFS reference;
+      reference.beta_ = 1;
+      reference.compute(g, root);
+      CHECK(reference.num_bottom_up_ == 0);
+      CHECK(reference.level_ == expected);
+      for (size_t num_threads : {1, 3}) {
+        thread_pool::setNumThreads(num_threads);
+        graph::BFS bfs;
+        bfs.alpha_ = size_t(1) << 40;
+        bfs.beta_ = size_t(1) << 40;
+        bfs.compute(g, root);
+        CHECK(bfs.num_bottom_up_ > 0);
+        CHECK(bfs.level_ == reference.level_);
+        CHECK(bfs.parent_ == reference.parent_);
+        CHECK(bfs.parent_edge_ == reference.parent_edge_);
+        CHECK(bfs.order_ == reference.order_);
+      }
+      thread_pool::setNumThreads(num_threads_default);
+
+      // Parent is adjacent via parent edge one level up, and order is topological
+      bool ok = reference.order_.size() == g.n_ && reference.order_[0] == root;
+      std::vector<uint8_t> visited(g.n_, 0);
+      for (auto v : reference.order_) {
+        if (v != root) {
+          uint32_t u = reference.parent_[v];
+          ok = ok && visited[u] && reference.level_[u] + 1 == reference.level_[v];
+          bool found = false;
+          for (auto p = g.indptr_[v]; p < g.indptr_[v + 1]; p++) {
+            found = found || (g.nodes_[p] == u && g.edges_[p] == reference.parent_edge_[v]);
+          }
+          ok = ok && found;
+        }
+        visited[v] = 1;
+      }
+      CHECK(ok);
+    }
+  }
+
+  SECTION("BFS (blocked edges)") {
+    // Blocking the edges of one ring on the sphere disconnects two poles
+    std::vector<float> verts;
+    std::vector<uint32_t> f2v;
+    makeUVSphere(8, 16, verts, f2v);
+    ddg::Topology topology;
+    topology.f2v_ = f2v;
+    topology.compute(verts.size() / 3);
+    auto g = graph::computeV2VE(topology);
+    std::vector<uint8_t> blocked(topology.nE_, 0);
+    for (size_t v = 1; v <= 16; v++) {
+      for (auto p = g.indptr_[v]; p < g.indptr_[v + 1]; p++) {
+        if (g.nodes_[p] > 16) { blocked[g.edges_[p]] = 1; }
+      }
+    }
+    graph::BFS bfs;
+    bfs.compute(g, 0, &blocked);
+    CHECK(bfs.order_.size() == 17);
+    CHECK(bfs.num_levels_ == 2);
+    CHECK(bfs.level_.back() == graph::kNone);
+  }
+
+  SECTION("TreeCotree") {
+    auto check = [&](const std::vector<float>& verts, const std::vector<uint32_t>& f2v, size_t genus) {
+      ddg::Topology topology;
+      topology.f2v_ = f2v;
+      topology.compute(verts.size() / 3);
+      graph::TreeCotree tree_cotree;
+      REQUIRE(tree_cotree.compute(topology));
+      auto& kinds = tree_cotree.edge_kind_;
+      CHECK(size_t(std::count(kinds.begin(), kinds.end(), graph::kPrimal)) == topology.nV_ - 1);
+      CHECK(size_t(std::count(kinds.begin(), kinds.end(), graph::kDual)) == topology.nF_ - 1);
+      CHECK(tree_cotree.generators_.size() == 2 * genus);
+      CHECK(tree_cotree.loops_indptr_.size() == 2 * genus + 1);
+
+      // Each loop is a simple closed dual cycle (two loop edges per visited face) through its generator
+      bool ok = true;
+      std::vector<uint32_t> count(topology.nF_);
+      for (size_t i = 0; i < tree_cotree.generators_.size(); i++) {
+        std::fill(count.begin(), count.end(), 0);
+        auto begin = tree_cotree.loops_.begin() + tree_cotree.loops_indptr_[i];
+        auto end = tree_cotree.loops_.begin() + tree_cotree.loops_indptr_[i + 1];
+        ok = ok && std::count(begin, end, tree_cotree.generators_[i]) == 1;
+        for (auto it = begin; it != end; it++) {
+          uint32_t h = topology.e2h_[*it];
+          count[h / 3]++;
+          count[topology.twin_[h] / 3]++;
+          ok = ok && (*it == tree_cotree.generators_[i] || kinds[*it] == graph::kDual);
+        }
+        ok = ok && std::all_of(count.begin(), count.end(), [](uint32_t c) { return c == 0 || c == 2; });
+      }
+      CHECK(ok);
+      return tree_cotree;
+    };
+
+    std::vector<float> verts;
+    std::vector<uint32_t> f2v;
+    makeUVSphere(16, 32, verts, f2v);
+    check(verts, f2v, 0);
+    makeTorus(48, 16, verts, f2v);
+    auto reference = check(verts, f2v, 1);
+
+    // Independent of number of threads
+    thread_pool::setNumThreads(3);
+    auto other = check(verts, f2v, 1);
+    CHECK(other.generators_ == reference.generators_);
+    CHECK(other.loops_indptr_ == reference.loops_indptr_);
+    CHECK(other.loops_ == reference.loops_);
+    thread_pool::setNumThreads(num_threads_default);
+
+    // Mesh with boundary
+    makeTorus(8, 8, verts, f2v);
+    f2v.resize(f2v.size() - 6);
+    ddg::Topology topology;
+    topology.f2v_ = f2v;
+    topology.compute(verts.size() / 3);
+    graph::TreeCotree tree_cotree;
+    CHECK(!tree_cotree.compute(topology));
+  }
+}
+
+TEST_CASE("collision") {
+  auto num_threads_default = thread_pool::getNumThreads();
+  Rng rng;
+
+  SECTION("Bvh and SpatialHash") {
+    // Random boxes of various sizes
+    size_t n = 2000;
+    auto randomBoxes = [&](size_t count, float size) {
+      std::vector<float> boxes(6 * count);
+      for (size_t i = 0; i < count; i++) {
+        for (size_t k = 0; k < 3; k++) {
+          float x = rng.uniform(), h = size * rng.uniform();
+          boxes[6 * i + k] = x - h;
+          boxes[6 * i + k + 3] = x + h;
+        }
+      }
+      return boxes;
+    };
+    auto boxes = randomBoxes(n, 0.03f);
+    auto queries = randomBoxes(200, 0.1f);
+    auto bruteForce = [&](const float* box) {
+      std::vector<uint32_t> result;
+      for (size_t i = 0; i < n; i++) {
+        if (collision::overlap(&boxes[6 * i], box)) { result.push_back(uint32_t(i)); }
+      }
+      return result;
+    };
+    auto check = [&](auto& structure) {
+      bool ok = true;
+      for (size_t q = 0; q < queries.size() / 6; q++) {
+        std::vector<uint32_t> result;
+        structure.query(&queries[6 * q], [&](uint32_t i) { result.push_back(i); });
+        std::sort(result.begin(), result.end());
+        ok = ok && result == bruteForce(&queries[6 * q]);
+      }
+      return ok;
+    };
+
+    collision::Bvh bvh;
+    bvh.build(boxes);
+    CHECK(check(bvh));
+    thread_pool::setNumThreads(3);
+    collision::Bvh bvh3;
+    bvh3.build(boxes);
+    CHECK(bvh3.children_ == bvh.children_);
+    CHECK(bvh3.order_ == bvh.order_);
+    CHECK(std::is_sorted(bvh3.codes_.begin(), bvh3.codes_.end()));
+
+    // Refit after moving boxes (same hierarchy)
+    for (auto& x : boxes) { x += 0.1f * rng.uniform(); }
+    for (size_t i = 0; i < n; i++) {
+      for (size_t k = 0; k < 3; k++) {
+        if (boxes[6 * i + k] > boxes[6 * i + k + 3]) { std::swap(boxes[6 * i + k], boxes[6 * i + k + 3]); }
+      }
+    }
+    bvh3.refit(boxes);
+    CHECK(check(bvh3));
+    thread_pool::setNumThreads(num_threads_default);
+
+    // Nearest box
+    bool ok = true;
+    for (size_t q = 0; q < 100; q++) {
+      vec3 p{rng.uniform(), rng.uniform(), rng.uniform()};
+      float best2 = INFINITY;
+      auto result = bvh3.nearest(p, best2, [&](uint32_t i) { return collision::distance2(&boxes[6 * i], p); });
+      float expected = INFINITY;
+      for (size_t i = 0; i < n; i++) { expected = std::min(expected, collision::distance2(&boxes[6 * i], p)); }
+      ok = ok && result != collision::kNone && best2 == expected;
+    }
+    CHECK(ok);
+
+    collision::SpatialHash hash;
+    hash.build(boxes, 0.05f);
+    CHECK(check(hash));
+    hash.build(boxes, 0.013f);
+    CHECK(check(hash));
+  }
+
+  // Two unit cubes where the second one is shifted by `offset`
+  std::vector<float> verts1;
+  std::vector<uint32_t> c3xc01;
+  makeTetrahedralizedCubeSymmetric(2, verts1, c3xc01);
+  size_t nV1 = verts1.size() / 3;
+  auto makeTwoCubes = [&](vec3 offset, Matrix<float>& verts, std::vector<uint32_t>& c3xc0) {
+    verts.resize(2 * nV1, 3);
+    for (size_t i = 0; i < nV1; i++) {
+      for (size_t k = 0; k < 3; k++) {
+        verts(i, k) = verts1[3 * i + k];
+        verts(nV1 + i, k) = verts1[3 * i + k] + offset[k];
+      }
+    }
+    c3xc0 = c3xc01;
+    for (auto v : c3xc01) { c3xc0.push_back(uint32_t(v + nV1)); }
+  };
+
+  SECTION("Collision") {
+    Matrix<float> verts;
+    std::vector<uint32_t> c3xc0;
+    makeTwoCubes({0.31f, 0.87f, 0.23f}, verts, c3xc0);
+    collision::Collision collision;
+    collision.init(verts, c3xc0);
+    CHECK(collision.surface_.size() == 3 * 2 * (6 * 2 * 16)); // 6 sides x 2 triangles x 4 x 4 quads
+    CHECK(collision.surface_verts_.size() == 2 * (125 - 27));
+
+    // Outward orientation (total signed volume by divergence theorem)
+    double volume = 0;
+    for (size_t s = 0; s < collision.surface_.size() / 3; s++) {
+      auto vs = &collision.surface_[3 * s];
+      vec3 a{verts(vs[0], 0), verts(vs[0], 1), verts(vs[0], 2)};
+      vec3 b{verts(vs[1], 0), verts(vs[1], 1), verts(vs[1], 2)};
+      vec3 c{verts(vs[2], 0), verts(vs[2], 1), verts(vs[2], 2)};
+      volume += glm::dot(a, glm::cross(b, c)) / 6;
+    }
+    CHECK(closeTo(float(volume), 2.0f));
+
+    // Vertices (or points) strictly inside the other cube
+    auto insideOther = [&](size_t v, vec3 x, float margin) {
+      vec3 lo = v < nV1 ? vec3{0.31f, 0.87f, 0.23f} : vec3{0, 0, 0};
+      bool result = true;
+      for (size_t k = 0; k < 3; k++) { result = result && lo[k] + margin < x[k] && x[k] < lo[k] + 1 - margin; }
+      return result;
+    };
+    auto inside = [&](size_t v) { return insideOther(v, {verts(v, 0), verts(v, 1), verts(v, 2)}, 0); };
+    size_t num_inside = 0;
+    for (size_t v = 0; v < 2 * nV1; v++) { num_inside += inside(v); }
+    REQUIRE(num_inside > 0);
+    collision.detect(verts);
+    CHECK(collision.num_penetrations_ == num_inside);
+    bool ok = true;
+    for (size_t i = 0; i < collision.contact_verts_.size(); i++) {
+      size_t v = collision.contact_verts_[i];
+      ok = ok && (!inside(v) || (v < nV1) != (collision.surface_[3 * collision.contact_tris_[i]] < nV1));
+    }
+    CHECK(ok);
+    collision.project(verts);
+
+    // Projected targets are outside of the other cube by thickness
+    ok = true;
+    for (size_t i = 0; i < collision.contact_verts_.size(); i++) {
+      size_t v = collision.contact_verts_[i];
+      vec3 y{collision.contact_targets_(i, 0), collision.contact_targets_(i, 1), collision.contact_targets_(i, 2)};
+      ok = ok && !insideOther(v, y, -0.99f * collision.thickness_);
+    }
+    CHECK(ok);
+
+    // Proximity (within thickness) gives the same contacts by Bvh, rebuilt Bvh and SpatialHash
+    makeTwoCubes({0.31f, 1.005f, 0.23f}, verts, c3xc0);
+    collision.detect(verts);
+    CHECK(collision.num_penetrations_ == 0);
+    CHECK(collision.contact_verts_.size() == 2 * 12); // 4 x 3 vertices of each face over the other
+    auto contact_verts = collision.contact_verts_;
+    auto contact_tris = collision.contact_tris_;
+    for (auto [use_hash, rebuild] : {std::pair{true, false}, {false, true}}) {
+      collision::Collision other;
+      other.use_hash_ = use_hash;
+      other.rebuild_ = rebuild;
+      other.init(verts, c3xc0);
+      other.detect(verts);
+      CHECK(other.contact_verts_ == contact_verts);
+      CHECK(other.contact_tris_ == contact_tris);
+    }
+  }
+
+  SECTION("Collision (number of threads)") {
+    // Finer overlapping cubes so that each worker handles many penetrating vertices at the same time
+    std::vector<float> verts16;
+    std::vector<uint32_t> c3xc016;
+    makeTetrahedralizedCubeSymmetric(16, verts16, c3xc016);
+    size_t nV16 = verts16.size() / 3;
+    Matrix<float> verts{2 * nV16, 3};
+    std::vector<uint32_t> c3xc0 = c3xc016;
+    vec3 offset{0.31f, 0.87f, 0.23f};
+    for (size_t i = 0; i < nV16; i++) {
+      for (size_t k = 0; k < 3; k++) {
+        verts(i, k) = verts16[3 * i + k];
+        verts(nV16 + i, k) = verts16[3 * i + k] + offset[k];
+      }
+    }
+    for (auto v : c3xc016) { c3xc0.push_back(uint32_t(v + nV16)); }
+
+    auto detect = [&](size_t num_threads) {
+      thread_pool::setNumThreads(num_threads);
+      collision::Collision collision;
+      collision.thickness_ = 0.05f;
+      collision.init(verts, c3xc0);
+      collision.detect(verts);
+      return std::tuple{collision.contact_verts_, collision.contact_tris_, collision.contact_bary_};
+    };
+    auto expected = detect(1);
+    REQUIRE(std::get<0>(expected).size() > 1000);
+    bool ok = true;
+    for (size_t trial = 0; trial < 10; trial++) { ok = ok && detect(8) == expected; }
+    CHECK(ok);
+    thread_pool::setNumThreads(num_threads_default);
+  }
+
+  SECTION("ProjectiveDynamics") {
+    // Cube falling on pinned cube (pinned by all vertices)
+    Matrix<float> verts;
+    std::vector<uint32_t> c3xc0;
+    makeTwoCubes({0, 1.1f, 0}, verts, c3xc0);
+    auto simulate = [&](float contact_stiffness) {
+      physics::ProjectiveDynamics solver{2 * nV1, c3xc0.size() / 4, nV1};
+      solver.verts_ = verts;
+      solver.c3xc0_ = c3xc0;
+      for (size_t i = 0; i < nV1; i++) {
+        solver.handles_[i] = uint32_t(i);
+        for (size_t k = 0; k < 3; k++) { solver.handle_targets_(i, k) = verts(i, k); }
+      }
+      solver.g_ = 1; // velocity changes by g per frame (as Example02), i.e. slow enough not to pass through
+      solver.contact_stiffness_ = contact_stiffness;
+      REQUIRE(solver.init(1 << 5));
+      for (size_t frame = 0; frame < 60; frame++) { solver.update(); }
+      // Lowest vertex above the pinned cube (resting cube may slide sideways since nothing holds it) and mean height
+      float y_min = INFINITY;
+      float y_mean = 0;
+      for (size_t i = nV1; i < 2 * nV1; i++) {
+        float x = solver.verts_(i, 0), y = solver.verts_(i, 1), z = solver.verts_(i, 2);
+        if (0 < x && x < 1 && 0 < z && z < 1) { y_min = std::min(y_min, y); }
+        y_mean += y / nV1;
+      }
+      return std::make_pair(y_min, y_mean);
+    };
+    CHECK(simulate(0).second < 0.5f);
+    auto [y_min, y_mean] = simulate(1 << 12);
+    CHECK(y_min > 0.97f);
+    CHECK(y_min < 1.05f);
+    CHECK(y_mean > 1.4f);
+  }
+}
+
+TEST_CASE("trace") {
+  auto count = [](const std::string& json, const std::string& pattern) {
+    size_t result = 0;
+    for (size_t p = json.find(pattern); p != std::string::npos; p = json.find(pattern, p + 1)) { result++; }
+    return result;
+  };
+  trace::clear();
+
+  SECTION("disabled") {
+    trace::enable(false);
+    {
+      trace::Zone zone{"disabled"};
+      trace::counter("disabled", 1);
+    }
+    CHECK(trace::size() == 0);
+  }
+
+  SECTION("zones and counters") {
+    trace::enable(true);
+    {
+      trace::Zone outer{"outer"};
+      for (size_t i = 0; i < 3; i++) {
+        trace::Zone inner{"inner"};
+        trace::counter("value", double(i));
+      }
+    }
+    trace::enable(false);
+    CHECK(trace::size() == 7);
+    std::string json = trace::toJSON();
+    CHECK(json.rfind("{\"displayTimeUnit\":\"ms\",\"traceEvents\":[", 0) == 0);
+    CHECK(count(json, "\"name\":\"outer\",\"ph\":\"X\"") == 1);
+    CHECK(count(json, "\"name\":\"inner\",\"ph\":\"X\"") == 3);
+    CHECK(count(json, "\"name\":\"value\",\"ph\":\"C\"") == 3);
+    CHECK(count(json, "\"args\":{\"value\":2}") == 1);
+    CHECK(count(json, "{") == count(json, "}"));
+
+    // Names are escaped
+    trace::enable(true);
+    trace::counter(trace::intern("a \"quoted\" name"), 0);
+    trace::enable(false);
+    CHECK(count(trace::toJSON(), "a \\\"quoted\\\" name") == 1);
+    CHECK(trace::intern("a \"quoted\" name") == trace::intern(std::string{"a \"quoted\" name"}));
+
+    // Long name is written as it is
+    std::string long_name(1000, 'x');
+    trace::enable(true);
+    trace::counter(trace::intern(long_name), 1);
+    trace::enable(false);
+    json = trace::toJSON();
+    CHECK(count(json, "{\"name\":\"" + long_name + "\",\"ph\":\"C\"") == 1);
+    CHECK(count(json, "{") == count(json, "}"));
+    CHECK(json.compare(json.size() - 3, 3, "]}\n") == 0);
+  }
+
+  SECTION("buffers of exited threads are reused") {
+    trace::enable(true);
+    auto record = []() { trace::counter("thread", 1); };
+    std::thread{record}.join();
+    size_t num_buffers = trace::registry().buffers_.size();
+    for (auto i = 0; i < 8; i++) { std::thread{record}.join(); }
+    trace::enable(false);
+    CHECK(trace::registry().buffers_.size() == num_buffers);
+    CHECK(count(trace::toJSON(), "\"name\":\"thread\",\"ph\":\"C\"") == 9);
+  }
+
+  SECTION("ring buffer keeps latest events") {
+    trace::enable(true);
+    for (size_t i = 0; i < trace::kCapacity + 10; i++) { trace::counter("ring", double(i)); }
+    trace::enable(false);
+    CHECK(trace::size() == trace::kCapacity);
+    std::string json = trace::toJSON();
+    CHECK(count(json, "\"args\":{\"value\":9}") == 0);
+    CHECK(count(json, "\"args\":{\"value\":10}") == 1);
+  }
+
+#if defined(USE_TRACE)
+  SECTION("ProjectiveDynamics frame across threads") {
+    std::vector<float> verts;
+    std::vector<uint32_t> c3xc0;
+    makeTetrahedralizedCubeSymmetric(3, verts, c3xc0);
+    physics::ProjectiveDynamics solver{verts.size() / 3, c3xc0.size() / 4, 1};
+    solver.verts_.data_ = verts;
+    solver.c3xc0_ = c3xc0;
+    solver.handles_[0] = 0;
+    REQUIRE(solver.init(1 << 5));
+    auto num_threads_default = thread_pool::getNumThreads();
+    thread_pool::setNumThreads(3);
+    trace::clear();
+    trace::enable(true);
+    solver.update();
+    trace::enable(false);
+    thread_pool::setNumThreads(num_threads_default);
+    std::string json = trace::toJSON();
+    CHECK(count(json, "\"name\":\"ProjectiveDynamics::update\"") == 1);
+    CHECK(count(json, "\"name\":\"ProjectiveDynamics::projectStrain\"") == size_t(solver.iterPD_));
+    CHECK(count(json, "\"name\":\"ProjectiveDynamics::solveGlobal\"") == size_t(solver.iterPD_));
+    CHECK(count(json, "\"name\":\"cholesky::Cholesky::solve\"") == size_t(solver.iterPD_));
+    CHECK(count(json, "\"name\":\"thread_pool::chunk\"") > 0);
+
+    // Written file is the same JSON
+    std::string path = "trace-test.json";
+    REQUIRE(trace::write(path));
+    std::string data;
+    {
+      FILE* file = std::fopen(path.c_str(), "rb");
+      REQUIRE(file);
+      char buffer[4096];
+      size_t n;
+      while ((n = std::fread(buffer, 1, sizeof(buffer), file)) > 0) { data.append(buffer, n); }
+      std::fclose(file);
+    }
+    CHECK(data == json);
+    std::remove(path.c_str());
+  }
+#endif
+  trace::clear();
+}
+
+TEST_CASE("perf") {
+  SECTION("counters") {
+    // Events may be unavailable (e.g. container without PMU) but available ones must count the region
+    perf::Counters counters;
+    bool available = counters.init();
+    counters.reset();
+    volatile float sink = 0;
+    {
+      perf::Scope scope{counters};
+      for (int i = 0; i < 1 << 20; i++) { sink = sink + 1; }
+    }
+    auto sample = counters.read();
+    for (int k = 0; k < perf::kNumEvents; k++) {
+      CHECK(sample.has(perf::Event(k)) == counters.available(perf::Event(k)));
+      if (sample.has(perf::Event(k))) { CHECK(sample[perf::Event(k)] >= 0); }
+    }
+    if (counters.available(perf::kTaskClock)) { CHECK(sample[perf::kTaskClock] > 0); }
+    if (counters.available(perf::kInstructions)) { CHECK(sample[perf::kInstructions] > (1 << 20)); }
+
+    // Not counted outside of region
+    counters.reset();
+    for (int i = 0; i < 1 << 20; i++) { sink = sink + 1; }
+    sample = counters.read();
+    if (counters.available(perf::kInstructions)) { CHECK(sample[perf::kInstructions] < (1 << 20)); }
+
+    // No event after close
+    counters.close();
+    CHECK(!counters.available());
+    counters.reset();
+    CHECK(!counters.read().has(perf::kTaskClock));
+    CHECK((available || !counters.init()));
+  }
+
+  SECTION("report") {
+    perf::Machine machine{100e9, 10e9}; // balance 10 Flop/B
+    CHECK(machine.balance() == 10);
+
+    // Nominal counts only (intensity 1 Flop/B attains 10 GFlop/s, achieved 5 GFlop/s)
+    perf::Sample sample;
+    auto r = perf::Report::compute(sample, 2e-7, 1000, 1000, machine);
+    CHECK(std::isnan(r.ipc));
+    CHECK(!r.measured_flops);
+    CHECK(!r.measured_bytes);
+    CHECK(r.bytes_per_flop == 1);
+    CHECK(r.memory_bound);
+    CHECK(closeTo(r.attainable / 10e9, 1));
+    CHECK(closeTo(r.efficiency, 0.5f));
+    CHECK(r.toString() == "1.000 B/Flop (nominal), memory-bound 50% of roofline");
+
+    // Measured events take precedence (640 bytes from cache misses, 25600 flops from 256-bit single)
+    sample.values_[perf::kCycles] = 1000;
+    sample.values_[perf::kInstructions] = 2500;
+    sample.values_[perf::kCacheReferences] = 100;
+    sample.values_[perf::kCacheMisses] = 10;
+    sample.values_[perf::kBranches] = 200;
+    sample.values_[perf::kBranchMisses] = 1;
+    sample.values_[perf::kFlopsScalar] = 0;
+    sample.values_[perf::kFlops256] = 25600;
+    r = perf::Report::compute(sample, 1e-6, 1000, 1000, machine);
+    CHECK(r.ipc == 2.5);
+    CHECK(r.cache_miss_rate == 0.1);
+    CHECK(r.branch_miss_rate == 0.005);
+    CHECK(r.flops == 25600);
+    CHECK(r.bytes == 640);
+    CHECK(!r.memory_bound);
+    CHECK(closeTo(r.efficiency, 0.256f));
+    CHECK(r.toString() == "IPC 2.50, cache-miss 10.0%, branch-miss 0.50%, 0.025 B/Flop (measured), compute-bound 26% of roofline");
+
+    // Without nominal counts nor FLOP events
+    r = perf::Report::compute(perf::Sample{}, 1e-6, 0, 0, machine);
+    CHECK(std::isnan(r.bytes_per_flop));
+    CHECK(std::isnan(r.efficiency));
+    CHECK(r.toString().empty());
+  }
+
+  SECTION("calibration") {
+    CHECK(perf::measurePeakFlops(1 << 12) > 0);
+    CHECK(perf::measurePeakBandwidth(1 << 20) > 0);
+  }
+}
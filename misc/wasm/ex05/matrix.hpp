@@ -0,0 +1,618 @@
+#pragma once
+
+//
+// Dense/CSR matrix (moved from ex01.cpp so that it can be used natively)
+//   - Matrix<T>::matmul_ is dense GEMM (cf. gemm.hpp)
+//   - MatrixCSR<T>::matmul_ is SpMV/SpMM parallelized over rows split by nnz
+//   - MatrixCSR<T> construction (fromCOO, transpose, matmulCsr, stack*, etc...) mirrors
+//     MatrixCSR in src/utils/array.js so that solver setup can run natively
+//   - `matmul(a, b, pool)` variants take the result buffer from arena::BufferPool
+//     (give it back by `pool.release(std::move(c.data_))`) to avoid allocation in steady state
+//
+
+#include <algorithm>
+#include <cassert>
+#include <vector>
+#include <array>
+#include <type_traits>
+#include <utility>
+#include "arena.hpp"
+#include "gemm.hpp"
+#include "thread_pool.hpp"
+#if defined(USE_DISPATCH)
+#include "dispatch.hpp"
+#endif
+
+template<typename T>
+struct Matrix {
+  std::array<size_t, 2> shape_;
+  std::vector<T> data_;
+
+  Matrix() : Matrix(0, 0) {}
+
+  Matrix(size_t shape0, size_t shape1) {
+    resize(shape0, shape1);
+  }
+
+  // Take `data` as storage (e.g. from arena::BufferPool)
+  Matrix(size_t shape0, size_t shape1, std::vector<T>&& data) : shape_{shape0, shape1}, data_{std::move(data)} {
+    data_.resize(shape_[0] * shape_[1]);
+  }
+
+  void resize(size_t shape0, size_t shape1) {
+    shape_ = { shape0, shape1 };
+    data_.resize(shape_[0] * shape_[1]);
+  }
+
+  T& operator()(size_t i, size_t j) {
+    return data_.data()[shape_[1] * i + j];
+  }
+
+  const T& operator()(size_t i, size_t j) const {
+    return data_.data()[shape_[1] * i + j];
+  }
+
+  static Matrix<T> matmul(const Matrix<T>& a, const Matrix<T>& b) {
+    Matrix<T> c{a.shape_[0], b.shape_[1]};
+    matmul_(a, b, c);
+    return c;
+  }
+
+  static Matrix<T> matmul(const Matrix<T>& a, const Matrix<T>& b, arena::BufferPool<T>& pool) {
+    Matrix<T> c{a.shape_[0], b.shape_[1], pool.acquire(a.shape_[0] * b.shape_[1])};
+    matmul_(a, b, c);
+    return c;
+  }
+
+  // c = a b
+  static void matmul_(const Matrix<T>& a, const Matrix<T>& b, Matrix<T>& c) {
+    gemm(T(1), a, b, T(0), c);
+  }
+
+  // c = alpha a b + beta c (cf. gemm.hpp)
+  static void gemm(T alpha, const Matrix<T>& a, const Matrix<T>& b, T beta, Matrix<T>& c) {
+    assert(c.shape_[0] == a.shape_[0]);
+    assert(a.shape_[1] == b.shape_[0]);
+    assert(b.shape_[1] == c.shape_[1]);
+    gemm::gemm(
+        a.shape_[0], b.shape_[1], a.shape_[1],
+        alpha, a.data_.data(), a.shape_[1], b.data_.data(), b.shape_[1],
+        beta, c.data_.data(), c.shape_[1]);
+  }
+
+  // Naive version (kept for testing/benchmark)
+  static void matmulNaive_(const Matrix<T>& a, const Matrix<T>& b, Matrix<T>& c) {
+    assert(c.shape_[0] == a.shape_[0]);
+    assert(a.shape_[1] == b.shape_[0]);
+    assert(b.shape_[1] == c.shape_[1]);
+    for (size_t i = 0; i < a.shape_[0]; i++) {
+      for (size_t j = 0; j < b.shape_[1]; j++) {
+        c(i, j) = 0;
+        for (size_t k = 0; k < a.shape_[1]; k++) {
+          c(i, j) += a(i, k) * b(k, j);
+        }
+      }
+    }
+  }
+
+  // b = a in another scalar type (e.g. float <-> double for mixed precision, cf. refinement.hpp)
+  template<typename U>
+  static void cast_(const Matrix<U>& a, Matrix<T>& b) {
+    if (b.shape_ != a.shape_) { b.resize(a.shape_[0], a.shape_[1]); }
+    std::copy(a.data_.begin(), a.data_.end(), b.data_.begin());
+  }
+};
+
+template<typename T>
+struct MatrixCSR {
+  static constexpr size_t kIndexEnd = ~size_t(0);
+
+  size_t shape_[2];
+  std::vector<size_t> indptr_;
+  std::vector<size_t> indices_;
+  std::vector<T> data_;
+
+  MatrixCSR() : MatrixCSR(0, 0, 0) {}
+
+  MatrixCSR(size_t shape0, size_t shape1, size_t nnz)
+    : shape_{shape0, shape1} {
+    indptr_.resize(shape0 + 1);
+    indices_.resize(nnz);
+    data_.resize(nnz);
+  }
+
+  size_t nnz() const { return indptr_[shape_[0]]; }
+
+  // Same pattern with values in another scalar type
+  template<typename U>
+  static MatrixCSR<T> cast(const MatrixCSR<U>& A) {
+    MatrixCSR<T> result;
+    result.shape_[0] = A.shape_[0];
+    result.shape_[1] = A.shape_[1];
+    result.indptr_ = A.indptr_;
+    result.indices_ = A.indices_;
+    result.data_.assign(A.data_.begin(), A.data_.end());
+    return result;
+  }
+
+  //
+  // Construction
+  //
+
+  // Sort indices within each row and sum duplicates (in place)
+  void sumDuplicates() {
+    size_t n = shape_[0];
+    auto& pool = thread_pool::getDefault();
+
+    // Sort and squash each row in its own range (`counts[i]` = new nnz of row i)
+    std::vector<size_t> counts(n);
+    pool.parallelFor(0, n, 0, [&](size_t i0, size_t i1) {
+      std::vector<std::pair<size_t, T>> row;
+      for (size_t i = i0; i < i1; i++) {
+        size_t p0 = indptr_[i], p1 = indptr_[i + 1];
+        row.clear();
+        for (auto p = p0; p < p1; p++) { row.push_back({indices_[p], data_[p]}); }
+        std::sort(row.begin(), row.end(), [](auto& a, auto& b) { return a.first < b.first; });
+        size_t q = p0;
+        for (auto [j, v] : row) {
+          if (q > p0 && indices_[q - 1] == j) {
+            data_[q - 1] += v;
+            continue;
+          }
+          indices_[q] = j;
+          data_[q] = v;
+          q++;
+        }
+        counts[i] = q - p0;
+      }
+    });
+
+    // Compact
+    size_t q = 0;
+    for (size_t i = 0; i < n; i++) {
+      size_t p0 = indptr_[i];
+      indptr_[i] = q;
+      for (size_t k = 0; k < counts[i]; k++, q++) {
+        indices_[q] = indices_[p0 + k];
+        data_[q] = data_[p0 + k];
+      }
+    }
+    indptr_[n] = q;
+    indices_.resize(q);
+    data_.resize(q);
+  }
+
+  // COO to CSR with duplicate summation (counting sort by row with per-chunk histogram so that scatter runs in parallel)
+  static MatrixCSR<T> fromCOO(
+      size_t shape0, size_t shape1,
+      const std::vector<size_t>& rows, const std::vector<size_t>& cols, const std::vector<T>& values) {
+    assert(rows.size() == cols.size() && rows.size() == values.size());
+    size_t nnz = rows.size();
+    auto& pool = thread_pool::getDefault();
+    size_t num_chunks = (nnz < (1 << 16)) ? 1 : pool.size();
+    size_t grain = (nnz + num_chunks - 1) / std::max<size_t>(num_chunks, 1);
+    num_chunks = grain == 0 ? 0 : (nnz + grain - 1) / grain;
+
+    // offsets[c * shape0 + i] = position of chunk c's first entry of row i
+    std::vector<size_t> offsets(num_chunks * shape0, 0);
+    pool.run(num_chunks, [&](size_t c) {
+      for (size_t p = c * grain; p < std::min(nnz, (c + 1) * grain); p++) {
+        assert(rows[p] < shape0 && cols[p] < shape1);
+        offsets[c * shape0 + rows[p]]++;
+      }
+    });
+    MatrixCSR<T> result{shape0, shape1, nnz};
+    size_t q = 0;
+    for (size_t i = 0; i < shape0; i++) {
+      result.indptr_[i] = q;
+      for (size_t c = 0; c < num_chunks; c++) {
+        size_t count = offsets[c * shape0 + i];
+        offsets[c * shape0 + i] = q;
+        q += count;
+      }
+    }
+    result.indptr_[shape0] = q;
+    pool.run(num_chunks, [&](size_t c) {
+      for (size_t p = c * grain; p < std::min(nnz, (c + 1) * grain); p++) {
+        size_t dst = offsets[c * shape0 + rows[p]]++;
+        result.indices_[dst] = cols[p];
+        result.data_[dst] = values[p];
+      }
+    });
+    result.sumDuplicates();
+    return result;
+  }
+
+  static MatrixCSR<T> fromDense(const Matrix<T>& a) {
+    MatrixCSR<T> result{a.shape_[0], a.shape_[1], 0};
+    for (size_t i = 0; i < a.shape_[0]; i++) {
+      for (size_t j = 0; j < a.shape_[1]; j++) {
+        T v = a(i, j);
+        if (v == 0) { continue; }
+        result.indices_.push_back(j);
+        result.data_.push_back(v);
+      }
+      result.indptr_[i + 1] = result.indices_.size();
+    }
+    return result;
+  }
+
+  static MatrixCSR<T> fromDiagonal(const std::vector<T>& diag) {
+    size_t n = diag.size();
+    MatrixCSR<T> result{n, n, n};
+    for (size_t i = 0; i < n; i++) {
+      result.indptr_[i + 1] = i + 1;
+      result.indices_[i] = i;
+      result.data_[i] = diag[i];
+    }
+    return result;
+  }
+
+  // (dim |selector|) x (dim width) matrix selecting `dim` coordinates of each `selector[i]`
+  template<typename Index>
+  static MatrixCSR<T> fromSelector(const std::vector<Index>& selector, size_t width, size_t dim) {
+    size_t shape0 = dim * selector.size();
+    MatrixCSR<T> result{shape0, dim * width, shape0};
+    for (size_t i = 0; i < selector.size(); i++) {
+      assert(size_t(selector[i]) < width);
+      for (size_t k = 0; k < dim; k++) {
+        size_t p = dim * i + k;
+        result.indptr_[p + 1] = p + 1;
+        result.indices_[p] = dim * selector[i] + k;
+        result.data_[p] = 1;
+      }
+    }
+    return result;
+  }
+
+  // Vertical stack [m0; m1; ...]
+  static MatrixCSR<T> stackCsr(const std::vector<MatrixCSR<T>>& ms) {
+    assert(!ms.empty());
+    size_t shape0 = 0, nnz = 0;
+    for (auto& m : ms) {
+      assert(m.shape_[1] == ms[0].shape_[1]);
+      shape0 += m.shape_[0];
+      nnz += m.nnz();
+    }
+    MatrixCSR<T> result{shape0, ms[0].shape_[1], 0};
+    result.indices_.reserve(nnz);
+    result.data_.reserve(nnz);
+    size_t row = 0;
+    for (auto& m : ms) {
+      result.indices_.insert(result.indices_.end(), m.indices_.begin(), m.indices_.begin() + m.nnz());
+      result.data_.insert(result.data_.end(), m.data_.begin(), m.data_.begin() + m.nnz());
+      for (size_t i = 0; i < m.shape_[0]; i++) {
+        result.indptr_[row + i + 1] = result.indptr_[row] + m.indptr_[i + 1];
+      }
+      row += m.shape_[0];
+    }
+    return result;
+  }
+
+  // Block diagonal diag(m0, m1, ...)
+  static MatrixCSR<T> stackDiagonal(const std::vector<MatrixCSR<T>>& ms) {
+    size_t shape0 = 0, shape1 = 0, nnz = 0;
+    for (auto& m : ms) {
+      shape0 += m.shape_[0];
+      shape1 += m.shape_[1];
+      nnz += m.nnz();
+    }
+    MatrixCSR<T> result{shape0, shape1, nnz};
+    size_t row = 0, col = 0, q = 0;
+    for (auto& m : ms) {
+      for (size_t i = 0; i < m.shape_[0]; i++) {
+        for (auto p = m.indptr_[i]; p < m.indptr_[i + 1]; p++, q++) {
+          result.indices_[q] = col + m.indices_[p];
+          result.data_[q] = m.data_[p];
+        }
+        result.indptr_[row + i + 1] = q;
+      }
+      row += m.shape_[0];
+      col += m.shape_[1];
+    }
+    return result;
+  }
+
+  // Counting sort by column (result has sorted indices when input rows are in order)
+  static MatrixCSR<T> transpose(const MatrixCSR<T>& a) {
+    size_t n = a.shape_[0], m = a.shape_[1];
+    size_t nnz = a.nnz();
+    MatrixCSR<T> result{m, n, nnz};
+    for (size_t p = 0; p < nnz; p++) { result.indptr_[a.indices_[p] + 1]++; }
+    for (size_t j = 0; j < m; j++) { result.indptr_[j + 1] += result.indptr_[j]; }
+    std::vector<size_t> offsets(result.indptr_.begin(), result.indptr_.end() - 1);
+    for (size_t i = 0; i < n; i++) {
+      for (auto p = a.indptr_[i]; p < a.indptr_[i + 1]; p++) {
+        size_t q = offsets[a.indices_[p]]++;
+        result.indices_[q] = i;
+        result.data_[q] = a.data_[p];
+      }
+    }
+    return result;
+  }
+
+  // c = alpha a + beta b (sorted indices assumed)
+  static MatrixCSR<T> add(const MatrixCSR<T>& a, const MatrixCSR<T>& b, T alpha = 1, T beta = 1) {
+    assert(a.shape_[0] == b.shape_[0] && a.shape_[1] == b.shape_[1]);
+    size_t n = a.shape_[0];
+    MatrixCSR<T> result{n, a.shape_[1], 0};
+    result.indices_.reserve(a.nnz() + b.nnz());
+    result.data_.reserve(a.nnz() + b.nnz());
+    for (size_t i = 0; i < n; i++) {
+      auto pa = a.indptr_[i], pa1 = a.indptr_[i + 1];
+      auto pb = b.indptr_[i], pb1 = b.indptr_[i + 1];
+      while (pa < pa1 || pb < pb1) {
+        size_t ja = pa < pa1 ? a.indices_[pa] : kIndexEnd;
+        size_t jb = pb < pb1 ? b.indices_[pb] : kIndexEnd;
+        size_t j = std::min(ja, jb);
+        T v = 0;
+        if (ja == j) { v += alpha * a.data_[pa++]; }
+        if (jb == j) { v += beta * b.data_[pb++]; }
+        result.indices_.push_back(j);
+        result.data_.push_back(v);
+      }
+      result.indptr_[i + 1] = result.indices_.size();
+    }
+    return result;
+  }
+
+  // c = a b (Gustavson's algorithm with symbolic pass to size c and numeric pass to fill it, both parallel over rows)
+  static MatrixCSR<T> matmulCsr(const MatrixCSR<T>& a, const MatrixCSR<T>& b) {
+    assert(a.shape_[1] == b.shape_[0]);
+    size_t n = a.shape_[0], m = b.shape_[1];
+    auto& pool = thread_pool::getDefault();
+    MatrixCSR<T> result{n, m, 0};
+
+    // Dense workspace of m columns per chunk from the thread's arena, so that repeated calls
+    // (e.g. many small `a` with wide `b` as A S where S is selector) don't allocate once the arena has grown
+    auto getWorkspace = [&](arena::Scope& scope) {
+      auto workspace = scope.allocate<size_t>(m);
+      std::fill_n(workspace, m, kIndexEnd);
+      return workspace;
+    };
+
+    // Symbolic (marker[j] != kIndexEnd iff column j already appeared in the current row)
+    pool.parallelFor(0, n, 0, [&](size_t i0, size_t i1) {
+      arena::Scope scope{arena::threadArena()};
+      auto marker = getWorkspace(scope);
+      for (size_t i = i0; i < i1; i++) {
+        size_t count = 0;
+        for (auto pa = a.indptr_[i]; pa < a.indptr_[i + 1]; pa++) {
+          size_t k = a.indices_[pa];
+          for (auto pb = b.indptr_[k]; pb < b.indptr_[k + 1]; pb++) {
+            size_t j = b.indices_[pb];
+            if (marker[j] != kIndexEnd) { continue; }
+            marker[j] = 0;
+            count++;
+          }
+        }
+        // Reset marker
+        for (auto pa = a.indptr_[i]; pa < a.indptr_[i + 1]; pa++) {
+          size_t k = a.indices_[pa];
+          for (auto pb = b.indptr_[k]; pb < b.indptr_[k + 1]; pb++) {
+            marker[b.indices_[pb]] = kIndexEnd;
+          }
+        }
+        result.indptr_[i + 1] = count;
+      }
+    });
+    for (size_t i = 0; i < n; i++) { result.indptr_[i + 1] += result.indptr_[i]; }
+    result.indices_.resize(result.nnz());
+    result.data_.resize(result.nnz());
+
+    // Numeric (dense accumulator, then sort columns of each row)
+    pool.parallelFor(0, n, 0, [&](size_t i0, size_t i1) {
+      arena::Scope scope{arena::threadArena()};
+      auto position = getWorkspace(scope);
+      size_t max_row = 0;
+      for (size_t i = i0; i < i1; i++) { max_row = std::max(max_row, result.indptr_[i + 1] - result.indptr_[i]); }
+      auto row = scope.allocate<std::pair<size_t, T>>(max_row);
+      for (size_t i = i0; i < i1; i++) {
+        size_t q0 = result.indptr_[i];
+        size_t q = q0;
+        for (auto pa = a.indptr_[i]; pa < a.indptr_[i + 1]; pa++) {
+          size_t k = a.indices_[pa];
+          T aik = a.data_[pa];
+          for (auto pb = b.indptr_[k]; pb < b.indptr_[k + 1]; pb++) {
+            size_t j = b.indices_[pb];
+            if (position[j] == kIndexEnd) {
+              position[j] = q;
+              result.indices_[q] = j;
+              result.data_[q] = 0;
+              q++;
+            }
+            result.data_[position[j]] += aik * b.data_[pb];
+          }
+        }
+        for (auto p = q0; p < q; p++) {
+          position[result.indices_[p]] = kIndexEnd;
+          row[p - q0] = {result.indices_[p], result.data_[p]};
+        }
+        std::sort(row, row + (q - q0), [](auto& x, auto& y) { return x.first < y.first; });
+        for (size_t r = 0; r < q - q0; r++) {
+          result.indices_[q0 + r] = row[r].first;
+          result.data_[q0 + r] = row[r].second;
+        }
+      }
+    });
+    return result;
+  }
+
+  // c = a b
+  static Matrix<T> matmul(const MatrixCSR<T>& a, const Matrix<T>& b) {
+    Matrix<T> c{a.shape_[0], b.shape_[1]};
+    matmul_(a, b, c);
+    return c;
+  }
+
+  static Matrix<T> matmul(const MatrixCSR<T>& a, const Matrix<T>& b, arena::BufferPool<T>& pool) {
+    Matrix<T> c{a.shape_[0], b.shape_[1], pool.acquire(a.shape_[0] * b.shape_[1])};
+    matmul_(a, b, c);
+    return c;
+  }
+
+  // y = A x
+  static void matmul_(const MatrixCSR<T>& A, const Matrix<T>& x, Matrix<T>& y) {
+    spmm<false>(A, x, y);
+  }
+
+  // y += A x
+  static void matmulAdd_(const MatrixCSR<T>& A, const Matrix<T>& x, Matrix<T>& y) {
+    spmm<true>(A, x, y);
+  }
+
+  // Naive version (accumulates into y, kept for testing/benchmark)
+  static void matmulNaive_(const MatrixCSR<T>& A, const Matrix<T>& x, Matrix<T>& y) {
+    assert(y.shape_[0] == A.shape_[0]);
+    assert(A.shape_[1] == x.shape_[0]);
+    assert(x.shape_[1] == y.shape_[1]);
+    size_t p = 0;
+    for (size_t i = 0; i < A.shape_[0]; i++) { // Loop A row
+      for (; p < A.indptr_[i + 1]; p++) { // Loop A col
+        size_t j = A.indices_[p];
+        T Aij = A.data_[p];
+        for (size_t k = 0; k < x.shape_[1]; k++) { // Loop x col
+          y(i, k) += Aij * x(j, k);
+        }
+      }
+    }
+  }
+
+  // Split rows into `num_parts` ranges with roughly equal nnz (returns num_parts + 1 row offsets)
+  static std::vector<size_t> partitionRows(const MatrixCSR<T>& A, size_t num_parts) {
+    return partitionRows(A.indptr_.data(), A.shape_[0], num_parts);
+  }
+
+  static std::vector<size_t> partitionRows(const size_t* indptr, size_t n, size_t num_parts) {
+    std::vector<size_t> result(num_parts + 1);
+    partitionRows(indptr, n, num_parts, result.data());
+    return result;
+  }
+
+  // Same into `result` of size num_parts + 1
+  static void partitionRows(const size_t* indptr, size_t n, size_t num_parts, size_t* result) {
+    size_t nnz = indptr[n];
+    result[0] = 0;
+    for (size_t k = 1; k < num_parts; k++) {
+      // First row whose start offset reaches k-th share of nnz (weighted by 1 per row to handle empty rows)
+      size_t target = (nnz + n) * k / num_parts;
+      size_t lo = result[k - 1], hi = n;
+      while (lo < hi) {
+        size_t mid = (lo + hi) / 2;
+        if (indptr[mid] + mid < target) { lo = mid + 1; } else { hi = mid; }
+      }
+      result[k] = lo;
+    }
+    result[num_parts] = n;
+  }
+
+  // Rows [i0, i1) of y (+)= A x with `NC` columns known at compile time (NC = 0 for runtime `nc`)
+  template<bool kAccumulate, size_t NC>
+  static void spmmRows(const size_t* indptr, const size_t* indices, const T* data,
+                       const T* x, T* y, size_t nc, size_t i0, size_t i1) {
+    if constexpr (NC > 0) {
+      // Accumulate the row in registers
+      for (size_t i = i0; i < i1; i++) {
+        T acc[NC];
+        for (size_t k = 0; k < NC; k++) { acc[k] = kAccumulate ? y[i * NC + k] : T(0); }
+        for (auto p = indptr[i]; p < indptr[i + 1]; p++) {
+          auto xj = x + indices[p] * NC;
+          T Aij = data[p];
+          for (size_t k = 0; k < NC; k++) { acc[k] += Aij * xj[k]; }
+        }
+        for (size_t k = 0; k < NC; k++) { y[i * NC + k] = acc[k]; }
+      }
+    } else {
+      // SIMD across columns (accumulate each L columns of the row in register)
+      using V = typename simd::Vec<T>::type;
+      constexpr size_t L = simd::Vec<T>::kSize;
+      size_t nc_simd = nc - nc % L;
+      for (size_t i = i0; i < i1; i++) {
+        auto yi = y + i * nc;
+        size_t p0 = indptr[i], p1 = indptr[i + 1];
+        for (size_t k = 0; k < nc_simd; k += L) {
+          V acc = kAccumulate ? simd::load<V>(yi + k) : simd::broadcast<V>(T(0));
+          for (auto p = p0; p < p1; p++) {
+            acc += simd::broadcast<V>(data[p]) * simd::load<V>(x + indices[p] * nc + k);
+          }
+          simd::store(yi + k, acc);
+        }
+        for (size_t k = nc_simd; k < nc; k++) {
+          T acc = kAccumulate ? yi[k] : T(0);
+          for (auto p = p0; p < p1; p++) {
+            acc += data[p] * x[indices[p] * nc + k];
+          }
+          yi[k] = acc;
+        }
+      }
+    }
+  }
+
+  // Row partitioned (by nnz) parallel SpMV/SpMM
+  template<bool kAccumulate>
+  static void spmm(const MatrixCSR<T>& A, const Matrix<T>& x, Matrix<T>& y) {
+    assert(y.shape_[0] == A.shape_[0]);
+    assert(A.shape_[1] == x.shape_[0]);
+    assert(x.shape_[1] == y.shape_[1]);
+    spmm<kAccumulate>(A.shape_[0], A.indptr_.data(), A.indices_.data(), A.data_.data(),
+                      x.data_.data(), y.data_.data(), x.shape_[1]);
+  }
+
+  // Same on raw arrays (e.g. for kernels compiled per instruction set, cf. dispatch.hpp)
+  template<bool kAccumulate>
+  static void spmm(size_t n, const size_t* indptr, const size_t* indices, const T* data,
+                   const T* x, T* y, size_t nc) {
+#if defined(DISPATCH_ROUTE)
+    if constexpr (std::is_same_v<T, float>) {
+      dispatch::kernels().spmm(n, indptr, indices, data, x, y, nc, kAccumulate);
+      return;
+    }
+#endif
+    auto kernel = [&](size_t i0, size_t i1) {
+      switch (nc) {
+        case 1: spmmRows<kAccumulate, 1>(indptr, indices, data, x, y, nc, i0, i1); break;
+        case 2: spmmRows<kAccumulate, 2>(indptr, indices, data, x, y, nc, i0, i1); break;
+        case 3: spmmRows<kAccumulate, 3>(indptr, indices, data, x, y, nc, i0, i1); break;
+        case 4: spmmRows<kAccumulate, 4>(indptr, indices, data, x, y, nc, i0, i1); break;
+        default: spmmRows<kAccumulate, 0>(indptr, indices, data, x, y, nc, i0, i1); break;
+      }
+    };
+
+    // Small problem runs serially
+    auto& pool = thread_pool::getDefault();
+    if (pool.size() == 1 || indptr[n] * nc < (1 << 15)) {
+      kernel(0, n);
+      return;
+    }
+    size_t num_parts = 4 * pool.size();
+    arena::Scope scope{arena::threadArena()};
+    auto parts = scope.allocate<size_t>(num_parts + 1);
+    partitionRows(indptr, n, num_parts, parts);
+    pool.run(num_parts, [&](size_t k) { kernel(parts[k], parts[k + 1]); });
+  }
+
+  // A x = b (cf. gauss_seidel.hpp for parallel version)
+  static void stepGaussSeidel(const MatrixCSR<T>& A, Matrix<T>& x, const Matrix<T>& b) {
+    for (size_t i = 0; i < A.shape_[0]; i++) { // Loop A row
+      T diag = 0;
+      for (auto p = A.indptr_[i]; p < A.indptr_[i + 1]; p++) {
+        if (A.indices_[p] == i) { diag += A.data_[p]; } // Don't assume indices are unique
+      }
+      for (size_t k = 0; k < x.shape_[1]; k++) { // Loop X col
+        T rhs = b(i, k);
+        for (auto p = A.indptr_[i]; p < A.indptr_[i + 1]; p++) { // Loop A col
+          size_t j = A.indices_[p];
+          if (j == i) { continue; }
+          rhs -= A.data_[p] * x(j, k);
+        }
+        x(i, k) = rhs / diag;
+      }
+    }
+  }
+
+  static void gaussSeidel(const MatrixCSR<T>& A, Matrix<T>& x, const Matrix<T>& b, int iteration) {
+    for (auto i = 0; i < iteration; i++) {
+      stepGaussSeidel(A, x, b);
+    }
+  }
+};
@@ -1,7 +1,16 @@
 #pragma once
 
+#include <cassert>
 #include <vector>
+#include <algorithm>
+#include <cmath>
+#include <limits>
 #include <glm/glm.hpp>
+#include "simd.hpp"
+#include "thread_pool.hpp"
+#if defined(USE_DISPATCH)
+#include "dispatch.hpp"
+#endif
 
 namespace misc {
 
@@ -9,9 +18,21 @@ using std::vector;
 using glm::vec2, glm::mat2, glm::vec3, glm::mat3, glm::uvec3;
 static_assert(sizeof(vec3) == 3 * 4, "Make sure `vec3 = float32 x 3`");
 
+//
+// Scalar path is templated on scalar type (e.g. glm::mat3 or glm::dmat3)
+//   - Thresholds are relative to machine epsilon of T, so that double converges to double precision
+//     instead of stopping at the absolute thresholds which are meaningless in float.
+//   - Rotation (co, si) is computed from sin(2t) on the side where it doesn't cancel,
+//     otherwise Q and the rotated entries disagree by ~sqrt(epsilon) (cf. "jacobi3" test).
+//
+
+template<typename T>
+constexpr T kEpsilon = std::numeric_limits<T>::epsilon();
+
+template<typename T>
 void _jacobi2(
-    float a, float b, float d,
-    float& a_next, float& d_next, float& co, float& si) {
+    T a, T b, T d,
+    T& a_next, T& d_next, T& co, T& si) {
   //
   // QT A Q : diagonal
   //
@@ -23,43 +44,58 @@ void _jacobi2(
   // <=> | cos(2t) |  parallel to | (a - d)/2 |
   //     | sin(2t) |              |    b      |
   //
-  using glm::sqrt, glm::sign;
-  float x = 0.5 * (a - d); // | x | parallel to | cos(2t) |
-  float y = b;             // | y |             | sin(2t) |
-  float l2 = x * x + y * y;
-  float l = sqrt(l2);
+  using std::sqrt, std::abs;
+  T x = T(0.5) * (a - d); // | x | parallel to | cos(2t) |
+  T y = b;                // | y |             | sin(2t) |
+  T l = sqrt(x * x + y * y);
   // NOTE: we assume b != 0 thus l != 0
-  float cos2t = x / l; // cos(2t)
-  float sin2t = y / l; // sin(2t)
-  float co2 = 0.5 * (cos2t + 1);
-  float si2 = 0.5 * (1 - cos2t);
-  a_next = a * co2 + d * si2 + b * sin2t; // a cos(t)^2 + d sin(t)^2 + 2 b cos(t) sin(t)
-  d_next = a * si2 + d * co2 - b * sin2t; // a sin(t)^2 + d cos(t)^2 - 2 b cos(t) sin(t)
-  co = sqrt(co2);
-  si = sign(b) * sqrt(si2); // sign(sin2t) = sign(y) = sign(b)
+  T cos2t = x / l; // cos(2t)
+  T sin2t = y / l; // sin(2t)
+  // a cos(t)^2 + d sin(t)^2 + 2 b cos(t) sin(t) = (a + d) / 2 + l (similarly for d_next)
+  a_next = T(0.5) * (a + d) + l;
+  d_next = T(0.5) * (a + d) - l;
+  // 2 co si = sin2t (sign(sin2t) = sign(y) = sign(b) and co >= 0)
+  if (cos2t >= 0) {
+    co = sqrt(T(0.5) * (1 + cos2t));
+    si = sin2t / (2 * co);
+  } else {
+    si = sqrt(T(0.5) * (1 - cos2t));
+    co = abs(sin2t) / (2 * si);
+    si = b < 0 ? -si : si;
+  }
 }
 
-void jacobi2(const mat2& A, vec2& U, vec2& D) {
+template<typename T>
+void jacobi2(const glm::mat<2, 2, T>& A, glm::vec<2, T>& U, glm::vec<2, T>& D) {
   _jacobi2(A[0][0], A[1][0], A[1][1], D[0], D[1], U[0], U[1]);
 }
 
-void jacobi3_step(float& a, float& b, float& d, float& e, float& f,vec3& q0, vec3& q1) {
-  float co, si;
+template<typename T>
+void jacobi3_step(T& a, T& b, T& d, T& e, T& f, glm::vec<3, T>& q0, glm::vec<3, T>& q1) {
+  T co, si;
   _jacobi2(a, b, d, a, d, co, si);
   b = 0;
-  float _e = e;
-  float _f = f;
+  T _e = e;
+  T _f = f;
   e = co * _e + si * _f;
   f = - si * _e + co * _f;
-  vec3 _q0 = q0;
-  vec3 _q1 = q1;
+  glm::vec<3, T> _q0 = q0;
+  glm::vec<3, T> _q1 = q1;
   q0 = co * _q0 + si * _q1;
   q1 = - si * _q0 + co * _q1;
 }
 
-void jacobi3(mat3& A, mat3& Q) {
-  using glm::abs;
-  Q = mat3(1.0);
+// Off-diagonal `b` is negligible against diagonals `a` and `d`
+template<typename T>
+bool isNegligible(T b, T a, T d) {
+  using std::abs;
+  return abs(b) <= kEpsilon<T> * (abs(a) + abs(d)) || abs(b) < std::numeric_limits<T>::min();
+}
+
+template<typename T>
+void jacobi3(glm::mat<3, 3, T>& A, glm::mat<3, 3, T>& Q) {
+  using std::abs;
+  Q = glm::mat<3, 3, T>(1.0);
 
   //
   // Manupulate only these 6 entries of symmetric A
@@ -68,7 +104,7 @@ void jacobi3(mat3& A, mat3& Q) {
   //   20    22
   //
 
-  // Loop fixed amount
+  // Loop at most fixed amount
   int N = 20;
   for (auto i = 0; i < N; i++) {
     //
@@ -84,62 +120,71 @@ void jacobi3(mat3& A, mat3& Q) {
     if (a01 < a12) {
       if (a12 < a20) {
         // A[2][0]
-        if (a20 < 1e-14) { break; }
+        if (isNegligible(a20, A[2][2], A[0][0])) { break; }
         jacobi3_step(A[2][2], A[2][0], A[0][0], A[1][2], A[0][1], Q[2], Q[0]);
         continue;
       }
       // A[1][2]
-      if (a12 < 1e-14) { break; }
+      if (isNegligible(a12, A[1][1], A[2][2])) { break; }
       jacobi3_step(A[1][1], A[1][2], A[2][2], A[0][1], A[2][0], Q[1], Q[2]);
       continue;
     }
 
     if (a01 < a20) {
       // A[2][0]
-      if (a20 < 1e-14) { break; }
+      if (isNegligible(a20, A[2][2], A[0][0])) { break; }
       jacobi3_step(A[2][2], A[2][0], A[0][0], A[1][2], A[0][1], Q[2], Q[0]);
       continue;
     }
 
     // A[0][1]
-    if (a01 < 1e-14) { break; }
+    if (isNegligible(a01, A[0][0], A[1][1])) { break; }
     jacobi3_step(A[0][0], A[0][1], A[1][1], A[2][0], A[1][2], Q[0], Q[1]);
   }
 }
 
-mat3 outer(const vec3& u, const vec3& v) {
-  return mat3(
+template<typename T>
+glm::mat<3, 3, T> outer(const glm::vec<3, T>& u, const glm::vec<3, T>& v) {
+  return glm::mat<3, 3, T>(
     u[0] * v[0], u[1] * v[0], u[2] * v[0],
     u[0] * v[1], u[1] * v[1], u[2] * v[1],
     u[0] * v[2], u[1] * v[2], u[2] * v[2]);
 }
 
-mat3 outer2(const vec3& u) {
+template<typename T>
+glm::mat<3, 3, T> outer2(const glm::vec<3, T>& u) {
   return outer(u, u);
 }
 
-void householderQR(const mat3& A, mat3& Q, mat3& R) {
-  using glm::abs, glm::length, glm::normalize;
+template<typename T>
+void householderQR(const glm::mat<3, 3, T>& A, glm::mat<3, 3, T>& Q, glm::mat<3, 3, T>& R) {
+  using std::abs, glm::length, glm::normalize;
+  using mat3T = glm::mat<3, 3, T>;
+  using vec3T = glm::vec<3, T>;
+  using vec2T = glm::vec<2, T>;
 
-  mat3 QT = mat3(1);
+  mat3T QT = mat3T(1);
   R = A;
 
+  // Skip reflection when the entries to eliminate are negligible against the column
+  T tol = kEpsilon<T> * length(A[0]);
+
   // 1st column
-  if (!(abs(R[0][1]) < 1e-7 && abs(R[0][2]) < 1e-7)) {
-    float l = length(R[0]);
-    vec3 h = normalize(R[0] - vec3(l, 0, 0));
-    mat3 H = mat3(1.0f) - 2.0f * outer2(h); // I - 2 h hT
+  if (!(abs(R[0][1]) <= tol && abs(R[0][2]) <= tol)) {
+    T l = length(R[0]);
+    vec3T h = normalize(R[0] - vec3T(l, 0, 0));
+    mat3T H = mat3T(1) - T(2) * outer2(h); // I - 2 h hT
     R = H * R;
     QT = H * QT;
   }
 
   // 2nd column
-  if (!(abs(R[1][2]) < 1e-7)) {
-    vec2 v = vec2(R[1][1], R[1][2]);
-    float l = length(v);
-    vec2 h = normalize(v - vec2(l, 0));
+  if (!(abs(R[1][2]) <= tol)) {
+    vec2T v = vec2T(R[1][1], R[1][2]);
+    T l = length(v);
+    vec2T h = normalize(v - vec2T(l, 0));
     // I - 2 h h^T
-    mat3 H = mat3(
+    mat3T H = mat3T(
       1, 0, 0,
       0, 1 - 2 * h[0] * h[0], - 2 * h[0] * h[1],
       0, - 2 * h[0] * h[1], 1 - 2 * h[1] * h[1]);
@@ -150,11 +195,13 @@ void householderQR(const mat3& A, mat3& Q, mat3& R) {
   Q = glm::transpose(QT);
 }
 
-mat3 permutation(const mat3& A, const uvec3& S) {
-  return mat3(A[S[0]], A[S[1]], A[S[2]]);
+template<typename T>
+glm::mat<3, 3, T> permutation(const glm::mat<3, 3, T>& A, const uvec3& S) {
+  return glm::mat<3, 3, T>(A[S[0]], A[S[1]], A[S[2]]);
 }
 
-uvec3 _sort(float l0, float l1, float l2) {
+template<typename T>
+uvec3 _sort(T l0, T l1, T l2) {
   // 3-elements insertion sort
   // [0, (1), 2]
   if (l1 > l0) {
@@ -179,7 +226,8 @@ uvec3 _sort(float l0, float l1, float l2) {
   return {0, 1, 2};
 }
 
-void sort(const mat3& A, uvec3& S, mat3& AS) {
+template<typename T>
+void sort(const glm::mat<3, 3, T>& A, uvec3& S, glm::mat<3, 3, T>& AS) {
   using glm::length;
   S = _sort(length(A[0]), length(A[1]), length(A[2]));
   AS = permutation(A, S);
@@ -191,57 +239,489 @@ void sort(const mat3& A, uvec3& S, mat3& AS) {
 //   3. C = B S (where S: permutation s.t. C's colume vectors have decreasing length)
 //   4. C = Q R = Q D (cf. QR decomposition where R turns out to be diagonal)
 //   5. A = Q D (P S)T
-void svd(const mat3& A, mat3& U, mat3& VT, vec3& D) {
+template<typename T>
+void svd(const glm::mat<3, 3, T>& A, glm::mat<3, 3, T>& U, glm::mat<3, 3, T>& VT, glm::vec<3, T>& D) {
   using glm::transpose;
+  using mat3T = glm::mat<3, 3, T>;
 
   // 1.
-  mat3 AT_A = transpose(A) * A;
-  mat3 P;
+  mat3T AT_A = transpose(A) * A;
+  mat3T P;
   jacobi3(/* inout */ AT_A, /* out */ P);
 
   // 2. 3.
-  mat3 B = A * P;
-  mat3 C;
+  mat3T B = A * P;
+  mat3T C;
   uvec3 S;
   sort(B, /* out */ S, C);
 
   // 4.
-  mat3 Q;
-  mat3 R;
+  mat3T Q;
+  mat3T R;
   householderQR(C, /* out */ Q, R);
 
   // 5.
   U = Q;
-  D = vec3(R[0][0], R[1][1], R[2][2]);
+  D = glm::vec<3, T>(R[0][0], R[1][1], R[2][2]);
   VT = transpose(permutation(P, S));
 }
 
-mat3 svdProjection(const mat3& A, const mat3& B) {
+template<typename T>
+glm::mat<3, 3, T> svdProjection(const glm::mat<3, 3, T>& A, const glm::mat<3, 3, T>& B) {
   using glm::transpose, glm::determinant;
-  mat3 B_AT = B * transpose(A);
-  mat3 U, VT;
-  vec3 D;
+  using mat3T = glm::mat<3, 3, T>;
+  mat3T B_AT = B * transpose(A);
+  mat3T U, VT;
+  glm::vec<3, T> D;
   svd(B_AT, U, VT, D);
-  mat3 E = mat3(
+  mat3T E = mat3T(
     1, 0, 0,
     0, 1, 0,
     0, 0, determinant(U) * determinant(VT));
-  mat3 U_E_VT = U * E * VT;
+  mat3T U_E_VT = U * E * VT;
   return U_E_VT;
 }
 
-void solve(const vector<float>& u1, const vector<float>& u2, vector<float>& result) {
+//
+// Batched svdProjection
+//   - simd::kWidth matrices are processed at once in structure-of-arrays layout (mat3v)
+//   - Same steps as `svd` but without data dependent branches:
+//     1. Jacobi with cyclic sweeps (instead of "largest off-diagonal" pivoting) until all lanes converge
+//     2. Sort by conditional swaps
+//     3. QR by Givens rotations (instead of Householder reflections)
+//
+
+using simd::floatv, simd::intv;
+
+// mat3v::m[col][row][lane] (cf. glm's column major)
+struct mat3v {
+  floatv m[3][3];
+};
+
+void load(const float* ptr, size_t num_lanes, mat3v& A) {
+  for (auto c = 0; c < 3; c++) {
+    for (auto r = 0; r < 3; r++) {
+      for (size_t k = 0; k < simd::kWidth; k++) {
+        // Pad with identity
+        A.m[c][r][k] = (k < num_lanes) ? ptr[9 * k + 3 * c + r] : (c == r ? 1 : 0);
+      }
+    }
+  }
+}
+
+void store(const mat3v& A, size_t num_lanes, float* ptr) {
+  for (size_t k = 0; k < num_lanes; k++) {
+    for (auto c = 0; c < 3; c++) {
+      for (auto r = 0; r < 3; r++) {
+        ptr[9 * k + 3 * c + r] = A.m[c][r][k];
+      }
+    }
+  }
+}
+
+// B AT
+mat3v matmulTransposed(const mat3v& B, const mat3v& A) {
+  mat3v C;
+  for (auto c = 0; c < 3; c++) {
+    for (auto r = 0; r < 3; r++) {
+      C.m[c][r] = B.m[0][r] * A.m[0][c] + B.m[1][r] * A.m[1][c] + B.m[2][r] * A.m[2][c];
+    }
+  }
+  return C;
+}
+
+// A B
+mat3v matmul(const mat3v& A, const mat3v& B) {
+  mat3v C;
+  for (auto c = 0; c < 3; c++) {
+    for (auto r = 0; r < 3; r++) {
+      C.m[c][r] = A.m[0][r] * B.m[c][0] + A.m[1][r] * B.m[c][1] + A.m[2][r] * B.m[c][2];
+    }
+  }
+  return C;
+}
+
+// Same as `jacobi3_step` except rotation angle choice and skipping rotation (co = 1, si = 0) for lanes with b ~ 0
+void jacobi3_stepv(floatv& a, floatv& b, floatv& d, floatv& e, floatv& f, floatv* q0, floatv* q1) {
+  intv active = simd::abs(b) > simd::splat(1e-14);
+  floatv x = simd::select(active, 0.5f * (a - d), simd::splat(1));
+  floatv y = simd::select(active, b, simd::splat(0));
+  floatv l = simd::sqrt(x * x + y * y);
+  // Choose |t| <= pi / 4 so that cyclic sweeps don't keep swapping diagonal entries
+  floatv cos2t = simd::abs(x) / l;
+  floatv sin2t = simd::select(x < 0, -y / l, y / l);
+  floatv co2 = 0.5f * (cos2t + 1);
+  floatv si2 = 0.5f * (1 - cos2t);
+  floatv co = simd::sqrt(co2);
+  floatv si = sin2t / (2 * co); // co >= cos(pi / 4) thus no cancellation (cf. `_jacobi2`)
+  floatv _a = a;
+  floatv _d = d;
+  a = _a * co2 + _d * si2 + y * sin2t;
+  d = _a * si2 + _d * co2 - y * sin2t;
+  b = simd::select(active, simd::splat(0), b);
+  floatv _e = e;
+  floatv _f = f;
+  e = co * _e + si * _f;
+  f = - si * _e + co * _f;
+  for (auto r = 0; r < 3; r++) {
+    floatv _q0 = q0[r];
+    floatv _q1 = q1[r];
+    q0[r] = co * _q0 + si * _q1;
+    q1[r] = - si * _q0 + co * _q1;
+  }
+}
+
+// True when off-diagonal entries of symmetric A are negligible relative to diagonal in every lane
+bool isDiagonalv(const mat3v& A) {
+  auto& m = A.m;
+  floatv off2 = m[0][1] * m[0][1] + m[1][2] * m[1][2] + m[2][0] * m[2][0];
+  floatv diag2 = m[0][0] * m[0][0] + m[1][1] * m[1][1] + m[2][2] * m[2][2];
+  return simd::all(off2 <= (kEpsilon<float> * kEpsilon<float>) * diag2);
+}
+
+// A : symmetric (inout), Q : orthogonal (out)
+// Sweeps stop early once every lane has converged (e.g. nearly diagonal A takes a single sweep)
+void jacobi3v(mat3v& A, mat3v& Q) {
+  for (auto c = 0; c < 3; c++) {
+    for (auto r = 0; r < 3; r++) {
+      Q.m[c][r] = simd::splat(c == r ? 1 : 0);
+    }
+  }
+
+  // Cyclic sweeps (cf. `jacobi3` for the choice of entries)
+  int N = 4;
+  for (auto i = 0; i < N; i++) {
+    jacobi3_stepv(A.m[0][0], A.m[0][1], A.m[1][1], A.m[2][0], A.m[1][2], Q.m[0], Q.m[1]);
+    jacobi3_stepv(A.m[1][1], A.m[1][2], A.m[2][2], A.m[0][1], A.m[2][0], Q.m[1], Q.m[2]);
+    jacobi3_stepv(A.m[2][2], A.m[2][0], A.m[0][0], A.m[1][2], A.m[0][1], Q.m[2], Q.m[0]);
+    if (isDiagonalv(A)) { break; }
+  }
+}
+
+// Swap columns (i, j) of A and P for lanes where |A[j]| > |A[i]|
+void sortStepv(mat3v& A, mat3v& P, floatv* l2, int i, int j) {
+  intv mask = l2[j] > l2[i];
+  for (auto r = 0; r < 3; r++) {
+    floatv ai = A.m[i][r];
+    floatv pi = P.m[i][r];
+    A.m[i][r] = simd::select(mask, A.m[j][r], ai);
+    A.m[j][r] = simd::select(mask, ai, A.m[j][r]);
+    P.m[i][r] = simd::select(mask, P.m[j][r], pi);
+    P.m[j][r] = simd::select(mask, pi, P.m[j][r]);
+  }
+  floatv li = l2[i];
+  l2[i] = simd::select(mask, l2[j], li);
+  l2[j] = simd::select(mask, li, l2[j]);
+}
+
+// Sort columns of A by decreasing length while applying the same permutation to P
+void sortv(mat3v& A, mat3v& P) {
+  floatv l2[3];
+  for (auto c = 0; c < 3; c++) {
+    l2[c] = A.m[c][0] * A.m[c][0] + A.m[c][1] * A.m[c][1] + A.m[c][2] * A.m[c][2];
+  }
+  sortStepv(A, P, l2, 0, 1);
+  sortStepv(A, P, l2, 0, 2);
+  sortStepv(A, P, l2, 1, 2);
+}
+
+// Givens rotation of rows (i, j) zeroing R[i][j] (i.e. column i, row j)
+void givensStepv(mat3v& R, mat3v& QT, int i, int j) {
+  floatv a1 = R.m[i][i];
+  floatv a2 = R.m[i][j];
+  floatv l = simd::sqrt(a1 * a1 + a2 * a2);
+  intv active = l > simd::splat(1e-14);
+  floatv co = simd::select(active, a1 / l, simd::splat(1));
+  floatv si = simd::select(active, a2 / l, simd::splat(0));
+  for (auto c = 0; c < 3; c++) {
+    floatv ri = R.m[c][i];
+    floatv rj = R.m[c][j];
+    R.m[c][i] = co * ri + si * rj;
+    R.m[c][j] = - si * ri + co * rj;
+    floatv qi = QT.m[c][i];
+    floatv qj = QT.m[c][j];
+    QT.m[c][i] = co * qi + si * qj;
+    QT.m[c][j] = - si * qi + co * qj;
+  }
+}
+
+// A = Q R where det(Q) = 1 (only Q is returned)
+void givensQRv(const mat3v& A, mat3v& Q) {
+  mat3v R = A;
+  mat3v QT;
+  for (auto c = 0; c < 3; c++) {
+    for (auto r = 0; r < 3; r++) {
+      QT.m[c][r] = simd::splat(c == r ? 1 : 0);
+    }
+  }
+  givensStepv(R, QT, 0, 1);
+  givensStepv(R, QT, 0, 2);
+  givensStepv(R, QT, 1, 2);
+  for (auto c = 0; c < 3; c++) {
+    for (auto r = 0; r < 3; r++) {
+      Q.m[c][r] = QT.m[r][c];
+    }
+  }
+}
+
+floatv determinantv(const mat3v& A) {
+  auto& m = A.m;
+  return
+    m[0][0] * (m[1][1] * m[2][2] - m[2][1] * m[1][2]) -
+    m[1][0] * (m[0][1] * m[2][2] - m[2][1] * m[0][2]) +
+    m[2][0] * (m[0][1] * m[1][2] - m[1][1] * m[0][2]);
+}
+
+// Same as `svdProjection` for simd::kWidth matrices
+mat3v svdProjectionv(const mat3v& A, const mat3v& B) {
+  // 1. (B AT)T (B AT) = P W PT
+  mat3v B_AT = matmulTransposed(B, A);
+  mat3v W;
+  for (auto c = 0; c < 3; c++) {
+    for (auto r = 0; r < 3; r++) {
+      W.m[c][r] = B_AT.m[r][0] * B_AT.m[c][0] + B_AT.m[r][1] * B_AT.m[c][1] + B_AT.m[r][2] * B_AT.m[c][2];
+    }
+  }
+  mat3v P;
+  jacobi3v(/* inout */ W, /* out */ P);
+
+  // 2. 3. C = (B AT) P S
+  mat3v C = matmul(B_AT, P);
+  sortv(/* inout */ C, P);
+
+  // 4. C = U R
+  mat3v U;
+  givensQRv(C, /* out */ U);
+
+  // 5. U E VT where V = P S, E = diag(1, 1, det(U) det(V)) and det(U) = 1
+  floatv e2 = determinantv(P);
+  mat3v result;
+  for (auto c = 0; c < 3; c++) {
+    for (auto r = 0; r < 3; r++) {
+      result.m[c][r] = U.m[0][r] * P.m[0][c] + U.m[1][r] * P.m[1][c] + e2 * U.m[2][r] * P.m[2][c];
+    }
+  }
+  return result;
+}
+
+//
+// Polar decomposition by quaternion (cf. "A Robust Method to Extract the Rotational Part of Deformations" [Muller et al. 2016])
+//   - Finds rotation R(q) maximizing tr(RT M), which is what `svdProjection` returns for M = B AT,
+//     by rotating R around omega = sum_i r_i x m_i (r_i, m_i : columns) each iteration.
+//   - Step is Newton's (quadratic convergence) once it is within ~1 rad from the maximum
+//     and exact line search along omega otherwise, both without trigonometric functions.
+//   - `q` (x, y, z, w) is updated in place so that it can be warm-started from the previous call
+//     (e.g. between PD iterations or frames, 1 iteration is enough). Without warm start (q = identity),
+//     2 iterations reach float precision for small rotations and ~6 for arbitrary rotations.
+//     Inverted or nearly degenerate M (whose maximum is flat) can take many more iterations.
+//   - ~200 flops per iteration (+ ~100 for B AT and `polarStart`) compared to ~1000 of `svdProjectionv`.
+//   - Written for both float and floatv (V) with M[col][row] as mat3v.
+//
+
+// R[col][row] of unit quaternion
+template<typename V>
+void quatToMat(const V q[4], V R[3][3]) {
+  V x = q[0], y = q[1], z = q[2], w = q[3];
+  V xx = x * x, yy = y * y, zz = z * z;
+  V xy = x * y, yz = y * z, zx = z * x;
+  V xw = x * w, yw = y * w, zw = z * w;
+  R[0][0] = 1.0f - 2.0f * (yy + zz); R[0][1] = 2.0f * (xy + zw);        R[0][2] = 2.0f * (zx - yw);
+  R[1][0] = 2.0f * (xy - zw);        R[1][1] = 1.0f - 2.0f * (zz + xx); R[1][2] = 2.0f * (yz + xw);
+  R[2][0] = 2.0f * (zx + yw);        R[2][1] = 2.0f * (yz - xw);        R[2][2] = 1.0f - 2.0f * (xx + yy);
+}
+
+// Returns squared rotation angle of the step (i.e. 4 sin^2(angle / 2))
+template<typename V>
+V polarStep(const V M[3][3], V q[4]) {
+  V R[3][3];
+  quatToMat(q, R);
+
+  // N = M RT, omega = sum_i r_i x m_i (i.e. N - NT = [omega]x) and tr(N) = sum_i r_i . m_i
+  V N[3][3]; // N[col][row]
+  for (auto c = 0; c < 3; c++) {
+    for (auto r = 0; r < 3; r++) {
+      N[c][r] = M[0][r] * R[0][c] + M[1][r] * R[1][c] + M[2][r] * R[2][c];
+    }
+  }
+  V o[3] = {N[1][2] - N[2][1], N[2][0] - N[0][2], N[0][1] - N[1][0]};
+  V t = N[0][0] + N[1][1] + N[2][2];
+
+  // Newton step theta = H^-1 omega for tr(exp([theta]x) N) where H = tr(N) I - sym(N)
+  V h00 = t - N[0][0], h11 = t - N[1][1], h22 = t - N[2][2];
+  V h01 = -0.5f * (N[0][1] + N[1][0]), h02 = -0.5f * (N[0][2] + N[2][0]), h12 = -0.5f * (N[1][2] + N[2][1]);
+  V c00 = h11 * h22 - h12 * h12, c01 = h02 * h12 - h01 * h22, c02 = h01 * h12 - h02 * h11;
+  V c11 = h00 * h22 - h02 * h02, c12 = h01 * h02 - h00 * h12, c22 = h00 * h11 - h01 * h01;
+  V det = h00 * c00 + h01 * c01 + h02 * c02;
+  V s_newton = 0.5f / simd::select(det > 0.0f, det, V{} + 1.0f);
+  V newton[3] = {
+    s_newton * (c00 * o[0] + c01 * o[1] + c02 * o[2]),
+    s_newton * (c01 * o[0] + c11 * o[1] + c12 * o[2]),
+    s_newton * (c02 * o[0] + c12 * o[1] + c22 * o[2])};
+
+  // When H is not positive definite (i.e. far from maximum), exact line search along u = omega / |omega|
+  // where tr(exp(phi [u]x) N) = |omega| sin(phi) + (tr(N) - uT N u) cos(phi) + const
+  V o2 = o[0] * o[0] + o[1] * o[1] + o[2] * o[2] + 1e-30f;
+  V uNu = (h00 * o[0] * o[0] + h11 * o[1] * o[1] + h22 * o[2] * o[2]
+           + 2.0f * (h01 * o[0] * o[1] + h02 * o[0] * o[2] + h12 * o[1] * o[2])) / o2; // = tr(N) - uT N u
+  V o_len = simd::sqrt(o2);
+  V cos_phi = uNu / simd::sqrt(o2 + uNu * uNu);
+  V half_sin = simd::sqrt(simd::abs(0.5f - 0.5f * cos_phi)) / o_len; // sin(phi / 2) / |omega|
+  V half_cos = simd::sqrt(simd::abs(0.5f + 0.5f * cos_phi));       // cos(phi / 2)
+
+  // q' = normalize(dq q) where dq = (theta / 2, 1) for Newton or (sin(phi / 2) u, cos(phi / 2))
+  V newton2 = newton[0] * newton[0] + newton[1] * newton[1] + newton[2] * newton[2];
+  auto use_newton = (h00 > 0.0f) & (c22 > 0.0f) & (det > 0.0f) & (newton2 < 0.25f);
+  V dw = simd::select(use_newton, V{} + 1.0f, half_cos);
+  V dv[3];
+  for (auto k = 0; k < 3; k++) { dv[k] = simd::select(use_newton, newton[k], half_sin * o[k]); }
+  V q0[4] = {q[0], q[1], q[2], q[3]};
+  q[0] = dw * q0[0] + q0[3] * dv[0] + dv[1] * q0[2] - dv[2] * q0[1];
+  q[1] = dw * q0[1] + q0[3] * dv[1] + dv[2] * q0[0] - dv[0] * q0[2];
+  q[2] = dw * q0[2] + q0[3] * dv[2] + dv[0] * q0[1] - dv[1] * q0[0];
+  q[3] = dw * q0[3] - (dv[0] * q0[0] + dv[1] * q0[1] + dv[2] * q0[2]);
+  V l = 1.0f / simd::sqrt(q[0] * q[0] + q[1] * q[1] + q[2] * q[2] + q[3] * q[3]);
+  for (auto k = 0; k < 4; k++) { q[k] *= l; }
+  V dv2 = dv[0] * dv[0] + dv[1] * dv[1] + dv[2] * dv[2];
+  return 4.0f * dv2 / (dw * dw + dv2);
+}
+
+// Replace q with identity or half turn around x, y or z axis when one of them is better (i.e. larger tr(RT M)),
+// so that iterations start within 120 degrees from the maximum even without warm start
+template<typename V>
+void polarStart(const V M[3][3], V q[4]) {
+  V R[3][3];
+  quatToMat(q, R);
+  V f = {};
+  for (auto c = 0; c < 3; c++) {
+    for (auto r = 0; r < 3; r++) { f += M[c][r] * R[c][r]; }
+  }
+  V d0 = M[0][0], d1 = M[1][1], d2 = M[2][2];
+  V fs[4] = {d0 - d1 - d2, d1 - d2 - d0, d2 - d0 - d1, d0 + d1 + d2}; // q = (1, 0, 0, 0), ..., (0, 0, 0, 1)
+  for (auto k = 0; k < 4; k++) {
+    auto better = fs[k] > f;
+    f = simd::select(better, fs[k], f);
+    for (auto j = 0; j < 4; j++) {
+      q[j] = simd::select(better, V{} + (j == k ? 1.0f : 0.0f), q[j]);
+    }
+  }
+}
+
+// `polarStart` and then polar steps until the last step rotates less than `tolerance` (radian) in every lane
+// or `iter_lim` steps. Returns the number of steps.
+template<typename V>
+int polarIterate(const V M[3][3], V q[4], int iter_lim, float tolerance) {
+  polarStart(M, q);
+  float tolerance2 = tolerance * tolerance;
+  int i = 0;
+  while (i < iter_lim) {
+    V angle2 = polarStep(M, q);
+    i++;
+    if (simd::all(angle2 < tolerance2)) { break; }
+  }
+  return i;
+}
+
+// Same as `svdProjection` by at most `iteration` polar steps from `q` (cf. `polarIterate` for `tolerance`)
+inline mat3 polarProjection(const mat3& A, const mat3& B, glm::vec4& q, int iteration, float tolerance = 0) {
+  mat3 M = B * glm::transpose(A);
+  float Ms[3][3], qs[4] = {q[0], q[1], q[2], q[3]};
+  for (auto c = 0; c < 3; c++) {
+    for (auto r = 0; r < 3; r++) { Ms[c][r] = M[c][r]; }
+  }
+  polarIterate(Ms, qs, iteration, tolerance);
+  q = glm::vec4(qs[0], qs[1], qs[2], qs[3]);
+  float R[3][3];
+  quatToMat(qs, R);
+  return mat3(R[0][0], R[0][1], R[0][2], R[1][0], R[1][1], R[1][2], R[2][0], R[2][1], R[2][2]);
+}
+
+// Same as `svdProjectionv` by polar steps (q[4] is quaternion per lane)
+inline mat3v polarProjectionv(const mat3v& A, const mat3v& B, floatv q[4], int iteration, float tolerance = 0) {
+  mat3v M = matmulTransposed(B, A);
+  polarIterate(M.m, q, iteration, tolerance);
+  mat3v result;
+  quatToMat(q, result.m);
+  return result;
+}
+
+// Scalar path in float or double (e.g. reference for the batched `solve`)
+template<typename T>
+void solveScalar(const vector<T>& u1, const vector<T>& u2, vector<T>& result) {
+  using mat3T = glm::mat<3, 3, T>;
+  static_assert(sizeof(mat3T) == 9 * sizeof(T));
   size_t n = u1.size();
   assert((n % 9 == 0));
   assert(u2.size() == n);
   assert(result.size() == n);
 
   for (size_t i = 0; i < n; i += 9) {
-    auto A = reinterpret_cast<const mat3*>(&*(u1.begin() + i));
-    auto B = reinterpret_cast<const mat3*>(&*(u2.begin() + i));
-    auto PT = reinterpret_cast<mat3*>(&*(result.begin() + i));
+    auto A = reinterpret_cast<const mat3T*>(&*(u1.begin() + i));
+    auto B = reinterpret_cast<const mat3T*>(&*(u2.begin() + i));
+    auto PT = reinterpret_cast<mat3T*>(&*(result.begin() + i));
     *PT = svdProjection(*A, *B);
   }
 }
 
+void solve(const vector<float>& u1, const vector<float>& u2, vector<float>& result) {
+#if defined(DISPATCH_ROUTE)
+  dispatch::kernels().solve(u1, u2, result);
+  return;
+#endif
+  size_t n = u1.size();
+  assert((n % 9 == 0));
+  assert(u2.size() == n);
+  assert(result.size() == n);
+
+  // Parallelize over blocks of simd::kWidth matrices
+  size_t stride = 9 * simd::kWidth;
+  size_t num_blocks = (n + stride - 1) / stride;
+  thread_pool::getDefault().parallelFor(0, num_blocks, 64, [&](size_t b_begin, size_t b_end) {
+    for (size_t b = b_begin; b < b_end; b++) {
+      size_t i = b * stride;
+      size_t num_lanes = std::min<size_t>(simd::kWidth, (n - i) / 9);
+      mat3v A, B;
+      load(u1.data() + i, num_lanes, A);
+      load(u2.data() + i, num_lanes, B);
+      mat3v PT = svdProjectionv(A, B);
+      store(PT, num_lanes, result.data() + i);
+    }
+  });
+}
+
+// Same as `solve` by polar decomposition where `q` (4 floats per matrix, e.g. (0, 0, 0, 1) initially)
+// is the starting rotation and receives the result.
+// With `tolerance > 0`, each block of simd::kWidth matrices stops as soon as all of its rotations have converged,
+// thus warm start from the previous call (e.g. PD iteration or frame) usually takes a single step.
+inline void solvePolar(
+    const vector<float>& u1, const vector<float>& u2, vector<float>& q, vector<float>& result,
+    int iteration, float tolerance) {
+  size_t n = u1.size();
+  assert((n % 9 == 0));
+  assert(u2.size() == n);
+  assert(result.size() == n);
+  assert(q.size() == 4 * (n / 9));
+
+  size_t stride = 9 * simd::kWidth;
+  size_t num_blocks = (n + stride - 1) / stride;
+  thread_pool::getDefault().parallelFor(0, num_blocks, 64, [&](size_t b_begin, size_t b_end) {
+    for (size_t b = b_begin; b < b_end; b++) {
+      size_t i = b * stride;
+      size_t num_lanes = std::min<size_t>(simd::kWidth, (n - i) / 9);
+      auto qb = q.data() + 4 * (i / 9);
+      mat3v A = {}, B = {};
+      load(u1.data() + i, num_lanes, A);
+      load(u2.data() + i, num_lanes, B);
+      floatv qv[4] = {};
+      for (size_t k = 0; k < simd::kWidth; k++) {
+        for (auto j = 0; j < 4; j++) { qv[j][k] = (k < num_lanes) ? qb[4 * k + j] : (j == 3 ? 1 : 0); }
+      }
+      mat3v PT = polarProjectionv(A, B, qv, iteration, tolerance);
+      for (size_t k = 0; k < num_lanes; k++) {
+        for (auto j = 0; j < 4; j++) { qb[4 * k + j] = qv[j][k]; }
+      }
+      store(PT, num_lanes, result.data() + i);
+    }
+  });
+}
+
 } // namespace misc
@@ -0,0 +1,305 @@
+#pragma once
+
+//
+// Preconditioned conjugate gradient for symmetric positive definite MatrixCSR
+// (cf. MatrixCSR.conjugateGradient in src/utils/array.js)
+//
+// - Preconditioner is a template parameter providing `setup(A)` and `apply(r, z)` (z = M^-1 r)
+//   - PreconditionerIdentity : plain CG
+//   - PreconditionerJacobi   : M = diag(A)
+//   - PreconditionerIC0      : M = L LT where L has the pattern of lower triangle of A
+// - Multiple right hand sides (columns of b) are iterated together with separate alpha/beta
+//   and each column stops updating once it has converged.
+// - Stop criterion is relative residual |b - A x| / |b| < residue_lim (for every column).
+//
+
+#include <algorithm>
+#include <cassert>
+#include <cmath>
+#include <vector>
+#include "matrix.hpp"
+#include "trace.hpp"
+
+namespace pcg {
+
+using std::vector;
+
+template<typename T>
+struct PreconditionerIdentity {
+  bool setup(const MatrixCSR<T>&) { return true; }
+
+  void apply(const Matrix<T>& r, Matrix<T>& z) const {
+    z.data_ = r.data_;
+  }
+};
+
+template<typename T>
+struct PreconditionerJacobi {
+  vector<T> inv_diag_;
+
+  // Returns false when some diagonal is not positive
+  bool setup(const MatrixCSR<T>& A) {
+    size_t n = A.shape_[0];
+    inv_diag_.assign(n, 0);
+    bool ok = true;
+    for (size_t i = 0; i < n; i++) {
+      T diag = 0;
+      for (auto p = A.indptr_[i]; p < A.indptr_[i + 1]; p++) {
+        if (A.indices_[p] == i) { diag += A.data_[p]; }
+      }
+      ok = ok && diag > 0;
+      inv_diag_[i] = diag > 0 ? T(1) / diag : T(1);
+    }
+    return ok;
+  }
+
+  void apply(const Matrix<T>& r, Matrix<T>& z) const {
+    size_t nc = r.shape_[1];
+    for (size_t i = 0; i < r.shape_[0]; i++) {
+      for (size_t k = 0; k < nc; k++) {
+        z(i, k) = inv_diag_[i] * r(i, k);
+      }
+    }
+  }
+};
+
+template<typename T>
+struct PreconditionerIC0 {
+  MatrixCSR<T> L_; // lower triangle (sorted, diagonal last in each row)
+  T shift_ = 0;    // diagonal shift used when plain IC(0) breaks down
+
+  // Returns false when factorization breaks down even with diagonal shift
+  bool setup(const MatrixCSR<T>& A) {
+    assert(A.shape_[0] == A.shape_[1]);
+    size_t n = A.shape_[0];
+
+    // Pattern of lower triangle (duplicates are summed)
+    L_ = MatrixCSR<T>(n, n, 0);
+    vector<T> A_diag(n, 0);
+    for (size_t i = 0; i < n; i++) {
+      size_t row_begin = L_.indices_.size();
+      for (auto p = A.indptr_[i]; p < A.indptr_[i + 1]; p++) {
+        size_t j = A.indices_[p];
+        if (j < i) {
+          L_.indices_.push_back(j);
+          L_.data_.push_back(A.data_[p]);
+        }
+        if (j == i) { A_diag[i] += A.data_[p]; }
+      }
+      // Sort and merge
+      vector<std::pair<size_t, T>> row;
+      for (auto p = row_begin; p < L_.indices_.size(); p++) { row.push_back({L_.indices_[p], L_.data_[p]}); }
+      std::sort(row.begin(), row.end(), [](auto& a, auto& b) { return a.first < b.first; });
+      L_.indices_.resize(row_begin);
+      L_.data_.resize(row_begin);
+      for (auto [j, v] : row) {
+        if (L_.indices_.size() > row_begin && L_.indices_.back() == j) {
+          L_.data_.back() += v;
+          continue;
+        }
+        L_.indices_.push_back(j);
+        L_.data_.push_back(v);
+      }
+      L_.indices_.push_back(i);
+      L_.data_.push_back(A_diag[i]);
+      L_.indptr_[i + 1] = L_.indices_.size();
+    }
+    vector<T> A_lower = L_.data_;
+
+    // Retry with increasing diagonal shift (Manteuffel) on breakdown
+    T max_diag = 0;
+    for (auto d : A_diag) { max_diag = std::max(max_diag, std::abs(d)); }
+    shift_ = 0;
+    for (auto attempt = 0; attempt < 8; attempt++) {
+      L_.data_ = A_lower;
+      if (factorize(shift_)) { return true; }
+      shift_ = (shift_ == 0) ? T(1e-3) * max_diag : 4 * shift_;
+    }
+    return false;
+  }
+
+  // In-place row-wise IC(0) : L_ik = (A_ik - sum_{j < k} L_ij L_kj) / L_kk, L_ii = sqrt(A_ii + shift - sum_{j < i} L_ij^2)
+  bool factorize(T shift) {
+    size_t n = L_.shape_[0];
+    for (size_t i = 0; i < n; i++) {
+      size_t p_diag = L_.indptr_[i + 1] - 1;
+      for (auto p = L_.indptr_[i]; p < p_diag; p++) {
+        size_t k = L_.indices_[p];
+        // Sparse dot of rows i and k over columns < k (both sorted)
+        T dot = 0;
+        auto q = L_.indptr_[k];
+        auto q_end = L_.indptr_[k + 1] - 1;
+        for (auto pp = L_.indptr_[i]; pp < p && q < q_end;) {
+          size_t a = L_.indices_[pp];
+          size_t b = L_.indices_[q];
+          if (a == b) { dot += L_.data_[pp++] * L_.data_[q++]; }
+          else if (a < b) { pp++; }
+          else { q++; }
+        }
+        L_.data_[p] = (L_.data_[p] - dot) / L_.data_[q_end];
+      }
+      T d = L_.data_[p_diag] + shift;
+      for (auto p = L_.indptr_[i]; p < p_diag; p++) {
+        d -= L_.data_[p] * L_.data_[p];
+      }
+      if (!(d > 0)) { return false; }
+      L_.data_[p_diag] = std::sqrt(d);
+    }
+    return true;
+  }
+
+  // z = (L LT)^-1 r
+  void apply(const Matrix<T>& r, Matrix<T>& z) const {
+    size_t n = L_.shape_[0];
+    size_t nc = r.shape_[1];
+    z.data_ = r.data_;
+
+    // L y = r
+    for (size_t i = 0; i < n; i++) {
+      size_t p_diag = L_.indptr_[i + 1] - 1;
+      for (auto p = L_.indptr_[i]; p < p_diag; p++) {
+        size_t j = L_.indices_[p];
+        T Lij = L_.data_[p];
+        for (size_t k = 0; k < nc; k++) { z(i, k) -= Lij * z(j, k); }
+      }
+      T inv_d = T(1) / L_.data_[p_diag];
+      for (size_t k = 0; k < nc; k++) { z(i, k) *= inv_d; }
+    }
+
+    // LT z = y
+    for (size_t i = n; i-- > 0;) {
+      size_t p_diag = L_.indptr_[i + 1] - 1;
+      T inv_d = T(1) / L_.data_[p_diag];
+      for (size_t k = 0; k < nc; k++) { z(i, k) *= inv_d; }
+      for (auto p = L_.indptr_[i]; p < p_diag; p++) {
+        size_t j = L_.indices_[p];
+        T Lij = L_.data_[p];
+        for (size_t k = 0; k < nc; k++) { z(j, k) -= Lij * z(i, k); }
+      }
+    }
+  }
+};
+
+template<typename T, typename Preconditioner>
+struct ConjugateGradient {
+  Preconditioner preconditioner_;
+
+  // Workspace (kept across `solve` so that repeated solves don't allocate)
+  Matrix<T> r_, z_, p_, Ap_;
+  vector<double> b_dot_, r_dot_, rz_, rz_prev_, pAp_, threshold_;
+  vector<T> alpha_, beta_;
+
+  // Report of last `solve`
+  int iteration_ = 0;
+  T residue_ = 0; // max relative residual over columns
+
+  bool setup(const MatrixCSR<T>& A) {
+    return preconditioner_.setup(A);
+  }
+
+  // Column-wise dot product (accumulated in double)
+  static void dot(const Matrix<T>& a, const Matrix<T>& b, vector<double>& result) {
+    size_t nc = a.shape_[1];
+    result.assign(nc, 0);
+    for (size_t i = 0; i < a.shape_[0]; i++) {
+      for (size_t k = 0; k < nc; k++) {
+        result[k] += double(a(i, k)) * double(b(i, k));
+      }
+    }
+  }
+
+  // Returns true when converged within `iter_lim`
+  bool solve(const MatrixCSR<T>& A, Matrix<T>& x, const Matrix<T>& b, int iter_lim = 1024, T residue_lim = 1e-5) {
+    TRACE_ZONE("pcg::ConjugateGradient::solve");
+    assert(A.shape_[0] == A.shape_[1]);
+    assert(x.shape_[0] == A.shape_[0] && b.shape_[0] == A.shape_[0]);
+    assert(x.shape_[1] == b.shape_[1]);
+    size_t n = A.shape_[0];
+    size_t nc = b.shape_[1];
+    r_.resize(n, nc);
+    z_.resize(n, nc);
+    p_.resize(n, nc);
+    Ap_.resize(n, nc);
+
+    auto& b_dot = b_dot_;
+    auto& r_dot = r_dot_;
+    auto& rz = rz_;
+    auto& rz_prev = rz_prev_;
+    auto& pAp = pAp_;
+    auto& threshold = threshold_;
+    auto& alpha = alpha_;
+    auto& beta = beta_;
+
+    // Squared thresholds per column
+    dot(b, b, b_dot);
+    threshold.resize(nc);
+    for (size_t k = 0; k < nc; k++) {
+      threshold[k] = double(residue_lim) * double(residue_lim) * std::max(b_dot[k], 1e-30);
+    }
+
+    auto finish = [&](bool converged) {
+      TRACE_COUNTER("pcg iterations", double(iteration_));
+      TRACE_COUNTER("pcg residue", double(residue_));
+      return converged;
+    };
+
+    auto updateResidue = [&]() {
+      dot(r_, r_, r_dot);
+      bool converged = true;
+      residue_ = 0;
+      for (size_t k = 0; k < nc; k++) {
+        converged = converged && r_dot[k] < threshold[k];
+        residue_ = std::max<T>(residue_, std::sqrt(r_dot[k] / std::max(b_dot[k], 1e-30)));
+      }
+      return converged;
+    };
+
+    // r = b - A x
+    MatrixCSR<T>::matmul_(A, x, r_);
+    for (size_t i = 0; i < n * nc; i++) { r_.data_[i] = b.data_[i] - r_.data_[i]; }
+
+    iteration_ = 0;
+    if (updateResidue()) { return finish(true); }
+
+    // p = z = M^-1 r
+    preconditioner_.apply(r_, z_);
+    p_.data_ = z_.data_;
+    dot(r_, z_, rz);
+
+    alpha.resize(nc);
+    beta.resize(nc);
+    for (iteration_ = 1; iteration_ <= iter_lim; iteration_++) {
+      MatrixCSR<T>::matmul_(A, p_, Ap_);
+      dot(p_, Ap_, pAp);
+
+      // x' = x + alpha p, r' = r - alpha A p (converged columns are kept as is)
+      for (size_t k = 0; k < nc; k++) {
+        alpha[k] = (r_dot[k] < threshold[k] || pAp[k] <= 0) ? 0 : T(rz[k] / pAp[k]);
+      }
+      for (size_t i = 0; i < n; i++) {
+        for (size_t k = 0; k < nc; k++) {
+          x(i, k) += alpha[k] * p_(i, k);
+          r_(i, k) -= alpha[k] * Ap_(i, k);
+        }
+      }
+      if (updateResidue()) { return finish(true); }
+
+      // p' = z' + beta p where beta = <r', z'> / <r, z>
+      preconditioner_.apply(r_, z_);
+      std::swap(rz, rz_prev);
+      dot(r_, z_, rz);
+      for (size_t k = 0; k < nc; k++) {
+        beta[k] = rz_prev[k] > 0 ? T(rz[k] / rz_prev[k]) : 0;
+      }
+      for (size_t i = 0; i < n; i++) {
+        for (size_t k = 0; k < nc; k++) {
+          p_(i, k) = z_(i, k) + beta[k] * p_(i, k);
+        }
+      }
+    }
+    iteration_ = iter_lim;
+    return finish(false);
+  }
+};
+
+} // namespace pcg
@@ -0,0 +1,345 @@
+#pragma once
+
+//
+// Hardware performance counters (Linux perf_event_open) around kernel regions with derived metrics
+// (IPC, cache/branch miss rates, bytes per flop) and roofline position
+//   - Each event is opened separately so that unavailable ones (e.g. in containers or VMs without PMU,
+//     or perf_event_paranoid > 2) are skipped individually. When an event is multiplexed,
+//     its value is scaled by time_enabled / time_running.
+//   - Counters cover the calling thread only (thread_pool workers are not counted).
+//   - FLOP events (FP_ARITH_INST_RETIRED) are raw Intel events. Otherwise flops and bytes fall back to
+//     the nominal counts given by the caller (e.g. bench::State).
+//   - Bytes are estimated as last level cache misses x 64 (i.e. traffic from memory). Roofline is against memory bandwidth,
+//     thus nominal bytes of cache resident kernels can exceed 100% of it.
+//   - Non Linux builds (e.g. emscripten) compile to a stub where no event is available.
+//
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <string>
+#include <vector>
+#include "simd.hpp"
+
+#if defined(__linux__) && !defined(__EMSCRIPTEN__)
+#define PERF_EVENT_OPEN
+#include <linux/perf_event.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
+
+namespace perf {
+
+using std::vector;
+
+enum Event {
+  kTaskClock, // ns (software event)
+  kCycles,
+  kInstructions,
+  kCacheReferences,
+  kCacheMisses,
+  kBranches,
+  kBranchMisses,
+  kFlopsScalar,  // FP_ARITH_INST_RETIRED.SCALAR_(SINGLE|DOUBLE)
+  kFlops128,     // 128-bit packed single/double in flops (i.e. 4 x single + 2 x double)
+  kFlops256,
+  kFlops512,
+  kNumEvents,
+};
+
+constexpr const char* kEventNames[kNumEvents] = {
+  "task-clock", "cycles", "instructions", "cache-references", "cache-misses", "branches", "branch-misses",
+  "fp-scalar", "fp-128", "fp-256", "fp-512",
+};
+
+constexpr double kCacheLine = 64;
+
+// Per-event values of a region (NaN when unavailable)
+struct Sample {
+  double values_[kNumEvents];
+
+  Sample() { std::fill(values_, values_ + kNumEvents, NAN); }
+
+  bool has(Event event) const { return !std::isnan(values_[event]); }
+  double operator[](Event event) const { return values_[event]; }
+
+  // FLOP events in flops (NaN when unavailable)
+  double flops() const {
+    if (!has(kFlopsScalar)) { return NAN; }
+    double result = 0;
+    for (auto event : {kFlopsScalar, kFlops128, kFlops256, kFlops512}) {
+      if (has(event)) { result += values_[event]; }
+    }
+    return result;
+  }
+};
+
+#if defined(PERF_EVENT_OPEN)
+
+inline bool isIntel() {
+#if defined(__x86_64__) || defined(__i386__)
+  uint32_t eax = 0, ebx, ecx, edx;
+  __asm__("cpuid" : "+a"(eax), "=b"(ebx), "=c"(ecx), "=d"(edx));
+  char vendor[13] = {};
+  std::memcpy(vendor + 0, &ebx, 4);
+  std::memcpy(vendor + 4, &edx, 4);
+  std::memcpy(vendor + 8, &ecx, 4);
+  return std::strcmp(vendor, "GenuineIntel") == 0;
+#else
+  return false;
+#endif
+}
+
+inline int openEvent(uint32_t type, uint64_t config) {
+  perf_event_attr attr;
+  std::memset(&attr, 0, sizeof(attr));
+  attr.size = sizeof(attr);
+  attr.type = type;
+  attr.config = config;
+  attr.disabled = 1;
+  attr.exclude_kernel = 1;
+  attr.exclude_hv = 1;
+  attr.read_format = PERF_FORMAT_TOTAL_TIME_ENABLED | PERF_FORMAT_TOTAL_TIME_RUNNING;
+  return (int)syscall(__NR_perf_event_open, &attr, 0, -1, -1, 0);
+}
+
+#endif
+
+struct Counters {
+  // Each event consists of fds with weight (e.g. 128-bit packed single counts 4 flops)
+  struct Fd {
+    int fd;
+    double weight;
+  };
+  vector<Fd> fds_[kNumEvents];
+  Sample sample_; // accumulated since `reset`
+
+  Counters() = default;
+  Counters(const Counters&) = delete;
+  Counters& operator=(const Counters&) = delete;
+  ~Counters() { close(); }
+
+  // Returns false when no event is available
+  bool init() {
+    close();
+#if defined(PERF_EVENT_OPEN)
+    auto add = [&](Event event, uint32_t type, uint64_t config, double weight) {
+      int fd = openEvent(type, config);
+      if (fd >= 0) { fds_[event].push_back({fd, weight}); }
+    };
+    add(kTaskClock, PERF_TYPE_SOFTWARE, PERF_COUNT_SW_TASK_CLOCK, 1);
+    add(kCycles, PERF_TYPE_HARDWARE, PERF_COUNT_HW_CPU_CYCLES, 1);
+    add(kInstructions, PERF_TYPE_HARDWARE, PERF_COUNT_HW_INSTRUCTIONS, 1);
+    add(kCacheReferences, PERF_TYPE_HARDWARE, PERF_COUNT_HW_CACHE_REFERENCES, 1);
+    add(kCacheMisses, PERF_TYPE_HARDWARE, PERF_COUNT_HW_CACHE_MISSES, 1);
+    add(kBranches, PERF_TYPE_HARDWARE, PERF_COUNT_HW_BRANCH_INSTRUCTIONS, 1);
+    add(kBranchMisses, PERF_TYPE_HARDWARE, PERF_COUNT_HW_BRANCH_MISSES, 1);
+    if (isIntel()) {
+      // FP_ARITH_INST_RETIRED (event 0xc7, umask: scalar double 0x01, scalar single 0x02, 128-bit double 0x04, ...)
+      // FMA is counted twice by the hardware
+      auto fp = [](uint64_t umask) { return 0xc7 | (umask << 8); };
+      add(kFlopsScalar, PERF_TYPE_RAW, fp(0x01 | 0x02), 1);
+      add(kFlops128, PERF_TYPE_RAW, fp(0x04), 2);
+      add(kFlops128, PERF_TYPE_RAW, fp(0x08), 4);
+      add(kFlops256, PERF_TYPE_RAW, fp(0x10), 4);
+      add(kFlops256, PERF_TYPE_RAW, fp(0x20), 8);
+      add(kFlops512, PERF_TYPE_RAW, fp(0x40), 8);
+      add(kFlops512, PERF_TYPE_RAW, fp(0x80), 16);
+    }
+#endif
+    return available();
+  }
+
+  void close() {
+#if defined(PERF_EVENT_OPEN)
+    for (auto& fds : fds_) {
+      for (auto& fd : fds) { ::close(fd.fd); }
+    }
+#endif
+    for (auto& fds : fds_) { fds.clear(); }
+  }
+
+  bool available() const {
+    for (auto& fds : fds_) {
+      if (!fds.empty()) { return true; }
+    }
+    return false;
+  }
+
+  bool available(Event event) const { return !fds_[event].empty(); }
+
+  // Clears accumulated values
+  void reset() {
+    sample_ = Sample{};
+#if defined(PERF_EVENT_OPEN)
+    for (int i = 0; i < kNumEvents; i++) {
+      if (fds_[i].empty()) { continue; }
+      sample_.values_[i] = 0;
+      for (auto& fd : fds_[i]) { ioctl(fd.fd, PERF_EVENT_IOC_RESET, 0); }
+    }
+#endif
+  }
+
+  void start() {
+#if defined(PERF_EVENT_OPEN)
+    for (auto& fds : fds_) {
+      for (auto& fd : fds) { ioctl(fd.fd, PERF_EVENT_IOC_ENABLE, 0); }
+    }
+#endif
+  }
+
+  void stop() {
+#if defined(PERF_EVENT_OPEN)
+    for (auto& fds : fds_) {
+      for (auto& fd : fds) { ioctl(fd.fd, PERF_EVENT_IOC_DISABLE, 0); }
+    }
+#endif
+  }
+
+  // Values since `reset` (counting is cumulative over `start`/`stop` pairs)
+  const Sample& read() {
+#if defined(PERF_EVENT_OPEN)
+    for (int i = 0; i < kNumEvents; i++) {
+      if (fds_[i].empty()) { continue; }
+      double value = 0;
+      for (auto& fd : fds_[i]) {
+        uint64_t data[3] = {}; // value, time_enabled, time_running
+        if (::read(fd.fd, data, sizeof(data)) != sizeof(data)) { continue; }
+        double scale = data[2] > 0 ? double(data[1]) / double(data[2]) : 0; // not scheduled at all
+        value += fd.weight * double(data[0]) * scale;
+      }
+      sample_.values_[i] = value;
+    }
+#endif
+    return sample_;
+  }
+};
+
+// RAII region (e.g. `{ perf::Scope scope{counters}; kernel(); }` then `counters.read()`)
+struct Scope {
+  Counters& counters_;
+  explicit Scope(Counters& counters) : counters_{counters} { counters_.start(); }
+  ~Scope() { counters_.stop(); }
+  Scope(const Scope&) = delete;
+  Scope& operator=(const Scope&) = delete;
+};
+
+//
+// Roofline
+//
+
+// Peak of calling thread (Flop/s and B/s)
+struct Machine {
+  double flops = 0;
+  double bandwidth = 0;
+
+  double balance() const { return flops / bandwidth; } // Flop/B where memory and compute bounds meet
+};
+
+// Independent multiply-add chains on simd vectors (mul and add are counted as 2 flops even without FMA)
+inline double measurePeakFlops(size_t n = 1 << 20) {
+  using simd::floatv;
+  constexpr int kChains = 12; // enough to hide latency of both mul + add and FMA
+  floatv acc[kChains];
+  for (int j = 0; j < kChains; j++) { acc[j] = simd::splat(float(j)); }
+  floatv a = simd::splat(0.999f), b = simd::splat(1e-3f);
+  double best = 0;
+  for (int trial = 0; trial < 3; trial++) {
+    auto t0 = std::chrono::steady_clock::now();
+    for (size_t k = 0; k < n; k++) {
+      for (int j = 0; j < kChains; j++) { acc[j] = acc[j] * a + b; }
+    }
+    auto t1 = std::chrono::steady_clock::now();
+    double elapsed = std::chrono::duration<double>(t1 - t0).count();
+    best = std::max(best, 2.0 * simd::kWidth * kChains * n / elapsed);
+  }
+  volatile float sink = 0;
+  for (int j = 0; j < kChains; j++) { sink = sink + acc[j][0]; }
+  return best;
+}
+
+// Streaming read of buffer larger than last level cache (integer sum so that the loop is vectorized without dependency chain)
+inline double measurePeakBandwidth(size_t bytes = 1 << 26) {
+  vector<uint64_t> data(bytes / sizeof(uint64_t), 1);
+  uint64_t sum = 0;
+  double best = 0;
+  for (int trial = 0; trial < 3; trial++) {
+    auto t0 = std::chrono::steady_clock::now();
+    for (auto v : data) { sum += v; }
+    auto t1 = std::chrono::steady_clock::now();
+    double elapsed = std::chrono::duration<double>(t1 - t0).count();
+    best = std::max(best, data.size() * sizeof(uint64_t) / elapsed);
+  }
+  volatile uint64_t sink = sum;
+  (void)sink;
+  return best;
+}
+
+inline Machine calibrate() { return {measurePeakFlops(), measurePeakBandwidth()}; }
+
+// Derived metrics of a region (NaN when underlying events are unavailable)
+struct Report {
+  double ipc = NAN;
+  double cache_miss_rate = NAN;  // cache-misses / cache-references
+  double branch_miss_rate = NAN; // branch-misses / branches
+  double flops = NAN;            // measured FLOP events or nominal
+  double bytes = NAN;            // cache-misses x 64 or nominal
+  bool measured_flops = false;
+  bool measured_bytes = false;
+  double bytes_per_flop = NAN;
+  double intensity = NAN;        // Flop/B
+  double attainable = NAN;       // min(peak flops, intensity x peak bandwidth) in Flop/s
+  double efficiency = NAN;       // achieved / attainable
+  bool memory_bound = false;     // intensity below machine balance
+
+  // `time` is seconds of the region, `nominal_flops` and `nominal_bytes` are fallbacks (0 when unknown)
+  static Report compute(const Sample& s, double time, double nominal_flops, double nominal_bytes, const Machine& machine) {
+    Report r;
+    if (s.has(kCycles) && s.has(kInstructions) && s[kCycles] > 0) { r.ipc = s[kInstructions] / s[kCycles]; }
+    if (s.has(kCacheReferences) && s.has(kCacheMisses) && s[kCacheReferences] > 0) {
+      r.cache_miss_rate = s[kCacheMisses] / s[kCacheReferences];
+    }
+    if (s.has(kBranches) && s.has(kBranchMisses) && s[kBranches] > 0) { r.branch_miss_rate = s[kBranchMisses] / s[kBranches]; }
+    r.measured_flops = s.flops() > 0;
+    r.flops = r.measured_flops ? s.flops() : nominal_flops > 0 ? nominal_flops : NAN;
+    r.measured_bytes = s.has(kCacheMisses);
+    r.bytes = r.measured_bytes ? s[kCacheMisses] * kCacheLine : nominal_bytes > 0 ? nominal_bytes : NAN;
+    if (r.flops > 0) { r.bytes_per_flop = r.bytes / r.flops; }
+    if (r.bytes >= 0 && r.flops > 0) {
+      r.intensity = r.flops / std::max(r.bytes, 1.0);
+      if (machine.flops > 0 && machine.bandwidth > 0) {
+        r.attainable = std::min(machine.flops, r.intensity * machine.bandwidth);
+        r.memory_bound = r.intensity < machine.balance();
+        if (time > 0) { r.efficiency = r.flops / time / r.attainable; }
+      }
+    }
+    return r;
+  }
+
+  // e.g. "IPC 2.31, cache-miss 12.0%, branch-miss 0.3%, 0.500 B/Flop (nominal), memory-bound 43% of roofline"
+  std::string toString() const {
+    std::string result;
+    char buffer[128];
+    auto append = [&](int length) {
+      if (!result.empty()) { result += ", "; }
+      result.append(buffer, std::min<size_t>(length, sizeof(buffer) - 1));
+    };
+    if (!std::isnan(ipc)) { append(std::snprintf(buffer, sizeof(buffer), "IPC %.2f", ipc)); }
+    if (!std::isnan(cache_miss_rate)) { append(std::snprintf(buffer, sizeof(buffer), "cache-miss %.1f%%", 100 * cache_miss_rate)); }
+    if (!std::isnan(branch_miss_rate)) { append(std::snprintf(buffer, sizeof(buffer), "branch-miss %.2f%%", 100 * branch_miss_rate)); }
+    if (!std::isnan(bytes_per_flop)) {
+      const char* source = measured_flops && measured_bytes ? "measured" : !measured_flops && !measured_bytes ? "nominal" : "mixed";
+      append(std::snprintf(buffer, sizeof(buffer), "%.3f B/Flop (%s)", bytes_per_flop, source));
+    }
+    if (!std::isnan(efficiency)) {
+      append(std::snprintf(buffer, sizeof(buffer), "%s-bound %.0f%% of roofline", memory_bound ? "memory" : "compute", 100 * efficiency));
+    }
+    return result;
+  }
+};
+
+} // namespace perf
@@ -0,0 +1,326 @@
+#pragma once
+
+//
+// Projective dynamics with pin and volume strain constraints (cf. Example02 in src/utils/physics.js)
+//
+// Differences from Example02
+// - Since every constraint acts on x, y, z coordinates in the same way,
+//   the system (Md + AT A) is factorized as nV x nV matrix and solved with 3 right hand sides
+//   instead of 3 nV x 3 nV matrix.
+// - AT B p is accumulated per constraint without assembling AT B.
+// - With `refinement_iteration_ > 0` (set before `init`), the global step is solved by float Cholesky
+//   with iterative refinement in double (cf. refinement.hpp), which keeps stiff handles accurate.
+// - With `warm_start_` (default), the local step is polar decomposition (cf. misc::solvePolar) starting from
+//   the rotation of the previous PD iteration (or frame) kept per tetrahedron as quaternion,
+//   which stops as soon as rotations stop changing instead of svd from scratch every time.
+// - With `contact_stiffness_ > 0` (set before `init`), contacts of surface vertices (cf. collision.hpp) are detected
+//   every frame and projected every PD iteration. Since each contact only adds to the diagonal of E,
+//   the global step is solved by PCG on E + (contact) preconditioned by the factorization of E
+//   (float Cholesky only, i.e. `refinement_iteration_ == 0`).
+//
+
+#include <algorithm>
+#include <cassert>
+#include <cstdint>
+#include <vector>
+#include "matrix.hpp"
+#include "cholesky.hpp"
+#include "refinement.hpp"
+#include "pcg.hpp"
+#include "collision.hpp"
+#include "misc.hpp"
+#include "trace.hpp"
+
+namespace physics {
+
+using std::vector;
+
+// M = E (factorization of the system without contacts) for PCG on E + (contact)
+template<typename T>
+struct PreconditionerCholesky {
+  cholesky::Cholesky<T>* cholesky_ = nullptr;
+
+  bool setup(const MatrixCSR<T>&) { return cholesky_ != nullptr; }
+
+  void apply(const Matrix<T>& r, Matrix<T>& z) const {
+    cholesky_->solve(z, r);
+  }
+};
+
+struct ProjectiveDynamics {
+  // Configuration
+  float g_ = 9.8;
+  int iterPD_ = 8;
+  float dt_ = 1.0 / 60.0;
+  float mass_ = 1;
+  float handle_stiffness_ = 1 << 12;
+  float strain_stiffness_ = 1 << 5;
+  int refinement_iteration_ = 0;
+  bool warm_start_ = true;
+  int local_iteration_ = 4;       // polar steps per local step (at most)
+  float local_tolerance_ = 1e-4;  // radian
+  float contact_stiffness_ = 0;   // collision is disabled when 0
+  int contact_iteration_ = 16;    // PCG iterations (at most) of global step with contacts
+
+  size_t nV_ = 0;
+  size_t nC3_ = 0;
+  size_t nH_ = 0;
+
+  // Mesh and handles (filled by user before `init`)
+  Matrix<float> verts_;            // nV x 3 (positions, updated by `update`)
+  vector<uint32_t> c3xc0_;         // 4 nC3
+  vector<uint32_t> handles_;       // nH
+  Matrix<float> handle_targets_;   // nH x 3 (can be mutated by user before each `update`)
+
+  // State
+  Matrix<float> x0_;  // previous positions
+  Matrix<float> v_;   // velocities
+
+  // Volume strain projection
+  MatrixCSR<float> frame_; // 3 nC3 x nV frame selector (cf. ddg.computeFrameSelectorC3)
+  Matrix<float> F_rest_;   // 3 nC3 x 3
+  Matrix<float> F_;        // 3 nC3 x 3
+  vector<float> p_;        // 9 nC3 (row major projected rotation for each tetrahedron)
+  vector<float> q_;        // 4 nC3 (same rotation as quaternion used for warm start)
+
+  // Global step
+  vector<float> Md_;       // nV (M / dt^2)
+  MatrixCSR<float> E_;     // nV x nV (Md + AT A for a single coordinate)
+  cholesky::Cholesky<float> E_cholesky_;
+  Matrix<float> rhs_;      // nV x 3
+  refinement::CholeskyRefinement<float, double> E_refinement_; // used when refinement_iteration_ > 0
+  Matrix<double> x_high_, rhs_high_;
+
+  // Contact (collision_ keeps contacts of current frame)
+  collision::Collision collision_;
+  MatrixCSR<float> E_contact_;  // E + contact stiffness on diagonal of contact vertices
+  vector<size_t> E_diagonal_;   // nV (position of diagonal entries in E)
+  pcg::ConjugateGradient<float, PreconditionerCholesky<float>> contact_solver_;
+
+  ProjectiveDynamics(size_t nV, size_t nC3, size_t nH)
+    : nV_{nV}, nC3_{nC3}, nH_{nH},
+      verts_{nV, 3}, c3xc0_(4 * nC3), handles_(nH), handle_targets_{nH, 3} {}
+
+  // Returns false when system cannot be factorized
+  bool init(float strain_stiffness) {
+    TRACE_ZONE("ProjectiveDynamics::init");
+    assert(contact_stiffness_ == 0 || refinement_iteration_ == 0);
+    strain_stiffness_ = strain_stiffness;
+    initState();
+    assemble();
+    if (refinement_iteration_ > 0) {
+      return E_refinement_.compute(MatrixCSR<double>::cast(E_));
+    }
+    return E_cholesky_.compute(E_);
+  }
+
+  // State and per-tetrahedron data which only depend on the mesh (i.e. everything except E and its factorization,
+  // which `cache::load` restores instead of `assemble` and `compute`)
+  void initState() {
+    size_t nV = nV_;
+    size_t nC3 = nC3_;
+
+    x0_ = verts_;
+    v_.resize(nV, 3);
+    std::fill(v_.data_.begin(), v_.data_.end(), 0);
+
+    // Frame selector
+    frame_ = MatrixCSR<float>(3 * nC3, nV, 2 * 3 * nC3);
+    for (size_t i = 0; i < 3 * nC3 + 1; i++) {
+      frame_.indptr_[i] = 2 * i;
+    }
+    for (size_t i = 0; i < nC3; i++) {
+      auto vs = &c3xc0_[4 * i];
+      for (size_t j = 0; j < 3; j++) {
+        uint32_t v0 = vs[0];
+        uint32_t vj = vs[j + 1];
+        bool swap = v0 > vj; // Keep indices sorted
+        size_t q = 2 * (3 * i + j);
+        frame_.indices_[q + 0] = swap ? vj : v0;
+        frame_.indices_[q + 1] = swap ? v0 : vj;
+        frame_.data_[q + 0] = swap ? 1 : -1;
+        frame_.data_[q + 1] = swap ? -1 : 1;
+      }
+    }
+    F_rest_.resize(3 * nC3, 3);
+    F_.resize(3 * nC3, 3);
+    MatrixCSR<float>::matmul_(frame_, verts_, F_rest_);
+    p_.resize(9 * nC3);
+    q_.resize(4 * nC3);
+    for (size_t i = 0; i < nC3; i++) {
+      q_[4 * i + 0] = q_[4 * i + 1] = q_[4 * i + 2] = 0;
+      q_[4 * i + 3] = 1;
+    }
+    Md_.assign(nV, (mass_ / nV) / (dt_ * dt_));
+    rhs_.resize(nV, 3);
+    if (contact_stiffness_ > 0) {
+      collision_.init(verts_, c3xc0_);
+    }
+    E_diagonal_.clear();
+  }
+
+  // E = Md + (pin) + (volume strain)
+  void assemble() {
+    size_t nV = nV_;
+    size_t nC3 = nC3_;
+    vector<size_t> rows, cols;
+    vector<float> values;
+    auto add = [&](size_t i, size_t j, float v) {
+      rows.push_back(i);
+      cols.push_back(j);
+      values.push_back(v);
+    };
+    for (size_t i = 0; i < nV; i++) {
+      add(i, i, Md_[i]);
+    }
+    for (size_t h = 0; h < nH_; h++) {
+      size_t i = handles_[h];
+      add(i, i, handle_stiffness_);
+    }
+    // AT A = K (x) I3 where K = [[3, -1, -1, -1], [-1, 1, 0, 0], [-1, 0, 1, 0], [-1, 0, 0, 1]]
+    float w = strain_stiffness_;
+    for (size_t i = 0; i < nC3; i++) {
+      auto vs = &c3xc0_[4 * i];
+      add(vs[0], vs[0], 3 * w);
+      for (size_t j = 1; j < 4; j++) {
+        add(vs[0], vs[j], -w);
+        add(vs[j], vs[0], -w);
+        add(vs[j], vs[j], w);
+      }
+    }
+    E_ = MatrixCSR<float>::fromCOO(nV, nV, rows, cols, values);
+  }
+
+  // Local step for volume strain (F = frame x, then svd projection)
+  void projectStrain() {
+    TRACE_ZONE("ProjectiveDynamics::projectStrain");
+    MatrixCSR<float>::matmul_(frame_, verts_, F_);
+    if (warm_start_) {
+      misc::solvePolar(F_.data_, F_rest_.data_, q_, p_, local_iteration_, local_tolerance_);
+      return;
+    }
+    misc::solve(F_.data_, F_rest_.data_, p_);
+  }
+
+  // rhs = Md x + AT B p
+  void computeRhs() {
+    TRACE_ZONE("ProjectiveDynamics::computeRhs");
+    size_t nV = nV_;
+    for (size_t i = 0; i < nV; i++) {
+      for (size_t k = 0; k < 3; k++) {
+        rhs_(i, k) = Md_[i] * verts_(i, k);
+      }
+    }
+
+    // Pin
+    float wh = handle_stiffness_;
+    for (size_t h = 0; h < nH_; h++) {
+      size_t i = handles_[h];
+      for (size_t k = 0; k < 3; k++) {
+        rhs_(i, k) += wh * handle_targets_(h, k);
+      }
+    }
+
+    // Volume strain (AT [P u1_rest; P u2_rest; P u3_rest])
+    float w = strain_stiffness_;
+    for (size_t i = 0; i < nC3_; i++) {
+      auto vs = &c3xc0_[4 * i];
+      auto P = &p_[9 * i];
+      for (size_t j = 0; j < 3; j++) {
+        auto u = &F_rest_(3 * i + j, 0);
+        for (size_t r = 0; r < 3; r++) {
+          float y = w * (P[3 * r + 0] * u[0] + P[3 * r + 1] * u[1] + P[3 * r + 2] * u[2]);
+          rhs_(vs[j + 1], r) += y;
+          rhs_(vs[0], r) -= y;
+        }
+      }
+    }
+
+    // Contact
+    float wc = contact_stiffness_;
+    for (size_t i = 0; i < collision_.contact_verts_.size(); i++) {
+      size_t v = collision_.contact_verts_[i];
+      for (size_t k = 0; k < 3; k++) {
+        rhs_(v, k) += wc * collision_.contact_targets_(i, k);
+      }
+    }
+  }
+
+  // E + (contact) for current contacts
+  void assembleContact() {
+    if (E_diagonal_.size() != nV_) {
+      E_diagonal_.resize(nV_);
+      for (size_t i = 0; i < nV_; i++) {
+        auto begin = E_.indices_.begin() + E_.indptr_[i], end = E_.indices_.begin() + E_.indptr_[i + 1];
+        auto it = std::lower_bound(begin, end, i);
+        assert(it != end && *it == i);
+        E_diagonal_[i] = it - E_.indices_.begin();
+      }
+      E_contact_ = E_;
+    }
+    E_contact_.data_ = E_.data_;
+    for (auto v : collision_.contact_verts_) {
+      E_contact_.data_[E_diagonal_[v]] += contact_stiffness_;
+    }
+  }
+
+  void solveGlobal() {
+    TRACE_ZONE("ProjectiveDynamics::solveGlobal");
+    if (!collision_.contact_verts_.empty()) {
+      contact_solver_.preconditioner_.cholesky_ = &E_cholesky_;
+      contact_solver_.solve(E_contact_, verts_, rhs_, contact_iteration_, 1e-6);
+      return;
+    }
+    if (refinement_iteration_ > 0) {
+      Matrix<double>::cast_(verts_, x_high_);
+      Matrix<double>::cast_(rhs_, rhs_high_);
+      E_refinement_.solve(x_high_, rhs_high_, refinement_iteration_, 0);
+      Matrix<float>::cast_(x_high_, verts_);
+      return;
+    }
+    E_cholesky_.solve(verts_, rhs_);
+  }
+
+  void update() {
+    TRACE_ZONE("ProjectiveDynamics::update");
+    size_t nV = nV_;
+    float dt = dt_;
+
+    // Integrate velocity and position (same as Example02.update)
+    for (size_t i = 0; i < nV; i++) {
+      v_(i, 1) -= g_;
+      for (size_t k = 0; k < 3; k++) {
+        verts_(i, k) += dt * v_(i, k);
+      }
+    }
+
+    // Contacts at predicted positions
+    if (contact_stiffness_ > 0) {
+      collision_.detect(verts_);
+      assembleContact();
+    }
+
+    // Projective dynamics iteration
+    for (auto i = 0; i < iterPD_; i++) {
+      // Local step
+      projectStrain();
+      if (!collision_.contact_verts_.empty()) {
+        collision_.project(verts_);
+      }
+
+      // Global step: solve (Md + AT A) x' = Md x + AT B p
+      computeRhs();
+      solveGlobal();
+    }
+
+    // Reset velocity (v = (x - x0) / dt) and update previous state
+    for (size_t i = 0; i < nV; i++) {
+      for (size_t k = 0; k < 3; k++) {
+        v_(i, k) = (verts_(i, k) - x0_(i, k)) / dt;
+      }
+    }
+    x0_.data_ = verts_.data_;
+  }
+};
+
+} // namespace physics
@@ -0,0 +1,823 @@
+#pragma once
+
+//
+// Mesh file reader for OFF/OBJ/MESH/ELE+NODE (native version of src/utils/reader.js)
+//   - File is memory-mapped (no copy into std::string) and split into chunks at line boundaries.
+//     Records (non-blank, non-comment lines) are counted per chunk in parallel,
+//     then header records (e.g. counts, keywords) are read sequentially and data sections are parsed
+//     in parallel straight into preallocated SoA buffers (Mesh::verts_, f2v_, c3xc0_).
+//   - Numbers are parsed by a hand-written parser instead of splitting strings. Decimal inputs with mantissa <= 2^53
+//     and |exponent| <= 22 are correctly rounded in double and then narrowed to float, which can't round twice
+//     unless the double is exactly halfway between two floats; that case and other inputs fall back to strtof.
+//   - Streaming mode (`stream*`) reads the file through a fixed size window and hands each parsed block
+//     to a callback, thus neither the file nor the whole mesh has to fit in memory.
+//   - Errors are reported by returning false (same checks as reader.js, e.g. "OFF" magic, nE = 0, 1-based indices).
+//
+
+#include <algorithm>
+#include <atomic>
+#include <cassert>
+#include <cfloat>
+#include <cmath>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <vector>
+#include "thread_pool.hpp"
+
+#if (defined(__unix__) || defined(__APPLE__)) && !defined(__EMSCRIPTEN__)
+#define READER_USE_MMAP
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+namespace reader {
+
+using std::vector;
+
+struct Mesh {
+  vector<float> verts_;     // 3 nV
+  vector<uint32_t> f2v_;    // 3 nF
+  vector<uint32_t> c3xc0_;  // 4 nC3
+};
+
+//
+// Read-only view of whole file (mmap or read into buffer when mmap is not available)
+//
+
+struct MappedFile {
+  const char* data_ = nullptr;
+  size_t size_ = 0;
+#if defined(READER_USE_MMAP)
+  void* map_ = nullptr;
+#else
+  vector<char> buffer_;
+#endif
+
+  MappedFile() = default;
+  MappedFile(const MappedFile&) = delete;
+  MappedFile& operator=(const MappedFile&) = delete;
+  ~MappedFile() { close(); }
+
+  bool open(const char* path) {
+    close();
+#if defined(READER_USE_MMAP)
+    int fd = ::open(path, O_RDONLY);
+    if (fd < 0) { return false; }
+    struct stat st;
+    if (fstat(fd, &st) != 0) {
+      ::close(fd);
+      return false;
+    }
+    size_ = size_t(st.st_size);
+    if (size_ > 0) {
+      map_ = mmap(nullptr, size_, PROT_READ, MAP_PRIVATE, fd, 0);
+      if (map_ == MAP_FAILED) {
+        map_ = nullptr;
+        ::close(fd);
+        return false;
+      }
+      madvise(map_, size_, MADV_SEQUENTIAL);
+      data_ = static_cast<const char*>(map_);
+    }
+    ::close(fd);
+    return true;
+#else
+    FILE* file = std::fopen(path, "rb");
+    if (!file) { return false; }
+    std::fseek(file, 0, SEEK_END);
+    buffer_.resize(size_t(std::ftell(file)));
+    std::fseek(file, 0, SEEK_SET);
+    size_ = std::fread(buffer_.data(), 1, buffer_.size(), file);
+    std::fclose(file);
+    data_ = buffer_.data();
+    return size_ == buffer_.size();
+#endif
+  }
+
+  void close() {
+#if defined(READER_USE_MMAP)
+    if (map_) { munmap(map_, size_); }
+    map_ = nullptr;
+#else
+    buffer_.clear();
+#endif
+    data_ = nullptr;
+    size_ = 0;
+  }
+};
+
+//
+// Number parsing (tokens are separated by spaces, tabs or '\r')
+//
+
+inline const char* skipSpaces(const char* p, const char* end) {
+  while (p < end && (*p == ' ' || *p == '\t' || *p == '\r')) { p++; }
+  return p;
+}
+
+inline const char* skipToken(const char* p, const char* end) {
+  p = skipSpaces(p, end);
+  while (p < end && *p != ' ' && *p != '\t' && *p != '\r') { p++; }
+  return p;
+}
+
+inline bool isDigit(char c) { return '0' <= c && c <= '9'; }
+
+// `v` is halfway between two adjacent floats (also true for subnormal/overflow range, which isn't checked)
+inline bool isFloatHalfway(double v) {
+  v = std::abs(v);
+  if (v == 0) { return false; }
+  if (v < FLT_MIN || v > FLT_MAX) { return true; }
+  uint64_t bits;
+  std::memcpy(&bits, &v, sizeof(bits));
+  constexpr uint64_t kDropped = (uint64_t(1) << 29) - 1; // mantissa bits of double not in float
+  return (bits & kDropped) == (uint64_t(1) << 28);
+}
+
+inline bool parseFloat(const char*& p, const char* end, float& result) {
+  static constexpr double kPow10[] = {
+    1e0, 1e1, 1e2, 1e3, 1e4, 1e5, 1e6, 1e7, 1e8, 1e9, 1e10, 1e11,
+    1e12, 1e13, 1e14, 1e15, 1e16, 1e17, 1e18, 1e19, 1e20, 1e21, 1e22};
+  p = skipSpaces(p, end);
+  const char* begin = p;
+  bool negative = false;
+  if (p < end && (*p == '-' || *p == '+')) {
+    negative = *p == '-';
+    p++;
+  }
+  uint64_t mantissa = 0;
+  int num_digits = 0; // significant digits in mantissa
+  int exponent = 0;
+  bool found = false;
+  for (; p < end && isDigit(*p); p++, found = true) {
+    if (num_digits < 19) {
+      mantissa = 10 * mantissa + (*p - '0');
+      num_digits += mantissa > 0;
+    } else {
+      exponent++;
+    }
+  }
+  if (p < end && *p == '.') {
+    for (p++; p < end && isDigit(*p); p++, found = true) {
+      if (num_digits < 19) {
+        mantissa = 10 * mantissa + (*p - '0');
+        num_digits += mantissa > 0;
+        exponent--;
+      }
+    }
+  }
+  if (!found) { return false; }
+  if (p < end && (*p == 'e' || *p == 'E')) {
+    const char* q = p + 1;
+    bool exp_negative = false;
+    if (q < end && (*q == '-' || *q == '+')) {
+      exp_negative = *q == '-';
+      q++;
+    }
+    if (q < end && isDigit(*q)) {
+      int e = 0;
+      for (; q < end && isDigit(*q); q++) { e = std::min(10 * e + (*q - '0'), 100000); }
+      exponent += exp_negative ? -e : e;
+      p = q;
+    }
+  }
+
+  // Fast path (mantissa and 10^|exponent| are exact in double, thus `v` is correctly rounded)
+  if (mantissa <= (uint64_t(1) << 53) && -22 <= exponent && exponent <= 22) {
+    double v = double(mantissa);
+    v = exponent < 0 ? v / kPow10[-exponent] : v * kPow10[exponent];
+    if (!isFloatHalfway(v)) {
+      result = float(negative ? -v : v);
+      return true;
+    }
+  }
+  std::string token{begin, p};
+  result = std::strtof(token.c_str(), nullptr);
+  return true;
+}
+
+inline bool parseUint(const char*& p, const char* end, uint32_t& result) {
+  p = skipSpaces(p, end);
+  if (p >= end || !isDigit(*p)) { return false; }
+  uint64_t v = 0;
+  for (; p < end && isDigit(*p); p++) {
+    v = 10 * v + (*p - '0');
+    if (v > UINT32_MAX) { return false; }
+  }
+  result = uint32_t(v);
+  return true;
+}
+
+// Parse `n` floats or indices (minus `base`) from record (remaining tokens are ignored)
+inline bool parseFloats(const char* p, const char* end, float* result, int n) {
+  for (auto i = 0; i < n; i++) {
+    if (!parseFloat(p, end, result[i])) { return false; }
+  }
+  return true;
+}
+
+inline bool parseIndices(const char* p, const char* end, uint32_t* result, int n, uint32_t base) {
+  for (auto i = 0; i < n; i++) {
+    if (!parseUint(p, end, result[i]) || result[i] < base) { return false; }
+    result[i] -= base;
+  }
+  return true;
+}
+
+// Record starts with `keyword` as a whole token
+inline bool startsWith(const char* p, const char* end, const char* keyword) {
+  p = skipSpaces(p, end);
+  size_t n = std::strlen(keyword);
+  return size_t(end - p) >= n && std::memcmp(p, keyword, n) == 0 && skipToken(p, end) == p + n;
+}
+
+//
+// Text split into chunks at line boundaries with the number of records in each chunk
+//
+
+struct Records {
+  static constexpr size_t kMinChunkSize = 1 << 16;
+
+  vector<const char*> bounds_;  // num_chunks + 1
+  vector<size_t> offsets_;      // num_chunks + 1 (index of first record of each chunk)
+
+  static const char* lineEnd(const char* p, const char* end) {
+    auto q = static_cast<const char*>(std::memchr(p, '\n', size_t(end - p)));
+    return q ? q : end;
+  }
+
+  static bool isRecord(const char* p, const char* line_end) {
+    p = skipSpaces(p, line_end);
+    return p < line_end && *p != '#';
+  }
+
+  void split(const char* begin, const char* end) {
+    auto& pool = thread_pool::getDefault();
+    size_t size = size_t(end - begin);
+    size_t num_chunks = std::max<size_t>(1, std::min(4 * pool.size(), size / kMinChunkSize));
+    bounds_.resize(num_chunks + 1);
+    bounds_[0] = begin;
+    bounds_[num_chunks] = end;
+    for (size_t c = 1; c < num_chunks; c++) {
+      const char* p = std::max(begin + size * c / num_chunks, bounds_[c - 1]);
+      if (p > begin && p[-1] != '\n') { p = std::min(lineEnd(p, end) + 1, end); }
+      bounds_[c] = p;
+    }
+    offsets_.assign(num_chunks + 1, 0);
+    pool.run(num_chunks, [&](size_t c) {
+      size_t count = 0;
+      for (const char* p = bounds_[c]; p < bounds_[c + 1];) {
+        const char* line_end = lineEnd(p, bounds_[c + 1]);
+        count += isRecord(p, line_end);
+        p = line_end + 1;
+      }
+      offsets_[c + 1] = count;
+    });
+    for (size_t c = 0; c < num_chunks; c++) { offsets_[c + 1] += offsets_[c]; }
+  }
+
+  size_t size() const { return offsets_.back(); }
+  size_t numChunks() const { return bounds_.size() - 1; }
+
+  // Call `func(r, line, line_end)` for records r in [r_begin, r_end) of chunk c (stops when func returns false)
+  template<typename F>
+  bool forEachInChunk(size_t c, size_t r_begin, size_t r_end, const F& func) const {
+    size_t r = offsets_[c];
+    for (const char* p = bounds_[c]; p < bounds_[c + 1] && r < r_end;) {
+      const char* line_end = lineEnd(p, bounds_[c + 1]);
+      if (isRecord(p, line_end)) {
+        if (r >= r_begin && !func(r, p, line_end)) { return false; }
+        r++;
+      }
+      p = line_end + 1;
+    }
+    return true;
+  }
+
+  // Same as `forEachInChunk` in parallel over chunks
+  template<typename F>
+  bool parallelForEach(size_t r_begin, size_t r_end, const F& func) const {
+    std::atomic<bool> ok{true};
+    thread_pool::getDefault().run(numChunks(), [&](size_t c) {
+      if (offsets_[c + 1] <= r_begin || offsets_[c] >= r_end) { return; }
+      if (!forEachInChunk(c, r_begin, r_end, func)) { ok = false; }
+    });
+    return ok;
+  }
+
+  // Single record (e.g. header)
+  bool get(size_t r, const char*& line, const char*& line_end) const {
+    if (r >= size()) { return false; }
+    size_t c = size_t(std::upper_bound(offsets_.begin(), offsets_.end(), r) - offsets_.begin()) - 1;
+    forEachInChunk(c, r, r + 1, [&](size_t, const char* p, const char* q) {
+      line = p;
+      line_end = q;
+      return true;
+    });
+    return true;
+  }
+};
+
+//
+// Destination of parsed data
+//   - `reserve` is called when the count is known from header
+//   - `verts/cells(first, n)` returns buffer for n records starting from index `first`
+//     and `commit` is called once they are filled
+//
+
+enum class Kind { kVerts, kTriangles, kTetrahedra };
+
+// Writes into Mesh
+struct MeshSink {
+  Mesh& mesh_;
+
+  vector<uint32_t>& cellVector(Kind kind) { return kind == Kind::kTriangles ? mesh_.f2v_ : mesh_.c3xc0_; }
+  static size_t arity(Kind kind) { return kind == Kind::kTetrahedra ? 4 : 3; }
+
+  void reserve(Kind kind, size_t count) {
+    if (kind == Kind::kVerts) {
+      mesh_.verts_.resize(3 * count);
+      return;
+    }
+    cellVector(kind).resize(arity(kind) * count);
+  }
+
+  float* verts(size_t first, size_t n) {
+    if (mesh_.verts_.size() < 3 * (first + n)) { mesh_.verts_.resize(3 * (first + n)); }
+    return &mesh_.verts_[3 * first];
+  }
+
+  uint32_t* cells(Kind kind, size_t first, size_t n) {
+    auto& v = cellVector(kind);
+    if (v.size() < arity(kind) * (first + n)) { v.resize(arity(kind) * (first + n)); }
+    return v.data() + arity(kind) * first;
+  }
+
+  void commit(Kind, size_t, size_t) {}
+};
+
+// Block of parsed records passed to the streaming callback (`verts` or `cells` depending on `kind`)
+struct Block {
+  Kind kind;
+  size_t first;
+  size_t count;
+  const float* verts;
+  const uint32_t* cells;
+};
+
+// Passes each block to `func(const Block&)` (buffers are reused between blocks)
+template<typename F>
+struct StreamSink {
+  F func_;
+  vector<float> verts_;
+  vector<uint32_t> cells_;
+
+  void reserve(Kind, size_t) {}
+
+  float* verts(size_t, size_t n) {
+    verts_.resize(3 * n);
+    return verts_.data();
+  }
+
+  uint32_t* cells(Kind kind, size_t, size_t n) {
+    cells_.resize(MeshSink::arity(kind) * n);
+    return cells_.data();
+  }
+
+  void commit(Kind kind, size_t first, size_t n) {
+    func_(Block{kind, first, n, verts_.data(), cells_.data()});
+  }
+};
+
+//
+// Parsers (state is kept across `consume` calls so that stream windows can split sections anywhere)
+//
+
+// OFF
+// <nV> <nF> <nE>
+// <x> <y> <z>        (nV times)
+// 3 <v0> <v1> <v2>   (nF times)
+struct OFFParser {
+  enum class State { kMagic, kCounts, kVerts, kFaces, kDone };
+  State state_ = State::kMagic;
+  uint32_t nV_ = 0;
+  uint32_t nF_ = 0;
+  size_t index_ = 0; // within current section
+
+  bool finished() const { return state_ == State::kDone; }
+
+  template<typename Sink>
+  bool consume(const Records& records, Sink& sink) {
+    size_t r = 0;
+    size_t n = records.size();
+    const char *line = nullptr, *line_end = nullptr;
+    while (r < n && state_ != State::kDone) {
+      if (state_ == State::kMagic) {
+        records.get(r++, line, line_end);
+        if (!startsWith(line, line_end, "OFF")) { return false; }
+        state_ = State::kCounts;
+        continue;
+      }
+      if (state_ == State::kCounts) {
+        records.get(r++, line, line_end);
+        uint32_t nE;
+        const char* p = line;
+        if (!parseUint(p, line_end, nV_) || !parseUint(p, line_end, nF_) || !parseUint(p, line_end, nE) || nE != 0) {
+          return false;
+        }
+        sink.reserve(Kind::kVerts, nV_);
+        sink.reserve(Kind::kTriangles, nF_);
+        state_ = nV_ > 0 ? State::kVerts : (nF_ > 0 ? State::kFaces : State::kDone);
+        continue;
+      }
+      bool verts = state_ == State::kVerts;
+      size_t total = verts ? nV_ : nF_;
+      size_t k = std::min(total - index_, n - r);
+      bool ok;
+      if (verts) {
+        float* dst = sink.verts(index_, k);
+        ok = records.parallelForEach(r, r + k, [&](size_t i, const char* p, const char* q) {
+          return parseFloats(p, q, dst + 3 * (i - r), 3);
+        });
+      } else {
+        uint32_t* dst = sink.cells(Kind::kTriangles, index_, k);
+        ok = records.parallelForEach(r, r + k, [&](size_t i, const char* p, const char* q) {
+          uint32_t num;
+          return parseUint(p, q, num) && num == 3 && parseIndices(p, q, dst + 3 * (i - r), 3, 0);
+        });
+      }
+      if (!ok) { return false; }
+      sink.commit(verts ? Kind::kVerts : Kind::kTriangles, index_, k);
+      index_ += k;
+      r += k;
+      if (index_ == total) {
+        index_ = 0;
+        state_ = (verts && nF_ > 0) ? State::kFaces : State::kDone;
+      }
+    }
+    return true;
+  }
+};
+
+// MeshVersionFormatted 1
+// Dimension 3
+// Vertices / Triangles / Tetrahedra (other sections are skipped)
+// <count>
+// <x> <y> <z> <ref> or <v0> ... <ref>   (count times, 1-based indices)
+// End (optional)
+struct MESHParser {
+  enum class State { kVersion, kDimension, kKeyword, kCount, kData, kDone };
+  State state_ = State::kVersion;
+  int section_ = -1; // Kind or -1 for skipped section
+  size_t count_ = 0;
+  size_t index_ = 0;
+
+  bool finished() const { return state_ == State::kDone || state_ == State::kKeyword; }
+
+  template<typename Sink>
+  bool consume(const Records& records, Sink& sink) {
+    size_t r = 0;
+    size_t n = records.size();
+    const char *line = nullptr, *line_end = nullptr;
+    while (r < n && state_ != State::kDone) {
+      if (state_ != State::kData) {
+        records.get(r++, line, line_end);
+      }
+      switch (state_) {
+        case State::kVersion: {
+          if (!startsWith(line, line_end, "MeshVersionFormatted")) { return false; }
+          state_ = State::kDimension;
+          break;
+        }
+        case State::kDimension: {
+          const char* p = skipToken(line, line_end);
+          uint32_t dim;
+          if (!startsWith(line, line_end, "Dimension") || !parseUint(p, line_end, dim) || dim != 3) { return false; }
+          state_ = State::kKeyword;
+          break;
+        }
+        case State::kKeyword: {
+          if (startsWith(line, line_end, "End")) {
+            state_ = State::kDone;
+            break;
+          }
+          section_ =
+              startsWith(line, line_end, "Vertices") ? int(Kind::kVerts) :
+              startsWith(line, line_end, "Triangles") ? int(Kind::kTriangles) :
+              startsWith(line, line_end, "Tetrahedra") ? int(Kind::kTetrahedra) : -1;
+          // Count can follow keyword on the same line
+          const char* p = skipToken(line, line_end);
+          uint32_t count;
+          if (parseUint(p, line_end, count)) {
+            startSection(count, sink);
+          } else {
+            state_ = State::kCount;
+          }
+          break;
+        }
+        case State::kCount: {
+          const char* p = line;
+          uint32_t count;
+          if (!parseUint(p, line_end, count)) { return false; }
+          startSection(count, sink);
+          break;
+        }
+        case State::kData: {
+          size_t k = std::min(count_ - index_, n - r);
+          bool ok = true;
+          if (section_ == int(Kind::kVerts)) {
+            float* dst = sink.verts(index_, k);
+            ok = records.parallelForEach(r, r + k, [&](size_t i, const char* p, const char* q) {
+              return parseFloats(p, q, dst + 3 * (i - r), 3);
+            });
+          } else if (section_ >= 0) {
+            auto kind = Kind(section_);
+            int arity = kind == Kind::kTetrahedra ? 4 : 3;
+            uint32_t* dst = sink.cells(kind, index_, k);
+            ok = records.parallelForEach(r, r + k, [&](size_t i, const char* p, const char* q) {
+              return parseIndices(p, q, dst + arity * (i - r), arity, 1);
+            });
+          }
+          if (!ok) { return false; }
+          if (section_ >= 0) { sink.commit(Kind(section_), index_, k); }
+          index_ += k;
+          r += k;
+          if (index_ == count_) { state_ = State::kKeyword; }
+          break;
+        }
+        case State::kDone: break;
+      }
+    }
+    return true;
+  }
+
+  template<typename Sink>
+  void startSection(size_t count, Sink& sink) {
+    count_ = count;
+    index_ = 0;
+    if (section_ >= 0) { sink.reserve(Kind(section_), count); }
+    state_ = count > 0 ? State::kData : State::kKeyword;
+  }
+};
+
+// Tetgen .node or .ele
+// <count> <dim or 4> ...
+// <index> <x> <y> <z> ...  or  <index> <v0> <v1> <v2> <v3> ...   (count times)
+// Element indices are shifted by `base` (index of the first node, i.e. 0 or 1).
+struct ELENODEParser {
+  Kind kind_;
+  uint32_t base_ = 0;
+  bool header_ = true;
+  uint32_t count_ = 0;
+  size_t index_ = 0;
+  uint32_t first_index_ = 0; // index of the first record (i.e. base of nodes)
+
+  bool finished() const { return !header_ && index_ == count_; }
+
+  template<typename Sink>
+  bool consume(const Records& records, Sink& sink) {
+    size_t r = 0;
+    size_t n = records.size();
+    if (header_ && n > 0) {
+      const char *line = nullptr, *line_end = nullptr;
+      records.get(r++, line, line_end);
+      const char* p = line;
+      uint32_t width;
+      if (!parseUint(p, line_end, count_) || !parseUint(p, line_end, width)) { return false; }
+      if (width != (kind_ == Kind::kVerts ? 3 : 4)) { return false; }
+      sink.reserve(kind_, count_);
+      header_ = false;
+    }
+    size_t k = std::min(count_ - index_, n - r);
+    if (k == 0) { return true; }
+    if (index_ == 0) {
+      const char *line = nullptr, *line_end = nullptr;
+      records.get(r, line, line_end);
+      if (!parseUint(line, line_end, first_index_)) { return false; }
+    }
+    bool ok;
+    if (kind_ == Kind::kVerts) {
+      float* dst = sink.verts(index_, k);
+      ok = records.parallelForEach(r, r + k, [&](size_t i, const char* p, const char* q) {
+        return skipToken(p, q) < q && parseFloats(skipToken(p, q), q, dst + 3 * (i - r), 3);
+      });
+    } else {
+      uint32_t* dst = sink.cells(kind_, index_, k);
+      ok = records.parallelForEach(r, r + k, [&](size_t i, const char* p, const char* q) {
+        return skipToken(p, q) < q && parseIndices(skipToken(p, q), q, dst + 4 * (i - r), 4, base_);
+      });
+    }
+    if (!ok) { return false; }
+    sink.commit(kind_, index_, k);
+    index_ += k;
+    return true;
+  }
+};
+
+// v <x> <y> <z>
+// f <v0> <v1> <v2> ...   (1-based, "v/vt/vn" allowed, polygons are triangulated as fan)
+// (other records are ignored)
+struct OBJParser {
+  size_t nV_ = 0;
+  size_t nF_ = 0;
+
+  bool finished() const { return true; }
+
+  static int numTriangles(const char* p, const char* end) {
+    int num_tokens = 0;
+    for (p = skipToken(p, end); skipSpaces(p, end) < end; p = skipToken(p, end)) { num_tokens++; }
+    return std::max(0, num_tokens - 2);
+  }
+
+  // Vertex index of "v", "v/vt", "v//vn" or "v/vt/vn"
+  static bool parseFaceVertex(const char*& p, const char* end, uint32_t& result) {
+    if (!parseUint(p, end, result) || result < 1) { return false; }
+    result -= 1;
+    while (p < end && *p != ' ' && *p != '\t' && *p != '\r') { p++; }
+    return true;
+  }
+
+  template<typename Sink>
+  bool consume(const Records& records, Sink& sink) {
+    // 1. Count verts and triangles per chunk
+    size_t num_chunks = records.numChunks();
+    vector<size_t> v_offsets(num_chunks + 1, 0), f_offsets(num_chunks + 1, 0);
+    thread_pool::getDefault().run(num_chunks, [&](size_t c) {
+      records.forEachInChunk(c, 0, records.size(), [&](size_t, const char* p, const char* q) {
+        if (startsWith(p, q, "v")) { v_offsets[c + 1]++; }
+        if (startsWith(p, q, "f")) { f_offsets[c + 1] += numTriangles(p, q); }
+        return true;
+      });
+    });
+    for (size_t c = 0; c < num_chunks; c++) {
+      v_offsets[c + 1] += v_offsets[c];
+      f_offsets[c + 1] += f_offsets[c];
+    }
+    size_t nV = v_offsets[num_chunks];
+    size_t nF = f_offsets[num_chunks];
+
+    // 2. Parse into the offsets
+    float* verts = sink.verts(nV_, nV);
+    uint32_t* f2v = sink.cells(Kind::kTriangles, nF_, nF);
+    std::atomic<bool> ok{true};
+    thread_pool::getDefault().run(num_chunks, [&](size_t c) {
+      float* v_dst = verts + 3 * v_offsets[c];
+      uint32_t* f_dst = f2v + 3 * f_offsets[c];
+      bool result = records.forEachInChunk(c, 0, records.size(), [&](size_t, const char* p, const char* q) {
+        if (startsWith(p, q, "v")) {
+          bool ok = parseFloats(skipToken(p, q), q, v_dst, 3);
+          v_dst += 3;
+          return ok;
+        }
+        if (startsWith(p, q, "f")) {
+          p = skipToken(p, q);
+          uint32_t v0, v1, v2;
+          if (!parseFaceVertex(p, q, v0) || !parseFaceVertex(p, q, v1)) { return false; }
+          while (skipSpaces(p, q) < q) {
+            if (!parseFaceVertex(p, q, v2)) { return false; }
+            *f_dst++ = v0;
+            *f_dst++ = v1;
+            *f_dst++ = v2;
+            v1 = v2;
+          }
+        }
+        return true;
+      });
+      if (!result) { ok = false; }
+    });
+    if (!ok) { return false; }
+    sink.commit(Kind::kVerts, nV_, nV);
+    sink.commit(Kind::kTriangles, nF_, nF);
+    nV_ += nV;
+    nF_ += nF;
+    return true;
+  }
+};
+
+//
+// Drivers
+//
+
+// Whole text at once
+template<typename Parser, typename Sink>
+bool parse(const char* data, size_t size, Parser& parser, Sink& sink) {
+  Records records;
+  records.split(data, data + size);
+  return parser.consume(records, sink) && parser.finished();
+}
+
+// Memory-mapped file
+template<typename Parser, typename Sink>
+bool parseFile(const char* path, Parser& parser, Sink& sink) {
+  MappedFile file;
+  if (!file.open(path)) { return false; }
+  return parse(file.data_, file.size_, parser, sink);
+}
+
+// File read through `window` bytes at a time (a line must fit in the window)
+template<typename Parser, typename Sink>
+bool parseStream(const char* path, size_t window, Parser& parser, Sink& sink) {
+  FILE* file = std::fopen(path, "rb");
+  if (!file) { return false; }
+  vector<char> buffer(window);
+  size_t size = 0; // bytes in buffer
+  bool ok = true;
+  while (ok) {
+    size_t num_read = std::fread(buffer.data() + size, 1, window - size, file);
+    size += num_read;
+    bool eof = num_read == 0 || std::feof(file);
+    // Process complete lines (everything at the end of file)
+    size_t complete = size;
+    if (!eof) {
+      while (complete > 0 && buffer[complete - 1] != '\n') { complete--; }
+      if (complete == 0) {
+        ok = size < window; // line longer than window
+        continue;
+      }
+    }
+    Records records;
+    records.split(buffer.data(), buffer.data() + complete);
+    ok = parser.consume(records, sink);
+    std::memmove(buffer.data(), buffer.data() + complete, size - complete);
+    size -= complete;
+    if (eof && size == 0) { break; }
+  }
+  std::fclose(file);
+  return ok && parser.finished();
+}
+
+//
+// API
+//
+
+inline bool parseOFF(const char* data, size_t size, Mesh& result) {
+  OFFParser parser;
+  MeshSink sink{result};
+  return parse(data, size, parser, sink);
+}
+
+inline bool parseOBJ(const char* data, size_t size, Mesh& result) {
+  OBJParser parser;
+  MeshSink sink{result};
+  return parse(data, size, parser, sink);
+}
+
+inline bool parseMESH(const char* data, size_t size, Mesh& result) {
+  MESHParser parser;
+  MeshSink sink{result};
+  return parse(data, size, parser, sink);
+}
+
+inline bool readOFF(const char* path, Mesh& result) {
+  OFFParser parser;
+  MeshSink sink{result};
+  return parseFile(path, parser, sink);
+}
+
+inline bool readOBJ(const char* path, Mesh& result) {
+  OBJParser parser;
+  MeshSink sink{result};
+  return parseFile(path, parser, sink);
+}
+
+inline bool readMESH(const char* path, Mesh& result) {
+  MESHParser parser;
+  MeshSink sink{result};
+  return parseFile(path, parser, sink);
+}
+
+inline bool readELENODE(const char* ele_path, const char* node_path, Mesh& result) {
+  ELENODEParser node_parser{Kind::kVerts};
+  MeshSink sink{result};
+  if (!parseFile(node_path, node_parser, sink)) { return false; }
+  ELENODEParser ele_parser{Kind::kTetrahedra, node_parser.first_index_};
+  return parseFile(ele_path, ele_parser, sink);
+}
+
+// Streaming versions call `func(const Block&)` for each parsed block
+template<typename F>
+bool streamOFF(const char* path, size_t window, F func) {
+  OFFParser parser;
+  StreamSink<F> sink{func, {}, {}};
+  return parseStream(path, window, parser, sink);
+}
+
+template<typename F>
+bool streamOBJ(const char* path, size_t window, F func) {
+  OBJParser parser;
+  StreamSink<F> sink{func, {}, {}};
+  return parseStream(path, window, parser, sink);
+}
+
+template<typename F>
+bool streamMESH(const char* path, size_t window, F func) {
+  MESHParser parser;
+  StreamSink<F> sink{func, {}, {}};
+  return parseStream(path, window, parser, sink);
+}
+
+} // namespace reader
@@ -0,0 +1,205 @@
+#pragma once
+
+//
+// SIMD reductions (replaces impl::sum_sse in ex02_impl.cpp)
+//   - sum, dot, min, max, norm2 and axpy for float/double
+//   - Scalar head until the pointer is aligned to the vector size, aligned vector body and scalar tail,
+//     so that any pointer/length works (cf. the inverted prologue condition of the original sum_sse).
+//   - Body uses kAccumulators independent vector accumulators so that throughput isn't bound by add latency.
+//   - sumKahan (compensated per lane) and sumPairwise (blocked recursion) for better accuracy.
+//   - Instruction set (SSE, AVX2, simd128) follows simd.hpp i.e. compiler flags.
+//
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <limits>
+#include <type_traits>
+#include "simd.hpp"
+#if defined(USE_DISPATCH)
+#include "dispatch.hpp"
+#endif
+
+namespace reduce {
+
+constexpr size_t kAccumulators = 4;
+
+// Split [x, x + n) into scalar head, aligned vector body and scalar tail
+// and call `scalar(i)` for scalar indices and `body(i)` for each vector starting at i.
+// `body4(i)` handles kAccumulators vectors at once.
+template<typename T, typename FScalar, typename FVector, typename FVector4>
+inline void forEachBlock(const T* x, size_t n, FScalar scalar, FVector body, FVector4 body4) {
+  using V = typename simd::Vec<T>::type;
+  constexpr size_t L = simd::Vec<T>::kSize;
+  size_t i = 0;
+  while (i < n && (reinterpret_cast<uintptr_t>(x + i) % sizeof(V)) != 0) {
+    scalar(i++);
+  }
+  for (; i + kAccumulators * L <= n; i += kAccumulators * L) {
+    body4(i);
+  }
+  for (; i + L <= n; i += L) {
+    body(i);
+  }
+  for (; i < n; i++) {
+    scalar(i);
+  }
+}
+
+template<typename T, typename V>
+inline T horizontalSum(const V& v) {
+  T result = 0;
+  for (size_t k = 0; k < sizeof(V) / sizeof(T); k++) { result += v[k]; }
+  return result;
+}
+
+template<typename T>
+T sum(const T* x, size_t n) {
+#if defined(DISPATCH_ROUTE)
+  if constexpr (std::is_same_v<T, float>) { return dispatch::kernels().sum(x, n); }
+#endif
+  using V = typename simd::Vec<T>::type;
+  constexpr size_t L = simd::Vec<T>::kSize;
+  V acc[kAccumulators];
+  for (auto& a : acc) { a = simd::broadcast<V>(T(0)); }
+  T result = 0;
+  forEachBlock(x, n,
+    [&](size_t i) { result += x[i]; },
+    [&](size_t i) { acc[0] += simd::load<V>(x + i); },
+    [&](size_t i) {
+      for (size_t k = 0; k < kAccumulators; k++) { acc[k] += simd::load<V>(x + i + k * L); }
+    });
+  for (size_t k = 1; k < kAccumulators; k++) { acc[0] += acc[k]; }
+  return result + horizontalSum<T>(acc[0]);
+}
+
+template<typename T>
+T dot(const T* x, const T* y, size_t n) {
+#if defined(DISPATCH_ROUTE)
+  if constexpr (std::is_same_v<T, float>) { return dispatch::kernels().dot(x, y, n); }
+#endif
+  using V = typename simd::Vec<T>::type;
+  constexpr size_t L = simd::Vec<T>::kSize;
+  V acc[kAccumulators];
+  for (auto& a : acc) { a = simd::broadcast<V>(T(0)); }
+  T result = 0;
+  forEachBlock(x, n,
+    [&](size_t i) { result += x[i] * y[i]; },
+    [&](size_t i) { acc[0] += simd::load<V>(x + i) * simd::load<V>(y + i); },
+    [&](size_t i) {
+      for (size_t k = 0; k < kAccumulators; k++) {
+        acc[k] += simd::load<V>(x + i + k * L) * simd::load<V>(y + i + k * L);
+      }
+    });
+  for (size_t k = 1; k < kAccumulators; k++) { acc[0] += acc[k]; }
+  return result + horizontalSum<T>(acc[0]);
+}
+
+template<typename T>
+T norm2(const T* x, size_t n) {
+  return std::sqrt(dot(x, x, n));
+}
+
+template<bool kMax, typename V>
+inline V minmaxStep(const V& a, const V& b) {
+  return kMax ? simd::blend(a > b, a, b) : simd::blend(a < b, a, b);
+}
+
+// Returns +inf for min and -inf for max when n = 0
+template<typename T, bool kMax>
+T minmax(const T* x, size_t n) {
+  using V = typename simd::Vec<T>::type;
+  constexpr size_t L = simd::Vec<T>::kSize;
+  constexpr T kInit = kMax ? -std::numeric_limits<T>::infinity() : std::numeric_limits<T>::infinity();
+  V acc[kAccumulators];
+  for (auto& a : acc) { a = simd::broadcast<V>(kInit); }
+  T result = kInit;
+  forEachBlock(x, n,
+    [&](size_t i) { result = kMax ? std::max(result, x[i]) : std::min(result, x[i]); },
+    [&](size_t i) { acc[0] = minmaxStep<kMax>(acc[0], simd::load<V>(x + i)); },
+    [&](size_t i) {
+      for (size_t k = 0; k < kAccumulators; k++) { acc[k] = minmaxStep<kMax>(acc[k], simd::load<V>(x + i + k * L)); }
+    });
+  for (size_t k = 1; k < kAccumulators; k++) { acc[0] = minmaxStep<kMax>(acc[0], acc[k]); }
+  for (size_t k = 0; k < L; k++) {
+    result = kMax ? std::max(result, acc[0][k]) : std::min(result, acc[0][k]);
+  }
+  return result;
+}
+
+template<typename T>
+T min(const T* x, size_t n) { return minmax<T, false>(x, n); }
+
+template<typename T>
+T max(const T* x, size_t n) {
+#if defined(DISPATCH_ROUTE)
+  if constexpr (std::is_same_v<T, float>) { return dispatch::kernels().max(x, n); }
+#endif
+  return minmax<T, true>(x, n);
+}
+
+// y += a x
+template<typename T>
+void axpy(T a, const T* x, T* y, size_t n) {
+#if defined(DISPATCH_ROUTE)
+  if constexpr (std::is_same_v<T, float>) {
+    dispatch::kernels().axpy(a, x, y, n);
+    return;
+  }
+#endif
+  using V = typename simd::Vec<T>::type;
+  constexpr size_t L = simd::Vec<T>::kSize;
+  V av = simd::broadcast<V>(a);
+  auto step = [&](size_t i) { simd::store(y + i, simd::load<V>(y + i) + av * simd::load<V>(x + i)); };
+  // Align on y since it's written
+  forEachBlock<T>(y, n,
+    [&](size_t i) { y[i] += a * x[i]; },
+    step,
+    [&](size_t i) {
+      for (size_t k = 0; k < kAccumulators; k++) { step(i + k * L); }
+    });
+}
+
+// Kahan-Babuska (Neumaier) summation per lane
+template<typename T>
+T sumKahan(const T* x, size_t n) {
+  using V = typename simd::Vec<T>::type;
+  constexpr size_t L = simd::Vec<T>::kSize;
+  V s = simd::broadcast<V>(T(0));
+  V c = simd::broadcast<V>(T(0));
+  auto add = [&](const V& v) {
+    V t = s + v;
+    auto mask = simd::abs(s) >= simd::abs(v);
+    c += simd::blend(mask, (s - t) + v, (v - t) + s);
+    s = t;
+  };
+  T s_scalar = 0;
+  T c_scalar = 0;
+  auto add_scalar = [&](T v) {
+    T t = s_scalar + v;
+    c_scalar += std::abs(s_scalar) >= std::abs(v) ? (s_scalar - t) + v : (v - t) + s_scalar;
+    s_scalar = t;
+  };
+  forEachBlock(x, n,
+    [&](size_t i) { add_scalar(x[i]); },
+    [&](size_t i) { add(simd::load<V>(x + i)); },
+    [&](size_t i) {
+      for (size_t k = 0; k < kAccumulators; k++) { add(simd::load<V>(x + i + k * L)); }
+    });
+  for (size_t k = 0; k < L; k++) {
+    add_scalar(s[k]);
+    add_scalar(c[k]);
+  }
+  return s_scalar + c_scalar;
+}
+
+// Pairwise summation (error grows as O(log n) instead of O(n)) with SIMD `sum` at leaves
+template<typename T>
+T sumPairwise(const T* x, size_t n) {
+  constexpr size_t kLeaf = 1024;
+  if (n <= kLeaf) { return sum(x, n); }
+  size_t half = (n / 2 + kLeaf - 1) / kLeaf * kLeaf;
+  return sumPairwise(x, half) + sumPairwise(x + half, n - half);
+}
+
+} // namespace reduce
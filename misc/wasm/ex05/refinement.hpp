@@ -0,0 +1,114 @@
+#pragma once
+
+//
+// Mixed precision solver for symmetric positive definite MatrixCSR (iterative refinement)
+//
+// - Cholesky factorization and substitutions run in low precision (TLow = float),
+//   while residual r = b - A x and update x += d run in high precision (THigh = double):
+//     repeat
+//       r = b - A x       (THigh)
+//       L LT d = r        (TLow)
+//       x = x + d         (THigh)
+//   Each iteration reduces the error by roughly cond(A) * epsilon(TLow), thus a few iterations reach
+//   the accuracy of THigh unless A is too ill-conditioned for TLow (then residual stops decreasing).
+// - Stop criterion is relative residual |b - A x| / |b| < residue_lim (for every column) as pcg.hpp.
+//
+
+#include <algorithm>
+#include <cassert>
+#include <cmath>
+#include <vector>
+#include "matrix.hpp"
+#include "cholesky.hpp"
+
+namespace refinement {
+
+using std::vector;
+
+template<typename TLow = float, typename THigh = double>
+struct CholeskyRefinement {
+  MatrixCSR<THigh> A_;
+  MatrixCSR<TLow> A_low_; // A_ in TLow (pattern set by `compute`, values by `factorize`)
+  cholesky::Cholesky<TLow> cholesky_;
+
+  // Workspace
+  Matrix<THigh> r_;
+  Matrix<TLow> r_low_, d_low_;
+  vector<double> b_dot_, r_dot_;
+
+  // Report of last `solve`
+  int iteration_ = 0;
+  THigh residue_ = 0; // max relative residual over columns
+
+  // Returns false when A is not positive definite in TLow
+  bool compute(const MatrixCSR<THigh>& A, cholesky::Ordering ordering = cholesky::Ordering::kND) {
+    A_ = A;
+    A_low_ = MatrixCSR<TLow>::cast(A);
+    return cholesky_.compute(A_low_, ordering);
+  }
+
+  // Same pattern with new values (values are cast in place, thus no allocation)
+  bool factorize(const MatrixCSR<THigh>& A) {
+    assert(A.nnz() == A_.nnz());
+    A_.data_ = A.data_;
+    if (A_low_.data_.size() != A.data_.size()) {
+      A_low_ = MatrixCSR<TLow>::cast(A); // e.g. A_ and cholesky_ restored by cache::read
+    } else {
+      std::copy(A.data_.begin(), A.data_.end(), A_low_.data_.begin());
+    }
+    return cholesky_.factorize(A_low_);
+  }
+
+  // Column-wise squared norm (accumulated in double)
+  static void norm2(const Matrix<THigh>& a, vector<double>& result) {
+    size_t nc = a.shape_[1];
+    result.assign(nc, 0);
+    for (size_t i = 0; i < a.shape_[0]; i++) {
+      for (size_t k = 0; k < nc; k++) {
+        result[k] += double(a(i, k)) * double(a(i, k));
+      }
+    }
+  }
+
+  // A x = b starting from given x (`iter_lim` refinement steps at most).
+  // Returns true when converged.
+  // `residue_lim = 0` runs exactly `iter_lim` steps (e.g. PD global step) and skips the residual after
+  // the last step, thus `residue_` is then the residual before the last step.
+  bool solve(Matrix<THigh>& x, const Matrix<THigh>& b, int iter_lim = 4, THigh residue_lim = 1e-10) {
+    assert(x.shape_[0] == A_.shape_[0] && b.shape_[0] == A_.shape_[0]);
+    assert(x.shape_[1] == b.shape_[1]);
+    size_t n = A_.shape_[0];
+    size_t nc = b.shape_[1];
+    r_.resize(n, nc);
+    d_low_.resize(n, nc);
+
+    norm2(b, b_dot_);
+    auto updateResidue = [&]() {
+      // r = b - A x
+      MatrixCSR<THigh>::matmul_(A_, x, r_);
+      for (size_t i = 0; i < n * nc; i++) { r_.data_[i] = b.data_[i] - r_.data_[i]; }
+      norm2(r_, r_dot_);
+      bool converged = true;
+      residue_ = 0;
+      for (size_t k = 0; k < nc; k++) {
+        double r_rel = std::sqrt(r_dot_[k] / std::max(b_dot_[k], 1e-300));
+        converged = converged && r_rel < residue_lim;
+        residue_ = std::max<THigh>(residue_, r_rel);
+      }
+      return converged;
+    };
+
+    for (iteration_ = 0; iteration_ < iter_lim; iteration_++) {
+      if (updateResidue()) { return true; }
+
+      // d = A^-1 r in low precision
+      Matrix<TLow>::cast_(r_, r_low_);
+      cholesky_.solve(d_low_, r_low_);
+      for (size_t i = 0; i < n * nc; i++) { x.data_[i] += THigh(d_low_.data_[i]); }
+    }
+    if (!(residue_lim > 0)) { return false; }
+    return updateResidue();
+  }
+};
+
+} // namespace refinement
@@ -0,0 +1,278 @@
+#pragma once
+
+//
+// Work-stealing scheduler for fork/join parallelism (irregular or nested workloads)
+//   - Each worker owns a deque. Forked tasks are pushed/popped at the back by the owner (LIFO)
+//     and idle workers steal from the front of a random victim (the oldest thus largest piece of work).
+//   - `parallelInvoke(f, g, ...)` forks all but the first function, runs the first one and joins the rest.
+//     Join runs the task itself when nobody stole it, otherwise it executes other tasks while waiting,
+//     so nested fork/join doesn't block workers (unlike ThreadPool where nested calls run serially).
+//   - `parallelFor`/`parallelReduce` split the range in halves recursively down to `grain`,
+//     thus load balancing comes from stealing instead of fixed partition.
+//     Partial results are combined following the split tree, so reduction doesn't depend on scheduling.
+//   - Default grain gives ~8 leaves per thread (cf. `defaultGrain`), i.e. enough slack for stealing
+//     while keeping per-task overhead (a few hundred ns) negligible.
+//   - Deques are guarded by a mutex per worker, which is simpler than lock-free Chase-Lev deque
+//     and only contends when stealing.
+//   - Workers are those of a thread_pool::ThreadPool (the default pool unless constructed with a size),
+//     so that fork/join and chunked loops share one set of threads (no oversubscription, and
+//     PTHREAD_POOL_SIZE on wasm bounds both). The outermost call runs as one pool job where every thread
+//     takes its own deque: one runs the root function and the others steal until it returns.
+//   - Outermost calls from several external threads are serialized (`root_mutex_`), and calls from inside
+//     of a ThreadPool job run serially (as nested ThreadPool calls do).
+//
+
+#include <algorithm>
+#include <atomic>
+#include <cstdint>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <thread>
+#include <vector>
+#include "thread_pool.hpp"
+
+namespace scheduler {
+
+struct Task {
+  std::atomic<bool> done_{false};
+
+  virtual ~Task() = default;
+  virtual void execute() = 0;
+
+  void run() {
+    execute();
+    done_.store(true, std::memory_order_release);
+  }
+};
+
+// Task referring to a function on the forking thread's stack (alive until join)
+template<typename F>
+struct FunctionTask : Task {
+  const F& func_;
+  FunctionTask(const F& func) : func_{func} {}
+  void execute() override { func_(); }
+};
+
+struct TaskDeque {
+  std::mutex mutex_;
+  std::deque<Task*> tasks_;
+
+  void push(Task* task) {
+    std::lock_guard<std::mutex> lock{mutex_};
+    tasks_.push_back(task);
+  }
+
+  // Owner side
+  Task* pop() {
+    std::lock_guard<std::mutex> lock{mutex_};
+    if (tasks_.empty()) { return nullptr; }
+    auto result = tasks_.back();
+    tasks_.pop_back();
+    return result;
+  }
+
+  // Thief side
+  Task* steal() {
+    std::lock_guard<std::mutex> lock{mutex_};
+    if (tasks_.empty()) { return nullptr; }
+    auto result = tasks_.front();
+    tasks_.pop_front();
+    return result;
+  }
+
+  // Remove `task` if it's still at the back (i.e. not stolen)
+  bool popIf(Task* task) {
+    std::lock_guard<std::mutex> lock{mutex_};
+    if (tasks_.empty() || tasks_.back() != task) { return false; }
+    tasks_.pop_back();
+    return true;
+  }
+};
+
+struct Scheduler {
+  std::unique_ptr<thread_pool::ThreadPool> own_pool_; // null for the default pool
+  std::vector<std::unique_ptr<TaskDeque>> deques_;    // deques_[k] for k-th thread of current root
+  std::mutex root_mutex_;
+
+  // Workers of `thread_pool::getDefault()` (looked up at each outermost call, cf. thread_pool::setNumThreads)
+  Scheduler() {}
+
+  // Own pool of `num_threads` (including calling thread)
+  Scheduler(size_t num_threads) : own_pool_{std::make_unique<thread_pool::ThreadPool>(num_threads)} {}
+
+  thread_pool::ThreadPool& pool() const {
+    return own_pool_ ? *own_pool_ : thread_pool::getDefault();
+  }
+
+  size_t size() const { return pool().size(); }
+
+  struct ThreadState {
+    Scheduler* scheduler = nullptr;
+    size_t index = 0;
+    uint64_t rng = 0x9e3779b97f4a7c15;
+  };
+
+  static ThreadState& threadState() {
+    static thread_local ThreadState result;
+    return result;
+  }
+
+  bool inside() { return threadState().scheduler == this; }
+
+  void push(Task* task) {
+    deques_[threadState().index]->push(task);
+  }
+
+  // Own deque first, then steal starting from random victim
+  Task* findTask() {
+    auto& state = threadState();
+    size_t self = state.index;
+    if (auto task = deques_[self]->pop()) { return task; }
+    auto& rng = state.rng;
+    rng ^= rng << 13; rng ^= rng >> 7; rng ^= rng << 17; // xorshift64
+    size_t n = deques_.size();
+    size_t start = rng % n;
+    for (size_t k = 0; k < n; k++) {
+      size_t victim = (start + k) % n;
+      if (victim == self) { continue; }
+      if (auto task = deques_[victim]->steal()) { return task; }
+    }
+    return nullptr;
+  }
+
+  // Outermost call: run `func` as a pool job where the other threads execute forked tasks until it returns
+  template<typename F>
+  void root(const F& func) {
+    std::lock_guard<std::mutex> lock{root_mutex_};
+    auto& pool = this->pool();
+    size_t n = pool.size();
+    while (deques_.size() < n) { deques_.push_back(std::make_unique<TaskDeque>()); }
+    std::atomic<size_t> next_index{0};
+    std::atomic<bool> done{false};
+    pool.run(n, [&](size_t) {
+      size_t index = next_index.fetch_add(1);
+      auto& state = threadState();
+      auto saved = state;
+      state = {this, index, 0x9e3779b97f4a7c15 * (index + 1)};
+      if (index == 0) {
+        func();
+        done.store(true, std::memory_order_release);
+      } else {
+        while (!done.load(std::memory_order_acquire)) {
+          if (auto task = findTask()) {
+            task->run();
+          } else {
+            std::this_thread::yield();
+          }
+        }
+      }
+      state = saved;
+    });
+  }
+
+  // Run `task` here if it's not stolen, otherwise execute other tasks until it's done
+  void join(Task& task) {
+    if (deques_[threadState().index]->popIf(&task)) {
+      task.run();
+      return;
+    }
+    while (!task.done_.load(std::memory_order_acquire)) {
+      if (auto other = findTask()) {
+        other->run();
+      } else {
+        std::this_thread::yield();
+      }
+    }
+  }
+
+  // Run all functions potentially in parallel and wait all
+  template<typename F, typename... Fs>
+  void parallelInvoke(const F& func, const Fs&... funcs) {
+    if constexpr (sizeof...(Fs) == 0) {
+      func();
+    } else {
+      if (!inside()) {
+        if (size() == 1) {
+          func();
+          parallelInvoke(funcs...);
+          return;
+        }
+        root([&]() { parallelInvoke(func, funcs...); });
+        return;
+      }
+      auto rest = [&]() { parallelInvoke(funcs...); };
+      FunctionTask<decltype(rest)> task{rest};
+      push(&task);
+      func();
+      join(task);
+    }
+  }
+
+  size_t defaultGrain(size_t n) const {
+    return std::max<size_t>(1, n / (8 * size()));
+  }
+
+  // Call `func(i_begin, i_end)` for disjoint ranges covering [begin, end) with i_end - i_begin <= grain
+  template<typename F>
+  void parallelFor(size_t begin, size_t end, size_t grain, const F& func) {
+    if (end <= begin) { return; }
+    if (grain == 0) { grain = defaultGrain(end - begin); }
+    forRange(begin, end, grain, func);
+  }
+
+  template<typename F>
+  void forRange(size_t begin, size_t end, size_t grain, const F& func) {
+    if (end - begin <= grain) {
+      func(begin, end);
+      return;
+    }
+    size_t mid = begin + (end - begin) / 2;
+    parallelInvoke(
+        [&]() { forRange(begin, mid, grain, func); },
+        [&]() { forRange(mid, end, grain, func); });
+  }
+
+  // combine(..., combine(func(i0, i1), func(i1, i2)) ...) over the split tree (`identity` for empty range)
+  template<typename T, typename F, typename C>
+  T parallelReduce(size_t begin, size_t end, size_t grain, T identity, const F& func, const C& combine) {
+    if (end <= begin) { return identity; }
+    if (grain == 0) { grain = defaultGrain(end - begin); }
+    return reduceRange<T>(begin, end, grain, func, combine);
+  }
+
+  // Partial results are held by std::optional, so T doesn't have to be default constructible
+  template<typename T, typename F, typename C>
+  T reduceRange(size_t begin, size_t end, size_t grain, const F& func, const C& combine) {
+    if (end - begin <= grain) {
+      return func(begin, end);
+    }
+    size_t mid = begin + (end - begin) / 2;
+    std::optional<T> left, right;
+    parallelInvoke(
+        [&]() { left.emplace(reduceRange<T>(begin, mid, grain, func, combine)); },
+        [&]() { right.emplace(reduceRange<T>(mid, end, grain, func, combine)); });
+    return combine(std::move(*left), std::move(*right));
+  }
+};
+
+//
+// Default scheduler on the workers of thread_pool::getDefault()
+//
+
+inline Scheduler& getDefault() {
+  static Scheduler result;
+  return result;
+}
+
+// Same as thread_pool::setNumThreads since workers are shared
+inline void setNumThreads(size_t num_threads) {
+  thread_pool::setNumThreads(num_threads);
+}
+
+inline size_t getNumThreads() {
+  return getDefault().size();
+}
+
+} // namespace scheduler
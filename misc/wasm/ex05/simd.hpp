@@ -0,0 +1,135 @@
+#pragma once
+
+//
+// Thin wrapper of GCC/Clang vector extension
+// so that the same code compiles to SSE/AVX2 (native) or simd128 (wasm).
+// When no SIMD instruction set is enabled, the compiler lowers vectors to scalar code.
+//
+// Instruction set follows compiler flags unless one of SIMD_AVX512/SIMD_AVX/SIMD_SSE is defined beforehand
+// (cf. dispatch_kernels.hpp which includes this header under `#pragma GCC target` for several targets).
+//
+
+#include <cstdint>
+#include <cmath>
+#include <cstring>
+
+#if !defined(SIMD_AVX512) && !defined(SIMD_AVX) && !defined(SIMD_SSE)
+#if defined(__AVX512F__)
+#define SIMD_AVX512
+#elif defined(__AVX__)
+#define SIMD_AVX
+#elif defined(__SSE__)
+#define SIMD_SSE
+#endif
+#endif
+
+#if defined(SIMD_AVX512) || defined(SIMD_AVX)
+#include <immintrin.h>
+#elif defined(SIMD_SSE)
+#include <xmmintrin.h>
+#elif defined(__wasm_simd128__)
+#include <wasm_simd128.h>
+#endif
+
+namespace simd {
+
+#if defined(SIMD_AVX512)
+constexpr int kWidth = 16;
+#elif defined(SIMD_AVX)
+constexpr int kWidth = 8;
+#else
+constexpr int kWidth = 4;
+#endif
+
+typedef float floatv __attribute__((vector_size(4 * kWidth)));
+typedef int32_t intv __attribute__((vector_size(4 * kWidth)));
+
+typedef double doublev __attribute__((vector_size(4 * kWidth)));
+typedef int64_t longv __attribute__((vector_size(4 * kWidth)));
+
+// Vector type with the same register width for each scalar type
+template<typename T> struct Vec;
+template<> struct Vec<float> { typedef floatv type; static constexpr int kSize = kWidth; };
+template<> struct Vec<double> { typedef doublev type; static constexpr int kSize = kWidth / 2; };
+
+// Unaligned load/store (memcpy compiles to a single movups/v128.load)
+template<typename V, typename T>
+inline V load(const T* ptr) {
+  V result;
+  std::memcpy(&result, ptr, sizeof(V));
+  return result;
+}
+
+template<typename V, typename T>
+inline void store(T* ptr, const V& v) {
+  std::memcpy(ptr, &v, sizeof(V));
+}
+
+template<typename V, typename T>
+inline V broadcast(T v) {
+  // Scalar operand of vector arithmetic is splatted (per-lane assignment compiles to lane inserts with 16 lanes)
+  // and `v - 0` keeps the sign of -0.0
+  return v - V{};
+}
+
+inline floatv splat(float v) {
+  floatv result;
+  for (auto k = 0; k < kWidth; k++) { result[k] = v; }
+  return result;
+}
+
+inline intv splati(int32_t v) {
+  intv result;
+  for (auto k = 0; k < kWidth; k++) { result[k] = v; }
+  return result;
+}
+
+// Bitwise blend (mask is the result of vector comparison i.e. all 0 or all 1 bits per lane)
+inline floatv select(const intv& mask, const floatv& a, const floatv& b) {
+  return (floatv)((mask & (intv)a) | (~mask & (intv)b));
+}
+
+inline floatv abs(const floatv& v) {
+  return (floatv)((intv)v & splati(0x7fffffff));
+}
+
+inline doublev abs(const doublev& v) {
+  return (doublev)((longv)v & ~(longv)broadcast<doublev>(-0.0));
+}
+
+// Bitwise blend for any vector type (`mask` is the result of vector comparison)
+template<typename M, typename V>
+inline V blend(const M& mask, const V& a, const V& b) {
+  return (V)((mask & (M)a) | (~mask & (M)b));
+}
+
+inline floatv sqrt(const floatv& v) {
+#if defined(SIMD_AVX512)
+  return (floatv)_mm512_maskz_sqrt_ps(0xffff, (__m512)v);
+#elif defined(SIMD_AVX)
+  return (floatv)_mm256_sqrt_ps((__m256)v);
+#elif defined(SIMD_SSE)
+  return (floatv)_mm_sqrt_ps((__m128)v);
+#elif defined(__wasm_simd128__)
+  return (floatv)wasm_f32x4_sqrt((v128_t)v);
+#else
+  floatv result;
+  for (auto k = 0; k < kWidth; k++) { result[k] = std::sqrt(v[k]); }
+  return result;
+#endif
+}
+
+// True when every lane of the comparison result is set (e.g. early exit of batched iterations)
+inline bool all(const intv& mask) {
+  bool result = true;
+  for (auto k = 0; k < kWidth; k++) { result = result && mask[k] != 0; }
+  return result;
+}
+
+// Scalar overloads so that the same template can be instantiated with float and floatv (e.g. misc::polarStep)
+inline float abs(float v) { return std::abs(v); }
+inline float sqrt(float v) { return std::sqrt(v); }
+inline float select(bool mask, float a, float b) { return mask ? a : b; }
+inline bool all(bool mask) { return mask; }
+
+} // namespace simd
@@ -46,9 +46,133 @@ describe('wasm', () => {
       // [ Debug ]
       // console.log(_.chunk(p.data(), 9).map(a => _.chunk(a, 3).join('\n')).join('\n- - - - - - -\n'))
 
+      p.assignZeros(9 * n)
+      assert(p.data().every(a => a === 0))
+
       u1.delete()
       u2.delete()
       p.delete()
     })
+
+    it('ProjectiveDynamics', async () => {
+      const { ProjectiveDynamics } = await requireEm('./ex05/build/js/Release/em.js')
+
+      // Single tetrahedron pinned at vertex 0
+      const solver = new ProjectiveDynamics(4, 1, 1)
+      solver.verts().set([0, 0, 0, 1, 0, 0, 0, 1, 0, 0, 0, 1])
+      solver.c3xc0().set([0, 1, 2, 3])
+      solver.handles().set([0])
+      solver.handleTargets().set([0, 0, 0])
+      assert(solver.init(32))
+
+      const t0 = performance.now()
+      for (let i = 0; i < 60; i++) {
+        solver.update()
+      }
+      const t1 = performance.now()
+      console.log(`ProjectiveDynamics.update (x 60): ${(t1 - t0).toPrecision(3)} msec`)
+
+      const verts = solver.verts()
+      assert(verts.every(Number.isFinite))
+      assert(verts.slice(0, 3).every(a => Math.abs(a) < 5e-2))
+
+      solver.delete()
+    })
+
+    it('trace', async () => {
+      const { ProjectiveDynamics, traceEnable, traceClear, traceToJSON } = await requireEm('./ex05/build/js/Release/em.js')
+
+      const solver = new ProjectiveDynamics(4, 1, 1)
+      solver.verts().set([0, 0, 0, 1, 0, 0, 0, 1, 0, 0, 0, 1])
+      solver.c3xc0().set([0, 1, 2, 3])
+      assert(solver.init(32))
+
+      traceClear()
+      traceEnable(true)
+      solver.update()
+      traceEnable(false)
+
+      const { traceEvents } = JSON.parse(traceToJSON())
+      const zones = traceEvents.filter(e => e.ph === 'X')
+      assert(zones.some(e => e.name === 'ProjectiveDynamics::update'))
+      assert(zones.every(e => e.dur >= 0))
+
+      traceClear()
+      solver.delete()
+    })
+
+    it('Mesh', async () => {
+      const { Mesh } = await requireEm('./ex05/build/js/Release/em.js')
+
+      // Tetrahedron (closed surface)
+      const mesh = new Mesh(4, 4)
+      mesh.verts().set([0, 0, 0, 1, 0, 0, 0, 1, 0, 0, 0, 1])
+      mesh.f2v().set([0, 2, 1, 0, 1, 3, 0, 3, 2, 1, 2, 3])
+      assert(mesh.init())
+      assert.strictEqual(mesh.numEdges(), 6)
+      assert(!mesh.hasBoundary())
+
+      // Gauss-Bonnet and zero row sums of Laplacian
+      const kg = _.sum(Array.from(mesh.kg()))
+      assert(Math.abs(kg - 4 * Math.PI) < 1e-4)
+      const indptr = mesh.laplacianIndptr()
+      const data = mesh.laplacianData()
+      for (let i = 0; i < 4; i++) {
+        assert(Math.abs(_.sum(Array.from(data.slice(indptr[i], indptr[i + 1])))) < 1e-5)
+      }
+
+      mesh.delete()
+    })
+
+    it('Delaunay', async () => {
+      const { Delaunay, Vector } = await requireEm('./ex05/build/js/Release/em.js')
+
+      // Unit cube corners and center (12 tetrahedra of volume 1 / 12)
+      const verts = Vector.zeros(27)
+      verts.data().set([0, 0, 0, 1, 0, 0, 0, 1, 0, 1, 1, 0, 0, 0, 1, 1, 0, 1, 0, 1, 1, 1, 1, 1, 0.5, 0.5, 0.5])
+      const solver = new Delaunay()
+      assert(solver.compute(verts))
+      assert.strictEqual(solver.numSkipped(), 0)
+      const c3xc0 = solver.c3xc0()
+      assert.strictEqual(c3xc0.length, 4 * 12)
+      assert(c3xc0.every(v => v < 9))
+
+      solver.delete()
+      verts.delete()
+    })
+
+    it('TreeCotree', async () => {
+      const { Mesh, TreeCotree } = await requireEm('./ex05/build/js/Release/em.js')
+
+      // 4 x 4 torus (genus 1)
+      const n = 4
+      const mesh = new Mesh(n * n, 2 * n * n)
+      const verts = mesh.verts()
+      const f2v = mesh.f2v()
+      const vertex = (i, j) => (j % n) * n + (i % n)
+      for (let j = 0; j < n; j++) {
+        for (let i = 0; i < n; i++) {
+          const p = 2 * Math.PI * i / n
+          const t = 2 * Math.PI * j / n
+          const r = 1 + 0.3 * Math.cos(t)
+          verts.set([r * Math.cos(p), r * Math.sin(p), 0.3 * Math.sin(t)], 3 * vertex(i, j))
+          const v0 = vertex(i, j); const v1 = vertex(i + 1, j); const v2 = vertex(i, j + 1); const v3 = vertex(i + 1, j + 1)
+          f2v.set([v0, v1, v3, v0, v3, v2], 6 * vertex(i, j))
+        }
+      }
+      assert(mesh.init())
+
+      const treeCotree = new TreeCotree()
+      assert(treeCotree.compute(mesh))
+      assert.strictEqual(treeCotree.generators().length, 2)
+      const indptr = treeCotree.loopsIndptr()
+      const loops = treeCotree.loops()
+      assert.strictEqual(indptr.length, 3)
+      assert.strictEqual(indptr[2], loops.length)
+      assert(loops.every(e => e < mesh.numEdges()))
+
+      treeCotree.delete()
+      mesh.delete()
+    })
   })
 })
@@ -0,0 +1,240 @@
+#pragma once
+
+//
+// Persistent thread pool with chunked parallel-for (cf. scheduler.hpp for work-stealing fork/join)
+//   - Calling thread also works on chunks, thus `ThreadPool(n)` spawns n - 1 workers.
+//   - Nested calls (e.g. parallelFor inside of parallelFor) run serially on the calling thread.
+//   - Emscripten without USE_PTHREADS runs everything on the calling thread.
+//     With USE_PTHREADS, the number of threads shouldn't exceed PTHREAD_POOL_SIZE + 1
+//     since the main thread blocks until the workers finish (cf. THREAD_POOL_DEFAULT_SIZE).
+//   - Jobs are passed by reference (function pointer + context) so that `run` doesn't allocate.
+//   - One job at a time: outermost calls from several external threads queue on `run_mutex_`.
+//   - `resize` (e.g. thread_pool::setNumThreads) replaces the workers in place once the running job finishes,
+//     so references to the pool (e.g. `getDefault()`) stay valid.
+//
+
+#include <algorithm>
+#include <atomic>
+#include <cassert>
+#include <condition_variable>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <type_traits>
+#include <vector>
+#include "arena.hpp"
+#include "trace.hpp"
+
+namespace thread_pool {
+
+#if defined(__EMSCRIPTEN__) && !defined(__EMSCRIPTEN_PTHREADS__)
+constexpr bool kHasThreads = false;
+#else
+constexpr bool kHasThreads = true;
+#endif
+
+struct ThreadPool {
+  std::vector<std::thread> workers_;
+  std::atomic<size_t> num_threads_{1}; // workers_.size() + 1 (readable while `resize` runs)
+  std::mutex run_mutex_; // held by `run` for whole job and by `resize`
+  std::mutex mutex_;
+  std::condition_variable cv_start_;
+  std::condition_variable cv_finish_;
+
+  // Current job (`generation_` is incremented for each job)
+  void (*job_)(const void*, size_t) = nullptr;
+  const void* job_context_ = nullptr;
+  size_t num_chunks_ = 0;
+  std::atomic<size_t> next_chunk_{0};
+  size_t generation_ = 0;
+  size_t num_running_ = 0;
+  bool stop_ = false;
+
+  ThreadPool(size_t num_threads) {
+    startWorkers(num_threads);
+  }
+
+  ~ThreadPool() {
+    stopWorkers();
+  }
+
+  size_t size() const { return num_threads_.load(std::memory_order_relaxed); }
+
+  // Replace workers by `num_threads - 1` new ones (waits for the running job, not callable from inside of a job)
+  void resize(size_t num_threads) {
+    assert(!insideJob());
+    std::lock_guard<std::mutex> lock{run_mutex_};
+    stopWorkers();
+    startWorkers(num_threads);
+  }
+
+  // No job is running (constructor or `run_mutex_` held)
+  void startWorkers(size_t num_threads) {
+    size_t generation = generation_; // new workers wait for the next job
+    for (size_t i = 1; kHasThreads && i < num_threads; i++) {
+      workers_.emplace_back([this, generation]() { workerLoop(generation); });
+    }
+    num_threads_.store(workers_.size() + 1, std::memory_order_relaxed);
+  }
+
+  void stopWorkers() {
+    {
+      std::lock_guard<std::mutex> lock{mutex_};
+      stop_ = true;
+    }
+    cv_start_.notify_all();
+    for (auto& worker : workers_) {
+      worker.join();
+    }
+    workers_.clear();
+    stop_ = false;
+  }
+
+  static bool& insideJob() {
+    static thread_local bool result = false;
+    return result;
+  }
+
+  void workerLoop(size_t generation) {
+    insideJob() = true;
+    while (true) {
+      {
+        std::unique_lock<std::mutex> lock{mutex_};
+        cv_start_.wait(lock, [&]() { return stop_ || generation != generation_; });
+        if (stop_) { return; }
+        generation = generation_;
+      }
+      runChunks();
+      {
+        std::lock_guard<std::mutex> lock{mutex_};
+        if (--num_running_ == 0) {
+          cv_finish_.notify_one();
+        }
+      }
+    }
+  }
+
+  void runChunks() {
+    while (true) {
+      size_t chunk = next_chunk_.fetch_add(1);
+      if (chunk >= num_chunks_) { break; }
+      TRACE_ZONE("thread_pool::chunk");
+      job_(job_context_, chunk);
+    }
+  }
+
+  // Call `func(chunk)` for each chunk in [0, num_chunks) and wait all
+  template<typename F>
+  void run(size_t num_chunks, const F& func) {
+    auto runSerial = [&]() {
+      for (size_t i = 0; i < num_chunks; i++) {
+        func(i);
+      }
+    };
+    if (num_chunks <= 1 || insideJob()) {
+      runSerial();
+      return;
+    }
+
+    std::lock_guard<std::mutex> run_lock{run_mutex_};
+    if (workers_.empty()) {
+      insideJob() = true; // nested calls stay serial as with workers
+      runSerial();
+      insideJob() = false;
+      return;
+    }
+
+    {
+      std::lock_guard<std::mutex> lock{mutex_};
+      job_ = [](const void* context, size_t chunk) { (*static_cast<const F*>(context))(chunk); };
+      job_context_ = &func;
+      num_chunks_ = num_chunks;
+      next_chunk_ = 0;
+      num_running_ = workers_.size();
+      generation_++;
+    }
+    cv_start_.notify_all();
+
+    insideJob() = true;
+    runChunks();
+    insideJob() = false;
+
+    {
+      std::unique_lock<std::mutex> lock{mutex_};
+      cv_finish_.wait(lock, [&]() { return num_running_ == 0; });
+      job_ = nullptr;
+      job_context_ = nullptr;
+    }
+  }
+
+  // Default grain gives a few chunks per thread so that faster threads can pick up more
+  size_t defaultGrain(size_t n) const {
+    size_t num_chunks = 4 * size();
+    return std::max<size_t>(1, (n + num_chunks - 1) / num_chunks);
+  }
+
+  // Call `func(i_begin, i_end)` for chunks of [begin, end)
+  template<typename F>
+  void parallelFor(size_t begin, size_t end, size_t grain, const F& func) {
+    if (end <= begin) { return; }
+    if (grain == 0) { grain = defaultGrain(end - begin); }
+    size_t num_chunks = (end - begin + grain - 1) / grain;
+    run(num_chunks, [&](size_t chunk) {
+      size_t i_begin = begin + chunk * grain;
+      size_t i_end = std::min(end, i_begin + grain);
+      func(i_begin, i_end);
+    });
+  }
+
+  // Sum of `func(i_begin, i_end)` over chunks (summed in chunk order so that result is deterministic)
+  template<typename T, typename F>
+  T parallelReduce(size_t begin, size_t end, size_t grain, T init, const F& func) {
+    if (end <= begin) { return init; }
+    if (grain == 0) { grain = defaultGrain(end - begin); }
+    size_t num_chunks = (end - begin + grain - 1) / grain;
+    auto reduce = [&](T* partials) {
+      run(num_chunks, [&](size_t chunk) {
+        size_t i_begin = begin + chunk * grain;
+        size_t i_end = std::min(end, i_begin + grain);
+        partials[chunk] = func(i_begin, i_end);
+      });
+      T result = init;
+      for (size_t chunk = 0; chunk < num_chunks; chunk++) {
+        result += partials[chunk];
+      }
+      return result;
+    };
+    // Partials from the calling thread's arena (e.g. float/double) or vector
+    if constexpr (std::is_trivially_copyable_v<T>) {
+      arena::Scope scope{arena::threadArena()};
+      return reduce(scope.allocate<T>(num_chunks));
+    } else {
+      std::vector<T> partials(num_chunks, T(0));
+      return reduce(partials.data());
+    }
+  }
+};
+
+//
+// Default pool shared by kernels (misc::solve, sum_parallel, etc...)
+//
+
+#ifndef THREAD_POOL_DEFAULT_SIZE
+#define THREAD_POOL_DEFAULT_SIZE std::max<size_t>(1, std::thread::hardware_concurrency())
+#endif
+
+inline ThreadPool& getDefault() {
+  static ThreadPool result{THREAD_POOL_DEFAULT_SIZE}; // thread-safe initialization
+  return result;
+}
+
+// Waits for the running job of the default pool (references from `getDefault()` stay valid)
+inline void setNumThreads(size_t num_threads) {
+  getDefault().resize(std::max<size_t>(1, num_threads));
+}
+
+inline size_t getNumThreads() {
+  return getDefault().size();
+}
+
+} // namespace thread_pool
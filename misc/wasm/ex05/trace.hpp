@@ -0,0 +1,228 @@
+#pragma once
+
+//
+// Low overhead tracing of scoped zones and counters exported as Chrome trace JSON (chrome://tracing or ui.perfetto.dev)
+// (replaces uncommenting misc2.measure blocks in src/utils/physics.js)
+//   - TRACE_ZONE("name") records the enclosing scope as a complete event ("ph": "X") and
+//     TRACE_COUNTER("name", value) records a counter event ("ph": "C").
+//     Names are kept by pointer, thus they should be string literals (or `intern`ed).
+//   - Each thread writes to its own ring buffer without lock (single producer) keeping the latest `kCapacity` events.
+//     Buffers outlive their thread so that `toJSON` can still read them, and a buffer of an exited thread
+//     is taken over by the next new thread (same track), so memory is bounded by the number of live threads
+//     (e.g. thread_pool::setNumThreads doesn't leak kCapacity events per old worker).
+//   - Recording is off until `enable(true)` (disabled zone is a relaxed atomic load) and
+//     building without USE_TRACE (cmake -DUSE_TRACE=OFF) compiles the macros away.
+//   - `toJSON`, `write` and `clear` should be called while traced kernels are idle (e.g. between frames).
+//
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+namespace trace {
+
+using std::vector;
+
+constexpr size_t kCapacity = 1 << 16; // events per thread (power of two)
+
+enum class Kind : uint32_t { kZone, kCounter };
+
+struct Event {
+  const char* name;
+  uint64_t begin; // ns since epoch
+  uint64_t end;   // ns since epoch (same as begin for counter)
+  double value;   // counter value
+  Kind kind;
+};
+
+// Ring buffer written only by its own thread
+struct Buffer {
+  uint32_t tid_;
+  std::atomic<uint64_t> head_{0}; // number of events written so far
+  std::atomic<bool> in_use_{true}; // false after its thread exited
+  vector<Event> events_;
+
+  Buffer(uint32_t tid) : tid_{tid}, events_(kCapacity) {}
+
+  void push(const Event& event) {
+    uint64_t head = head_.load(std::memory_order_relaxed);
+    events_[head & (kCapacity - 1)] = event;
+    head_.store(head + 1, std::memory_order_release);
+  }
+};
+
+struct Registry {
+  std::atomic<bool> enabled_{false};
+  std::chrono::steady_clock::time_point epoch_ = std::chrono::steady_clock::now();
+  std::mutex mutex_;
+  vector<std::shared_ptr<Buffer>> buffers_;
+  std::deque<std::string> names_; // interned names
+};
+
+inline Registry& registry() {
+  static Registry result;
+  return result;
+}
+
+inline bool enabled() { return registry().enabled_.load(std::memory_order_relaxed); }
+
+inline void enable(bool value) { registry().enabled_.store(value, std::memory_order_relaxed); }
+
+inline uint64_t now() {
+  auto duration = std::chrono::steady_clock::now() - registry().epoch_;
+  return uint64_t(std::chrono::duration_cast<std::chrono::nanoseconds>(duration).count());
+}
+
+// Releases the buffer at thread exit
+struct BufferOwner {
+  Buffer* buffer_ = nullptr;
+  ~BufferOwner() {
+    if (buffer_) { buffer_->in_use_.store(false, std::memory_order_release); }
+  }
+};
+
+// Buffer of calling thread (buffer of exited thread or new one on first use)
+inline Buffer& threadBuffer() {
+  thread_local BufferOwner owner;
+  if (!owner.buffer_) {
+    auto& r = registry();
+    std::lock_guard<std::mutex> lock{r.mutex_};
+    for (auto& buffer : r.buffers_) {
+      if (!buffer->in_use_.load(std::memory_order_acquire)) {
+        buffer->in_use_.store(true, std::memory_order_relaxed);
+        owner.buffer_ = buffer.get();
+        break;
+      }
+    }
+    if (!owner.buffer_) {
+      r.buffers_.push_back(std::make_shared<Buffer>(uint32_t(r.buffers_.size())));
+      owner.buffer_ = r.buffers_.back().get();
+    }
+  }
+  return *owner.buffer_;
+}
+
+// Stable copy of dynamic name (e.g. benchmark name)
+inline const char* intern(const std::string& name) {
+  auto& r = registry();
+  std::lock_guard<std::mutex> lock{r.mutex_};
+  auto it = std::find(r.names_.begin(), r.names_.end(), name);
+  if (it != r.names_.end()) { return it->c_str(); }
+  return r.names_.emplace_back(name).c_str();
+}
+
+struct Zone {
+  const char* name_;
+  uint64_t begin_ = 0;
+  bool active_;
+
+  explicit Zone(const char* name) : name_{name}, active_{enabled()} {
+    if (active_) { begin_ = now(); }
+  }
+
+  ~Zone() {
+    if (active_) { threadBuffer().push({name_, begin_, now(), 0, Kind::kZone}); }
+  }
+
+  Zone(const Zone&) = delete;
+  Zone& operator=(const Zone&) = delete;
+};
+
+inline void counter(const char* name, double value) {
+  if (!enabled()) { return; }
+  uint64_t t = now();
+  threadBuffer().push({name, t, t, value, Kind::kCounter});
+}
+
+// Number of events currently kept (all threads)
+inline size_t size() {
+  auto& r = registry();
+  std::lock_guard<std::mutex> lock{r.mutex_};
+  size_t result = 0;
+  for (auto& buffer : r.buffers_) {
+    result += std::min<uint64_t>(buffer->head_.load(std::memory_order_acquire), kCapacity);
+  }
+  return result;
+}
+
+inline void clear() {
+  auto& r = registry();
+  std::lock_guard<std::mutex> lock{r.mutex_};
+  for (auto& buffer : r.buffers_) { buffer->head_.store(0, std::memory_order_release); }
+}
+
+// Chrome trace JSON (timestamps in microseconds, one track per thread)
+inline std::string toJSON() {
+  auto& r = registry();
+  std::lock_guard<std::mutex> lock{r.mutex_};
+  std::string result = "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[";
+  // Events are formatted directly into `result` (no fixed size line, so long names aren't truncated)
+  auto appendf = [&](const char* format, auto... args) {
+    int length = std::snprintf(nullptr, 0, format, args...);
+    size_t offset = result.size();
+    result.resize(offset + length + 1);
+    std::snprintf(&result[offset], length + 1, format, args...);
+    result.resize(offset + length);
+  };
+  auto appendName = [&](const char* name) {
+    result += "{\"name\":\"";
+    for (auto c = name; *c; c++) {
+      if (*c == '"' || *c == '\\') { result += '\\'; }
+      result += (unsigned char)*c < 0x20 ? ' ' : *c;
+    }
+    result += '"';
+  };
+  bool first = true;
+  auto separate = [&]() {
+    if (!first) { result += ",\n"; }
+    first = false;
+  };
+  for (auto& buffer : r.buffers_) {
+    uint32_t tid = buffer->tid_;
+    separate();
+    appendf("{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":%u,\"args\":{\"name\":\"thread %u\"}}", tid, tid);
+    uint64_t head = buffer->head_.load(std::memory_order_acquire);
+    for (uint64_t i = head - std::min<uint64_t>(head, kCapacity); i < head; i++) {
+      auto& e = buffer->events_[i & (kCapacity - 1)];
+      separate();
+      appendName(e.name);
+      if (e.kind == Kind::kZone) {
+        appendf(",\"ph\":\"X\",\"ts\":%.3f,\"dur\":%.3f,\"pid\":1,\"tid\":%u}",
+                e.begin * 1e-3, (e.end - e.begin) * 1e-3, tid);
+      } else {
+        appendf(",\"ph\":\"C\",\"ts\":%.3f,\"pid\":1,\"tid\":%u,\"args\":{\"value\":%.9g}}",
+                e.begin * 1e-3, tid, e.value);
+      }
+    }
+  }
+  result += "]}\n";
+  return result;
+}
+
+// Returns false when file cannot be written
+inline bool write(const std::string& path) {
+  std::string json = toJSON();
+  FILE* file = std::fopen(path.c_str(), "wb");
+  if (!file) { return false; }
+  bool ok = std::fwrite(json.data(), 1, json.size(), file) == json.size();
+  return std::fclose(file) == 0 && ok;
+}
+
+} // namespace trace
+
+#if defined(USE_TRACE)
+#define TRACE_CONCAT_(a, b) a##b
+#define TRACE_CONCAT(a, b) TRACE_CONCAT_(a, b)
+#define TRACE_ZONE(name) ::trace::Zone TRACE_CONCAT(trace_zone_, __LINE__){name}
+#define TRACE_COUNTER(name, value) ::trace::counter(name, value)
+#else
+#define TRACE_ZONE(name)
+#define TRACE_COUNTER(name, value)
+#endif
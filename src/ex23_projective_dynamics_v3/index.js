@@ -178,7 +178,7 @@ AFRAME.registerComponent('physics', {
     // Use wasm code if available
     await wasm_ex05_promise
     if (wasm_ex05) {
-      this.solver.setupWasm(wasm_ex05)
+      this.solver.setupWasmV2(wasm_ex05)
     }
   },
 
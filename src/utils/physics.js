@@ -676,7 +676,7 @@ class Example02 {
     const F = Matrix.emptyLike(F_rest) // Temporary variable used in `svdProjection`
 
     _.assign(this, {
-      g, iterPD, dt, mass,
+      g, iterPD, dt, mass, strainStiffness,
       constraints, pCumsum, handles,
       Md_vec, AT_B_sparse, E_sparse, E_cholesky,
       xx, x, x0, vv, v, p, tmp1, tmp2, tmp3,
@@ -749,7 +749,49 @@ class Example02 {
     p.data.set(wasm.p, pSvdOffset)
   }
 
+  // Whole `update` runs in wasm (cf. ProjectiveDynamics in misc/wasm/ex05/projective_dynamics.hpp)
+  // Assume `Module` is from "misc/wasm/ex05/build/js/Release/em.js"
+  setupWasmV2 (Module) {
+    const { verts, c3xc0, handles, strainStiffness, nV, nC3 } = this
+    const { ProjectiveDynamics } = Module
+
+    const solver = new ProjectiveDynamics(nV, nC3, handles.length)
+    solver.verts().set(verts.data)
+    solver.c3xc0().set(c3xc0.data)
+    solver.handles().set(handles.map(h => h.vertex))
+    solver.handleTargets().set(_.flatten(handles.map(h => h.target)))
+    if (!solver.init(strainStiffness)) {
+      throw new Error('[Example02.setupWasmV2] Not positive definite')
+    }
+
+    this.wasmV2 = { solver }
+  }
+
+  updateWasmV2 () {
+    const { iterPD, handles, xx, x0, v } = this
+    const { solver } = this.wasmV2
+
+    // Copy handle targets (views are obtained each time since wasm memory can grow)
+    const targets = solver.handleTargets()
+    for (let i = 0; i < handles.length; i++) {
+      targets.set(handles[i].target, 3 * i)
+    }
+
+    solver.setIterPD(iterPD)
+    solver.update()
+
+    // Copy state back once per frame
+    xx.data.set(solver.verts())
+    x0.data.set(xx.data)
+    v.data.set(solver.velocities())
+  }
+
   update () {
+    if (this.wasmV2) {
+      this.updateWasmV2()
+      return
+    }
+
     const {
       g, iterPD, dt,
       constraints, pCumsum, handles,